@@ -0,0 +1,114 @@
+// Frame thread cost of the frame capture (frame_capture.h) at 1080p, on
+// the software renderer's present(), at 60 frames per second.
+//
+// partial: partial redraw, what the render thread does. A moving
+//          crosshair, a status band and a panel coming and going: only
+//          their damage is copied to the staging slot.
+// full:    every frame repainted, the whole image is copied (split over
+//          the Job_system's workers when there are any).
+//
+// The cost is what on_present() takes on the frame thread
+// (Capture_stats::copy_seconds, frame by frame). The target is under 1 ms
+// per frame at the 99th percentile with partial redraw; the full frame
+// numbers are printed for reference. The encoding runs on the capture
+// thread: its time per frame is printed too, with the file size.
+//
+//     bench_capture [path of the capture file]
+
+#include "renderer_software.h"
+#include "frame_capture.h"
+#include "damage_region.h"
+#include "draw_list.h"
+#include "frame_arena.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ****************************************************************************
+
+namespace {
+
+const int WIDTH = 1920;
+const int HEIGHT = 1080;
+const double BUDGET_MS = 1.0;
+
+/// @return 99th percentile of the frame thread cost, in milliseconds
+double run(Job_system& jobs, bool partial, int frames, const std::string& path)
+{
+    Renderer_software renderer;
+    renderer.set_job_system(&jobs);
+    renderer.init(nullptr, WIDTH, HEIGHT);
+    renderer.set_partial_redraw(partial);
+    Frame_capture capture;
+    if (!capture.open(path.c_str())) {
+        std::printf("can't create %s\n", path.c_str());
+        return 1e9;
+    }
+    renderer.set_capture(&capture);
+
+    Frame_arena arena;
+    Damage_tracker tracker;
+    std::vector<double> cost;
+    double copied = 0.0;
+    for (int f = 0; f < frames; ++f)
+    {
+        arena.begin_frame();
+        Draw_list list(arena.current(), 64);
+        const float x = float((f * 7) % WIDTH);
+        const float y = float((f * 3) % HEIGHT);
+        list.line(x - 12.0f, y, x + 12.0f, y, 1.0f, 0xC0FFFFFF);
+        list.line(x, y - 12.0f, x, y + 12.0f, 1.0f, 0xC0FFFFFF);
+        list.rect(x - 2.5f, y - 2.5f, 5.0f, 5.0f, 0xFFFFC040);
+        list.rect(6.0f, HEIGHT - 30.0f, 200.0f + float(f % 50), 22.0f, 0xA0000000);
+        if ((f / 90) % 2) {
+            list.rect(400.0f, 200.0f, 600.0f, 400.0f, 0xFF308050);
+        }
+        tracker.update(list, renderer.damage());
+        renderer.clear(0.1f, 0.2f, 0.3f);
+        renderer.submit(list);
+        renderer.present();
+
+        // Written by on_present(), on this thread
+        const double seconds = capture.stats().copy_seconds;
+        cost.push_back((seconds - copied) * 1000.0);
+        copied = seconds;
+        std::this_thread::sleep_for(std::chrono::microseconds(16667));
+    }
+    renderer.set_capture(nullptr);
+    capture.close();
+    std::remove(path.c_str());
+
+    const Capture_stats& stats = capture.stats();
+    std::sort(cost.begin(), cost.end());
+    const double p99 = cost[cost.size() * 99 / 100];
+    std::printf("%-8s on_present() p50 %.3f ms, p99 %.3f ms, max %.3f ms | %.2f%% of the pixels copied"
+                " | %llu captured, %llu dropped | encode %.2f ms per frame | %.2f MB\n",
+                partial ? "partial:" : "full:", cost[cost.size() / 2], p99, cost.back(),
+                100.0 * double(stats.copied_pixels) / double(stats.frame_pixels),
+                (unsigned long long)stats.captured, (unsigned long long)stats.dropped,
+                stats.captured ? stats.encode_seconds * 1000.0 / double(stats.captured) : 0.0,
+                double(stats.file_bytes) / (1024.0 * 1024.0));
+    return p99;
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main(int argc, char** argv)
+{
+    const std::string path = argc > 1 ? argv[1] : "bench_capture.wfc";
+    Job_system jobs;
+    const double partial_p99 = run(jobs, true, 300, path);
+    run(jobs, false, 120, path);
+
+    const bool ok = partial_p99 < BUDGET_MS;
+    std::printf("partial redraw p99 %.3f ms: %s the %.1f ms budget\n",
+                partial_p99, ok ? "within" : "OVER", BUDGET_MS);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// Frame cost of the software renderer at 1080p with 1%, 10% and 100% of
+// the window damaged (partial redraw, see renderer.h), on a scene of 576
+// tiles plus a moving crosshair and a status band.
+//
+// First checks that partial redraw driven by a Damage_tracker ends up with
+// the very same pixels as repainting everything every frame.
+//
+// Then, for each damage fraction, one rectangle of that area moves around
+// the window from frame to frame; 100% is a full redraw. Best of 3 runs.
+
+#include "renderer_software.h"
+#include "damage_region.h"
+#include "draw_list.h"
+#include "frame_arena.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int WIDTH = 1920;
+const int HEIGHT = 1080;
+const int FRAMES = 200;
+
+void scene(Draw_list& list, int frame)
+{
+    for (int y = 0; y < 18; ++y) {
+        for (int x = 0; x < 32; ++x) {
+            list.rect(x * 60 + 2.0f, y * 60 + 2.0f, 56.0f, 56.0f, 0xFF203040u + ((x * 7 + y * 13) & 0xFF));
+        }
+    }
+    list.set_layer(1);
+    const float cx = 200.0f + frame * 3.0f;
+    const float cy = 300.0f + frame * 2.0f;
+    list.line(cx - 12.0f, cy, cx + 12.0f, cy, 1.0f, 0xC0FFFFFF);
+    list.line(cx, cy - 12.0f, cx, cy + 12.0f, 1.0f, 0xC0FFFFFF);
+    list.rect(cx - 2.5f, cy - 2.5f, 5.0f, 5.0f, 0xC0FFFFFF);
+    list.rect(6.0f, 1040.0f, 300.0f, 30.0f, 0xA0000000);
+}
+
+double percent(const Render_stats& stats)
+{
+    return stats.frame_pixels ? 100.0 * double(stats.repaint_pixels) / double(stats.frame_pixels) : 0.0;
+}
+
+/// Partial and full redraw of the same 60 frames give the same image
+bool identical(Job_system& jobs, Frame_arena& arena)
+{
+    Renderer_software partial, full;
+    partial.set_job_system(&jobs);
+    full.set_job_system(&jobs);
+    partial.init(nullptr, WIDTH, HEIGHT);
+    full.init(nullptr, WIDTH, HEIGHT);
+    partial.set_partial_redraw(true);
+
+    Damage_tracker tracker;
+    for (int f = 0; f < 60; ++f)
+    {
+        arena.begin_frame();
+        Draw_list a(arena.current());
+        Draw_list b(arena.current());
+        scene(a, f);
+        scene(b, f);
+        tracker.update(a, partial.damage());
+        partial.clear(0.1f, 0.2f, 0.3f);
+        partial.submit(a);
+        partial.present();
+        full.clear(0.1f, 0.2f, 0.3f);
+        full.submit(b);
+        full.present();
+    }
+    const bool same = std::memcmp(partial.front_pixels(), full.front_pixels(),
+                                  std::size_t(WIDTH) * HEIGHT * sizeof(uint32_t)) == 0;
+    std::printf("partial redraw %s full redraw, %.2f%% of the pixels repainted\n",
+                same ? "identical to" : "DIFFERS from", percent(partial.stats()));
+    return same;
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    Job_system jobs;
+    Frame_arena arena;
+    const bool same = identical(jobs, arena);
+
+    const double fractions[] = { 0.01, 0.10, 1.0 };
+    for (double fraction : fractions)
+    {
+        Renderer_software renderer;
+        renderer.set_job_system(&jobs);
+        renderer.init(nullptr, WIDTH, HEIGHT);
+        renderer.set_partial_redraw(fraction < 1.0);
+        const int w = int(WIDTH * std::sqrt(fraction));
+        const int h = int(HEIGHT * std::sqrt(fraction));
+
+        double best_ms = 1e9;
+        for (int rep = 0; rep < 3; ++rep)
+        {
+            const Clock::time_point start = Clock::now();
+            for (int f = 0; f < FRAMES; ++f)
+            {
+                arena.begin_frame();
+                Draw_list list(arena.current());
+                scene(list, 0);
+                const int x = (f * 37) % (WIDTH - w + 1);
+                const int y = (f * 23) % (HEIGHT - h + 1);
+                renderer.damage().add(x, y, x + w, y + h);
+                renderer.clear(0.1f, 0.2f, 0.3f);
+                renderer.submit(list);
+                renderer.present();
+            }
+            best_ms = std::min(best_ms, std::chrono::duration<double, std::milli>(Clock::now() - start).count() / FRAMES);
+        }
+        std::printf("damage %5.1f%%: %7.3f ms per frame (%.1f%% of the pixels repainted)\n",
+                    fraction * 100.0, best_ms, percent(renderer.stats()));
+    }
+    return same ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+// Dispatch_table (message_dispatch.h) against a hand written switch, the
+// way event_handler() used to dispatch, on a realistic message mix: mostly
+// mouse moves, some keys, paints and timers, a few WM_USER and registered
+// messages, and messages without a handler (left to DefWindowProc()).
+//
+// Both sides call the same handlers. The switch is kept out of line so the
+// compiler can't fold it into the loop, like a window procedure called by
+// DispatchMessage().
+
+#include "message_dispatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const UINT WM_REGISTERED = 0xC001; ///< what RegisterWindowMessage() returns
+const UINT WM_NCHITTEST = 0x0084;
+const UINT WM_SETCURSOR = 0x0020;
+
+long g_hits = 0;
+
+bool on_command(const Message&, LRESULT& r) { g_hits++; r = 0; return true; }
+bool on_destroy(const Message&, LRESULT&)    { g_hits++; return false; }
+bool on_input(const Message& m, LRESULT&)    { g_hits += long(m.wParam & 1); return false; }
+bool on_paint(const Message&, LRESULT& r)    { g_hits++; r = 0; return true; }
+bool on_user(const Message&, LRESULT& r)     { g_hits++; r = 1; return true; }
+
+// Two subsystems, each with its own list
+constexpr Message_entry g_window_handlers[] = {
+    { WM_COMMAND, on_command },
+    { WM_DESTROY, on_destroy },
+    { WM_PAINT,   on_paint },
+    { WM_TIMER,   on_paint },
+};
+constexpr Message_entry g_input_handlers[] = {
+    { WM_MOUSEMOVE,     on_input },
+    { WM_KEYDOWN,       on_input },
+    { WM_KEYUP,         on_input },
+    { WM_CHAR,          on_input },
+    { WM_LBUTTONDOWN,   on_input },
+    { WM_USER + 1,      on_user },
+    { WM_USER + 5,      on_user },
+    { WM_REGISTERED,    on_user },
+};
+constexpr auto g_table = make_dispatch_table<0x240>(g_window_handlers, g_input_handlers);
+static_assert(g_table.valid(), "a message has two handlers");
+
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+bool dispatch_switch(const Message& m, LRESULT& r)
+{
+    switch (m.message)
+    {
+    case WM_COMMAND:     return on_command(m, r);
+    case WM_DESTROY:     return on_destroy(m, r);
+    case WM_PAINT:
+    case WM_TIMER:       return on_paint(m, r);
+    case WM_MOUSEMOVE:
+    case WM_KEYDOWN:
+    case WM_KEYUP:
+    case WM_CHAR:
+    case WM_LBUTTONDOWN: return on_input(m, r);
+    case WM_USER + 1:
+    case WM_USER + 5:
+    case WM_REGISTERED:  return on_user(m, r);
+    }
+    return false;
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    // Weighted mix: 4 mouse moves for every other message
+    const UINT common[] = {
+        WM_MOUSEMOVE, WM_MOUSEMOVE, WM_MOUSEMOVE, WM_MOUSEMOVE, WM_KEYDOWN, WM_KEYUP, WM_CHAR,
+        WM_PAINT, WM_TIMER, WM_LBUTTONDOWN, WM_NCHITTEST, WM_SETCURSOR, WM_USER + 1, WM_REGISTERED
+    };
+    const std::size_t COUNT = std::size_t(1) << 20;
+    std::vector<Message> mix(COUNT);
+    std::mt19937 rng(1);
+    for (Message& m : mix) {
+        m = Message();
+        m.message = common[rng() % (sizeof(common) / sizeof(common[0]))];
+        m.wParam = rng();
+    }
+
+    // Same results both ways
+    long handled_table = 0, handled_switch = 0;
+    LRESULT r = 0;
+    for (const Message& m : mix) {
+        handled_table += g_table.dispatch(m.message, m, r);
+        handled_switch += dispatch_switch(m, r);
+    }
+
+    double best_table = 1e9, best_switch = 1e9;
+    for (int rep = 0; rep < 5; ++rep)
+    {
+        Clock::time_point start = Clock::now();
+        for (const Message& m : mix) {
+            g_table.dispatch(m.message, m, r);
+        }
+        best_table = std::min(best_table, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+
+        start = Clock::now();
+        for (const Message& m : mix) {
+            dispatch_switch(m, r);
+        }
+        best_switch = std::min(best_switch, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    std::printf("table  %.2f ns per message\nswitch %.2f ns per message\nhandled %ld / %ld (checksum %ld)\n",
+                best_table / double(COUNT), best_switch / double(COUNT),
+                handled_table, handled_switch, g_hits);
+    return handled_table == handled_switch ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+// Input_state (input_state.h) against polling the keyboard every iteration.
+//
+// The old loop called GetAsyncKeyState(VK_ESCAPE) on every pass: a system
+// call per spin for a single key. Input_state is filled by event_handler()
+// from the messages and read with plain bit tests. Off Windows there is no
+// GetAsyncKeyState(): a raw getpid system call stands in for it, which is
+// a lower bound of its cost (no keyboard state lookup).
+
+#include "input_state.h"
+#include "backend_headless.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double ns_since(Clock::time_point start, std::size_t count)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / double(count);
+}
+
+bool poll_escape()
+{
+#ifdef _WIN32
+    return (GetAsyncKeyState(VK_ESCAPE) & 0x8000) != 0;
+#else
+    return syscall(SYS_getpid) == 0;
+#endif
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    const std::size_t FRAMES = 1000000;
+    const std::size_t MESSAGES_PER_FRAME = 4;
+    const std::vector<MSG> stream = make_synthetic_stream(FRAMES * MESSAGES_PER_FRAME);
+    const unsigned keys[8] = { VK_ESCAPE, ' ', 'E', 'Q', 'W', 'A', 'S', 'D' };
+
+    // Polling: one system call per key read
+    unsigned hits = 0;
+    Clock::time_point start = Clock::now();
+    for (std::size_t f = 0; f < FRAMES; ++f) {
+        hits += poll_escape();
+    }
+    const double poll_ns = ns_since(start, FRAMES);
+
+    // Snapshot: the messages of the frame, 8 keys and a button read, then
+    // the end of frame
+    Input_state state;
+    input_reset(state);
+    start = Clock::now();
+    for (std::size_t f = 0; f < FRAMES; ++f)
+    {
+        const MSG* msg = &stream[f * MESSAGES_PER_FRAME];
+        for (std::size_t m = 0; m < MESSAGES_PER_FRAME; ++m) {
+            input_on_message(state, msg[m].message, msg[m].wParam, msg[m].lParam);
+        }
+        for (unsigned k : keys) {
+            hits += key_pressed(state, k) + key_down(state, k);
+        }
+        hits += button_pressed(state, MOUSE_LEFT);
+        input_end_frame(state);
+    }
+    const double snapshot_ns = ns_since(start, FRAMES);
+
+    std::printf("polling:  %.1f ns per frame for 1 key (one system call)\n", poll_ns);
+    std::printf("snapshot: %.1f ns per frame for %zu messages + 8 keys + 1 button (%u)\n",
+                snapshot_ns, MESSAGES_PER_FRAME, hits);
+    return 0;
+}
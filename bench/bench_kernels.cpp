@@ -0,0 +1,138 @@
+// Span kernels (simd_kernels.h) at each level, scalar against SSE2 against
+// AVX2, at 1080p and 4K: first the raw kernels on one thread over a whole
+// image, then through the tiled Framebuffer split over a Job_system.
+//
+// Throughput is the memory traffic of the kernel: fill writes 4 bytes per
+// pixel, blend reads 8 and writes 4, swap_red_blue reads 4 and writes 4.
+// Levels the CPU doesn't support are clamped (see set_kernel_level()) and
+// reported under the level actually used.
+//
+// Then short spans (1 to 31 pixels, the edge of a tile, a glyph row), where
+// the AVX2 kernels run their SSE2 / scalar tail on almost every call. An
+// AVX2 level much slower than SSE2 there is the AVX / SSE transition
+// penalty: the upper halves of the ymm registers weren't cleared
+// (vzeroupper) before the tail.
+
+#include "simd_kernels.h"
+#include "framebuffer.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/// Best of 'reps' runs of 'fn', in seconds
+template <typename Fn>
+double best_of(int reps, const Fn& fn)
+{
+    double best = 1e9;
+    for (int r = 0; r < reps; ++r) {
+        const Clock::time_point start = Clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+void random_pixels(std::vector<uint32_t>& pixels, unsigned seed)
+{
+    for (uint32_t& p : pixels) {
+        seed = seed * 1103515245u + 12345u;
+        p = seed;
+    }
+}
+
+/// Every level must give the same result, odd counts included
+bool levels_agree()
+{
+    std::vector<uint32_t> src(1001), dst(1001);
+    random_pixels(src, 1);
+    random_pixels(dst, 2);
+    std::vector<uint32_t> blend[3], swap[3];
+    for (int level = 0; level < 3; ++level) {
+        set_kernel_level(Kernel_level(level));
+        blend[level] = dst;
+        span_kernels().blend(blend[level].data(), src.data(), 999);
+        swap[level].resize(src.size());
+        span_kernels().swap_red_blue(swap[level].data(), src.data(), 999);
+    }
+    return blend[0] == blend[1] && blend[0] == blend[2] &&
+           swap[0] == swap[1] && swap[0] == swap[2];
+}
+
+void run(int width, int height, Job_system& jobs)
+{
+    const std::size_t count = std::size_t(width) * std::size_t(height);
+    const double gb = double(count) * 4.0 / 1e9; // per pass over the image
+    std::vector<uint32_t> src(count), dst(count);
+    random_pixels(src, 3);
+    random_pixels(dst, 4);
+    Framebuffer fb(&jobs);
+    fb.resize(width, height);
+
+    std::printf("%dx%d\n", width, height);
+    for (int level = 0; level < 3; ++level)
+    {
+        const Kernel_level used = set_kernel_level(Kernel_level(level));
+        const Span_kernels& k = span_kernels();
+        const double fill = best_of(10, [&]() { k.fill(dst.data(), count, 0xFF112233u); });
+        const double blend = best_of(10, [&]() { k.blend(dst.data(), src.data(), count); });
+        const double swap = best_of(10, [&]() { k.swap_red_blue(dst.data(), src.data(), count); });
+        const double clear = best_of(10, [&]() { fb.clear(0xFF445566u); });
+        const double blit = best_of(10, [&]() { fb.blit_alpha(src.data(), width, height, width, 0, 0); });
+        std::printf("  %-6s fill %5.1f GB/s  blend %5.1f GB/s  swap %5.1f GB/s | framebuffer clear %.3f ms  blit %.3f ms\n",
+                    to_string(used), gb / fill, 3.0 * gb / blend, 2.0 * gb / swap,
+                    clear * 1e3, blit * 1e3);
+    }
+}
+
+/// Nanoseconds per span of 1 to 31 pixels, at each level
+void short_spans()
+{
+    const std::size_t SPANS = 1 << 20;
+    std::vector<uint32_t> src(32), dst(32);
+    random_pixels(src, 5);
+    std::printf("short spans (1 to 31 pixels)\n");
+    for (int level = 0; level < 3; ++level)
+    {
+        const Kernel_level used = set_kernel_level(Kernel_level(level));
+        const Span_kernels& k = span_kernels();
+        const double fill = best_of(5, [&]() {
+            for (std::size_t i = 0; i < SPANS; ++i) {
+                k.fill(dst.data(), 1 + (i & 31) % 31, uint32_t(i));
+            }
+        });
+        const double blend = best_of(5, [&]() {
+            for (std::size_t i = 0; i < SPANS; ++i) {
+                k.blend(dst.data(), src.data(), 1 + (i & 31) % 31);
+            }
+        });
+        std::printf("  %-6s fill %5.1f ns  blend %5.1f ns per span\n",
+                    to_string(used), fill * 1e9 / double(SPANS), blend * 1e9 / double(SPANS));
+    }
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    const bool agree = levels_agree();
+    std::printf("best level: %s, levels agree: %s\n",
+                to_string(best_kernel_level()), agree ? "yes" : "NO");
+    Job_system jobs;
+    std::printf("job system: %u threads\n", jobs.concurrency());
+    run(1920, 1080, jobs);
+    run(3840, 2160, jobs);
+    short_spans();
+    set_kernel_level(best_kernel_level());
+    return agree ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+// Input latency of the render thread against a simulated 60 Hz display
+// (vblank_clock.h), Present_mode::QUEUED against WAITABLE with a maximum
+// frame latency of 1.
+//
+// A mouse move is posted every millisecond for a few seconds, time stamped
+// like MSG::time. The render thread runs uncapped: the display paces it,
+// through present() (QUEUED: up to 3 frames wait for their vertical blank)
+// or wait_for_frame() (WAITABLE: the input is read after the wait, "late
+// latch"). Window_state::latency pairs each input with the frame it was
+// presented in: p50 / p99 from input to present() and to the vertical
+// blank that shows it.
+
+#include "render_thread.h"
+#include "renderer_software.h"
+#include "backend_headless.h"
+#include "vblank_clock.h"
+#include "window_manager.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int SECONDS = 3;
+
+void run(Present_mode mode, const char* name)
+{
+    Window_manager windows(true);
+    Window_state* window = windows.create_headless(640, 480);
+    Vblank_clock display(60.0);
+    Renderer_software* renderer = (Renderer_software*)window->renderer.get();
+    renderer->set_present_mode(mode, 1);
+    renderer->set_vblank_clock(&display);
+
+    // Only its clock is used: the MSG::time of the posted messages
+    Backend_headless backend([](HWND, UINT, WPARAM, LPARAM) -> LRESULT { return 0; });
+    Render_thread render(windows, Frame_pacer(Pacing::UNCAPPED));
+    render.set_input_clock(&backend);
+    render.start();
+
+    const Clock::time_point end = Clock::now() + std::chrono::seconds(SECONDS);
+    for (int i = 0; Clock::now() < end; ++i) {
+        render.post(*window, WM_MOUSEMOVE, 0, MAKELPARAM(i % 600, i % 400), backend.now_ms());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    render.stop();
+
+    const Latency_stats stats = window->latency.stats();
+    const Render_stats& rs = renderer->stats();
+    std::printf("%-9s %4llu frames, %5llu inputs | input to present p50 %5.1f p99 %5.1f max %5.1f ms"
+                " | input to display p50 %5.1f p99 %5.1f ms | wait_for_frame() %.2f s, present() %.2f s\n",
+                name, (unsigned long long)stats.frames, (unsigned long long)stats.inputs,
+                stats.present_p50_ms, stats.present_p99_ms, stats.present_max_ms,
+                stats.display_p50_ms, stats.display_p99_ms, rs.wait_seconds, rs.present_seconds);
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    run(Present_mode::QUEUED, "queued:");
+    run(Present_mode::WAITABLE, "waitable:");
+    return 0;
+}
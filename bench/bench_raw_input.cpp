@@ -0,0 +1,132 @@
+// Cost per raw mouse sample through Mouse_history (raw_input.h), replaying
+// the synthetic reports of an 8000 Hz mouse (make_synthetic_raw_mouse()):
+//
+// - single thread: push() every report, collect() every 133 of them (one
+//   60 Hz frame at 8 kHz). Checks every sample arrives and the motion adds
+//   up to what was pushed.
+// - two threads: the "UI thread" pushes bursts of 40 reports every 5 ms
+//   (what one GetRawInputBuffer() call returns), the "render thread"
+//   collects at 60 Hz. Checks nothing is dropped and the order is kept.
+// - stall: the render thread doesn't collect for a second, the ring keeps
+//   the oldest CAPACITY samples and counts the rest as dropped.
+
+#include "raw_input.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const std::size_t RATE = 8000;          ///< reports per second
+const std::size_t SAMPLES = RATE * 10;  ///< 10 s of input
+const std::size_t PER_FRAME = RATE / 60;
+const std::size_t BURST = 40;           ///< 5 ms at 8 kHz
+const std::size_t BURSTS = 200;         ///< 1 s
+
+bool single_thread(const std::vector<Raw_mouse>& reports)
+{
+    Mouse_history history;
+    const int64_t start_us = raw_input_now_us();
+    std::size_t seen = 0;
+    int64_t dx = 0, dy = 0;
+    auto frame = [&]() {
+        seen += history.collect();
+        dx += history.frame_dx();
+        dy += history.frame_dy();
+    };
+
+    const Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < reports.size(); ++i) {
+        history.push(reports[i], start_us + int64_t(i) * 1000000 / int64_t(RATE));
+        if (i % PER_FRAME == PER_FRAME - 1) {
+            frame();
+        }
+    }
+    frame();
+    const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+    int64_t expected_dx = 0, expected_dy = 0;
+    for (const Raw_mouse& r : reports) {
+        expected_dx += r.last_x;
+        expected_dy += r.last_y;
+    }
+    const Mouse_history_stats stats = history.stats();
+    std::printf("single thread: %6.2f ns per sample (push + collect), at most %zu per frame, %llu dropped\n",
+                ns / double(reports.size()), stats.max_per_frame, (unsigned long long)stats.dropped);
+    return seen == reports.size() && dx == expected_dx && dy == expected_dy;
+}
+
+bool two_threads(const std::vector<Raw_mouse>& reports)
+{
+    Mouse_history history;
+    std::atomic<bool> done{false};
+    std::size_t seen = 0;
+    int64_t last_us = 0;
+    bool ordered = true;
+    auto collect = [&]() {
+        history.collect();
+        for (const Mouse_sample& s : history.frame()) {
+            ordered = ordered && s.time_us >= last_us;
+            last_us = s.time_us;
+        }
+        seen += history.frame().size();
+    };
+
+    std::thread render([&]() {
+        while (!done.load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(16667));
+            collect();
+        }
+    });
+    std::size_t pushed = 0;
+    for (std::size_t b = 0; b < BURSTS; ++b) {
+        // A batch read shares one time stamp
+        const int64_t now_us = raw_input_now_us();
+        for (std::size_t k = 0; k < BURST; ++k, ++pushed) {
+            history.push(reports[pushed], now_us);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    done.store(true, std::memory_order_release);
+    render.join();
+    collect();
+
+    const Mouse_history_stats stats = history.stats();
+    std::printf("two threads:   %zu pushed, %zu collected in %llu frames, at most %zu per frame, %llu dropped\n",
+                pushed, seen, (unsigned long long)stats.frames, stats.max_per_frame,
+                (unsigned long long)stats.dropped);
+    return seen == pushed && stats.dropped == 0 && ordered;
+}
+
+bool stall(const std::vector<Raw_mouse>& reports)
+{
+    Mouse_history history;
+    for (std::size_t i = 0; i < RATE; ++i) {
+        history.push(reports[i], 0);
+    }
+    history.collect();
+    const Mouse_history_stats stats = history.stats();
+    std::printf("stall of 1 s:  %zu kept, %llu dropped\n",
+                history.frame().size(), (unsigned long long)stats.dropped);
+    return history.frame().size() + stats.dropped == RATE;
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    const std::vector<Raw_mouse> reports = make_synthetic_raw_mouse(SAMPLES, 1);
+    bool ok = single_thread(reports);
+    ok = two_threads(reports) && ok;
+    ok = stall(reports) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+// A 1000 event resize drag replayed through Backend_headless, against the
+// software renderer.
+//
+// naive:   Renderer::resize() on every WM_SIZE, what handling WM_SIZE
+//          directly in event_handler() would do
+// managed: Resize_manager (resize_manager.h) applies the last size once per
+//          frame and grows the buffers with slack during the drag
+//
+// The drag grows the window by a pixel per event (half a pixel vertically)
+// from 800x600, with a frame after every 4 events like a 60 Hz loop fed by
+// a 240 Hz mouse.
+
+#include "resize_manager.h"
+#include "renderer.h"
+#include "event_loop.h"
+#include "backend_headless.h"
+#include "job_system.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int EVENTS = 1000;
+const int EVENTS_PER_FRAME = 4;
+
+std::vector<MSG> make_drag()
+{
+    std::vector<MSG> drag;
+    MSG msg = {};
+    msg.message = WM_ENTERSIZEMOVE;
+    drag.push_back(msg);
+    for (int i = 0; i < EVENTS; ++i) {
+        msg.message = WM_SIZE;
+        msg.lParam = MAKELPARAM(800 + i, 600 + i / 2);
+        drag.push_back(msg);
+    }
+    msg.message = WM_EXITSIZEMOVE;
+    msg.lParam = 0;
+    drag.push_back(msg);
+    return drag;
+}
+
+void run(bool managed)
+{
+    // The tiles are cleared by the workers, as on the render thread
+    Job_system jobs;
+    std::unique_ptr<Renderer> renderer = create_renderer(Renderer_type::SOFTWARE);
+    renderer->set_job_system(&jobs);
+    renderer->init(nullptr, 800, 600);
+    renderer->reset_stats();
+    Resize_manager manager;
+
+    int since_frame = 0;
+    Backend_headless backend([&](HWND, UINT msg, WPARAM w, LPARAM l) -> LRESULT {
+        if (managed) {
+            manager.on_message(msg, w, l);
+        } else if (msg == WM_SIZE) {
+            renderer->resize(LOWORD(l), HIWORD(l));
+        }
+        since_frame++;
+        return 0;
+    });
+    backend.post(make_drag());
+
+    // One message per iteration, a frame drawn every EVENTS_PER_FRAME
+    Event_loop loop(backend);
+    double frame_seconds = 0.0;
+    int frames = 0;
+    loop.set_frame_callback([&]() {
+        if (since_frame < EVENTS_PER_FRAME && backend.pending() > 0) {
+            return true;
+        }
+        since_frame = 0;
+        const Clock::time_point start = Clock::now();
+        if (managed) {
+            manager.end_frame(*renderer);
+        }
+        renderer->clear(0.1f, 0.2f, 0.3f);
+        renderer->present();
+        frame_seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        frames++;
+        return true;
+    });
+    loop.run();
+
+    const Render_stats& rs = renderer->stats();
+    std::printf("%-8s %d WM_SIZE, %llu reallocations, %llu size changes, resize %.2f ms, frames %d (%.3f ms each), final %dx%d in a %dx%d buffer\n",
+                managed ? "managed:" : "naive:", EVENTS,
+                (unsigned long long)rs.resizes, (unsigned long long)rs.size_changes,
+                rs.resize_seconds * 1e3, frames, frames ? frame_seconds * 1e3 / frames : 0.0,
+                renderer->width(), renderer->height(),
+                renderer->buffer_width(), renderer->buffer_height());
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    run(false);
+    run(true);
+    return 0;
+}
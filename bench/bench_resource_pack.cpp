@@ -0,0 +1,108 @@
+// String lookups from the memory mapped resources.pack (resource_pack.h)
+// against LoadStringW() into a fixed MAX_LOADSTRING buffer, the way
+// win_main.cpp loaded the title and the window class.
+//
+// On Windows LoadStringW() reads the string table linked into this
+// program (main_win_rsc.rc, see CMakeLists.txt). Elsewhere there is no
+// resource loader: the stand-in copies the UTF-16 string from the pack
+// into the fixed buffer, truncated like LoadStringW() does. It leaves out
+// FindResource() / LoadResource(), so it underestimates the real cost.
+//
+//     bench_resource_pack [path of resources.pack]
+
+#include "resource_pack.h"
+#include "resource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int MAX_LOADSTRING = 100;
+const int LOOKUPS = 1000000;
+
+#ifdef _WIN32
+int load_string(const Resource_pack&, UINT id, WCHAR* buffer)
+{
+    return LoadStringW(GetModuleHandleW(NULL), id, buffer, MAX_LOADSTRING);
+}
+#else
+int load_string(const Resource_pack& pack, UINT id, char16_t* buffer)
+{
+    std::size_t length = 0;
+    const char16_t* s = pack.string_utf16(id, &length);
+    if (!s) {
+        return 0;
+    }
+    length = std::min<std::size_t>(length, MAX_LOADSTRING - 1);
+    std::copy(s, s + length, buffer);
+    buffer[length] = 0;
+    return int(length);
+}
+#endif
+
+double ns_per_lookup(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / LOOKUPS;
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "resources.pack";
+    Resource_pack pack;
+    if (!pack.open(path)) {
+        std::printf("can't open %s (built by tools/make_resource_pack.py)\n", path);
+        return 1;
+    }
+    const std::string_view title = pack.string(IDS_APP_TITLE);
+    std::size_t accelerators = 0;
+    pack.accelerators(IDC_MAINWIN, &accelerators);
+    std::printf("%zu entries, title '%.*s', %zu accelerators\n", pack.entry_count(),
+                int(title.size()), title.data(), accelerators);
+
+    const UINT ids[2] = { IDS_APP_TITLE, IDC_MAINWIN };
+    std::size_t sum = 0;
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < LOOKUPS; ++i) {
+        sum += pack.string(ids[i & 1]).size();
+    }
+    const double view_ns = ns_per_lookup(start);
+
+    start = Clock::now();
+    for (int i = 0; i < LOOKUPS; ++i) {
+        std::size_t length = 0;
+        sum += pack.string_utf16(ids[i & 1], &length) ? length : 0;
+    }
+    const double utf16_ns = ns_per_lookup(start);
+
+#ifdef _WIN32
+    WCHAR buffer[MAX_LOADSTRING];
+#else
+    char16_t buffer[MAX_LOADSTRING];
+#endif
+    start = Clock::now();
+    for (int i = 0; i < LOOKUPS; ++i) {
+        sum += load_string(pack, ids[i & 1], buffer);
+    }
+    const double load_ns = ns_per_lookup(start);
+
+    std::printf("pack string (UTF-8 view)    %6.1f ns\n", view_ns);
+    std::printf("pack string_utf16 (view)    %6.1f ns\n", utf16_ns);
+#ifdef _WIN32
+    std::printf("LoadStringW (copy)          %6.1f ns\n", load_ns);
+#else
+    std::printf("copy to a fixed buffer      %6.1f ns (LoadStringW stand-in)\n", load_ns);
+#endif
+    std::printf("(%zu)\n", sum);
+    return 0;
+}
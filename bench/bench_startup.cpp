@@ -0,0 +1,177 @@
+// Cold and warm startup, from process start to the first presented frame,
+// with the resources loaded up front (the old wWinMain) or deferred
+// through a Resource_cache (resource_cache.h).
+//
+// Every measurement is a fresh process (this program run with -child) that
+// goes through the headless equivalent of wWinMain(): resources, a window,
+// the render thread, then waits for its first frame. The resources are
+// files made by the parent: two small ones (icons, accelerators) and a
+// 64 MB one standing for the textures and shaders to come. A loader maps
+// its file and touches every page.
+//
+// cold: the files are evicted from the page cache before the run (Linux
+//       only, posix_fadvise(): elsewhere cold and warm are the same)
+// warm: the same run again, the files are in the page cache
+//
+// Phases are printed by startup_report() (startup_timer.h).
+
+#include "resource_cache.h"
+#include "startup_timer.h"
+#include "mapped_file.h"
+#include "render_thread.h"
+#include "window_manager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// ****************************************************************************
+
+namespace {
+
+const char* const FILES[] = { "icon.res", "accelerators.res", "textures.res" };
+const std::size_t SIZES[] = { 64 << 10, 4 << 10, 64 << 20 };
+const int FILE_COUNT = 3;
+
+std::string file_path(const std::string& dir, int i)
+{
+    return dir + "/" + FILES[i];
+}
+
+/// Map the file and touch every page, what decoding it would cost at least
+void* load(const std::string& path)
+{
+    Mapped_file file;
+    if (!file.open(path.c_str())) {
+        return nullptr;
+    }
+    volatile uint8_t sum = 0;
+    for (std::size_t i = 0; i < file.size(); i += 4096) {
+        sum = sum ^ file.data()[i];
+    }
+    return (void*)(uintptr_t)(file.size() | 1);
+}
+
+void evict(const std::string& path)
+{
+#if defined(__linux__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd); // dirty pages aren't evicted
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#else
+    (void)path;
+#endif
+}
+
+void print(const char* text, void*)
+{
+    std::fputs(text, stdout);
+}
+
+/// One startup, what the child process does
+int child(const std::string& dir, bool deferred)
+{
+    startup_mark("main");
+    Resource_cache resources;
+    for (int i = 0; i < FILE_COUNT; ++i) {
+        const std::string path = file_path(dir, i);
+        resources.add(Resource_cache::Id(i), [path]() { return load(path); },
+                      deferred ? Load_policy::BACKGROUND : Load_policy::LAZY);
+    }
+    if (!deferred) {
+        // Old wWinMain(): everything loaded before the window exists
+        for (int i = 0; i < FILE_COUNT; ++i) {
+            resources.get(Resource_cache::Id(i));
+        }
+        startup_mark("resources loaded");
+    }
+
+    Window_manager windows(true);
+    windows.create_headless(1280, 720);
+    startup_mark("window created");
+    Render_thread render(windows, Frame_pacer(Pacing::FIXED_HZ, 60));
+    render.start();
+    if (deferred) {
+        resources.start_background([]() { startup_mark("background resources"); });
+    }
+    while (render.latest().frame < 1) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    const double first_frame_ms = startup_elapsed_ms();
+    while (!resources.background_done() && deferred) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    render.stop();
+    startup_report(print, nullptr);
+    std::printf("first frame after %.2f ms, everything loaded after %.2f ms\n",
+                first_frame_ms, startup_elapsed_ms());
+    return 0;
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main(int argc, char** argv)
+{
+    if (argc == 4 && std::strcmp(argv[1], "-child") == 0) {
+        return child(argv[2], std::strcmp(argv[3], "deferred") == 0);
+    }
+
+    const std::string dir = argc > 1 ? argv[1] : ".";
+    std::vector<char> zeros(1 << 20);
+    for (int i = 0; i < FILE_COUNT; ++i)
+    {
+        FILE* f = std::fopen(file_path(dir, i).c_str(), "wb");
+        if (!f) {
+            std::printf("can't write to %s\n", dir.c_str());
+            return 1;
+        }
+        for (std::size_t left = SIZES[i]; left > 0; ) {
+            // Not zeros, some file systems store those sparse
+            const std::size_t n = std::min(left, zeros.size());
+            for (std::size_t k = 0; k < n; k += 4096) {
+                zeros[k] = char(left + k);
+            }
+            std::fwrite(zeros.data(), 1, n, f);
+            left -= n;
+        }
+        std::fclose(f);
+    }
+
+    const char* modes[] = { "eager", "deferred" };
+    for (const char* mode : modes)
+    {
+        for (int warm = 0; warm < 2; ++warm)
+        {
+            if (!warm) {
+                for (int i = 0; i < FILE_COUNT; ++i) {
+                    evict(file_path(dir, i));
+                }
+            }
+            std::printf("---- %s, %s\n", mode, warm ? "warm" : "cold");
+            std::fflush(stdout);
+            const std::string command = "\"" + std::string(argv[0]) + "\" -child \"" + dir + "\" " + mode;
+            if (std::system(command.c_str()) != 0) {
+                return 1;
+            }
+        }
+    }
+    for (int i = 0; i < FILE_COUNT; ++i) {
+        std::remove(file_path(dir, i).c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Throughput and worst frame stall while streaming 1 GB of assets through
+// the Asset_streamer (asset_streamer.h).
+//
+// 128 files of 8 MB are written to the directory given on the command line
+// (default: the temporary directory) and evicted from the page cache
+// (Linux only, posix_fadvise()) so they are read from the disk, then all
+// requested at once, plus a few requests cancelled right away and a missing
+// file. They are removed however the program exits. Each asset is
+// "decoded" by a worker (a copy XORed with a key) and uploaded by the frame
+// loop into an 8 MB "texture", at most Upload_budget per frame. The frame
+// loop stands for the render thread: pump(), then 1 ms of other work.
+//
+// The stall is what pump() adds to a frame: it must stay around the budget
+// (2 ms) however much is streamed. With fewer cores than busy threads
+// (reader, decoders, frame loop) the worst case also counts the time the
+// frame loop was preempted in the middle of a pump().
+//
+//     bench_streaming [directory] [decode threads]
+
+#include "asset_streamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int FILES = 128;    ///< 1 GB
+const int CANCELLED = 8;   ///< more files, cancelled right away
+const std::size_t FILE_SIZE = std::size_t(8) << 20;
+
+double ms_between(Clock::time_point a, Clock::time_point b)
+{
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+std::string file_path(const std::string& dir, int i)
+{
+    return dir + "/stream_" + std::to_string(i) + ".bin";
+}
+
+void evict(const std::string& path)
+{
+#if defined(__linux__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd); // dirty pages aren't evicted
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#else
+    (void)path;
+#endif
+}
+
+/// Removes the files on every way out of main()
+struct Stream_files {
+    std::string dir;
+    ~Stream_files() {
+        for (int i = 0; i < FILES + CANCELLED; ++i) {
+            std::remove(file_path(dir, i).c_str());
+        }
+    }
+};
+
+bool decode(const uint8_t* file, std::size_t size, std::vector<uint8_t>& out)
+{
+    out.resize(size);
+    const uint64_t key = 0x9E3779B97F4A7C15ull;
+    for (std::size_t i = 0; i + 8 <= size; i += 8) {
+        uint64_t v;
+        std::memcpy(&v, file + i, 8);
+        v ^= key;
+        std::memcpy(out.data() + i, &v, 8);
+    }
+    return true;
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main(int argc, char** argv)
+{
+    std::error_code error;
+    const std::string dir = argc > 1 ? argv[1] : std::filesystem::temp_directory_path(error).string();
+    const int decode_threads = argc > 2 ? std::atoi(argv[2]) : -1;
+
+    const Stream_files files = { dir };
+    std::vector<uint8_t> bytes(FILE_SIZE);
+    for (int i = 0; i < FILES + CANCELLED; ++i)
+    {
+        FILE* f = std::fopen(file_path(dir, i).c_str(), "wb");
+        if (!f) {
+            std::printf("can't write to %s\n", dir.c_str());
+            return 1;
+        }
+        for (std::size_t k = 0; k < FILE_SIZE; k += 4096) {
+            bytes[k] = uint8_t(i + k);
+        }
+        std::fwrite(bytes.data(), 1, bytes.size(), f);
+        std::fclose(f);
+        evict(file_path(dir, i));
+    }
+
+    std::vector<uint8_t> texture(FILE_SIZE);
+    int completed = 0, failed = 0;
+    auto upload = [&](const Stream_asset& asset, std::size_t offset, std::size_t size) {
+        std::memcpy(texture.data() + offset, asset.data + offset, size);
+    };
+    auto done = [&](Stream_id, bool ok) {
+        (ok ? completed : failed)++;
+    };
+
+    Asset_streamer streamer(std::size_t(256) << 20, decode_threads);
+    const Clock::time_point start = Clock::now();
+    std::vector<Stream_id> ids;
+    for (int i = 0; i < FILES + CANCELLED; ++i) {
+        ids.push_back(streamer.request(file_path(dir, i).c_str(), Stream_priority::NORMAL, upload, done, decode));
+    }
+    streamer.request((dir + "/missing.bin").c_str(), Stream_priority::NORMAL, upload, done, decode);
+    for (int i = FILES; i < FILES + CANCELLED; ++i) {
+        streamer.cancel(ids[i]);
+    }
+
+    const Upload_budget budget;
+    std::vector<double> pumps;
+    double worst_frame = 0.0;
+    while (streamer.outstanding() > 0)
+    {
+        const Clock::time_point frame = Clock::now();
+        streamer.pump(budget);
+        pumps.push_back(ms_between(frame, Clock::now()));
+        // The rest of the frame
+        while (ms_between(frame, Clock::now()) < 1.0) {
+        }
+        worst_frame = std::max(worst_frame, ms_between(frame, Clock::now()));
+    }
+    const double seconds = ms_between(start, Clock::now()) / 1000.0;
+
+    const Stream_stats stats = streamer.stats();
+    std::sort(pumps.begin(), pumps.end());
+    std::printf("%.0f MB uploaded in %.2f s (%.2f GB/s) over %zu frames, read %.2f s, decode %.2f s\n",
+                double(stats.bytes_uploaded) / (1024.0 * 1024.0), seconds,
+                double(stats.bytes_uploaded) / seconds / 1e9, pumps.size(),
+                stats.read_seconds, stats.decode_seconds);
+    std::printf("pump() p50 %.3f ms, p99 %.3f ms, worst %.3f ms (budget %zu MB / %.1f ms), worst frame %.3f ms\n",
+                pumps[pumps.size() / 2], pumps[pumps.size() * 99 / 100], pumps.back(),
+                budget.bytes >> 20, budget.milliseconds, worst_frame);
+    std::printf("%d completed, %d failed, %llu cancelled\n",
+                completed, failed, (unsigned long long)stats.cancelled);
+    return completed == FILES && failed == 1 ? 0 : 1;
+}
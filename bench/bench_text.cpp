@@ -0,0 +1,94 @@
+// Cost of drawing text with the Text_renderer (text_renderer.h) and its
+// Glyph_atlas (glyph_atlas.h), on the bitmap font, 40 strings of about 30
+// characters per frame:
+//
+// repeated: the same strings every frame, like labels and a status that
+//           rarely changes: layout cache hits, glyphs found by their hint.
+// changing: every string formats the frame number and a timing, like a
+//           debug overlay: shaped every frame, glyphs found in the atlas.
+// cold:     the atlas is cleared before each frame: every glyph is
+//           rasterized again (the first frames, or a new font size).
+//
+// Prints the layout cache and atlas counters of each case and the glyphs
+// recorded per second (draw() into a Draw_list, nothing is rasterized to
+// the screen).
+
+#include "text_renderer.h"
+#include "glyph_rasterizer.h"
+#include "draw_list.h"
+#include "frame_arena.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int STRINGS = 40;
+const int FRAMES = 2000;
+const int PIXEL_SIZE = 16;
+
+enum class Text_case {
+    REPEATED,
+    CHANGING,
+    COLD
+};
+
+void run(Text_case mode, const char* name)
+{
+    Bitmap_font_rasterizer font;
+    Text_renderer text(font);
+    Frame_arena arena(256 * 1024);
+
+    std::vector<std::string> labels;
+    for (int i = 0; i < STRINGS; ++i) {
+        labels.push_back("Label " + std::to_string(i) + ": the quick brown fox");
+    }
+
+    const Clock::time_point start = Clock::now();
+    for (int f = 0; f < FRAMES; ++f)
+    {
+        arena.begin_frame();
+        if (mode == Text_case::COLD) {
+            text.atlas().clear();
+        }
+        text.begin_frame();
+        Draw_list list(arena.current(), 2048);
+        for (int i = 0; i < STRINGS; ++i)
+        {
+            const char* str = labels[std::size_t(i)].c_str();
+            if (mode != Text_case::REPEATED) {
+                str = arena.current().format("frame %d line %d: %.3f ms", f, i, double(f % 997) * 0.017);
+            }
+            text.draw(list, 10.0f, float(10 + i * 20), str, PIXEL_SIZE, 0xFFFFFFFF);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const Text_stats& ts = text.stats();
+    const Atlas_stats as = text.atlas().stats();
+    std::printf("%-9s %8.2f M glyphs/s, %6.2f us per frame | strings %llu, glyphs %llu, layout hits %llu,"
+                " misses %llu | atlas hits %llu (hint %llu), misses %llu, evictions %llu\n",
+                name, double(ts.glyphs) / seconds / 1e6, seconds * 1e6 / FRAMES,
+                (unsigned long long)ts.strings, (unsigned long long)ts.glyphs,
+                (unsigned long long)ts.layout_hits, (unsigned long long)ts.layout_misses,
+                (unsigned long long)as.hits, (unsigned long long)as.hint_hits,
+                (unsigned long long)as.misses, (unsigned long long)as.evictions);
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    run(Text_case::REPEATED, "repeated:");
+    run(Text_case::CHANGING, "changing:");
+    run(Text_case::COLD, "cold:");
+    return 0;
+}
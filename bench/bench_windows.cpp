@@ -0,0 +1,85 @@
+// Message dispatch cost with 1, 8 and 64 windows served by one pump.
+//
+// The same synthetic stream is spread over N headless windows (fake
+// handles, see window_manager.h). The window procedure does what
+// event_handler() does for input: find the Window_state of the HWND and
+// update its input snapshot and status. The frame callback ends the frame
+// of every open window. With an O(1) from_hwnd() the cost per message
+// should not depend on N; the per frame cost grows with N by design.
+
+#include "window_manager.h"
+#include "event_loop.h"
+#include "backend_headless.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const std::size_t MESSAGES = 1000000;
+
+void run(int window_count)
+{
+    Window_manager windows(true);
+    for (int i = 0; i < window_count; ++i) {
+        windows.create_headless(64, 64);
+    }
+
+    // Each message goes to a random window
+    std::vector<MSG> stream = make_synthetic_stream(MESSAGES, nullptr, 9);
+    std::mt19937 rng(window_count);
+    std::uniform_int_distribution<int> pick(0, window_count - 1);
+    for (MSG& msg : stream) {
+        msg.hwnd = windows[std::size_t(pick(rng))].hwnd;
+    }
+
+    uint64_t missed = 0;
+    Backend_headless backend([&](HWND hwnd, UINT msg, WPARAM w, LPARAM l) -> LRESULT {
+        Window_state* window = windows.from_hwnd(hwnd);
+        if (!window) {
+            missed++;
+            return 0;
+        }
+        input_on_message(window->input, msg, w, l);
+        if (msg == WM_LBUTTONDOWN) {
+            const POINTS p = MAKEPOINTS(l);
+            window->status.begin().append("x: ").append(p.x).append(" y: ").append(p.y);
+        }
+        return 0;
+    });
+    backend.post(stream);
+
+    double end_frame_seconds = 0.0;
+    Event_loop loop(backend);
+    loop.set_frame_callback([&]() {
+        const Clock::time_point start = Clock::now();
+        windows.for_each_open([](Window_state& w) { input_end_frame(w.input); });
+        end_frame_seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        return true;
+    });
+    loop.run();
+
+    const Loop_stats& s = loop.stats();
+    std::printf("%2d windows: dispatch %.1f ns per message, end of frame %.1f ns, %.2f M messages/s%s\n",
+                window_count, s.dispatch_seconds * 1e9 / double(s.messages),
+                end_frame_seconds * 1e9 / double(s.frames), s.messages_per_second() / 1e6,
+                missed ? " (LOOKUPS FAILED)" : "");
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    run(1);
+    run(8);
+    run(64);
+    return 0;
+}
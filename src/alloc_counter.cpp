@@ -0,0 +1,75 @@
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// ****************************************************************************
+
+namespace {
+
+std::atomic<unsigned long long> g_allocations(0);
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+unsigned long long heap_allocation_count()
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+// ****************************************************************************
+
+bool alloc_counter_enabled()
+{
+#ifdef ENABLE_ALLOC_COUNTER
+    return true;
+#else
+    return false;
+#endif
+}
+
+// ****************************************************************************
+
+#ifdef ENABLE_ALLOC_COUNTER
+
+// Replacing these is enough: the nothrow variants forward to them in the
+// standard library. The sized deletes are replaced too, GCC warns otherwise.
+// (Over-aligned 'new' is not counted)
+
+void* operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
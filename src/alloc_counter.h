@@ -0,0 +1,19 @@
+#pragma once
+
+// Count heap allocations made through operator new.
+//
+// Define ENABLE_ALLOC_COUNTER in the preprocessor definitions of the project
+// to replace the global operator new / delete by counting versions (see
+// alloc_counter.cpp). Use it to check a code path doesn't allocate:
+//
+//     unsigned long long before = heap_allocation_count();
+//     hot_path();
+//     assert(heap_allocation_count() == before);
+//
+// When the macro is not defined the counter always reads 0.
+
+/// Number of calls to operator new since the start of the process.
+unsigned long long heap_allocation_count();
+
+/// Is the counter active? (i.e. ENABLE_ALLOC_COUNTER was defined)
+bool alloc_counter_enabled();
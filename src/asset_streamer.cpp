@@ -0,0 +1,400 @@
+#include "asset_streamer.h"
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int decode_workers(int decode_threads)
+{
+    // At least one worker: the reader never calls Job_system::wait(), jobs
+    // only run if a worker picks them up
+    if (decode_threads < 0) {
+        decode_threads = int(std::thread::hardware_concurrency()) - 1;
+    }
+    return std::max(1, decode_threads);
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+Asset_streamer::Asset_streamer(std::size_t max_bytes_in_flight, int decode_threads)
+    : _jobs(decode_workers(decode_threads))
+    , _max_bytes_in_flight(max_bytes_in_flight)
+{
+    // The reader thread is the job system's external thread: the only one
+    // creating jobs
+    _reader = std::thread(&Asset_streamer::reader_main, this);
+}
+
+// ****************************************************************************
+
+Asset_streamer::~Asset_streamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        for (auto& it : _requests) {
+            it.second->cancelled.store(true, std::memory_order_relaxed);
+        }
+    }
+    _wake_reader.notify_all();
+    _reader.join(); // after the decode jobs, see reader_main()
+
+    for (auto& it : _requests) {
+        delete it.second;
+    }
+}
+
+// ****************************************************************************
+
+Stream_id Asset_streamer::request(const char* path, Stream_priority priority,
+                                  const Upload_fn& upload, const Done_fn& done,
+                                  const Decode_fn& decode)
+{
+    Request* r = new Request();
+    r->path = path;
+    r->priority = priority;
+    r->upload = upload;
+    r->done = done;
+    r->decode = decode;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    r->id = _next_id++;
+    _requests[r->id] = r;
+    _pending[int(priority)].push_back(r);
+    _stats.requests++;
+    _wake_reader.notify_one();
+    return r->id;
+}
+
+// ****************************************************************************
+
+bool Asset_streamer::cancel(Stream_id id)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _requests.find(id);
+    if (it == _requests.end()) {
+        return false;
+    }
+    Request* r = it->second;
+    if (r->cancelled.exchange(true)) {
+        return false;
+    }
+    _stats.cancelled++;
+    // Nobody works on a pending request yet: forget it now. The others are
+    // dropped by whoever holds them (reader, decoder, pump())
+    if (r->state == PENDING && remove(_pending, r)) {
+        release(r);
+    }
+    return true;
+}
+
+// ****************************************************************************
+
+bool Asset_streamer::set_priority(Stream_id id, Stream_priority priority)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _requests.find(id);
+    if (it == _requests.end()) {
+        return false;
+    }
+    Request* r = it->second;
+    if (r->priority == priority) {
+        return true;
+    }
+    // Being read or decoded: the new priority applies once it's ready
+    Queue* queue = r->state == PENDING ? &_pending : r->state == READY ? &_ready : nullptr;
+    if (queue && remove(*queue, r)) {
+        (*queue)[int(priority)].push_back(r);
+    }
+    r->priority = priority;
+    return true;
+}
+
+// ****************************************************************************
+
+bool Asset_streamer::upload_pending() const
+{
+    if (_uploading) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const std::deque<Request*>& q : _ready) {
+        if (!q.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ****************************************************************************
+
+std::size_t Asset_streamer::outstanding() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _requests.size();
+}
+
+// ****************************************************************************
+
+Stream_stats Asset_streamer::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+// ****************************************************************************
+
+Asset_streamer::Request* Asset_streamer::pop(Queue& queue)
+{
+    for (int p = PRIORITIES - 1; p >= 0; --p) {
+        if (!queue[p].empty()) {
+            Request* r = queue[p].front();
+            queue[p].pop_front();
+            return r;
+        }
+    }
+    return nullptr;
+}
+
+// ****************************************************************************
+
+bool Asset_streamer::remove(Queue& queue, Request* r)
+{
+    std::deque<Request*>& q = queue[int(r->priority)];
+    auto it = std::find(q.begin(), q.end(), r);
+    if (it == q.end()) {
+        return false;
+    }
+    q.erase(it);
+    return true;
+}
+
+// ****************************************************************************
+
+void Asset_streamer::release(Request* r)
+{
+    if (r->state != PENDING) {
+        _in_flight--;
+        _bytes_in_flight -= r->charged;
+        _wake_reader.notify_one();
+    }
+    _requests.erase(r->id);
+    delete r;
+}
+
+// ****************************************************************************
+
+void Asset_streamer::reader_main()
+{
+    if (profiler_enabled()) {
+        profiler_set_thread_name("asset reader");
+    }
+    // The decode jobs are run from here
+    _jobs.set_external_thread();
+    for (;;)
+    {
+        Request* r = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            // Don't read ahead of the frame loop by more than the budget.
+            // (one asset is always allowed, however large)
+            _wake_reader.wait(lock, [this]() {
+                if (_stop) {
+                    return true;
+                }
+                bool any = false;
+                for (const std::deque<Request*>& q : _pending) {
+                    any = any || !q.empty();
+                }
+                return any && _in_flight < MAX_IN_FLIGHT &&
+                       (_in_flight == 0 || _bytes_in_flight < _max_bytes_in_flight);
+            });
+            if (_stop) {
+                break;
+            }
+            r = pop(_pending);
+            r->state = LOADING;
+            _in_flight++;
+        }
+
+        const auto start = Clock::now();
+        const bool read_all = read(*r);
+        const double seconds = seconds_since(start);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            r->charged = r->file.size();
+            _bytes_in_flight += r->charged;
+            _stats.read_seconds += seconds;
+            if (read_all) {
+                _stats.bytes_read += r->file.size();
+            }
+        }
+        // The decoder also takes the failed and cancelled requests: they
+        // reach pump() through the ready queue like any other
+        _decoding.fetch_add(1, std::memory_order_relaxed);
+        _jobs.run(_jobs.create([this, r]() { decode(r); }));
+    }
+    // Decode jobs point to 'this' and to their request
+    while (_decoding.load(std::memory_order_acquire) > 0) {
+        std::this_thread::yield();
+    }
+}
+
+// ****************************************************************************
+
+bool Asset_streamer::read(Request& r)
+{
+    PROFILE_ZONE("read asset");
+    if (!r.file.open(r.path.c_str())) {
+        r.ok = false;
+        return false;
+    }
+    // Touch a byte per page: the page faults (the actual disk reads) happen
+    // here rather than in the decoder or, worse, in the frame loop. A
+    // volatile sum so the compiler keeps the loads.
+    const std::size_t PAGE = 4096;
+    const uint8_t* data = r.file.data();
+    const std::size_t size = r.file.size();
+    volatile uint8_t sink = 0;
+    for (std::size_t chunk = 0; chunk < size; chunk += READ_CHUNK)
+    {
+        if (r.cancelled.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        const std::size_t end = std::min(size, chunk + READ_CHUNK);
+        uint8_t sum = 0;
+        for (std::size_t i = chunk; i < end; i += PAGE) {
+            sum ^= data[i];
+        }
+        sink = sink ^ sum;
+    }
+    (void)sink;
+    return true;
+}
+
+// ****************************************************************************
+
+void Asset_streamer::decode(Request* r)
+{
+    const auto start = Clock::now();
+    if (r->ok && !r->cancelled.load(std::memory_order_relaxed))
+    {
+        PROFILE_ZONE("decode asset");
+        if (r->decode) {
+            r->ok = r->decode(r->file.data(), r->file.size(), r->decoded);
+            r->file.close();
+            r->data = r->decoded.data();
+            r->size = r->decoded.size();
+        } else {
+            // Uploaded straight from the mapping
+            r->data = r->file.data();
+            r->size = r->file.size();
+        }
+    }
+    const double seconds = seconds_since(start);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stats.decode_seconds += seconds;
+        if (r->decode && r->ok) {
+            // The mapping is gone, the decoded bytes are what waits for pump()
+            _bytes_in_flight = _bytes_in_flight - r->charged + r->decoded.capacity();
+            r->charged = r->decoded.capacity();
+        }
+        r->state = READY;
+        _ready[int(r->priority)].push_back(r);
+    }
+    if (_on_ready) {
+        _on_ready();
+    }
+    // Last: once it reaches 0 the streamer may be destroyed (see reader_main())
+    _decoding.fetch_sub(1, std::memory_order_release);
+}
+
+// ****************************************************************************
+
+std::size_t Asset_streamer::pump(const Upload_budget& budget)
+{
+    PROFILE_ZONE("stream pump");
+    const auto start = Clock::now();
+    std::size_t uploaded = 0;
+    for (;;)
+    {
+        // Finish the partially uploaded asset first: its first slices are
+        // already in use on the other side
+        Request* r = _uploading;
+        if (!r) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            r = pop(_ready);
+            if (!r) {
+                break;
+            }
+            _uploading = r;
+        }
+        if (r->cancelled.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _uploading = nullptr;
+            release(r);
+            continue;
+        }
+        if (!r->ok) {
+            if (r->done) {
+                r->done(r->id, false);
+            }
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stats.failed++;
+            _uploading = nullptr;
+            release(r);
+            continue;
+        }
+
+        // One slice: what's left of the asset, or of the byte budget, at
+        // most READ_CHUNK so the time budget is checked often enough
+        if (uploaded >= budget.bytes) {
+            break;
+        }
+        const std::size_t slice = std::min(std::min(r->size - r->uploaded, budget.bytes - uploaded),
+                                           std::size_t(READ_CHUNK));
+        if (slice > 0) {
+            const Stream_asset asset = { r->id, r->path, r->data, r->size };
+            r->upload(asset, r->uploaded, slice);
+            r->uploaded += slice;
+            uploaded += slice;
+        }
+        if (r->uploaded == r->size)
+        {
+            if (r->done) {
+                r->done(r->id, true);
+            }
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stats.completed++;
+            _uploading = nullptr;
+            release(r);
+        }
+        // Checked between slices: a single slice may overshoot
+        if (seconds_since(start) * 1000.0 >= budget.milliseconds) {
+            break;
+        }
+    }
+
+    const double ms = seconds_since(start) * 1000.0;
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.pumps++;
+    _stats.bytes_uploaded += uploaded;
+    _stats.max_pump_ms = std::max(_stats.max_pump_ms, ms);
+    return uploaded;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+// Asynchronous asset streaming: files are read and decoded in the
+// background, then handed to the frame loop a little at a time.
+//
+//   request()      reader thread            job system          pump() (frame loop)
+//   ---------      -------------            ----------          -------------------
+//   pending  --->  map the file, fault  --> decode (worker) --> upload in slices,
+//   (priority)     its pages in, 1MB at                         at most 'budget'
+//                  a time                                       bytes / ms per frame
+//
+// - reading: the file is memory mapped (Mapped_file) and its pages are
+//   touched by the reader thread, so the disk I/O (page faults) happens
+//   there and never in a decoder or in the frame loop. One request at a
+//   time, highest priority first, in request order within a priority.
+// - decoding: a job on the streamer's own Job_system, so several assets
+//   decode in parallel while the reader moves on. Without a Decode_fn the
+//   mapped bytes are uploaded as they are (no copy).
+// - uploading: pump() is called once per frame by the thread owning the
+//   renderer. It gives the decoded bytes to each asset's Upload_fn in
+//   slices, and stops once the frame's budget of bytes or milliseconds is
+//   spent: a large asset is spread over several frames instead of blowing
+//   one frame's deadline. Then the Done_fn is called, on the same thread.
+//   A frame loop that only draws on demand is told when there is
+//   something to pump: set_ready_callback() when an asset is ready,
+//   upload_pending() after a pump() that ran out of budget.
+// - memory: at most 'max_bytes_in_flight' bytes (and MAX_IN_FLIGHT
+//   assets) are read but not uploaded yet. The reader waits when the frame
+//   loop lags behind.
+//
+// cancel() works at any stage: a pending request is forgotten, a request
+// being read stops at the next 1MB, a decoded or partially uploaded one is
+// dropped by the next pump(). Done_fn is not called for cancelled
+// requests. set_priority() moves a request that is waiting (to be read,
+// or to be uploaded) to the back of its new priority.
+//
+// request(), cancel() and set_priority() may be called from any thread,
+// pump() from a single one.
+
+#include "job_system.h"
+#include "mapped_file.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+typedef uint64_t Stream_id; ///< 0 is never a valid request
+
+enum class Stream_priority : uint8_t {
+    LOW,
+    NORMAL,
+    HIGH,
+    URGENT
+};
+
+/// What pump() may spend per call
+struct Upload_budget {
+    std::size_t bytes = 4 << 20;
+    double milliseconds = 2.0;
+};
+
+/// Decoded bytes given to an Upload_fn
+struct Stream_asset {
+    Stream_id id;
+    const std::string& path;
+    const uint8_t* data;
+    std::size_t size;
+};
+
+struct Stream_stats {
+    uint64_t requests = 0;
+    uint64_t completed = 0;       ///< uploaded, Done_fn called with true
+    uint64_t failed = 0;          ///< file missing or Decode_fn returned false
+    uint64_t cancelled = 0;
+    uint64_t bytes_read = 0;      ///< file bytes
+    uint64_t bytes_uploaded = 0;  ///< decoded bytes given to Upload_fn
+    double read_seconds = 0.0;    ///< reader thread, mapping + page faults
+    double decode_seconds = 0.0;  ///< summed over the workers
+    uint64_t pumps = 0;
+    double max_pump_ms = 0.0;     ///< longest pump()
+};
+
+// ****************************************************************************
+
+class Asset_streamer {
+public:
+    /// Worker thread: file bytes -> decoded bytes. false if the file is bad.
+    typedef std::function<bool(const uint8_t* file, std::size_t size, std::vector<uint8_t>& out)> Decode_fn;
+    /// pump() thread: bytes [offset, offset + size) of the decoded asset
+    typedef std::function<void(const Stream_asset& asset, std::size_t offset, std::size_t size)> Upload_fn;
+    /// pump() thread: the whole asset was uploaded (true) or couldn't be
+    /// loaded (false)
+    typedef std::function<void(Stream_id id, bool ok)> Done_fn;
+
+    static const std::size_t MAX_IN_FLIGHT = 64; ///< assets read and not uploaded yet
+    static const std::size_t READ_CHUNK = 1 << 20;
+
+    /// @param decode_threads : workers decoding, -1 for one less than the
+    /// number of hardware threads (at least one)
+    explicit Asset_streamer(std::size_t max_bytes_in_flight = std::size_t(256) << 20,
+                            int decode_threads = -1);
+    /// Cancels everything and waits for the threads
+    ~Asset_streamer();
+
+    Asset_streamer(const Asset_streamer&) = delete;
+    Asset_streamer& operator=(const Asset_streamer&) = delete;
+
+    /// Stream the file at 'path'.
+    /// @param decode : NULL to upload the file's bytes as they are
+    Stream_id request(const char* path, Stream_priority priority,
+                      const Upload_fn& upload, const Done_fn& done = Done_fn(),
+                      const Decode_fn& decode = Decode_fn());
+
+    /// @return false if the request is already done (or unknown)
+    bool cancel(Stream_id id);
+    bool set_priority(Stream_id id, Stream_priority priority);
+
+    /// Called from a worker each time an asset becomes ready for pump()
+    /// (e.g. to wake up the frame loop). Call before the first request().
+    void set_ready_callback(const std::function<void()>& ready) { _on_ready = ready; }
+
+    /// Upload what's ready, within 'budget'. Call once per frame.
+    /// @return bytes uploaded
+    std::size_t pump(const Upload_budget& budget = Upload_budget());
+
+    /// pump() thread: something is left to upload (the budget ran out)
+    bool upload_pending() const;
+
+    /// Requests not done yet (pending, loading or waiting for pump())
+    std::size_t outstanding() const;
+
+    Stream_stats stats() const;
+
+private:
+    enum State { PENDING, LOADING, READY };
+    static const int PRIORITIES = int(Stream_priority::URGENT) + 1;
+
+    struct Request {
+        Stream_id id;
+        std::string path;
+        Stream_priority priority;
+        Upload_fn upload;
+        Done_fn done;
+        Decode_fn decode;
+        State state = PENDING;         ///< protected by '_mutex'
+        std::atomic<bool> cancelled{false};
+        bool ok = true;                ///< false: failed to load
+        Mapped_file file;
+        std::vector<uint8_t> decoded;
+        const uint8_t* data = nullptr; ///< file or decoded bytes
+        std::size_t size = 0;
+        std::size_t uploaded = 0;      ///< pump() thread
+        std::size_t charged = 0;       ///< counted in '_bytes_in_flight'
+    };
+
+    void reader_main();
+    /// Map the file and fault its pages in. @return false if cancelled
+    bool read(Request& r);
+    void decode(Request* r);
+    typedef std::deque<Request*> Queue[PRIORITIES];
+
+    /// Pop the oldest request of the highest priority (locked), NULL if empty
+    static Request* pop(Queue& queue);
+    /// Remove 'r' from 'queue' if it's there (locked)
+    static bool remove(Queue& queue, Request* r);
+    /// Forget 'r' (locked)
+    void release(Request* r);
+
+    Job_system _jobs;
+    std::function<void()> _on_ready;
+    std::thread _reader;
+    bool _stop = false;                   ///< protected by '_mutex'
+
+    mutable std::mutex _mutex;
+    std::condition_variable _wake_reader;
+    std::unordered_map<Stream_id, Request*> _requests;
+    Queue _pending;                       ///< waiting for the reader
+    Queue _ready;                         ///< waiting for pump()
+    Stream_id _next_id = 1;
+    std::size_t _max_bytes_in_flight;
+    std::size_t _bytes_in_flight = 0;
+    std::size_t _in_flight = 0;           ///< assets past PENDING
+    std::atomic<int> _decoding{0};        ///< decode jobs not finished
+
+    Request* _uploading = nullptr;        ///< pump() thread
+    Stream_stats _stats;                  ///< protected by '_mutex'
+};
@@ -0,0 +1,160 @@
+#include "backend_headless.h"
+
+#include <random>
+
+// ****************************************************************************
+
+void Backend_headless::post(const MSG& msg)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(msg);
+    }
+    _not_empty.notify_one();
+}
+
+// ****************************************************************************
+
+void Backend_headless::post(const std::vector<MSG>& script)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.insert(_queue.end(), script.begin(), script.end());
+    }
+    _not_empty.notify_one();
+}
+
+// ****************************************************************************
+
+void Backend_headless::post_input(MSG msg)
+{
+    msg.time = now_ms();
+    post(msg);
+}
+
+// ****************************************************************************
+
+DWORD Backend_headless::now_ms() const
+{
+    auto elapsed = std::chrono::steady_clock::now() - _start;
+    return (DWORD)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+// ****************************************************************************
+
+void Backend_headless::post_quit(int exit_code)
+{
+    MSG msg = {};
+    msg.message = WM_QUIT;
+    msg.wParam = (WPARAM)exit_code;
+    post(msg);
+}
+
+// ****************************************************************************
+
+void Backend_headless::set_quit_when_empty(bool state)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit_when_empty = state;
+    }
+    _not_empty.notify_one();
+}
+
+// ****************************************************************************
+
+std::size_t Backend_headless::pending() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _queue.size();
+}
+
+// ****************************************************************************
+
+bool Backend_headless::peek(MSG& msg)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_queue.empty())
+    {
+        if (!_quit_when_empty) {
+            return false;
+        }
+        msg = MSG();
+        msg.message = WM_QUIT;
+        return true;
+    }
+    msg = _queue.front();
+    _queue.pop_front();
+    return true;
+}
+
+// ****************************************************************************
+
+void Backend_headless::wait(double timeout_seconds)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto has_message = [this]() { return !_queue.empty() || _quit_when_empty; };
+    if (timeout_seconds < 0.0) {
+        _not_empty.wait(lock, has_message);
+    } else {
+        _not_empty.wait_for(lock, std::chrono::duration<double>(timeout_seconds), has_message);
+    }
+}
+
+// ****************************************************************************
+
+void Backend_headless::dispatch(MSG& msg)
+{
+    if (_proc) {
+        _proc(msg.hwnd, msg.message, msg.wParam, msg.lParam);
+    }
+}
+
+// ****************************************************************************
+
+std::vector<MSG> make_synthetic_stream(std::size_t count,
+                                       HWND hwnd,
+                                       unsigned seed,
+                                       DWORD ms_between_messages)
+{
+    std::vector<MSG> stream;
+    stream.reserve(count);
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> coord(0, 1023);
+    std::uniform_int_distribution<int> kind(0, 99);
+    std::uniform_int_distribution<int> key('A', 'Z');
+
+    short x = 512, y = 512;
+    DWORD time = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        MSG msg = {};
+        msg.hwnd = hwnd;
+        msg.time = time;
+        time += ms_between_messages;
+
+        // Roughly what a user produces: mostly mouse motion, some clicks
+        // and keys.
+        int k = kind(rng);
+        if (k < 70) {
+            x = (short)(x + (coord(rng) % 9) - 4);
+            y = (short)(y + (coord(rng) % 9) - 4);
+            msg.message = WM_MOUSEMOVE;
+            msg.lParam = MAKELPARAM(x, y);
+        } else if (k < 80) {
+            msg.message = (k & 1) ? WM_LBUTTONUP : WM_LBUTTONDOWN;
+            msg.lParam = MAKELPARAM(x, y);
+        } else if (k < 95) {
+            msg.message = (k & 1) ? WM_KEYUP : WM_KEYDOWN;
+            msg.wParam = (WPARAM)key(rng);
+        } else {
+            msg.message = WM_CHAR;
+            msg.wParam = (WPARAM)(key(rng) + ('a' - 'A'));
+        }
+        msg.pt.x = x;
+        msg.pt.y = y;
+        stream.push_back(msg);
+    }
+    return stream;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Event_backend without any window system.
+//
+// Messages come from a script (a std::vector<MSG>) instead of the OS, and
+// dispatch() calls a user provided window procedure directly. This is what
+// we use to measure the loop (messages/second, per frame overhead) on
+// machines without Win32, e.g. the Linux build farm.
+//
+// post() may be called from any thread, wait() then wakes up the loop just
+// like MsgWaitForMultipleObjectsEx() does on Windows.
+
+#include "event_loop.h"
+
+#include <cstddef>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class Backend_headless : public Event_backend {
+public:
+    /// Same signature as a Win32 window procedure (e.g. 'event_handler()')
+    typedef std::function<LRESULT(HWND, UINT, WPARAM, LPARAM)> Window_proc;
+
+    explicit Backend_headless(const Window_proc& proc) : _proc(proc) { }
+
+    /// Append messages to the end of the queue.
+    void post(const MSG& msg);
+    void post(const std::vector<MSG>& script);
+
+    /// Same as post() but 'MSG::time' is overwritten with now_ms() as the
+    /// OS would do. Use it to simulate live input and measure latency.
+    void post_input(MSG msg);
+
+    /// Equivalent of PostQuitMessage(exit_code)
+    void post_quit(int exit_code);
+
+    /// When the script is exhausted peek() reports a WM_QUIT so that
+    /// Event_loop::run() returns. Disable to have an endless idle loop.
+    void set_quit_when_empty(bool state);
+
+    std::size_t pending() const;
+
+    bool peek(MSG& msg) override;
+    void dispatch(MSG& msg) override;
+    void wait(double timeout_seconds) override;
+    /// Milliseconds since the backend was created
+    DWORD now_ms() const override;
+
+private:
+    Window_proc _proc;
+    mutable std::mutex _mutex;
+    std::condition_variable _not_empty;
+    std::deque<MSG> _queue;
+    bool _quit_when_empty = true;
+    std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+};
+
+// ****************************************************************************
+
+/// Build a reproducible stream of 'count' user input messages (mouse moves,
+/// clicks, key presses...) targeted at 'hwnd'. Time stamps ('MSG::time')
+/// increase by 'ms_between_messages'.
+std::vector<MSG> make_synthetic_stream(std::size_t count,
+                                       HWND hwnd = nullptr,
+                                       unsigned seed = 0,
+                                       DWORD ms_between_messages = 1);
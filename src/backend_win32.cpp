@@ -0,0 +1,107 @@
+#include "backend_win32.h"
+
+#include "profiler.h"
+
+#ifdef _WIN32
+
+#include <timeapi.h>
+#include <cmath>
+
+// timeBeginPeriod() / timeEndPeriod()
+#pragma comment(lib, "winmm.lib")
+
+// ****************************************************************************
+
+Backend_win32::Backend_win32(HACCEL accelerators)
+    : _accelerators(accelerators)
+{
+    // By default the Windows scheduler wakes threads up with a 15.6ms
+    // granularity, which makes any timed wait useless to pace frames at
+    // 60Hz (16.6ms). Ask for 1ms resolution while the loop is alive.
+    timeBeginPeriod(1);
+}
+
+// ****************************************************************************
+
+Backend_win32::~Backend_win32()
+{
+    timeEndPeriod(1);
+}
+
+// ****************************************************************************
+
+bool Backend_win32::peek(MSG& msg)
+{
+    // returns true if a message was available in the event queue.
+    return PeekMessage(// MSG* messsage
+                       &msg,
+                       // HWND hwnd: Handle to the window we peek a
+                       // message from, or NULL to peek from every window
+                       NULL,
+                       // UINT wMsgFilterMin, wMsgFilterMax:
+                       // define the interval [min, max] of message codes
+                       // that we should look out for. 0, 0 means we peek
+                       // any message (no filtering)
+                       0, 0,
+                       // UINT wRemoveMsg: a bitfield to specify how we
+                       // process messages in the event queue.
+                       // PM_REMOVE: remove from the queue when processed
+                       // https://docs.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-peekmessagea
+                       PM_REMOVE) != FALSE;
+}
+
+// ****************************************************************************
+
+void Backend_win32::dispatch(MSG& msg)
+{
+    BOOL translated;
+    {
+        PROFILE_ZONE("TranslateAccelerator");
+        translated = _accelerators && TranslateAccelerator(msg.hwnd, _accelerators, &msg);
+    }
+    if (!translated)
+    {
+        PROFILE_ZONE("DispatchMessage");
+        // TranslateMessage() will add additional messages to the queue
+        // that will get picked up by PeekMessage() or GetMessage() on
+        // the next iteration of our loop.
+        // For instance on WM_KEYDOWN and WM_KEYUP events it will add
+        // a WM_CHAR or WM_DEADCHAR event message.
+        // On a WM_CHAR event you can retreive the key code in wParam
+        // WM_SYSKEYDOWN and WM_SYSKEYUP produce a WM_SYSCHAR or
+        // WM_SYSDEADCHAR message.
+        TranslateMessage(&msg);
+
+        // Call the "window procedure" i.e our function event_handler()
+        // that should handle the various events the API knows to call
+        // this function because we specified it in 'register_class()'
+        // earlier
+        DispatchMessage(&msg);
+    }
+}
+
+// ****************************************************************************
+
+void Backend_win32::wait(double timeout_seconds)
+{
+    DWORD timeout_ms = INFINITE;
+    if (timeout_seconds >= 0.0) {
+        // Round down: better wake up a bit early and spin for the remaining
+        // fraction of a millisecond than miss the frame deadline.
+        timeout_ms = (DWORD)std::floor(timeout_seconds * 1000.0);
+        if (timeout_ms == 0) {
+            return;
+        }
+    }
+
+    // Sleeps until a message is posted to our queue or the timeout elapsed.
+    // We don't wait on any kernel object (0, NULL) only on the message queue.
+    // QS_ALLINPUT: wake up for any kind of message (input, paint, timers...)
+    // MWMO_INPUTAVAILABLE: also return if there are messages that have
+    // already been seen by a previous PeekMessage() but are still in the
+    // queue, otherwise we could sleep with pending input.
+    // https://docs.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-msgwaitformultipleobjectsex
+    MsgWaitForMultipleObjectsEx(0, NULL, timeout_ms, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+}
+
+#endif
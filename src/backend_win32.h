@@ -0,0 +1,28 @@
+#pragma once
+
+// Event_backend on top of the real Win32 message queue of the calling thread.
+
+#ifdef _WIN32
+
+#include "event_loop.h"
+
+class Backend_win32 : public Event_backend {
+public:
+    /// @param accelerators : table returned by LoadAccelerators() or NULL
+    explicit Backend_win32(HACCEL accelerators);
+    ~Backend_win32();
+
+    /// Change the accelerator table (e.g. once loaded in the background)
+    void set_accelerators(HACCEL accelerators) { _accelerators = accelerators; }
+
+    bool peek(MSG& msg) override;
+    void dispatch(MSG& msg) override;
+    void wait(double timeout_seconds) override;
+    // MSG::time is given by the same clock as GetTickCount()
+    DWORD now_ms() const override { return GetTickCount(); }
+
+private:
+    HACCEL _accelerators;
+};
+
+#endif
@@ -0,0 +1,195 @@
+#include "damage_region.h"
+
+#include "draw_list.h"
+
+#include <algorithm>
+#include <cstring>
+
+// ****************************************************************************
+
+namespace {
+
+uint64_t mix(uint64_t h, uint64_t v)
+{
+    // One round of a 64 bit multiplicative hash (splitmix64 finalizer)
+    h ^= v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+uint64_t bits(float f)
+{
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+/// Everything that changes the pixels of command 'i'
+uint64_t hash_command(const Draw_list& list, uint32_t i)
+{
+    uint64_t h = mix(list.key(i), list.type(i));
+    h = mix(h, bits(list.x0(i)) | (bits(list.y0(i)) << 32));
+    h = mix(h, bits(list.x1(i)) | (bits(list.y1(i)) << 32));
+    h = mix(h, list.color(i));
+    if (list.type(i) == DRAW_LINE) {
+        h = mix(h, bits(list.thickness(i)));
+    } else if (list.type(i) == DRAW_GLYPH) {
+        const Draw_uv& uv = list.uv(i);
+        h = mix(h, bits(uv.u0) | (bits(uv.v0) << 32));
+        h = mix(h, bits(uv.u1) | (bits(uv.v1) << 32));
+    }
+    return h;
+}
+
+/// Area added by merging 'a' and 'b' into one rectangle
+int64_t merge_cost(const Damage_rect& a, const Damage_rect& b)
+{
+    return damage_union(a, b).area() - a.area() - b.area();
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+Damage_rect damage_union(const Damage_rect& a, const Damage_rect& b)
+{
+    return Damage_rect{ std::min(a.x0, b.x0), std::min(a.y0, b.y0),
+                        std::max(a.x1, b.x1), std::max(a.y1, b.y1) };
+}
+
+// ****************************************************************************
+
+void Damage_region::add(const Damage_rect& rect)
+{
+    if (rect.empty()) {
+        return;
+    }
+    Damage_rect r = rect;
+    // Merge with whatever it overlaps enough (the union costs no more
+    // pixels than the two apart), which may in turn reach other rectangles
+    for (int i = 0; i < _count; )
+    {
+        if (_rects[i].contains(r)) {
+            return;
+        }
+        if (r.contains(_rects[i]) || merge_cost(_rects[i], r) <= 0) {
+            r = damage_union(r, _rects[i]);
+            remove(i);
+            i = 0;
+            continue;
+        }
+        ++i;
+    }
+    _rects[_count++] = r;
+    if (_count <= MAX_RECTS) {
+        return;
+    }
+    // Too many: merge the cheapest pair
+    int best_a = 0, best_b = 1;
+    int64_t best = INT64_MAX;
+    for (int a = 0; a < _count; ++a) {
+        for (int b = a + 1; b < _count; ++b) {
+            const int64_t cost = merge_cost(_rects[a], _rects[b]);
+            if (cost < best) {
+                best = cost;
+                best_a = a;
+                best_b = b;
+            }
+        }
+    }
+    const Damage_rect merged = damage_union(_rects[best_a], _rects[best_b]);
+    remove(best_b); // the higher index first, 'best_a' stays valid
+    remove(best_a);
+    add(merged);
+}
+
+// ****************************************************************************
+
+void Damage_region::add(const Damage_region& region)
+{
+    for (const Damage_rect& r : region) {
+        add(r);
+    }
+}
+
+// ****************************************************************************
+
+void Damage_region::clip(int width, int height)
+{
+    for (int i = 0; i < _count; )
+    {
+        Damage_rect& r = _rects[i];
+        r.x0 = std::max(r.x0, 0);
+        r.y0 = std::max(r.y0, 0);
+        r.x1 = std::min(r.x1, width);
+        r.y1 = std::min(r.y1, height);
+        if (r.empty()) {
+            remove(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+// ****************************************************************************
+
+int64_t Damage_region::area() const
+{
+    int64_t sum = 0;
+    for (const Damage_rect& r : *this) {
+        sum += r.area();
+    }
+    return sum;
+}
+
+// ****************************************************************************
+
+bool Damage_region::covers(int width, int height) const
+{
+    const Damage_rect all = { 0, 0, width, height };
+    for (const Damage_rect& r : *this) {
+        if (r.contains(all)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ****************************************************************************
+
+void Damage_tracker::update(const Draw_list& list, Damage_region& damage)
+{
+    _current.clear();
+    for (uint32_t i = 0; i < uint32_t(list.size()); ++i)
+    {
+        Entry e;
+        e.hash = hash_command(list, i);
+        list.bounds(i, e.rect.x0, e.rect.y0, e.rect.x1, e.rect.y1);
+        // One pixel of margin: the GPU may round an edge the other way
+        e.rect.x0 -= 1;
+        e.rect.y0 -= 1;
+        e.rect.x1 += 1;
+        e.rect.y1 += 1;
+        _current.push_back(e);
+    }
+    std::sort(_current.begin(), _current.end());
+
+    // Walk both sorted lists: a hash only in one of them is a command that
+    // appeared (new position) or disappeared (old position)
+    std::size_t a = 0, b = 0;
+    while (a < _previous.size() || b < _current.size())
+    {
+        if (b == _current.size() || (a < _previous.size() && _previous[a].hash < _current[b].hash)) {
+            damage.add(_previous[a++].rect);
+        } else if (a == _previous.size() || _current[b].hash < _previous[a].hash) {
+            damage.add(_current[b++].rect);
+        } else {
+            ++a;
+            ++b;
+        }
+    }
+    _previous.swap(_current);
+}
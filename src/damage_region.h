@@ -0,0 +1,107 @@
+#pragma once
+
+// Damage tracking: which parts of the window changed since the last frame.
+//
+// Most frames only change a small part of the window: the crosshair moved,
+// the status text changed, a button was clicked. Repainting and presenting
+// the whole back buffer for that costs the same as a full screen update.
+// Instead each frame collects its "damage" and the renderer only repaints
+// and presents that (see Renderer::set_partial_redraw()):
+//
+//   Draw_list ---> Damage_tracker::update() ---> Damage_region
+//   (this frame)   (diff with the last frame)    (a few rectangles)
+//                                                     |
+//                  software: tiles outside are skipped (clear, draw, resolve)
+//                  D3D11: cleared / scissored rectangles, Present1() dirty rects
+//
+// Damage_region keeps at most MAX_RECTS rectangles: adding one either
+// merges it with a rectangle it mostly overlaps, or appends it; past the
+// limit the two rectangles whose union wastes the least area are merged.
+// Bounded, cheap to walk, and a superset of what was added.
+//
+// Damage_tracker finds the damage by itself, comparing the commands of
+// the draw list with the ones of the last frame: a command that is in
+// both frames (same type, position, size, color, texture coordinates and
+// layer) didn't change, anything else damages its bounding box, in its
+// old and new position. Nothing to invalidate by hand in the frame code.
+// Limits: the content of a texture is not compared (re-uploading the glyph
+// atlas damages the whole window, see Render_thread::render_frame()) and
+// two overlapping translucent commands swapping their order in the same
+// layer are not seen.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Draw_list;
+
+/// [x0, x1) x [y0, y1), in pixels
+struct Damage_rect {
+    int x0, y0, x1, y1;
+
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+    int64_t area() const { return empty() ? 0 : int64_t(x1 - x0) * int64_t(y1 - y0); }
+    bool contains(const Damage_rect& r) const {
+        return r.x0 >= x0 && r.y0 >= y0 && r.x1 <= x1 && r.y1 <= y1;
+    }
+    bool overlaps(const Damage_rect& r) const {
+        return r.x0 < x1 && x0 < r.x1 && r.y0 < y1 && y0 < r.y1;
+    }
+};
+
+/// Smallest rectangle containing both
+Damage_rect damage_union(const Damage_rect& a, const Damage_rect& b);
+
+// ****************************************************************************
+
+class Damage_region {
+public:
+    static const int MAX_RECTS = 8;
+
+    void add(const Damage_rect& rect);
+    void add(int x0, int y0, int x1, int y1) { add(Damage_rect{ x0, y0, x1, y1 }); }
+    void add(const Damage_region& region);
+    void clear() { _count = 0; }
+
+    /// Intersect with [0, width) x [0, height)
+    void clip(int width, int height);
+
+    bool empty() const { return _count == 0; }
+    int count() const { return _count; }
+    const Damage_rect& operator[](int i) const { return _rects[i]; }
+    const Damage_rect* begin() const { return _rects; }
+    const Damage_rect* end() const { return _rects + _count; }
+
+    /// Sum of the areas (rectangles may overlap a little: an upper bound)
+    int64_t area() const;
+    /// Does the region cover all of [0, width) x [0, height)?
+    bool covers(int width, int height) const;
+
+private:
+    void remove(int i) { _rects[i] = _rects[--_count]; }
+
+    Damage_rect _rects[MAX_RECTS + 1];
+    int _count = 0;
+};
+
+// ****************************************************************************
+
+class Damage_tracker {
+public:
+    /// Add to 'damage' the difference between the commands of 'list' and
+    /// those of the list given to the previous call.
+    void update(const Draw_list& list, Damage_region& damage);
+
+    /// Forget the last frame: the next update() damages everything drawn
+    void reset() { _previous.clear(); }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        Damage_rect rect;
+        bool operator<(const Entry& e) const { return hash < e.hash; }
+    };
+
+    std::vector<Entry> _previous; ///< sorted by hash
+    std::vector<Entry> _current;
+};
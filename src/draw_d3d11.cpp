@@ -0,0 +1,300 @@
+#include "draw_d3d11.h"
+
+#ifdef _WIN32
+
+#include <d3dcompiler.h>
+
+#include <cstddef>
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+// ****************************************************************************
+
+namespace {
+
+// Pixel coordinates to clip space: x * 2 / width - 1, 1 - y * 2 / height
+const char SHADERS[] = R"(
+cbuffer Viewport : register(b0) {
+    float2 scale;
+    float2 unused;
+};
+
+struct Vertex {
+    float2 position : POSITION;
+    float2 uv       : TEXCOORD;
+    float4 color    : COLOR;
+};
+
+struct Pixel {
+    float4 position : SV_Position;
+    float2 uv       : TEXCOORD;
+    float4 color    : COLOR;
+};
+
+Pixel vs_main(Vertex v) {
+    Pixel p;
+    p.position = float4(v.position * scale + float2(-1.0, 1.0), 0.0, 1.0);
+    p.uv = v.uv;
+    p.color = v.color;
+    return p;
+}
+
+float4 ps_solid(Pixel p) : SV_Target {
+    return p.color;
+}
+
+Texture2D<float> coverage : register(t0);
+SamplerState point_sampler : register(s0);
+
+float4 ps_text(Pixel p) : SV_Target {
+    return float4(p.color.rgb, p.color.a * coverage.Sample(point_sampler, p.uv));
+}
+)";
+
+bool compile(const char* entry, const char* target, Microsoft::WRL::ComPtr<ID3DBlob>& blob)
+{
+    Microsoft::WRL::ComPtr<ID3DBlob> errors;
+    HRESULT hr = D3DCompile(SHADERS, sizeof(SHADERS) - 1, "draw_d3d11", nullptr, nullptr,
+                            entry, target, D3DCOMPILE_OPTIMIZATION_LEVEL3, 0,
+                            &blob, &errors);
+    if (FAILED(hr) && errors) {
+        OutputDebugStringA((const char*)errors->GetBufferPointer());
+    }
+    return SUCCEEDED(hr);
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+bool Draw_d3d11::init(ID3D11Device* device)
+{
+    _device = device;
+
+    ComPtr<ID3DBlob> vs, ps_solid, ps_text;
+    if (!compile("vs_main", "vs_4_0", vs) ||
+        !compile("ps_solid", "ps_4_0", ps_solid) ||
+        !compile("ps_text", "ps_4_0", ps_text))
+    {
+        return false;
+    }
+    if (FAILED(device->CreateVertexShader(vs->GetBufferPointer(), vs->GetBufferSize(), nullptr, &_vertex_shader)) ||
+        FAILED(device->CreatePixelShader(ps_solid->GetBufferPointer(), ps_solid->GetBufferSize(), nullptr, &_pixel_shaders[int(Draw_pipeline::SOLID)])) ||
+        FAILED(device->CreatePixelShader(ps_text->GetBufferPointer(), ps_text->GetBufferSize(), nullptr, &_pixel_shaders[int(Draw_pipeline::TEXT)])))
+    {
+        return false;
+    }
+
+    // Matches Draw_vertex. 0xAARRGGBB colors are B, G, R, A bytes in memory.
+    const D3D11_INPUT_ELEMENT_DESC layout[] = {
+        { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT,   0, offsetof(Draw_vertex, x),     D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,   0, offsetof(Draw_vertex, u),     D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "COLOR",    0, DXGI_FORMAT_B8G8R8A8_UNORM, 0, offsetof(Draw_vertex, color), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
+    if (FAILED(device->CreateInputLayout(layout, ARRAYSIZE(layout), vs->GetBufferPointer(), vs->GetBufferSize(), &_layout))) {
+        return false;
+    }
+
+    D3D11_BUFFER_DESC cb = {};
+    cb.ByteWidth = 16;
+    cb.Usage = D3D11_USAGE_DEFAULT;
+    cb.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    if (FAILED(device->CreateBuffer(&cb, nullptr, &_constants))) {
+        return false;
+    }
+
+    // Straight alpha: rgb = src * a + dst * (1 - a)
+    D3D11_BLEND_DESC blend = {};
+    D3D11_RENDER_TARGET_BLEND_DESC& rt = blend.RenderTarget[0];
+    rt.BlendEnable = TRUE;
+    rt.SrcBlend = D3D11_BLEND_SRC_ALPHA;
+    rt.DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+    rt.BlendOp = D3D11_BLEND_OP_ADD;
+    rt.SrcBlendAlpha = D3D11_BLEND_ONE;
+    rt.DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+    rt.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+    rt.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+    if (FAILED(device->CreateBlendState(&blend, &_blend))) {
+        return false;
+    }
+
+    // Line quads can come in either winding: no culling. Scissor: partial
+    // redraw only touches the damaged rectangles.
+    D3D11_RASTERIZER_DESC raster = {};
+    raster.FillMode = D3D11_FILL_SOLID;
+    raster.CullMode = D3D11_CULL_NONE;
+    raster.DepthClipEnable = TRUE;
+    raster.ScissorEnable = TRUE;
+    if (FAILED(device->CreateRasterizerState(&raster, &_rasterizer))) {
+        return false;
+    }
+
+    // Nearest texel, like the software renderer
+    D3D11_SAMPLER_DESC sampler = {};
+    sampler.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+    sampler.AddressU = sampler.AddressV = sampler.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+    sampler.MaxLOD = D3D11_FLOAT32_MAX;
+    return SUCCEEDED(device->CreateSamplerState(&sampler, &_sampler));
+}
+
+// ****************************************************************************
+
+bool Draw_d3d11::reserve_quads(std::size_t quads)
+{
+    if (quads <= _quad_capacity) {
+        return true;
+    }
+    std::size_t capacity = _quad_capacity ? _quad_capacity : 1024;
+    while (capacity < quads) {
+        capacity *= 2;
+    }
+
+    // Written every frame by the CPU, read once by the GPU
+    D3D11_BUFFER_DESC vb = {};
+    vb.ByteWidth = UINT(capacity * 4 * sizeof(Draw_vertex));
+    vb.Usage = D3D11_USAGE_DYNAMIC;
+    vb.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    vb.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+    // Same two triangles for every quad: 0 1 2, 2 1 3
+    std::vector<uint32_t> indices(capacity * 6);
+    for (std::size_t q = 0; q < capacity; ++q) {
+        const uint32_t v = uint32_t(q * 4);
+        uint32_t* i = &indices[q * 6];
+        i[0] = v;     i[1] = v + 1; i[2] = v + 2;
+        i[3] = v + 2; i[4] = v + 1; i[5] = v + 3;
+    }
+    D3D11_BUFFER_DESC ib = {};
+    ib.ByteWidth = UINT(indices.size() * sizeof(uint32_t));
+    ib.Usage = D3D11_USAGE_IMMUTABLE;
+    ib.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    D3D11_SUBRESOURCE_DATA data = {};
+    data.pSysMem = indices.data();
+
+    ComPtr<ID3D11Buffer> vertices, index_buffer;
+    if (FAILED(_device->CreateBuffer(&vb, nullptr, &vertices)) ||
+        FAILED(_device->CreateBuffer(&ib, &data, &index_buffer)))
+    {
+        return false;
+    }
+    _vertices = vertices;
+    _indices = index_buffer;
+    _quad_capacity = capacity;
+    return true;
+}
+
+// ****************************************************************************
+
+void Draw_d3d11::set_texture(uint16_t id, const Draw_texture& texture)
+{
+    if (id >= _textures.size()) {
+        _textures.resize(std::size_t(id) + 1);
+    }
+    Texture& t = _textures[id];
+    if (!texture.pixels) {
+        t = Texture();
+        return;
+    }
+    if (t.texture && t.width == texture.width && t.height == texture.height) {
+        // Same size: update in place (e.g. glyphs added to the atlas)
+        ID3D11DeviceContext* context = nullptr;
+        _device->GetImmediateContext(&context);
+        context->UpdateSubresource(t.texture.Get(), 0, nullptr, texture.pixels, UINT(texture.stride), 0);
+        context->Release();
+        return;
+    }
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = UINT(texture.width);
+    desc.Height = UINT(texture.height);
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = DXGI_FORMAT_R8_UNORM;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    D3D11_SUBRESOURCE_DATA data = {};
+    data.pSysMem = texture.pixels;
+    data.SysMemPitch = UINT(texture.stride);
+
+    Texture created;
+    if (FAILED(_device->CreateTexture2D(&desc, &data, &created.texture)) ||
+        FAILED(_device->CreateShaderResourceView(created.texture.Get(), nullptr, &created.view)))
+    {
+        t = Texture();
+        return;
+    }
+    created.width = texture.width;
+    created.height = texture.height;
+    t = created;
+}
+
+// ****************************************************************************
+
+void Draw_d3d11::execute(ID3D11DeviceContext* context, const Draw_list& list,
+                         const Draw_batches& batches, int width, int height,
+                         const Damage_region* clip)
+{
+    if (batches.count == 0 || width <= 0 || height <= 0 || !reserve_quads(batches.count)) {
+        return;
+    }
+
+    // 1. Every quad, in sorted order, in one upload
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (FAILED(context->Map(_vertices.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+        return;
+    }
+    Draw_vertex* vertices = (Draw_vertex*)mapped.pData;
+    for (std::size_t k = 0; k < batches.count; ++k) {
+        list.quad(batches.order[k], vertices + k * 4);
+    }
+    context->Unmap(_vertices.Get(), 0);
+
+    // 2. States shared by every batch
+    const float viewport[4] = { 2.0f / float(width), -2.0f / float(height), 0.0f, 0.0f };
+    context->UpdateSubresource(_constants.Get(), 0, nullptr, viewport, 0, 0);
+
+    const UINT stride = sizeof(Draw_vertex);
+    const UINT offset = 0;
+    context->IASetInputLayout(_layout.Get());
+    context->IASetVertexBuffers(0, 1, _vertices.GetAddressOf(), &stride, &offset);
+    context->IASetIndexBuffer(_indices.Get(), DXGI_FORMAT_R32_UINT, 0);
+    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    context->VSSetShader(_vertex_shader.Get(), nullptr, 0);
+    context->VSSetConstantBuffers(0, 1, _constants.GetAddressOf());
+    context->RSSetState(_rasterizer.Get());
+    context->OMSetBlendState(_blend.Get(), nullptr, 0xFFFFFFFF);
+    context->PSSetSamplers(0, 1, _sampler.GetAddressOf());
+
+    // 3. One draw call per batch, once per clip rectangle: a viewport has
+    //    a single scissor rectangle, not a list
+    D3D11_RECT full = { 0, 0, LONG(width), LONG(height) };
+    const int clip_count = clip ? clip->count() : 1;
+    for (int c = 0; c < clip_count; ++c)
+    {
+        D3D11_RECT scissor = full;
+        if (clip) {
+            const Damage_rect& r = (*clip)[c];
+            scissor = { LONG(r.x0), LONG(r.y0), LONG(r.x1), LONG(r.y1) };
+        }
+        context->RSSetScissorRects(1, &scissor);
+
+        ID3D11PixelShader* current = nullptr;
+        for (std::size_t b = 0; b < batches.batch_count; ++b)
+        {
+            const Draw_batch& batch = batches.batches[b];
+            ID3D11PixelShader* shader = _pixel_shaders[int(batch.pipeline)].Get();
+            if (shader != current) {
+                context->PSSetShader(shader, nullptr, 0);
+                current = shader;
+            }
+            if (batch.pipeline == Draw_pipeline::TEXT) {
+                ID3D11ShaderResourceView* view = batch.texture < _textures.size() ? _textures[batch.texture].view.Get() : nullptr;
+                context->PSSetShaderResources(0, 1, &view);
+            }
+            context->DrawIndexed(batch.count * 6, batch.first * 6, 0);
+        }
+    }
+}
+
+#endif
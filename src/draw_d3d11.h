@@ -0,0 +1,67 @@
+#pragma once
+
+// Draw_list executed with Direct3D 11.
+//
+// Every frame the quads of all commands are written, in sorted order, to
+// one dynamic vertex buffer (Map() with D3D11_MAP_WRITE_DISCARD, no stall).
+// Then each Draw_batch is a single DrawIndexed() over its range of quads:
+// the number of draw calls is the number of batches, not of primitives.
+//
+// Two pixel shaders: SOLID returns the vertex color, TEXT multiplies the
+// vertex color's alpha by an 8 bit coverage texture (DXGI_FORMAT_R8_UNORM).
+// Shaders are compiled at init() with D3DCompile().
+
+#ifdef _WIN32
+
+#include "damage_region.h"
+#include "draw_list.h"
+#include "platform.h"
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include <vector>
+
+class Draw_d3d11 {
+public:
+    /// @return false if the shaders or states could not be created
+    bool init(ID3D11Device* device);
+
+    /// Upload (or replace) the coverage texture 'id'
+    void set_texture(uint16_t id, const Draw_texture& texture);
+
+    /// Draw into the render target currently bound to 'context'
+    /// @param width, height : viewport size in pixels
+    /// @param clip : only draw inside these rectangles, NULL for everywhere
+    void execute(ID3D11DeviceContext* context, const Draw_list& list,
+                 const Draw_batches& batches, int width, int height,
+                 const Damage_region* clip = nullptr);
+
+private:
+    bool reserve_quads(std::size_t quads);
+
+    template<class T> using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+    ComPtr<ID3D11Device> _device;
+    ComPtr<ID3D11VertexShader> _vertex_shader;
+    ComPtr<ID3D11PixelShader> _pixel_shaders[2]; ///< by Draw_pipeline
+    ComPtr<ID3D11InputLayout> _layout;
+    ComPtr<ID3D11Buffer> _constants;
+    ComPtr<ID3D11BlendState> _blend;
+    ComPtr<ID3D11RasterizerState> _rasterizer;
+    ComPtr<ID3D11SamplerState> _sampler;
+
+    ComPtr<ID3D11Buffer> _vertices;
+    ComPtr<ID3D11Buffer> _indices;
+    std::size_t _quad_capacity = 0;
+
+    struct Texture {
+        ComPtr<ID3D11Texture2D> texture;
+        ComPtr<ID3D11ShaderResourceView> view;
+        int width = 0;
+        int height = 0;
+    };
+    std::vector<Texture> _textures;
+};
+
+#endif
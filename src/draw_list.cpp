@@ -0,0 +1,228 @@
+#include "draw_list.h"
+
+#include <cmath>
+#include <cstring>
+
+// ****************************************************************************
+
+namespace {
+
+uint32_t float_bits(float f)
+{
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+/// Index of the first pixel whose center (x + 0.5) is at or after 'v'
+int pixel_start(float v)
+{
+    return int(std::ceil(v - 0.5f));
+}
+
+/// Stable LSD radix sort of 'order' by keys[order[i]], one byte per pass.
+/// Passes where every key has the same byte are skipped (e.g. a single
+/// layer or a single texture).
+void radix_sort(const uint32_t* keys, uint32_t* order, uint32_t* temp, std::size_t count)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        std::size_t histogram[256] = {};
+        for (std::size_t i = 0; i < count; ++i) {
+            histogram[(keys[order[i]] >> shift) & 0xFF]++;
+        }
+        if (histogram[(keys[order[0]] >> shift) & 0xFF] == count) {
+            continue;
+        }
+        std::size_t offset = 0;
+        for (std::size_t& h : histogram) {
+            std::size_t n = h;
+            h = offset;
+            offset += n;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            temp[histogram[(keys[order[i]] >> shift) & 0xFF]++] = order[i];
+        }
+        std::memcpy(order, temp, count * sizeof(uint32_t));
+    }
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+Draw_list::Draw_list(Linear_arena& arena, std::size_t reserve)
+    : _arena(&arena)
+    , _key(arena, reserve), _type(arena, reserve)
+    , _x0(arena, reserve), _y0(arena, reserve), _x1(arena, reserve), _y1(arena, reserve)
+    , _color(arena, reserve), _aux(arena, reserve), _uv(arena)
+{ }
+
+// ****************************************************************************
+
+void Draw_list::push(uint32_t key, Draw_type type, float x0, float y0, float x1, float y1,
+                     uint32_t color, uint32_t aux)
+{
+    _key.push_back(key);
+    _type.push_back(type);
+    _x0.push_back(x0);
+    _y0.push_back(y0);
+    _x1.push_back(x1);
+    _y1.push_back(y1);
+    _color.push_back(color);
+    _aux.push_back(aux);
+    _sorted = false;
+}
+
+// ****************************************************************************
+
+void Draw_list::rect(float x, float y, float width, float height, uint32_t color)
+{
+    push(make_key(_layer, Draw_pipeline::SOLID, 0), DRAW_RECT,
+         x, y, x + width, y + height, color, 0);
+}
+
+// ****************************************************************************
+
+void Draw_list::line(float x0, float y0, float x1, float y1, float thickness, uint32_t color)
+{
+    push(make_key(_layer, Draw_pipeline::SOLID, 0), DRAW_LINE,
+         x0, y0, x1, y1, color, float_bits(thickness));
+}
+
+// ****************************************************************************
+
+void Draw_list::glyph(float x, float y, float width, float height, const Draw_uv& uv,
+                      uint16_t texture, uint32_t color)
+{
+    push(make_key(_layer, Draw_pipeline::TEXT, texture), DRAW_GLYPH,
+         x, y, x + width, y + height, color, uint32_t(_uv.size()));
+    _uv.push_back(uv);
+}
+
+// ****************************************************************************
+
+float Draw_list::thickness(uint32_t i) const
+{
+    float f;
+    std::memcpy(&f, &_aux[i], sizeof(f));
+    return f;
+}
+
+// ****************************************************************************
+
+void Draw_list::quad(uint32_t i, Draw_vertex out[4]) const
+{
+    const uint32_t c = _color[i];
+    if (_type[i] == DRAW_LINE)
+    {
+        // Offset both end points by half the thickness along the normal
+        float dx = _x1[i] - _x0[i];
+        float dy = _y1[i] - _y0[i];
+        float length = std::sqrt(dx * dx + dy * dy);
+        if (length > 0.0f) {
+            dx /= length;
+            dy /= length;
+        } else {
+            dx = 1.0f;
+            dy = 0.0f;
+        }
+        const float h = thickness(i) * 0.5f;
+        const float nx = -dy * h, ny = dx * h;
+        out[0] = { _x0[i] + nx, _y0[i] + ny, 0.0f, 0.0f, c };
+        out[1] = { _x1[i] + nx, _y1[i] + ny, 0.0f, 0.0f, c };
+        out[2] = { _x0[i] - nx, _y0[i] - ny, 0.0f, 0.0f, c };
+        out[3] = { _x1[i] - nx, _y1[i] - ny, 0.0f, 0.0f, c };
+        return;
+    }
+    Draw_uv uv = { 0.0f, 0.0f, 0.0f, 0.0f };
+    if (_type[i] == DRAW_GLYPH) {
+        uv = _uv[_aux[i]];
+    }
+    out[0] = { _x0[i], _y0[i], uv.u0, uv.v0, c };
+    out[1] = { _x1[i], _y0[i], uv.u1, uv.v0, c };
+    out[2] = { _x0[i], _y1[i], uv.u0, uv.v1, c };
+    out[3] = { _x1[i], _y1[i], uv.u1, uv.v1, c };
+}
+
+// ****************************************************************************
+
+void Draw_list::bounds(uint32_t i, int& x0, int& y0, int& x1, int& y1) const
+{
+    float fx0 = _x0[i], fy0 = _y0[i], fx1 = _x1[i], fy1 = _y1[i];
+    if (_type[i] == DRAW_LINE) {
+        // Conservative: end points grown by half the thickness
+        const float h = thickness(i) * 0.5f;
+        fx0 = std::fmin(_x0[i], _x1[i]) - h;
+        fx1 = std::fmax(_x0[i], _x1[i]) + h;
+        fy0 = std::fmin(_y0[i], _y1[i]) - h;
+        fy1 = std::fmax(_y0[i], _y1[i]) + h;
+    }
+    x0 = pixel_start(fx0);
+    y0 = pixel_start(fy0);
+    x1 = pixel_start(fx1);
+    y1 = pixel_start(fy1);
+}
+
+// ****************************************************************************
+
+const Draw_batches& Draw_list::sort_and_merge()
+{
+    if (_sorted) {
+        return _batches;
+    }
+    const std::size_t count = _key.size();
+    _batches = Draw_batches();
+    _batches.count = count;
+    _sorted = true;
+    if (count == 0) {
+        return _batches;
+    }
+
+    // Draw calls we would issue in recording order
+    const uint32_t* keys = _key.data();
+    std::size_t unsorted = 1;
+    bool in_order = true;
+    for (std::size_t i = 1; i < count; ++i) {
+        unsorted += ((keys[i] ^ keys[i - 1]) & STATE_MASK) != 0;
+        in_order = in_order && keys[i - 1] <= keys[i];
+    }
+    _batches.unsorted_batch_count = unsorted;
+
+    uint32_t* order = _arena->allocate_array<uint32_t>(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        order[i] = uint32_t(i);
+    }
+    // Often already in order (e.g. a frame of flat rectangles): no need
+    // to sort.
+    if (!in_order) {
+        uint32_t* temp = _arena->allocate_array<uint32_t>(count);
+        radix_sort(keys, order, temp, count);
+    }
+
+    // Merge runs of identical pipeline / texture
+    std::size_t runs = 1;
+    for (std::size_t i = 1; i < count; ++i) {
+        runs += ((keys[order[i]] ^ keys[order[i - 1]]) & STATE_MASK) != 0;
+    }
+    Draw_batch* batches = _arena->allocate_array<Draw_batch>(runs);
+    std::size_t batch_count = 0;
+    uint32_t state = ~0u;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const uint32_t key = keys[order[i]];
+        if ((key & STATE_MASK) != state) {
+            state = key & STATE_MASK;
+            Draw_batch& b = batches[batch_count++];
+            b.pipeline = pipeline_of(key);
+            b.texture = texture_of(key);
+            b.first = uint32_t(i);
+            b.count = 0;
+        }
+        batches[batch_count - 1].count++;
+    }
+    _batches.order = order;
+    _batches.batches = batches;
+    _batches.batch_count = batch_count;
+    return _batches;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+// Immediate mode 2D draw list.
+//
+// Each frame the code records rectangles, lines and glyph quads:
+//
+//     Draw_list list(arena);                 // memory from a Linear_arena
+//     list.rect(10, 10, 100, 20, 0xFF3060A0);
+//     list.line(0, 0, 200, 100, 2.0f, 0xFFFFFFFF);
+//     list.glyph(x, y, w, h, uv, atlas_texture, 0xFFFFFFFF);
+//     renderer->submit(list);                // sort, merge, draw
+//
+// Commands are stored as a structure of arrays (one array per field): the
+// sort only reads the 'key' array and each backend only touches the fields
+// it needs.
+//
+// Before drawing, commands are sorted by key (layer, then pipeline, then
+// texture) and consecutive commands sharing the same pipeline and texture
+// are merged into one Draw_batch, i.e. one draw call on the GPU whatever
+// the number of primitives. The sort is stable: within a layer, commands
+// with the same pipeline / texture keep their recording order, but e.g.
+// text (Draw_pipeline::TEXT) is drawn after the rectangles (SOLID) of the
+// same layer. Use set_layer() when something must be drawn on top.
+//
+// Executed by Renderer::submit() (renderer.h): Draw_software on the CPU,
+// Draw_d3d11 with Direct3D 11.
+//
+// Coordinates are in pixels, origin at the top left of the client area.
+// Colors are 0xAARRGGBB with straight (non premultiplied) alpha.
+
+#include "frame_arena.h"
+
+#include <cstddef>
+#include <cstdint>
+
+enum class Draw_pipeline : uint8_t {
+    SOLID = 0, ///< flat colored triangles (rectangles and lines)
+    TEXT  = 1  ///< color * coverage of an 8 bit alpha texture
+};
+
+enum Draw_type : uint8_t {
+    DRAW_RECT,
+    DRAW_LINE,
+    DRAW_GLYPH
+};
+
+/// Texture coordinates in [0, 1] of a glyph quad
+struct Draw_uv {
+    float u0, v0, u1, v1;
+};
+
+/// A corner of a command's quad, as uploaded to the GPU
+struct Draw_vertex {
+    float x, y;
+    float u, v;
+    uint32_t color;
+};
+
+/// 8 bits per pixel coverage texture (glyph atlas)
+struct Draw_texture {
+    const uint8_t* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int stride = 0; ///< bytes between two rows
+};
+
+/// Consecutive commands (in sorted order) drawn with one draw call
+struct Draw_batch {
+    Draw_pipeline pipeline;
+    uint16_t texture;
+    uint32_t first; ///< index in Draw_batches::order
+    uint32_t count;
+};
+
+/// Result of Draw_list::sort_and_merge()
+struct Draw_batches {
+    const uint32_t* order = nullptr;    ///< command indices, sorted
+    std::size_t count = 0;              ///< number of commands
+    const Draw_batch* batches = nullptr;
+    std::size_t batch_count = 0;
+    /// Draw calls needed without sorting (state changes in recording order)
+    std::size_t unsorted_batch_count = 0;
+};
+
+// ****************************************************************************
+
+class Draw_list {
+public:
+    /// Every array is allocated in 'arena': the list must not outlive the
+    /// arena's next reset().
+    explicit Draw_list(Linear_arena& arena, std::size_t reserve = 256);
+
+    /// Commands recorded from now on are drawn after those of lower layers
+    void set_layer(uint8_t layer) { _layer = layer; }
+
+    void rect(float x, float y, float width, float height, uint32_t color);
+
+    /// Segment of 'thickness' pixels between (x0, y0) and (x1, y1)
+    void line(float x0, float y0, float x1, float y1, float thickness, uint32_t color);
+
+    /// Quad textured with a Draw_texture given to Renderer::set_texture()
+    void glyph(float x, float y, float width, float height, const Draw_uv& uv,
+               uint16_t texture, uint32_t color);
+
+    std::size_t size() const { return _key.size(); }
+    bool empty() const { return _key.empty(); }
+
+    /// Sort the commands and group them in batches. Recording more commands
+    /// afterward is allowed, the next call sorts again.
+    const Draw_batches& sort_and_merge();
+
+    // -------------------------------------------------------------------------
+    /// @name Command fields (structure of arrays), indexed by command
+    // -------------------------------------------------------------------------
+
+    uint32_t key(uint32_t i) const { return _key[i]; }
+    Draw_type type(uint32_t i) const { return Draw_type(_type[i]); }
+    /// Rectangle and glyph: top left / bottom right. Line: end points
+    float x0(uint32_t i) const { return _x0[i]; }
+    float y0(uint32_t i) const { return _y0[i]; }
+    float x1(uint32_t i) const { return _x1[i]; }
+    float y1(uint32_t i) const { return _y1[i]; }
+    uint32_t color(uint32_t i) const { return _color[i]; }
+    /// DRAW_LINE only
+    float thickness(uint32_t i) const;
+    /// DRAW_GLYPH only
+    const Draw_uv& uv(uint32_t i) const { return _uv[_aux[i]]; }
+
+    /// The 4 corners of command 'i': top left, top right, bottom left,
+    /// bottom right (two triangles: 0 1 2, 2 1 3)
+    void quad(uint32_t i, Draw_vertex out[4]) const;
+
+    /// Pixel bounding box [x0, x1) x [y0, y1) of command 'i' (not clipped)
+    void bounds(uint32_t i, int& x0, int& y0, int& x1, int& y1) const;
+
+    // -------------------------------------------------------------------------
+    /// @name Sort key: layer | pipeline | texture
+    // -------------------------------------------------------------------------
+
+    static const uint32_t STATE_MASK = 0x00FFFFF0u; ///< what splits batches
+
+    static uint32_t make_key(uint8_t layer, Draw_pipeline pipeline, uint16_t texture) {
+        return (uint32_t(layer) << 24) | (uint32_t(pipeline) << 20) | (uint32_t(texture) << 4);
+    }
+    static Draw_pipeline pipeline_of(uint32_t key) { return Draw_pipeline((key >> 20) & 0xF); }
+    static uint16_t texture_of(uint32_t key) { return uint16_t(key >> 4); }
+
+private:
+    void push(uint32_t key, Draw_type type, float x0, float y0, float x1, float y1,
+              uint32_t color, uint32_t aux);
+
+    Linear_arena* _arena;
+    uint8_t _layer = 0;
+
+    Arena_vector<uint32_t> _key;
+    Arena_vector<uint8_t> _type;
+    Arena_vector<float> _x0, _y0, _x1, _y1;
+    Arena_vector<uint32_t> _color;
+    /// DRAW_LINE: thickness (float bits), DRAW_GLYPH: index in '_uv'
+    Arena_vector<uint32_t> _aux;
+    Arena_vector<Draw_uv> _uv;
+
+    Draw_batches _batches;
+    bool _sorted = false;
+};
@@ -0,0 +1,242 @@
+#include "draw_software.h"
+
+#include "framebuffer.h"
+#include "simd_kernels.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <cmath>
+
+// ****************************************************************************
+
+namespace {
+
+const int TILE = Framebuffer::TILE_SIZE;
+
+/// Index of the first pixel whose center (x + 0.5) is at or after 'v'
+int pixel_start(float v)
+{
+    return int(std::ceil(v - 0.5f));
+}
+
+/// Fill or blend [x0, x1) of row 'py' in the tile, 'color' is a span of
+/// TILE pixels of the same color
+void solid_span(uint32_t* tile, int ox, int oy, int py, int x0, int x1,
+                const uint32_t* color, bool opaque, const Span_kernels& k)
+{
+    uint32_t* dst = tile + (py - oy) * TILE + (x0 - ox);
+    if (opaque) {
+        k.fill(dst, std::size_t(x1 - x0), color[0]);
+    } else {
+        k.blend(dst, color, std::size_t(x1 - x0));
+    }
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+void Draw_software::set_texture(uint16_t id, const Draw_texture& texture)
+{
+    if (id >= _textures.size()) {
+        _textures.resize(std::size_t(id) + 1);
+    }
+    _textures[id] = texture;
+}
+
+// ****************************************************************************
+
+void Draw_software::execute(const Draw_list& list, const Draw_batches& batches,
+                            Framebuffer& target, Job_system* jobs)
+{
+    const int width = target.width();
+    const int height = target.height();
+    const int tile_count = target.tile_count();
+    if (batches.count == 0 || tile_count == 0) {
+        return;
+    }
+    _tiles_x = target.tiles_x();
+
+    // 1. Tile range of every command, and how many commands per tile
+    _tile_range.resize(batches.count);
+    _tile_start.assign(std::size_t(tile_count) + 1, 0);
+    for (std::size_t k = 0; k < batches.count; ++k)
+    {
+        int x0, y0, x1, y1;
+        list.bounds(batches.order[k], x0, y0, x1, y1);
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, width);
+        y1 = std::min(y1, height);
+        if (x0 >= x1 || y0 >= y1) {
+            _tile_range[k] = ~0ull; // off screen
+            continue;
+        }
+        const uint64_t tx0 = uint64_t(x0 / TILE), tx1 = uint64_t((x1 - 1) / TILE);
+        const uint64_t ty0 = uint64_t(y0 / TILE), ty1 = uint64_t((y1 - 1) / TILE);
+        _tile_range[k] = tx0 | (ty0 << 16) | (tx1 << 32) | (ty1 << 48);
+        for (uint64_t ty = ty0; ty <= ty1; ++ty) {
+            for (uint64_t tx = tx0; tx <= tx1; ++tx) {
+                _tile_start[ty * _tiles_x + tx + 1]++;
+            }
+        }
+    }
+
+    // 2. Prefix sum, then scatter the commands (in sorted order) per tile
+    for (int t = 0; t < tile_count; ++t) {
+        _tile_start[t + 1] += _tile_start[t];
+    }
+    _tile_items.resize(_tile_start[tile_count]);
+    _tile_fill.assign(_tile_start.begin(), _tile_start.end() - 1);
+    for (std::size_t k = 0; k < batches.count; ++k)
+    {
+        const uint64_t r = _tile_range[k];
+        if (r == ~0ull) {
+            continue;
+        }
+        const int tx0 = int(r & 0xFFFF), ty0 = int((r >> 16) & 0xFFFF);
+        const int tx1 = int((r >> 32) & 0xFFFF), ty1 = int(r >> 48);
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                _tile_items[_tile_fill[ty * _tiles_x + tx]++] = batches.order[k];
+            }
+        }
+    }
+
+    // 3. Rasterize the tiles in parallel, the undamaged ones keep their
+    //    pixels (partial redraw, see Framebuffer::set_damage())
+    auto run_tile = [&](std::size_t t) {
+        const int tx = int(t) % _tiles_x, ty = int(t) / _tiles_x;
+        if (target.tile_damaged(tx, ty)) {
+            draw_tile(list, tx, ty, target);
+        }
+    };
+    if (jobs && tile_count > 1) {
+        jobs->parallel_for(std::size_t(tile_count), run_tile);
+    } else {
+        for (int t = 0; t < tile_count; ++t) {
+            run_tile(std::size_t(t));
+        }
+    }
+}
+
+// ****************************************************************************
+
+void Draw_software::draw_tile(const Draw_list& list, int tx, int ty, Framebuffer& target) const
+{
+    const uint32_t t = uint32_t(ty * _tiles_x + tx);
+    const uint32_t begin = _tile_start[t], end = _tile_start[t + 1];
+    if (begin == end) {
+        return;
+    }
+    uint32_t* tile = target.tile(tx, ty);
+    const Span_kernels& k = span_kernels();
+
+    // Pixels of the tile inside the framebuffer
+    const int ox = tx * TILE, oy = ty * TILE;
+    const int cx0 = ox, cy0 = oy;
+    const int cx1 = std::min(ox + TILE, target.width());
+    const int cy1 = std::min(oy + TILE, target.height());
+
+    uint32_t span[TILE];
+    for (uint32_t item = begin; item < end; ++item)
+    {
+        const uint32_t i = _tile_items[item];
+        const uint32_t color = list.color(i);
+        const bool opaque = (color >> 24) == 0xFF;
+        if ((color >> 24) == 0) {
+            continue;
+        }
+        int x0, y0, x1, y1;
+        list.bounds(i, x0, y0, x1, y1);
+        x0 = std::max(x0, cx0);
+        y0 = std::max(y0, cy0);
+        x1 = std::min(x1, cx1);
+        y1 = std::min(y1, cy1);
+        if (x0 >= x1 || y0 >= y1) {
+            continue;
+        }
+
+        switch (list.type(i))
+        {
+        case DRAW_RECT:
+        {
+            if (!opaque) {
+                k.fill(span, std::size_t(x1 - x0), color);
+            } else {
+                span[0] = color;
+            }
+            for (int py = y0; py < y1; ++py) {
+                solid_span(tile, ox, oy, py, x0, x1, span, opaque, k);
+            }
+        }break;
+
+        case DRAW_LINE:
+        {
+            // Scan the convex quad: for each row intersect the pixel center
+            // line with the 4 edges
+            Draw_vertex q[4];
+            list.quad(i, q);
+            const Draw_vertex* loop[4] = { &q[0], &q[1], &q[3], &q[2] };
+            k.fill(span, TILE, color);
+            for (int py = y0; py < y1; ++py)
+            {
+                const float yc = float(py) + 0.5f;
+                float xmin = 1e30f, xmax = -1e30f;
+                for (int e = 0; e < 4; ++e) {
+                    const Draw_vertex& a = *loop[e];
+                    const Draw_vertex& b = *loop[(e + 1) & 3];
+                    if ((a.y <= yc && b.y > yc) || (b.y <= yc && a.y > yc)) {
+                        const float x = a.x + (yc - a.y) * (b.x - a.x) / (b.y - a.y);
+                        xmin = std::min(xmin, x);
+                        xmax = std::max(xmax, x);
+                    }
+                }
+                if (xmin > xmax) {
+                    continue;
+                }
+                const int sx0 = std::max(pixel_start(xmin), x0);
+                const int sx1 = std::min(pixel_start(xmax), x1);
+                if (sx0 < sx1) {
+                    solid_span(tile, ox, oy, py, sx0, sx1, span, opaque, k);
+                }
+            }
+        }break;
+
+        case DRAW_GLYPH:
+        {
+            const uint16_t id = Draw_list::texture_of(list.key(i));
+            if (id >= _textures.size() || !_textures[id].pixels) {
+                break;
+            }
+            // Nearest texel: glyphs are drawn at the atlas resolution
+            const Draw_texture& tex = _textures[id];
+            const Draw_uv& uv = list.uv(i);
+            const float gx0 = list.x0(i), gy0 = list.y0(i);
+            const float du = (uv.u1 - uv.u0) / (list.x1(i) - gx0);
+            const float dv = (uv.v1 - uv.v0) / (list.y1(i) - gy0);
+            const uint32_t rgb = color & 0x00FFFFFF;
+            const uint32_t alpha = color >> 24;
+            // Texel columns are the same for every row
+            int columns[TILE];
+            for (int px = x0; px < x1; ++px) {
+                const float u = uv.u0 + (float(px) + 0.5f - gx0) * du;
+                columns[px - x0] = std::min(std::max(int(u * float(tex.width)), 0), tex.width - 1);
+            }
+            for (int py = y0; py < y1; ++py)
+            {
+                const float v = uv.v0 + (float(py) + 0.5f - gy0) * dv;
+                const int row = std::min(std::max(int(v * float(tex.height)), 0), tex.height - 1);
+                const uint8_t* texels = tex.pixels + std::size_t(row) * std::size_t(tex.stride);
+                for (int px = 0; px < x1 - x0; ++px) {
+                    // alpha * coverage / 255, rounded
+                    uint32_t a = alpha * texels[columns[px]] + 128;
+                    a = (a + (a >> 8)) >> 8;
+                    span[px] = (a << 24) | rgb;
+                }
+                k.blend(tile + (py - oy) * TILE + (x0 - ox), span, std::size_t(x1 - x0));
+            }
+        }break;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// Draw_list executed on the CPU, into a tiled Framebuffer.
+//
+// The sorted commands are first binned per tile: each tile gets the list
+// of commands overlapping it, in draw order. Tiles are then rasterized in
+// parallel, each by one thread, so no two threads ever write to the same
+// pixels and a 64 x 64 tile stays in cache while all of its commands are
+// drawn.
+//
+// Batches don't matter here (there is no pipeline to switch on the CPU),
+// only the sorted order does. Rectangles and glyphs are axis aligned, lines
+// are rasterized as a convex quad; a pixel is covered when its center is
+// inside (no anti-aliasing).
+
+#include "draw_list.h"
+
+#include <cstdint>
+#include <vector>
+
+class Framebuffer;
+class Job_system;
+
+class Draw_software {
+public:
+    /// Coverage texture for glyphs using 'id'. The pixels must stay valid
+    /// until replaced.
+    void set_texture(uint16_t id, const Draw_texture& texture);
+
+    /// @param jobs : threads processing the tiles, may be NULL
+    void execute(const Draw_list& list, const Draw_batches& batches,
+                 Framebuffer& target, Job_system* jobs);
+
+private:
+    void draw_tile(const Draw_list& list, int tx, int ty, Framebuffer& target) const;
+
+    std::vector<Draw_texture> _textures;
+
+    // Binning, kept from one frame to the next to avoid reallocations
+    std::vector<uint64_t> _tile_range;  ///< per sorted command: tx0 ty0 tx1 ty1
+    std::vector<uint32_t> _tile_start;  ///< per tile: first item in '_tile_items'
+    std::vector<uint32_t> _tile_items;  ///< command indices grouped per tile
+    std::vector<uint32_t> _tile_fill;   ///< per tile: next free item (scatter)
+    int _tiles_x = 0;
+};
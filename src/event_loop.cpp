@@ -0,0 +1,253 @@
+#include "event_loop.h"
+
+#include "input_log.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// Can 'next' replace 'prev' without changing the outcome? i.e. only the
+/// latest state matters (position of the mouse, size of the window)
+bool is_redundant(const MSG& prev, const MSG& next)
+{
+    if (prev.message != next.message || prev.hwnd != next.hwnd) {
+        return false;
+    }
+    // wParam holds the state of the mouse buttons / modifier keys for
+    // WM_MOUSEMOVE and the kind of resize (minimized, maximized...)
+    // for WM_SIZE. If it changes the message is not redundant.
+    return (next.message == WM_MOUSEMOVE || next.message == WM_SIZE) &&
+           prev.wParam == next.wParam;
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int Event_loop::run()
+{
+    // Struct holding the value of a message such as:
+    // user events (e.g. mouse click, keyboard events)
+    // WM_LBUTTONDOWN (left button down)
+    // window events (e.g. closing/quiting window) WM_CLOSE / WM_QUIT
+    // system events
+    // https://docs.microsoft.com/en-us/windows/win32/learnwin32/window-messages
+    // https://docs.microsoft.com/en-us/windows/win32/api/winuser/ns-winuser-msg
+    //
+    // struct MSG {
+    //     // Handle to the window that received the message
+    //     // NULL from thread messages
+    //     HWND hwnd;
+    //     // Message type
+    //     UINT message;
+    //     // Additional parameters which values depends on
+    //     // the type of the message
+    //     WPARAM wParam;
+    //     LPARAM lParam;
+    //     // Time the message was posted
+    //     DWORD time;
+    //     // Cursor position when the message was posted
+    //     POINT pt;
+    //     // Internal value for the API (we can ignore it)
+    //     DWORD lPrivate;
+    // };
+    //
+    // Note: MSG msg = {}; zero fills the struct, this is equivalent to
+    // ZeroMemory(&msg, sizeof(MSG)) you will often see in Win32 samples.
+    MSG msg = {};
+
+    const Clock::time_point loop_start = Clock::now();
+
+    // Rendering loop:
+    while (msg.message != WM_QUIT)
+    {
+        bool has_message;
+        {
+            PROFILE_ZONE("pump");
+            has_message = _batched ? pump_all(msg) : pump_one(msg);
+        }
+
+        // WM_QUIT is never sent to a window procedure: it only tells us
+        // to leave the loop.
+        if (msg.message == WM_QUIT) {
+            break;
+        }
+
+        if (_pacer && !_pacer->frame_due(Clock::now()))
+        {
+            // Nothing to draw yet: instead of spinning we sleep until either
+            // a message arrives or the next frame deadline is reached.
+            // If we just handled a message we go back to the queue first, it
+            // may hold more.
+            if (!has_message) {
+                PROFILE_ZONE("wait");
+                _backend.wait(_pacer->seconds_until_due(Clock::now()));
+            }
+            continue;
+        }
+
+        end_frame_input();
+        _stats.frames++;
+        if (_on_frame)
+        {
+            PROFILE_ZONE("frame");
+            Clock::time_point t = Clock::now();
+            bool keep_going = _on_frame();
+            _stats.frame_seconds += seconds_since(t);
+            if (!keep_going) {
+                msg.wParam = 0;
+                break;
+            }
+        }
+        if (_pacer) {
+            _pacer->frame_done(Clock::now());
+        }
+        _input = Frame_input();
+    }
+
+    _stats.total_seconds += seconds_since(loop_start);
+
+    // When message == WM_QUIT then msg.wParam contains the value
+    // past to PostQuitMessage(value) which should be our exit value.
+    return (int)msg.wParam;
+}
+
+// ****************************************************************************
+
+bool Event_loop::pump_one(MSG& msg)
+{
+    if (!_backend.peek(msg)) {
+        return false;
+    }
+    if (_recorder) {
+        _recorder->record(msg);
+    }
+    if (msg.message != WM_QUIT) {
+        dispatch(msg);
+    }
+    return true;
+}
+
+// ****************************************************************************
+
+bool Event_loop::pump_all(MSG& msg)
+{
+    // We hold back the last coalescable message (e.g. WM_MOUSEMOVE) until we
+    // know the next one is not of the same kind. Only the latest of a run
+    // of identical messages reaches the window procedure.
+    // Note: we can't collect the whole queue first and dispatch afterwards:
+    // dispatching may post new messages (TranslateMessage() posts WM_CHAR
+    // for every WM_KEYDOWN) that must be handled this frame as well.
+    MSG held = {};
+    bool holding = false;
+    bool has_message = false;
+    while (_backend.peek(msg))
+    {
+        has_message = true;
+        if (_recorder) {
+            _recorder->record(msg);
+        }
+        if (msg.message == WM_QUIT) {
+            break;
+        }
+
+        if (holding)
+        {
+            if (is_redundant(held, msg)) {
+                // The older message still counts for the latency: the user
+                // produced it and waits for this frame to see the result.
+                account(held);
+                _input.coalesced++;
+                _stats.coalesced++;
+                held = msg;
+                continue;
+            }
+            dispatch(held);
+            holding = false;
+        }
+
+        if (msg.message == WM_MOUSEMOVE || msg.message == WM_SIZE) {
+            held = msg;
+            holding = true;
+        } else {
+            dispatch(msg);
+        }
+    }
+
+    if (holding) {
+        dispatch(held);
+    }
+    return has_message;
+}
+
+// ****************************************************************************
+
+void Event_loop::dispatch(MSG& msg)
+{
+    // How long the message waited in the queue before we got to it
+    PROFILE_COUNTER("queue age (ms)", uint64_t(std::max(0, (int32_t)(_backend.now_ms() - msg.time))));
+
+    Clock::time_point t = Clock::now();
+    _backend.dispatch(msg);
+    _stats.dispatch_seconds += seconds_since(t);
+    _stats.messages++;
+    account(msg);
+
+    if (_pacer) {
+        _pacer->on_message();
+    }
+}
+
+// ****************************************************************************
+
+void Event_loop::account(const MSG& msg)
+{
+    // MSG::time is a 32 bits millisecond counter that wraps around every
+    // 49.7 days, we only accumulate signed differences which keep working
+    // across the wrap.
+    if (_input.messages == 0) {
+        _input.first_time = msg.time;
+    }
+    int32_t offset = (int32_t)(msg.time - _input.first_time);
+    _input.oldest_offset = std::min(_input.oldest_offset, offset);
+    _input.offset_sum += offset;
+    _input.messages++;
+
+    switch (msg.message) {
+    case WM_MOUSEMOVE:
+        _input.mouse_moved = true;
+        _input.mouse = MAKEPOINTS(msg.lParam);
+        break;
+    case WM_SIZE:
+        _input.resized = true;
+        _input.size = MAKEPOINTS(msg.lParam);
+        break;
+    }
+}
+
+// ****************************************************************************
+
+void Event_loop::end_frame_input()
+{
+    if (_input.messages == 0) {
+        return;
+    }
+    double since_first = (double)(int32_t)(_backend.now_ms() - _input.first_time);
+    double oldest = since_first - double(_input.oldest_offset);
+    double sum = double(_input.messages) * since_first - double(_input.offset_sum);
+    _stats.latency_samples += _input.messages;
+    _stats.latency_sum_ms += sum;
+    if (oldest > _stats.latency_max_ms) {
+        _stats.latency_max_ms = oldest;
+    }
+}
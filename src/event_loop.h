@@ -0,0 +1,150 @@
+#pragma once
+
+// Platform-neutral main loop.
+//
+// The loop itself does not know about PeekMessage() or DispatchMessage():
+// it only talks to an 'Event_backend'. We provide two backends:
+// - Backend_win32    (backend_win32.h)    the real Windows message queue
+// - Backend_headless (backend_headless.h) replays a synthetic message stream
+//   so the loop can be measured on any machine (e.g. our Linux build farm)
+
+#include "platform.h"
+#include "frame_pacer.h"
+
+#include <cstdint>
+#include <functional>
+
+class Input_recorder;
+
+// ****************************************************************************
+
+// Where messages come from and where they go.
+class Event_backend {
+public:
+    virtual ~Event_backend() {}
+
+    // Remove the next pending message from the queue and copy it to 'msg'.
+    // returns false when the queue is empty (msg is left untouched).
+    virtual bool peek(MSG& msg) = 0;
+
+    // Hand the message over to the window procedure (i.e. 'event_handler()')
+    virtual void dispatch(MSG& msg) = 0;
+
+    // Block the calling thread until a message is available or until
+    // 'timeout_seconds' elapsed. A negative timeout means wait forever.
+    // Returns immediately if the queue is not empty.
+    virtual void wait(double timeout_seconds) = 0;
+
+    // Current time in the same unit and origin as 'MSG::time' (milliseconds)
+    // Used to measure how long a message waited before its frame ran.
+    virtual DWORD now_ms() const = 0;
+};
+
+// ****************************************************************************
+
+// Compact summary of the messages handled since the previous frame.
+// Redundant messages coalesced by the batched mode are folded in here.
+struct Frame_input {
+    uint32_t messages = 0;     ///< messages received (dispatched + coalesced) this frame
+    uint32_t coalesced = 0;    ///< ... of which redundant ones, dropped
+    bool mouse_moved = false;
+    POINTS mouse = {};         ///< last WM_MOUSEMOVE position (client coords)
+    bool resized = false;
+    POINTS size = {};          ///< last WM_SIZE client width (x) and height (y)
+    DWORD first_time = 0;      ///< 'MSG::time' of the first message
+    int32_t oldest_offset = 0; ///< oldest 'MSG::time' relative to first_time
+    int64_t offset_sum = 0;    ///< sum of 'MSG::time - first_time' (mean latency)
+};
+
+// ****************************************************************************
+
+// Counters updated by Event_loop::run()
+struct Loop_stats {
+    uint64_t messages = 0;        ///< messages dispatched
+    uint64_t frames = 0;          ///< loop iterations (i.e. frame callbacks)
+    double total_seconds = 0.0;   ///< wall clock time spent in run()
+    double dispatch_seconds = 0.0;///< time spent in Event_backend::dispatch()
+    double frame_seconds = 0.0;   ///< time spent in the frame callback
+    uint64_t coalesced = 0;       ///< messages dropped by the batched mode
+
+    // Input to frame latency: time between 'MSG::time' and the start of the
+    // frame that follows the message (milliseconds). Coalesced messages are
+    // sampled too: latency_samples = messages + coalesced
+    uint64_t latency_samples = 0;
+    double latency_sum_ms = 0.0;
+    double latency_max_ms = 0.0;
+
+    double mean_latency_ms() const {
+        return latency_samples > 0 ? latency_sum_ms / double(latency_samples) : 0.0;
+    }
+
+    double messages_per_second() const {
+        return total_seconds > 0.0 ? double(messages) / total_seconds : 0.0;
+    }
+
+    /// Average cost of one loop iteration minus the user's frame work.
+    /// This is the overhead of the loop itself (peek + dispatch + bookkeeping).
+    double frame_overhead_us() const {
+        return frames > 0 ? (total_seconds - frame_seconds) * 1e6 / double(frames) : 0.0;
+    }
+};
+
+// ****************************************************************************
+
+class Event_loop {
+public:
+    /// Per frame work. Return false to exit the loop.
+    typedef std::function<bool()> Frame_callback;
+
+    explicit Event_loop(Event_backend& backend) : _backend(backend) { }
+
+    void set_frame_callback(const Frame_callback& callback) { _on_frame = callback; }
+
+    /// Without a pacer (the default) a frame runs every iteration and the
+    /// loop never sleeps. With a pacer the loop sleeps in
+    /// Event_backend::wait() until input arrives or the next frame is due.
+    /// The pacer must outlive run().
+    void set_pacer(Frame_pacer* pacer) { _pacer = pacer; }
+
+    /// Batched mode: every pending message is dispatched before the frame
+    /// runs (instead of a single one per iteration) and consecutive
+    /// redundant messages (mouse moves, resizes) are coalesced into the
+    /// last one. A burst of N inputs then costs one frame of latency
+    /// instead of N.
+    void set_batched(bool state) { _batched = state; }
+
+    /// Write every message peeked from the backend (before coalescing) to
+    /// a log that Backend_replay can play back (see input_log.h).
+    /// nullptr stops recording.
+    void set_recorder(Input_recorder* recorder) { _recorder = recorder; }
+
+    /// Summary of the input handled since the last frame.
+    /// Valid inside the frame callback.
+    const Frame_input& frame_input() const { return _input; }
+
+    /// Run until WM_QUIT is received or the frame callback returns false.
+    /// @return the exit code: wParam of WM_QUIT (i.e. the value given to
+    /// PostQuitMessage()) or 0 when the frame callback stopped the loop.
+    int run();
+
+    const Loop_stats& stats() const { return _stats; }
+    void reset_stats() { _stats = Loop_stats(); }
+
+private:
+    /// Peek and dispatch a single message. @return true if there was one
+    bool pump_one(MSG& msg);
+    /// Drain the whole queue. @return true if at least one message was seen
+    bool pump_all(MSG& msg);
+    void dispatch(MSG& msg);
+    /// Fold the message into the frame input summary
+    void account(const MSG& msg);
+    void end_frame_input();
+
+    Event_backend& _backend;
+    Frame_callback _on_frame;
+    Frame_pacer* _pacer = nullptr;
+    Input_recorder* _recorder = nullptr;
+    bool _batched = false;
+    Frame_input _input;
+    Loop_stats _stats;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+// String with a fixed capacity stored inline (on the stack or inside another
+// object). Appending never allocates: text that does not fit is truncated.
+// Meant for small, frequently rebuilt strings such as status messages:
+//
+//     Fixed_string<64> str;
+//     str.append("x: ").append(p.x).append(" y: ").append(p.y);
+//     SetWindowTextA(hWnd, str.c_str());
+
+#include <cstddef>
+#include <cstring>
+
+template<std::size_t Capacity>
+class Fixed_string {
+public:
+    static_assert(Capacity > 0, "room is needed for the terminating zero");
+
+    Fixed_string() { clear(); }
+    Fixed_string(const char* str) { clear(); append(str); }
+
+    Fixed_string& clear() {
+        _size = 0;
+        _data[0] = '\0';
+        return *this;
+    }
+
+    Fixed_string& append(const char* str) {
+        std::size_t n = std::strlen(str);
+        return append(str, n);
+    }
+
+    Fixed_string& append(const char* str, std::size_t n) {
+        std::size_t room = Capacity - 1 - _size;
+        n = n < room ? n : room;
+        std::memcpy(_data + _size, str, n);
+        _size += n;
+        _data[_size] = '\0';
+        return *this;
+    }
+
+    Fixed_string& append(char c) { return append(&c, 1); }
+
+    Fixed_string& append(long long value) {
+        // Digits are produced backward in a local buffer, large enough for
+        // the 19 digits of 2^63 plus the sign.
+        char digits[24];
+        char* end = digits + sizeof(digits);
+        char* p = end;
+        unsigned long long v = value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value;
+        do {
+            *--p = char('0' + (v % 10));
+            v /= 10;
+        } while (v != 0);
+        if (value < 0) {
+            *--p = '-';
+        }
+        return append(p, std::size_t(end - p));
+    }
+
+    Fixed_string& append(int value)   { return append((long long)value); }
+    Fixed_string& append(short value) { return append((long long)value); }
+
+    const char* c_str() const { return _data; }
+    std::size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    static constexpr std::size_t capacity() { return Capacity - 1; }
+
+    bool operator==(const Fixed_string& other) const {
+        return _size == other._size && std::memcmp(_data, other._data, _size) == 0;
+    }
+    bool operator!=(const Fixed_string& other) const { return !(*this == other); }
+
+private:
+    std::size_t _size;
+    char _data[Capacity];
+};
@@ -0,0 +1,205 @@
+#include "frame_arena.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+// ****************************************************************************
+
+namespace {
+
+const uint8_t POISON_NEW  = 0xCD; ///< allocated, not written yet
+const uint8_t POISON_FREE = 0xDD; ///< released by reset()
+
+std::size_t align_up(std::size_t value, std::size_t align)
+{
+    return (value + align - 1) & ~(align - 1);
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+Linear_arena::Linear_arena(std::size_t capacity)
+{
+    _capacity = capacity;
+    _base = (uint8_t*)std::malloc(_capacity ? _capacity : 1);
+    if (!_base) {
+        throw std::bad_alloc();
+    }
+    _heap_allocations++;
+}
+
+// ****************************************************************************
+
+Linear_arena::~Linear_arena()
+{
+    reset();
+    std::free(_base);
+}
+
+// ****************************************************************************
+
+void* Linear_arena::allocate(std::size_t size, std::size_t align)
+{
+    _allocations++;
+    std::size_t offset = align_up(std::size_t(_base + _offset), align) - std::size_t(_base);
+    if (offset + size <= _capacity)
+    {
+        void* ptr = _base + offset;
+        _last = offset;
+        _offset = offset + size;
+#ifdef FRAME_ARENA_POISON
+        std::memset(ptr, POISON_NEW, size);
+#endif
+        return ptr;
+    }
+
+    // Doesn't fit: a heap block, freed by the next reset(). The header is
+    // padded so the user memory keeps its alignment.
+    _overflows++;
+    _heap_allocations++;
+    const std::size_t header = align_up(sizeof(Overflow_block), align > alignof(std::max_align_t) ? align : alignof(std::max_align_t));
+    uint8_t* block = (uint8_t*)std::malloc(header + size + align);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    Overflow_block* node = (Overflow_block*)block;
+    node->next = _overflow;
+    _overflow = node;
+    _overflow_bytes += size;
+    uint8_t* ptr = (uint8_t*)align_up(std::size_t(block + header), align);
+#ifdef FRAME_ARENA_POISON
+    std::memset(ptr, POISON_NEW, size);
+#endif
+    return ptr;
+}
+
+// ****************************************************************************
+
+bool Linear_arena::try_extend(void* ptr, std::size_t old_size, std::size_t new_size)
+{
+    if (ptr != _base + _last || _last + old_size != _offset || _last + new_size > _capacity) {
+        return false;
+    }
+#ifdef FRAME_ARENA_POISON
+    if (new_size > old_size) {
+        std::memset(_base + _offset, POISON_NEW, new_size - old_size);
+    }
+#endif
+    _offset = _last + new_size;
+    return true;
+}
+
+// ****************************************************************************
+
+void Linear_arena::reset()
+{
+    const std::size_t used = _offset + _overflow_bytes;
+    if (used > _high_water) {
+        _high_water = used;
+    }
+#ifdef FRAME_ARENA_POISON
+    std::memset(_base, POISON_FREE, _offset);
+#endif
+    _offset = 0;
+    _last = 0;
+
+    if (!_overflow) {
+        return;
+    }
+    while (_overflow) {
+        Overflow_block* next = _overflow->next;
+        std::free(_overflow);
+        _overflow = next;
+    }
+    _overflow_bytes = 0;
+
+    // Enlarge the block so the same frame fits next time
+    std::size_t capacity = _capacity ? _capacity : 1;
+    while (capacity < _high_water) {
+        capacity *= 2;
+    }
+    if (uint8_t* base = (uint8_t*)std::malloc(capacity)) {
+        std::free(_base);
+        _base = base;
+        _capacity = capacity;
+        _heap_allocations++;
+    }
+}
+
+// ****************************************************************************
+
+std::string_view Linear_arena::copy(std::string_view str)
+{
+    char* dst = (char*)allocate(str.size() + 1, 1);
+    std::memcpy(dst, str.data(), str.size());
+    dst[str.size()] = '\0';
+    return std::string_view(dst, str.size());
+}
+
+// ****************************************************************************
+
+const char* Linear_arena::format(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    const char* str = vformat(fmt, args);
+    va_end(args);
+    return str;
+}
+
+// ****************************************************************************
+
+const char* Linear_arena::vformat(const char* fmt, va_list args)
+{
+    // Print directly in the free space of the block, then claim only what
+    // was written. Measure and print again only if it doesn't fit.
+    va_list copy;
+    va_copy(copy, args);
+    std::size_t room = _capacity - _offset;
+    int length = std::vsnprintf((char*)_base + _offset, room, fmt, copy);
+    va_end(copy);
+    if (length < 0) {
+        return "";
+    }
+    if (std::size_t(length) < room) {
+        // Claimed without allocate(): poisoning would erase the text
+        const char* str = (const char*)_base + _offset;
+        _allocations++;
+        _last = _offset;
+        _offset += std::size_t(length) + 1;
+        return str;
+    }
+    char* str = (char*)allocate(std::size_t(length) + 1, 1);
+    std::vsnprintf(str, std::size_t(length) + 1, fmt, args);
+    return str;
+}
+
+// ****************************************************************************
+
+Arena_stats Linear_arena::stats() const
+{
+    Arena_stats s;
+    s.capacity = _capacity;
+    s.used = used();
+    s.high_water = _high_water > s.used ? _high_water : s.used;
+    s.allocations = _allocations;
+    s.overflows = _overflows;
+    s.heap_allocations = _heap_allocations;
+    return s;
+}
+
+// ****************************************************************************
+
+Arena_stats Frame_arena::stats() const
+{
+    Arena_stats a = _arenas[0].stats();
+    Arena_stats b = _arenas[1].stats();
+    a.capacity = a.capacity > b.capacity ? a.capacity : b.capacity;
+    a.used = _arenas[_current].used();
+    a.high_water = a.high_water > b.high_water ? a.high_water : b.high_water;
+    a.allocations += b.allocations;
+    a.overflows += b.overflows;
+    a.heap_allocations += b.heap_allocations;
+    return a;
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+// Per-frame linear allocator.
+//
+// Data that only lives for one frame (input snapshots, formatted strings,
+// draw lists...) is bump-allocated from a big block and everything is
+// dropped at once at the start of the next frame: no malloc/free, no
+// destructor, no fragmentation.
+//
+//     Frame_arena arena(64 * 1024);
+//     while (running) {
+//         arena.begin_frame();
+//         const char* text = arena.current().format("x: %d", x);
+//         Arena_vector<Vertex> vertices(arena.current());
+//         vertices.push_back(v);
+//         ...
+//     }
+//
+// Frame_arena holds two Linear_arena and alternates between them, so the
+// data of the previous frame stays valid for one more frame: it can be
+// compared with the current one, or read by another thread as long as that
+// thread is done with it before the next begin_frame().
+//
+// When a frame needs more than the block, the extra allocations go to the
+// heap (counted in Arena_stats::overflows) and the block is enlarged at the
+// next reset: after a couple of frames a steady workload doesn't touch the
+// heap anymore.
+//
+// Only trivially destructible types can live in an arena (nothing is ever
+// destroyed). With FRAME_ARENA_POISON (defined by default in debug builds)
+// new allocations are filled with 0xCD and released memory with 0xDD, so
+// reading uninitialized or stale data shows up right away.
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if !defined(NDEBUG) && !defined(FRAME_ARENA_NO_POISON)
+#define FRAME_ARENA_POISON
+#endif
+
+struct Arena_stats {
+    std::size_t capacity = 0;     ///< size of the block
+    std::size_t used = 0;         ///< bytes used since the last reset
+    std::size_t high_water = 0;   ///< most bytes used between two resets
+    uint64_t allocations = 0;     ///< calls to allocate() since the creation
+    uint64_t overflows = 0;       ///< allocations that didn't fit in the block
+    uint64_t heap_allocations = 0;///< malloc() calls: blocks and overflows
+};
+
+// ****************************************************************************
+
+class Linear_arena {
+public:
+    explicit Linear_arena(std::size_t capacity = 64 * 1024);
+    ~Linear_arena();
+
+    Linear_arena(const Linear_arena&) = delete;
+    Linear_arena& operator=(const Linear_arena&) = delete;
+
+    /// Uninitialized memory, never nullptr (falls back on the heap)
+    void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t));
+
+    /// Grow the last allocation in place if possible.
+    /// @return false if 'ptr' isn't the last allocation or there is no room
+    bool try_extend(void* ptr, std::size_t old_size, std::size_t new_size);
+
+    /// Drop every allocation. Enlarges the block if it overflowed.
+    void reset();
+
+    // -------------------------------------------------------------------------
+    /// @name Typed helpers
+    // -------------------------------------------------------------------------
+
+    template<class T>
+    T* allocate_array(std::size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+        return (T*)allocate(sizeof(T) * count, alignof(T));
+    }
+
+    template<class T, class... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /// NUL terminated copy of 'str'
+    std::string_view copy(std::string_view str);
+
+    /// printf() into the arena, NUL terminated
+    const char* format(const char* fmt, ...);
+    const char* vformat(const char* fmt, va_list args);
+
+    // -------------------------------------------------------------------------
+
+    std::size_t used() const { return _offset + _overflow_bytes; }
+    std::size_t capacity() const { return _capacity; }
+    /// Does 'ptr' point inside the block? (overflows are not)
+    bool owns(const void* ptr) const { return ptr >= _base && ptr < _base + _capacity; }
+
+    Arena_stats stats() const;
+
+private:
+    struct Overflow_block {
+        Overflow_block* next;
+    };
+
+    uint8_t* _base = nullptr;
+    std::size_t _capacity = 0;
+    std::size_t _offset = 0;
+    std::size_t _last = 0;              ///< offset of the last allocation
+    Overflow_block* _overflow = nullptr;///< allocations that didn't fit
+    std::size_t _overflow_bytes = 0;
+    std::size_t _high_water = 0;
+    uint64_t _allocations = 0;
+    uint64_t _overflows = 0;
+    uint64_t _heap_allocations = 0;
+};
+
+// ****************************************************************************
+
+class Frame_arena {
+public:
+    explicit Frame_arena(std::size_t capacity = 64 * 1024)
+        : _arenas{ Linear_arena(capacity), Linear_arena(capacity) }
+    { }
+
+    /// Call at the top of each frame: the current arena becomes the
+    /// previous one and the other is reset.
+    void begin_frame() {
+        _current ^= 1;
+        _arenas[_current].reset();
+        _frame++;
+    }
+
+    Linear_arena& current() { return _arenas[_current]; }
+    /// Data allocated during the previous frame (read only)
+    const Linear_arena& previous() const { return _arenas[_current ^ 1]; }
+
+    uint64_t frame() const { return _frame; }
+
+    /// Stats of both arenas combined (capacity and high water of the largest)
+    Arena_stats stats() const;
+
+private:
+    Linear_arena _arenas[2];
+    int _current = 0;
+    uint64_t _frame = 0;
+};
+
+// ****************************************************************************
+
+// Growable array in an arena, for small lists built during a frame.
+// Growing reallocates in the arena (the old storage is simply abandoned)
+// except when it's the last allocation, which is extended in place.
+template<class T>
+class Arena_vector {
+public:
+    static_assert(std::is_trivially_copyable<T>::value &&
+                  std::is_trivially_destructible<T>::value,
+                  "elements are moved with memcpy and never destroyed");
+
+    explicit Arena_vector(Linear_arena& arena, std::size_t reserve = 0) : _arena(&arena) {
+        if (reserve) {
+            grow(reserve);
+        }
+    }
+
+    void push_back(const T& value) {
+        if (_size == _capacity) {
+            grow(_capacity ? _capacity * 2 : 8);
+        }
+        _data[_size++] = value;
+    }
+
+    void clear() { _size = 0; }
+
+    T* data() { return _data; }
+    const T* data() const { return _data; }
+    std::size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    T& operator[](std::size_t i) { return _data[i]; }
+    const T& operator[](std::size_t i) const { return _data[i]; }
+
+    T* begin() { return _data; }
+    T* end() { return _data + _size; }
+    const T* begin() const { return _data; }
+    const T* end() const { return _data + _size; }
+
+private:
+    void grow(std::size_t capacity) {
+        if (_data && _arena->try_extend(_data, _capacity * sizeof(T), capacity * sizeof(T))) {
+            _capacity = capacity;
+            return;
+        }
+        T* data = _arena->allocate_array<T>(capacity);
+        if (_size) {
+            std::memcpy(data, _data, _size * sizeof(T));
+        }
+        _data = data;
+        _capacity = capacity;
+    }
+
+    Linear_arena* _arena;
+    T* _data = nullptr;
+    std::size_t _size = 0;
+    std::size_t _capacity = 0;
+};
@@ -0,0 +1,601 @@
+#include "frame_capture.h"
+
+#include "input_log.h" // varint_encode(), varint_decode()
+#include "job_system.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+// ****************************************************************************
+
+namespace {
+
+const char FILE_MAGIC[8] = { 'W', 'F', 'R', 'M', 'C', 'A', 'P', '1' };
+const char INDEX_MAGIC[8] = { 'W', 'F', 'R', 'M', 'I', 'D', 'X', '2' };
+const std::size_t TRAILER_SIZE = 2 * sizeof(uint64_t) + sizeof(INDEX_MAGIC);
+
+std::size_t put_token(uint8_t* out, std::size_t count, Capture_run kind)
+{
+    return varint_encode((uint64_t(count) << 2) | kind, out);
+}
+
+std::size_t put_literal(uint8_t* out, const uint32_t* pixels, std::size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+    std::size_t n = put_token(out, count, CAPTURE_LITERAL);
+    std::memcpy(out + n, pixels, count * 4);
+    return n + count * 4;
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+std::size_t capture_encode(const uint32_t* pixels, std::size_t count, uint8_t* out)
+{
+    // Runs of at least 2 zeros or 3 equal pixels get a token, anything
+    // else goes into literals. Then a literal is always next to a run of
+    // 2 pixels or more: at most 5 bytes per pixel, capture_encode_bound().
+    std::size_t n = 0;
+    std::size_t literal = 0; // first pixel of the pending literal
+    std::size_t i = 0;
+    while (i < count)
+    {
+        const uint32_t p = pixels[i];
+        std::size_t run = 1;
+        while (i + run < count && pixels[i + run] == p) {
+            ++run;
+        }
+        if ((p == 0 && run >= 2) || run >= 3) {
+            n += put_literal(out + n, pixels + literal, i - literal);
+            if (p == 0) {
+                n += put_token(out + n, run, CAPTURE_ZEROS);
+            } else {
+                n += put_token(out + n, run, CAPTURE_REPEAT);
+                std::memcpy(out + n, &p, 4);
+                n += 4;
+            }
+            literal = i + run;
+        }
+        i += run;
+    }
+    n += put_literal(out + n, pixels + literal, count - literal);
+    return n;
+}
+
+// ****************************************************************************
+
+bool capture_decode_xor(const uint8_t*& p, const uint8_t* end, uint32_t* pixels, std::size_t count)
+{
+    std::size_t i = 0;
+    while (i < count)
+    {
+        uint64_t token;
+        if (!varint_decode(p, end, token)) {
+            return false;
+        }
+        const std::size_t run = std::size_t(token >> 2);
+        if (run > count - i) {
+            return false;
+        }
+        switch (Capture_run(token & 3))
+        {
+        case CAPTURE_ZEROS:
+            break;
+        case CAPTURE_REPEAT: {
+            uint32_t v;
+            if (end - p < 4) {
+                return false;
+            }
+            std::memcpy(&v, p, 4);
+            p += 4;
+            for (std::size_t k = 0; k < run; ++k) {
+                pixels[i + k] ^= v;
+            }
+            break;
+        }
+        case CAPTURE_LITERAL:
+            if (std::size_t(end - p) < run * 4) {
+                return false;
+            }
+            for (std::size_t k = 0; k < run; ++k) {
+                uint32_t v;
+                std::memcpy(&v, p + k * 4, 4);
+                pixels[i + k] ^= v;
+            }
+            p += run * 4;
+            break;
+        default:
+            return false;
+        }
+        i += run;
+    }
+    return true;
+}
+
+// ****************************************************************************
+
+bool Frame_capture::open(const char* path, int every)
+{
+    close();
+    if (!_file.open(path) || !_file.append(FILE_MAGIC, sizeof(FILE_MAGIC))) {
+        _file.close();
+        return false;
+    }
+    _every = std::max(1, every);
+    _start = Clock::now();
+    _stats = Capture_stats();
+    _missed.clear();
+    _sent_width = _sent_height = 0;
+    _width = _height = 0;
+    _since_keyframe = 0;
+    _index.clear();
+    _index.reserve(INDEX_BLOCK); // the only allocation of the index
+    _index_block = 0;
+    _indexed = 0;
+
+    // Every slot is free (the queues are empty after a close())
+    for (int i = 0; i < POOL; ++i) {
+        _free.push(i);
+    }
+    _quit.store(false);
+    _thread = std::thread(&Frame_capture::thread_main, this);
+    return true;
+}
+
+// ****************************************************************************
+
+void Frame_capture::close()
+{
+    if (!is_open()) {
+        return;
+    }
+    _quit.store(true);
+    wake();
+    _thread.join();
+
+    write_index();
+    _stats.file_bytes = _file.size();
+    _file.close();
+    int slot;
+    while (_free.pop(slot)) { }
+}
+
+// ****************************************************************************
+
+void Frame_capture::on_present(const uint32_t* pixels, int width, int height, int stride,
+                               const Damage_region* damage, Job_system* jobs)
+{
+    if (!is_open() || width <= 0 || height <= 0 || width > 0xFFFF || height > 0xFFFF) {
+        return;
+    }
+    const Clock::time_point start = Clock::now();
+    const uint64_t frame = ++_stats.presents;
+
+    // What changed since the last frame we captured
+    if (damage) {
+        _missed.add(*damage);
+    } else {
+        _missed.add(0, 0, width, height);
+    }
+    if ((frame - 1) % uint64_t(_every) != 0) {
+        _stats.skipped++;
+        return;
+    }
+    int slot;
+    if (!_free.pop(slot)) {
+        _stats.dropped++;
+        return;
+    }
+    Staged& staged = _pool[slot];
+    staged.rects.clear();
+    _missed.clip(width, height);
+    // A new size, or so much damage that one copy of the frame is cheaper
+    if (width != _sent_width || height != _sent_height ||
+        _missed.area() >= int64_t(width) * int64_t(height))
+    {
+        staged.rects.add(0, 0, width, height);
+    } else {
+        staged.rects.add(_missed);
+    }
+    // Grows up to one frame, then stays allocated
+    const std::size_t size = std::size_t(staged.rects.area());
+    if (staged.pixels.size() < size) {
+        staged.pixels.resize(size);
+    }
+    uint32_t* dst = staged.pixels.data();
+    for (const Damage_rect& r : staged.rects)
+    {
+        const std::size_t row = std::size_t(r.x1 - r.x0);
+        const std::size_t ROWS_PER_JOB = 32;
+        if (jobs && r.area() >= int64_t(ROWS_PER_JOB * 1024 * 4)) {
+            // Bands of rows, one per job
+            const int y0 = r.y0;
+            const std::size_t x0 = std::size_t(r.x0);
+            uint32_t* band = dst;
+            jobs->parallel_for(std::size_t(r.y1 - r.y0), [&](std::size_t i) {
+                std::memcpy(band + i * row, pixels + (std::size_t(y0) + i) * std::size_t(stride) + x0, row * 4);
+            }, ROWS_PER_JOB);
+            dst += std::size_t(r.y1 - r.y0) * row;
+            continue;
+        }
+        if (r.x0 == 0 && r.x1 == width && stride == width) {
+            // Whole rows: one copy
+            const std::size_t rows = std::size_t(r.y1 - r.y0);
+            std::memcpy(dst, pixels + std::size_t(r.y0) * std::size_t(stride), rows * row * 4);
+            dst += rows * row;
+            continue;
+        }
+        for (int y = r.y0; y < r.y1; ++y) {
+            std::memcpy(dst, pixels + std::size_t(y) * std::size_t(stride) + std::size_t(r.x0), row * 4);
+            dst += row;
+        }
+    }
+    staged.width = width;
+    staged.height = height;
+    staged.frame = frame;
+    staged.time_us = std::chrono::duration_cast<std::chrono::microseconds>(start - _start).count();
+    _filled.push(slot); // can't fail, there are only POOL slots
+    wake();
+
+    _missed.clear();
+    _sent_width = width;
+    _sent_height = height;
+    _stats.captured++;
+    _stats.copied_pixels += size;
+    _stats.frame_pixels += uint64_t(width) * uint64_t(height);
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    _stats.copy_seconds += seconds;
+    _stats.max_copy_ms = std::max(_stats.max_copy_ms, seconds * 1000.0);
+}
+
+// ****************************************************************************
+
+void Frame_capture::wake()
+{
+    // Same handshake as Render_thread::wake(): no system call while the
+    // capture thread is busy.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _wake.notify_one();
+    }
+}
+
+// ****************************************************************************
+
+void Frame_capture::thread_main()
+{
+    if (profiler_enabled()) {
+        profiler_set_thread_name("capture");
+    }
+    for (;;)
+    {
+        int slot;
+        if (_filled.pop(slot)) {
+            PROFILE_ZONE("capture encode");
+            encode(_pool[slot]);
+            _free.push(slot);
+            continue;
+        }
+        if (_quit.load(std::memory_order_acquire)) {
+            break;
+        }
+        std::unique_lock<std::mutex> lock(_mutex);
+        _sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_filled.empty() && !_quit.load(std::memory_order_acquire)) {
+            _wake.wait(lock);
+        }
+        _sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+// ****************************************************************************
+
+void Frame_capture::encode(const Staged& staged)
+{
+    const Clock::time_point start = Clock::now();
+    if (staged.width != _width || staged.height != _height) {
+        // The frame thread sends a whole frame after a size change
+        _width = staged.width;
+        _height = staged.height;
+        _image.assign(std::size_t(_width) * std::size_t(_height), 0);
+        _since_keyframe = KEYFRAME_INTERVAL;
+    }
+    const bool keyframe = _since_keyframe >= KEYFRAME_INTERVAL;
+    _since_keyframe = keyframe ? 1 : _since_keyframe + 1;
+
+    // Bring '_image' up to date, '_delta' gets what changed
+    if (_delta.size() < staged.pixels.size()) {
+        _delta.resize(staged.pixels.size());
+    }
+    const uint32_t* src = staged.pixels.data();
+    uint32_t* delta = _delta.data();
+    for (const Damage_rect& r : staged.rects)
+    {
+        const int w = r.x1 - r.x0;
+        for (int y = r.y0; y < r.y1; ++y)
+        {
+            uint32_t* image = _image.data() + std::size_t(y) * std::size_t(_width) + std::size_t(r.x0);
+            for (int x = 0; x < w; ++x) {
+                delta[x] = image[x] ^ src[x];
+            }
+            std::memcpy(image, src, std::size_t(w) * 4);
+            src += w;
+            delta += w;
+        }
+    }
+
+    // A keyframe is the whole image against black, a delta frame the
+    // changed rectangles against the previous frame
+    const Damage_rect whole = { 0, 0, _width, _height };
+    const std::size_t pixels = keyframe ? _image.size() : std::size_t(staged.rects.area());
+    const int rects = keyframe ? 1 : staged.rects.count();
+    const std::size_t bound = sizeof(Capture_frame_header) + 10 + std::size_t(rects) * (40 + 16) +
+                              capture_encode_bound(pixels);
+    uint8_t* out = _file.reserve(bound);
+    if (!out) {
+        return; // disk full: the file ends at the last frame written
+    }
+    uint8_t* p = out + sizeof(Capture_frame_header);
+    p += varint_encode(uint64_t(rects), p);
+    const uint32_t* code = keyframe ? _image.data() : _delta.data();
+    for (int i = 0; i < rects; ++i)
+    {
+        const Damage_rect& r = keyframe ? whole : staged.rects[i];
+        p += varint_encode(uint64_t(r.x0), p);
+        p += varint_encode(uint64_t(r.y0), p);
+        p += varint_encode(uint64_t(r.x1 - r.x0), p);
+        p += varint_encode(uint64_t(r.y1 - r.y0), p);
+        const std::size_t count = std::size_t(r.area());
+        p += capture_encode(code, count, p);
+        code += count;
+    }
+
+    Capture_frame_header header = {};
+    header.payload = uint32_t(p - out - sizeof(Capture_frame_header));
+    header.flags = keyframe ? uint32_t(CAPTURE_KEYFRAME) : 0u;
+    header.frame = staged.frame;
+    header.time_us = staged.time_us;
+    header.width = uint16_t(_width);
+    header.height = uint16_t(_height);
+    std::memcpy(out, &header, sizeof(header));
+
+    Capture_index_entry entry = { uint64_t(_file.size()), header.frame, header.time_us, header.flags, 0 };
+    _index.push_back(entry);
+    _file.commit(std::size_t(p - out));
+    if (_index.size() == std::size_t(INDEX_BLOCK)) {
+        write_index_block();
+    }
+    if (keyframe) {
+        _stats.keyframes++;
+    }
+    _stats.encode_seconds += std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// ****************************************************************************
+
+void Frame_capture::write_index_block()
+{
+    if (_index.empty()) {
+        return;
+    }
+    const std::size_t entries = _index.size() * sizeof(Capture_index_entry);
+    Capture_frame_header header = {};
+    header.payload = uint32_t(sizeof(uint64_t) + entries);
+    header.flags = CAPTURE_INDEX;
+    uint8_t* out = _file.reserve(sizeof(header) + header.payload);
+    if (!out) {
+        // Disk full: the file ends at the last frame written, read by
+        // walking the records
+        _index.clear();
+        return;
+    }
+    std::memcpy(out, &header, sizeof(header));
+    std::memcpy(out + sizeof(header), &_index_block, sizeof(_index_block));
+    std::memcpy(out + sizeof(header) + sizeof(_index_block), _index.data(), entries);
+    _index_block = _file.size();
+    _indexed += _index.size();
+    _index.clear();
+    _file.commit(sizeof(header) + header.payload);
+}
+
+// ****************************************************************************
+
+void Frame_capture::write_index()
+{
+    // The last index block, a header of zeros ends the records, then the
+    // trailer
+    write_index_block();
+    const Capture_frame_header end = {};
+    _file.append(&end, sizeof(end));
+    _file.append(&_index_block, sizeof(_index_block));
+    _file.append(&_indexed, sizeof(_indexed));
+    _file.append(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+}
+
+// ****************************************************************************
+
+bool Capture_reader::open(const char* path)
+{
+    _index.clear();
+    _image.clear();
+    _current = SIZE_MAX;
+    if (!_file.open(path) || _file.size() < sizeof(FILE_MAGIC) ||
+        std::memcmp(_file.data(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+    {
+        return false;
+    }
+    if (read_index()) {
+        return true;
+    }
+    // No index (the capture didn't close): walk the frames
+    _index.clear();
+    const uint8_t* data = _file.data();
+    const std::size_t size = _file.size();
+    std::size_t offset = sizeof(FILE_MAGIC);
+    while (offset + sizeof(Capture_frame_header) <= size)
+    {
+        Capture_frame_header h;
+        std::memcpy(&h, data + offset, sizeof(h));
+        if (h.payload == 0 || h.payload > size - offset - sizeof(h)) {
+            break;
+        }
+        if ((h.flags & CAPTURE_INDEX) == 0) {
+            Capture_index_entry entry = { offset, h.frame, h.time_us, h.flags, 0 };
+            _index.push_back(entry);
+        }
+        offset += sizeof(h) + h.payload;
+    }
+    return true;
+}
+
+// ****************************************************************************
+
+bool Capture_reader::read_index()
+{
+    const uint8_t* data = _file.data();
+    const std::size_t size = _file.size();
+    if (size < sizeof(FILE_MAGIC) + TRAILER_SIZE ||
+        std::memcmp(data + size - sizeof(INDEX_MAGIC), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+    {
+        return false;
+    }
+    uint64_t block, count;
+    std::memcpy(&block, data + size - TRAILER_SIZE, sizeof(block));
+    std::memcpy(&count, data + size - TRAILER_SIZE + sizeof(block), sizeof(count));
+    if (count > (size - TRAILER_SIZE) / sizeof(Capture_index_entry)) {
+        return false;
+    }
+
+    // The blocks are chained from the last one: fill the index backward.
+    // Each block must lie before the previous one read, so the walk ends.
+    _index.resize(std::size_t(count));
+    std::size_t filled = std::size_t(count);
+    uint64_t limit = size - TRAILER_SIZE;
+    while (block != 0)
+    {
+        Capture_frame_header h;
+        if (block < sizeof(FILE_MAGIC) || block >= limit || limit - block < sizeof(h)) {
+            return false;
+        }
+        std::memcpy(&h, data + block, sizeof(h));
+        if ((h.flags & CAPTURE_INDEX) == 0 || h.payload < sizeof(uint64_t) ||
+            h.payload > limit - block - sizeof(h) ||
+            (h.payload - sizeof(uint64_t)) % sizeof(Capture_index_entry) != 0)
+        {
+            return false;
+        }
+        const std::size_t entries = (h.payload - sizeof(uint64_t)) / sizeof(Capture_index_entry);
+        if (entries > filled) {
+            return false;
+        }
+        filled -= entries;
+        const uint8_t* p = data + block + sizeof(h);
+        std::memcpy(_index.data() + filled, p + sizeof(uint64_t), entries * sizeof(Capture_index_entry));
+        limit = block;
+        std::memcpy(&block, p, sizeof(block));
+    }
+    return filled == 0;
+}
+
+// ****************************************************************************
+
+Capture_frame_header Capture_reader::header(std::size_t i) const
+{
+    // Records are not aligned in the file
+    Capture_frame_header h;
+    std::memcpy(&h, _file.data() + _index[i].offset, sizeof(h));
+    return h;
+}
+
+// ****************************************************************************
+
+std::size_t Capture_reader::seek(int64_t time_us) const
+{
+    auto it = std::upper_bound(_index.begin(), _index.end(), time_us,
+                               [](int64_t t, const Capture_index_entry& e) { return t < e.time_us; });
+    return it == _index.begin() ? 0 : std::size_t(it - _index.begin()) - 1;
+}
+
+// ****************************************************************************
+
+bool Capture_reader::read(std::size_t i, std::vector<uint32_t>& pixels)
+{
+    if (i >= _index.size()) {
+        return false;
+    }
+    std::size_t key = i;
+    while (key > 0 && (_index[key].flags & CAPTURE_KEYFRAME) == 0) {
+        --key;
+    }
+    // Reading forward from '_current' is cheaper than from the keyframe
+    std::size_t first = key;
+    if (_current != SIZE_MAX && _current >= key && _current <= i) {
+        first = _current + 1;
+    }
+    for (std::size_t k = first; k <= i; ++k) {
+        if (!apply(k)) {
+            _current = SIZE_MAX;
+            return false;
+        }
+        _current = k;
+    }
+    pixels = _image;
+    return true;
+}
+
+// ****************************************************************************
+
+bool Capture_reader::apply(std::size_t i)
+{
+    const Capture_frame_header h = header(i);
+    const std::size_t width = h.width;
+    const std::size_t height = h.height;
+    if (h.flags & CAPTURE_KEYFRAME) {
+        _image.assign(width * height, 0);
+    } else if (_image.size() != width * height) {
+        return false;
+    }
+    const uint8_t* p = _file.data() + _index[i].offset + sizeof(h);
+    const uint8_t* end = p + h.payload;
+    uint64_t rects;
+    if (!varint_decode(p, end, rects)) {
+        return false;
+    }
+    std::vector<uint32_t> row;
+    for (uint64_t r = 0; r < rects; ++r)
+    {
+        uint64_t x, y, w, hh;
+        if (!varint_decode(p, end, x) || !varint_decode(p, end, y) ||
+            !varint_decode(p, end, w) || !varint_decode(p, end, hh) ||
+            x + w > width || y + hh > height)
+        {
+            return false;
+        }
+        if (x == 0 && w == width) {
+            // Whole rows are contiguous in the image
+            if (!capture_decode_xor(p, end, _image.data() + y * width, std::size_t(w * hh))) {
+                return false;
+            }
+            continue;
+        }
+        // The run length code spans rows: decode the rectangle, then XOR
+        row.assign(std::size_t(w * hh), 0);
+        if (!capture_decode_xor(p, end, row.data(), row.size())) {
+            return false;
+        }
+        for (uint64_t j = 0; j < hh; ++j) {
+            uint32_t* dst = _image.data() + (y + j) * width + x;
+            const uint32_t* src = row.data() + j * w;
+            for (uint64_t k = 0; k < w; ++k) {
+                dst[k] ^= src[k];
+            }
+        }
+    }
+    return true;
+}
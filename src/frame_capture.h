@@ -0,0 +1,245 @@
+#pragma once
+
+// Capture what the window shows to a compact file, for support cases.
+//
+//   present() (frame thread)             capture thread
+//   ------------------------             --------------
+//   copy the damaged rectangles  --->    apply them to its own copy of
+//   into a free staging slot             the image, XOR with the previous
+//   (Spsc_queue, never blocks)   <---    pixels, run length encode, append
+//                                        to the file, give the slot back
+//
+// - frame thread: only what changed since the last captured frame is
+//   copied (the renderer's damage(), see damage_region.h), usually a few
+//   small rectangles. A full frame (resize, full redraw) is a copy of the
+//   visible pixels, split over the caller's Job_system workers when it
+//   gives one (memory bandwidth per core is the limit). If no staging slot
+//   is free the frame is dropped and its damage carried over to the next
+//   one, the frame thread never waits.
+//   With 'every' > 1 only one frame in 'every' is captured, same thing.
+// - capture thread: XOR delta against the previous frame (unchanged pixels
+//   become zeros), then a run length code on 32 bit pixels. Every
+//   KEYFRAME_INTERVAL frames, and when the size changes, a keyframe holds
+//   the whole image instead: seeking decodes at most that many frames.
+// - memory: POOL staging slots of at most one frame each, the capture
+//   thread's image and delta (one frame each), the index entries of the
+//   last INDEX_BLOCK frames at most (8 KB): however long the capture, the
+//   index goes to the file a block at a time. The file is written through
+//   a Mapped_append_file.
+//
+// File layout, integers little endian:
+//
+//     "WFRMCAP1"
+//     frame record:  Capture_frame_header then 'payload' bytes:
+//                    varint rectangle count, per rectangle varints x, y,
+//                    width, height, then the run length code of its pixels
+//                    (XOR with the previous frame, with black for keyframes)
+//     index block:   after every INDEX_BLOCK frames, and the last frames at
+//                    close(): Capture_frame_header with CAPTURE_INDEX, then
+//                    uint64 offset of the previous index block (0 for the
+//                    first) and one Capture_index_entry per frame
+//     ...            a header of zeros (or the end of file) ends the records
+//     trailer:       uint64 offset of the last index block, uint64 frame
+//                    count, "WFRMIDX2"
+//
+// Run length code: a varint token (count << 2 | kind) then
+//     CAPTURE_ZEROS    'count' unchanged pixels, nothing follows
+//     CAPTURE_REPEAT   'count' times the 4 bytes that follow
+//     CAPTURE_LITERAL  'count' pixels of 4 bytes follow
+// The reader follows the index blocks from the trailer, written by close():
+// a capture cut short (crash) is read by walking the records instead,
+// skipping the index blocks.
+
+#include "damage_region.h"
+#include "mapped_file.h"
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Job_system;
+
+enum Capture_run : uint32_t {
+    CAPTURE_ZEROS,
+    CAPTURE_REPEAT,
+    CAPTURE_LITERAL
+};
+
+enum Capture_flags : uint32_t {
+    CAPTURE_KEYFRAME = 1, ///< doesn't depend on the previous frame
+    CAPTURE_INDEX = 2     ///< not a frame: an index block
+};
+
+struct Capture_frame_header {
+    uint32_t payload;  ///< bytes following this header, 0 marks the end
+    uint32_t flags;    ///< Capture_flags
+    uint64_t frame;    ///< number of the present() it was captured from
+    int64_t time_us;   ///< since Frame_capture::open()
+    uint16_t width;
+    uint16_t height;
+    uint32_t reserved;
+};
+
+struct Capture_index_entry {
+    uint64_t offset;   ///< of the Capture_frame_header in the file
+    uint64_t frame;
+    int64_t time_us;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+/// Run length code of 'count' pixels, see the top of this file.
+/// 'out' needs room for capture_encode_bound(count) bytes.
+/// @return bytes written
+std::size_t capture_encode(const uint32_t* pixels, std::size_t count, uint8_t* out);
+inline std::size_t capture_encode_bound(std::size_t count) { return count * 5 + 16; }
+
+/// Decode 'count' pixels and XOR them into 'pixels'. Advances 'p'.
+/// @return false if the code is truncated or doesn't match 'count'
+bool capture_decode_xor(const uint8_t*& p, const uint8_t* end, uint32_t* pixels, std::size_t count);
+
+// ****************************************************************************
+
+struct Capture_stats {
+    uint64_t presents = 0;     ///< frames seen by on_present()
+    uint64_t captured = 0;     ///< ... given to the capture thread
+    uint64_t skipped = 0;      ///< ... not captured because of 'every'
+    uint64_t dropped = 0;      ///< ... not captured because no slot was free
+    uint64_t keyframes = 0;
+    uint64_t copied_pixels = 0; ///< by the frame thread
+    uint64_t frame_pixels = 0;  ///< visible pixels of the captured frames
+    uint64_t file_bytes = 0;
+    double copy_seconds = 0.0;  ///< frame thread, on_present()
+    double max_copy_ms = 0.0;
+    double encode_seconds = 0.0; ///< capture thread
+};
+
+// ****************************************************************************
+
+class Frame_capture {
+public:
+    static const int POOL = 3;                  ///< staging slots
+    static const int KEYFRAME_INTERVAL = 120;   ///< captured frames
+    static const int INDEX_BLOCK = 256;         ///< index entries per block
+
+    Frame_capture() = default;
+    ~Frame_capture() { close(); }
+
+    Frame_capture(const Frame_capture&) = delete;
+    Frame_capture& operator=(const Frame_capture&) = delete;
+
+    /// Create the file and start the capture thread.
+    /// @param every : capture one frame out of 'every'
+    /// @return false if the file can't be created
+    bool open(const char* path, int every = 1);
+    /// Encode the frames still queued, write the last index block and the
+    /// trailer, close the file
+    void close();
+    bool is_open() const { return _thread.joinable(); }
+
+    /// Frame thread, after the frame is drawn: 'pixels' are 0xAARRGGBB,
+    /// 'stride' pixels between rows. 'damage' is what changed since the
+    /// previous call (NULL: everything). Never blocks.
+    /// @param jobs : large copies are split over its workers (the caller
+    /// must be its external thread), NULL to copy on this thread only
+    void on_present(const uint32_t* pixels, int width, int height, int stride,
+                    const Damage_region* damage, Job_system* jobs = nullptr);
+
+    /// Call after close()
+    const Capture_stats& stats() const { return _stats; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    /// A frame handed to the capture thread: the rectangles' pixels packed
+    /// one after the other, row major
+    struct Staged {
+        std::vector<uint32_t> pixels;
+        Damage_region rects;
+        int width = 0;
+        int height = 0;
+        uint64_t frame = 0;
+        int64_t time_us = 0;
+    };
+
+    void thread_main();
+    void encode(const Staged& staged);
+    void wake();
+    /// Append the pending index entries as an index block
+    void write_index_block();
+    void write_index();
+
+    std::thread _thread;
+    std::atomic<bool> _quit{false};
+    Mapped_append_file _file;
+    Clock::time_point _start;
+
+    Staged _pool[POOL];
+    Spsc_queue<int, POOL + 1> _free;   ///< capture thread -> frame thread
+    Spsc_queue<int, POOL + 1> _filled; ///< frame thread -> capture thread
+
+    // Sleeping / waking up the capture thread
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::atomic<bool> _sleeping{false};
+
+    // Frame thread
+    int _every = 1;
+    Damage_region _missed;     ///< changes not captured yet
+    int _sent_width = 0;       ///< size of the last frame captured
+    int _sent_height = 0;
+
+    // Capture thread
+    std::vector<uint32_t> _image; ///< last frame, as the reader sees it
+    std::vector<uint32_t> _delta;
+    int _width = 0;
+    int _height = 0;
+    int _since_keyframe = 0;
+    std::vector<Capture_index_entry> _index; ///< not written yet
+    uint64_t _index_block = 0;    ///< offset of the last index block
+    uint64_t _indexed = 0;        ///< frames in the index blocks written
+
+    Capture_stats _stats; ///< each field written by one thread, see close()
+};
+
+// ****************************************************************************
+
+/// Read a capture: random access to any frame through the index (the whole
+/// of it is loaded).
+class Capture_reader {
+public:
+    /// @return false if the file can't be mapped or isn't a capture
+    bool open(const char* path);
+
+    std::size_t frames() const { return _index.size(); }
+    const Capture_index_entry& entry(std::size_t i) const { return _index[i]; }
+    Capture_frame_header header(std::size_t i) const;
+
+    /// Last frame captured at or before 'time_us' (0 if none)
+    std::size_t seek(int64_t time_us) const;
+
+    /// Pixels of frame 'i', header(i).width x header(i).height. Decodes
+    /// from the keyframe before it, or from the last frame read when
+    /// reading forward.
+    /// @return false if the file is corrupted
+    bool read(std::size_t i, std::vector<uint32_t>& pixels);
+
+private:
+    /// Apply frame 'i' on top of '_image'
+    bool apply(std::size_t i);
+
+    /// Gather the index blocks chained from the trailer
+    /// @return false if there is no trailer or the chain is broken
+    bool read_index();
+
+    Mapped_file _file;
+    std::vector<Capture_index_entry> _index;
+    std::vector<uint32_t> _image;
+    std::size_t _current = SIZE_MAX; ///< frame in '_image'
+};
@@ -0,0 +1,134 @@
+#include "frame_pacer.h"
+
+#include "platform.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// ****************************************************************************
+
+Frame_pacer::Frame_pacer(Pacing policy, double hz)
+{
+    set_policy(policy, hz);
+    reset_stats();
+}
+
+// ****************************************************************************
+
+void Frame_pacer::set_policy(Pacing policy, double hz)
+{
+    _policy = policy;
+    hz = std::max(hz, 1.0);
+    _period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+    _next_deadline = Clock::now();
+    _redraw_requested = true;
+}
+
+// ****************************************************************************
+
+bool Frame_pacer::frame_due(Clock::time_point now) const
+{
+    switch (_policy) {
+    case Pacing::UNCAPPED:  return true;
+    case Pacing::FIXED_HZ:  return now >= _next_deadline;
+    case Pacing::ON_DEMAND: return _redraw_requested;
+    }
+    return true;
+}
+
+// ****************************************************************************
+
+double Frame_pacer::seconds_until_due(Clock::time_point now) const
+{
+    switch (_policy) {
+    case Pacing::UNCAPPED: return 0.0;
+    case Pacing::FIXED_HZ:
+        return std::max(0.0, std::chrono::duration<double>(_next_deadline - now).count());
+    case Pacing::ON_DEMAND: return _redraw_requested ? 0.0 : -1.0;
+    }
+    return 0.0;
+}
+
+// ****************************************************************************
+
+void Frame_pacer::frame_done(Clock::time_point now)
+{
+    _redraw_requested = false;
+
+    if (_policy == Pacing::FIXED_HZ)
+    {
+        // Keep a steady cadence: the next deadline is relative to the
+        // previous one, not to 'now', otherwise wake up delays accumulate.
+        // If we fell behind by more than a whole period (e.g. the window was
+        // dragged) we re-synchronize instead of running a burst of frames.
+        _next_deadline += _period;
+        if (_next_deadline < now) {
+            _next_deadline = now + _period;
+        }
+    }
+
+    if (_has_last_frame)
+    {
+        double dt = std::chrono::duration<double, std::milli>(now - _last_frame).count();
+        _frames++;
+        double delta = dt - _mean;
+        _mean += delta / double(_frames);
+        _m2 += delta * (dt - _mean);
+        _max = std::max(_max, dt);
+    }
+    _last_frame = now;
+    _has_last_frame = true;
+}
+
+// ****************************************************************************
+
+Pacing_stats Frame_pacer::stats() const
+{
+    Pacing_stats s;
+    s.frames = _frames;
+    s.mean_frame_ms = _mean;
+    s.jitter_ms = _frames > 1 ? std::sqrt(_m2 / double(_frames - 1)) : 0.0;
+    s.max_frame_ms = _max;
+    double wall = std::chrono::duration<double>(Clock::now() - _stats_start).count();
+    s.cpu_usage = wall > 0.0 ? (process_cpu_seconds() - _cpu_start) / wall : 0.0;
+    return s;
+}
+
+// ****************************************************************************
+
+void Frame_pacer::reset_stats()
+{
+    _has_last_frame = false;
+    _frames = 0;
+    _mean = _m2 = _max = 0.0;
+    _stats_start = Clock::now();
+    _cpu_start = process_cpu_seconds();
+}
+
+// ****************************************************************************
+
+double process_cpu_seconds()
+{
+#ifdef _WIN32
+    // FILETIME are expressed in 100 nanoseconds units
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;   u.HighPart = user.dwHighDateTime;
+    return double(k.QuadPart + u.QuadPart) * 1e-7;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.0;
+    }
+    return double(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           double(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
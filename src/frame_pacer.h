@@ -0,0 +1,80 @@
+#pragma once
+
+// Decides *when* the loop should run a frame, and how long it may sleep
+// in between. Without a pacer Event_loop spins as fast as it can which pins
+// one core at 100% even when the window is idle.
+
+#include <chrono>
+#include <cstdint>
+
+enum class Pacing {
+    UNCAPPED,  ///< a frame every loop iteration (old behavior: busy spin)
+    FIXED_HZ,  ///< a frame every 1/hz seconds, sleep in between
+    ON_DEMAND  ///< a frame only after input or request_redraw(), sleep otherwise
+};
+
+// ****************************************************************************
+
+struct Pacing_stats {
+    uint64_t frames = 0;
+    double mean_frame_ms = 0.0; ///< average time between two frames
+    double jitter_ms = 0.0;     ///< standard deviation of the frame time
+    double max_frame_ms = 0.0;
+    /// Process CPU time over wall clock time since the pacer was created
+    /// (or reset). 1.0 means one core fully busy.
+    double cpu_usage = 0.0;
+};
+
+// ****************************************************************************
+
+class Frame_pacer {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit Frame_pacer(Pacing policy = Pacing::UNCAPPED, double hz = 60.0);
+
+    void set_policy(Pacing policy, double hz = 60.0);
+    Pacing policy() const { return _policy; }
+
+    /// Ask for a frame in Pacing::ON_DEMAND mode (no-op otherwise)
+    void request_redraw() { _redraw_requested = true; }
+
+    /// Should be called for every dispatched message. In ON_DEMAND mode
+    /// any input triggers a redraw.
+    void on_message() { _redraw_requested = true; }
+
+    /// Is it time to run the frame callback?
+    bool frame_due(Clock::time_point now) const;
+
+    /// How long we may sleep before the next frame is due.
+    /// Negative means "forever" (i.e. until input arrives).
+    double seconds_until_due(Clock::time_point now) const;
+
+    /// Call once the frame callback returned, schedules the next frame.
+    void frame_done(Clock::time_point now);
+
+    Pacing_stats stats() const;
+    void reset_stats();
+
+private:
+    Pacing _policy;
+    Clock::duration _period;
+    Clock::time_point _next_deadline;
+    bool _redraw_requested = true;
+
+    // Frame time statistics (Welford's online mean / variance)
+    Clock::time_point _last_frame;
+    bool _has_last_frame = false;
+    uint64_t _frames = 0;
+    double _mean = 0.0;
+    double _m2 = 0.0;
+    double _max = 0.0;
+
+    Clock::time_point _stats_start;
+    double _cpu_start = 0.0;
+};
+
+// ****************************************************************************
+
+/// CPU time (user + kernel) consumed by the whole process so far, in seconds.
+double process_cpu_seconds();
@@ -0,0 +1,158 @@
+#include "framebuffer.h"
+
+#include "damage_region.h"
+#include "simd_kernels.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <cstring>
+
+// ****************************************************************************
+
+void Framebuffer::resize(int width, int height)
+{
+    _width = std::max(width, 0);
+    _height = std::max(height, 0);
+    _tiles_x = (_width + TILE_SIZE - 1) / TILE_SIZE;
+    _tiles_y = (_height + TILE_SIZE - 1) / TILE_SIZE;
+    _pixels.resize(std::size_t(tile_count()) * TILE_PIXELS);
+    set_damage(nullptr);
+}
+
+// ****************************************************************************
+
+void Framebuffer::set_damage(const Damage_region* region)
+{
+    if (!region) {
+        _tile_mask.clear();
+        _damaged_tiles = tile_count();
+        return;
+    }
+    _tile_mask.assign(std::size_t(tile_count()), 0);
+    _damaged_tiles = 0;
+    for (const Damage_rect& r : *region)
+    {
+        const int x0 = std::max(r.x0, 0), y0 = std::max(r.y0, 0);
+        const int x1 = std::min(r.x1, _width), y1 = std::min(r.y1, _height);
+        if (x0 >= x1 || y0 >= y1) {
+            continue;
+        }
+        for (int ty = y0 / TILE_SIZE; ty <= (y1 - 1) / TILE_SIZE; ++ty) {
+            for (int tx = x0 / TILE_SIZE; tx <= (x1 - 1) / TILE_SIZE; ++tx) {
+                uint8_t& m = _tile_mask[std::size_t(ty * _tiles_x + tx)];
+                _damaged_tiles += m == 0;
+                m = 1;
+            }
+        }
+    }
+}
+
+// ****************************************************************************
+
+void Framebuffer::reserve(int width, int height)
+{
+    const std::size_t tiles = std::size_t((width + TILE_SIZE - 1) / TILE_SIZE) *
+                              std::size_t((height + TILE_SIZE - 1) / TILE_SIZE);
+    // std::vector never gives memory back on its own: swap with a fresh one
+    std::vector<uint32_t>().swap(_pixels);
+    _pixels.reserve(tiles * TILE_PIXELS);
+    resize(0, 0);
+}
+
+// ****************************************************************************
+
+void Framebuffer::for_each_tile(int x0, int y0, int x1, int y1, const Tile_fn& fn) const
+{
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, _width);
+    y1 = std::min(y1, _height);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    const int tx0 = x0 / TILE_SIZE, tx1 = (x1 - 1) / TILE_SIZE + 1;
+    const int ty0 = y0 / TILE_SIZE, ty1 = (y1 - 1) / TILE_SIZE + 1;
+    const int nx = tx1 - tx0;
+    const std::size_t count = std::size_t(nx * (ty1 - ty0));
+
+    auto run_tile = [&](std::size_t i) {
+        const int tx = tx0 + int(i % nx);
+        const int ty = ty0 + int(i / nx);
+        if (!tile_damaged(tx, ty)) {
+            return;
+        }
+        fn(tx, ty,
+           std::max(x0, tx * TILE_SIZE), std::max(y0, ty * TILE_SIZE),
+           std::min(x1, (tx + 1) * TILE_SIZE), std::min(y1, (ty + 1) * TILE_SIZE));
+    };
+
+    if (_jobs && count > 1) {
+        _jobs->parallel_for(count, run_tile);
+    } else {
+        for (std::size_t i = 0; i < count; ++i) {
+            run_tile(i);
+        }
+    }
+}
+
+// ****************************************************************************
+
+void Framebuffer::clear(uint32_t color)
+{
+    // Whole tiles are contiguous: one span per tile, padding included.
+    uint32_t* pixels = _pixels.data();
+    const Span_kernels& k = span_kernels();
+    for_each_tile(0, 0, _width, _height, [&](int tx, int ty, int, int, int, int) {
+        k.fill(pixels + tile_offset(tx, ty), TILE_PIXELS, color);
+    });
+}
+
+// ****************************************************************************
+
+void Framebuffer::fill_rect(int x, int y, int w, int h, uint32_t color)
+{
+    uint32_t* pixels = _pixels.data();
+    const Span_kernels& k = span_kernels();
+    for_each_tile(x, y, x + w, y + h, [&](int tx, int ty, int x0, int y0, int x1, int y1)
+    {
+        uint32_t* t = pixels + tile_offset(tx, ty);
+        const int lx = x0 - tx * TILE_SIZE;
+        for (int py = y0; py < y1; ++py) {
+            k.fill(t + (py - ty * TILE_SIZE) * TILE_SIZE + lx, std::size_t(x1 - x0), color);
+        }
+    });
+}
+
+// ****************************************************************************
+
+void Framebuffer::blit_alpha(const uint32_t* src, int src_width, int src_height, int stride, int x, int y)
+{
+    uint32_t* pixels = _pixels.data();
+    const Span_kernels& k = span_kernels();
+    for_each_tile(x, y, x + src_width, y + src_height, [&](int tx, int ty, int x0, int y0, int x1, int y1)
+    {
+        uint32_t* t = pixels + tile_offset(tx, ty);
+        const int lx = x0 - tx * TILE_SIZE;
+        for (int py = y0; py < y1; ++py) {
+            const uint32_t* s = src + std::size_t(py - y) * std::size_t(stride) + (x0 - x);
+            k.blend(t + (py - ty * TILE_SIZE) * TILE_SIZE + lx, s, std::size_t(x1 - x0));
+        }
+    });
+}
+
+// ****************************************************************************
+
+void Framebuffer::resolve(uint32_t* dst, int stride) const
+{
+    const uint32_t* pixels = _pixels.data();
+    for_each_tile(0, 0, _width, _height, [&](int tx, int ty, int x0, int y0, int x1, int y1)
+    {
+        const uint32_t* t = pixels + tile_offset(tx, ty);
+        for (int py = y0; py < y1; ++py) {
+            std::memcpy(dst + std::size_t(py) * std::size_t(stride) + x0,
+                        t + (py - ty * TILE_SIZE) * TILE_SIZE,
+                        std::size_t(x1 - x0) * sizeof(uint32_t));
+        }
+    });
+}
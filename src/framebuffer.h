@@ -0,0 +1,107 @@
+#pragma once
+
+// Software framebuffer with a tile-major memory layout.
+//
+// The image is cut into TILE_SIZE x TILE_SIZE tiles stored one after the
+// other, each tile being row major. A 64 x 64 tile is 16KB: it fits in the
+// L1/L2 cache while we work on it, and two threads never write to the same
+// cache line as long as they work on different tiles. Operations are split
+// per tile over a Job_system and use the SIMD span kernels of
+// simd_kernels.h.
+//
+// Pixels are 32 bits 0xAARRGGBB (bytes B, G, R, A in memory).
+//
+// set_damage() restricts every operation to the tiles overlapping a
+// Damage_region (partial redraw): the other tiles keep their pixels.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class Damage_region;
+class Job_system;
+
+class Framebuffer {
+public:
+    static const int TILE_SIZE = 64;
+    static const int TILE_PIXELS = TILE_SIZE * TILE_SIZE;
+
+    /// @param jobs : threads used to process tiles in parallel,
+    /// NULL to do everything on the calling thread.
+    explicit Framebuffer(Job_system* jobs = nullptr) : _jobs(jobs) { }
+
+    void set_job_system(Job_system* jobs) { _jobs = jobs; }
+
+    /// Change the size, the content is undefined afterward.
+    /// Only allocates memory if the new size doesn't fit in the capacity.
+    void resize(int width, int height);
+
+    /// Set the capacity to exactly what a width x height image needs
+    /// (grows or releases memory). The size is reset to 0 x 0.
+    void reserve(int width, int height);
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+    int tiles_x() const { return _tiles_x; }
+    int tiles_y() const { return _tiles_y; }
+    int tile_count() const { return _tiles_x * _tiles_y; }
+
+    /// Only touch the tiles overlapping 'region' from now on, NULL for
+    /// every tile (the default). Reset by resize().
+    void set_damage(const Damage_region* region);
+    bool tile_damaged(int tx, int ty) const {
+        return _tile_mask.empty() || _tile_mask[std::size_t(ty * _tiles_x + tx)] != 0;
+    }
+    /// Tiles set_damage() enabled
+    int damaged_tiles() const { return _damaged_tiles; }
+
+    /// Pixels of tile (tx, ty), row major with a stride of TILE_SIZE.
+    /// Tiles on the right / bottom border are padded: pixels outside
+    /// [0, width) x [0, height) exist but are never displayed.
+    uint32_t* tile(int tx, int ty) { return _pixels.data() + tile_offset(tx, ty); }
+    const uint32_t* tile(int tx, int ty) const { return _pixels.data() + tile_offset(tx, ty); }
+
+    uint32_t pixel(int x, int y) const { return _pixels[pixel_offset(x, y)]; }
+    void set_pixel(int x, int y, uint32_t color) { _pixels[pixel_offset(x, y)] = color; }
+
+    // -------------------------------------------------------------------------
+    /// @name Drawing (rectangles are clipped to the framebuffer)
+    // -------------------------------------------------------------------------
+
+    void clear(uint32_t color);
+
+    void fill_rect(int x, int y, int w, int h, uint32_t color);
+
+    /// Alpha blend a row major image over the framebuffer at (x, y)
+    /// @param stride : number of pixels between two rows of 'src'
+    void blit_alpha(const uint32_t* src, int src_width, int src_height, int stride, int x, int y);
+
+    /// Copy the framebuffer to a row major image of width() x height()
+    /// @param stride : number of pixels between two rows of 'dst'
+    void resolve(uint32_t* dst, int stride) const;
+
+    /// Call fn(tx, ty, x0, y0, x1, y1) for every damaged tile overlapping
+    /// the rectangle [x0, x1) x [y0, y1), given in framebuffer coordinates
+    /// and already clipped to the tile. Tiles are processed in parallel.
+    typedef std::function<void(int tx, int ty, int x0, int y0, int x1, int y1)> Tile_fn;
+    void for_each_tile(int x0, int y0, int x1, int y1, const Tile_fn& fn) const;
+
+private:
+    std::size_t tile_offset(int tx, int ty) const {
+        return std::size_t(ty * _tiles_x + tx) * TILE_PIXELS;
+    }
+    std::size_t pixel_offset(int x, int y) const {
+        return tile_offset(x / TILE_SIZE, y / TILE_SIZE) +
+               std::size_t((y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE));
+    }
+
+    Job_system* _jobs;
+    int _width = 0;
+    int _height = 0;
+    int _tiles_x = 0;
+    int _tiles_y = 0;
+    std::vector<uint32_t> _pixels;
+    std::vector<uint8_t> _tile_mask; ///< per tile, empty: every tile
+    int _damaged_tiles = 0;
+};
@@ -0,0 +1,227 @@
+#include "glyph_atlas.h"
+
+#include <algorithm>
+#include <cstring>
+
+// ****************************************************************************
+
+Glyph_atlas::Glyph_atlas(Glyph_rasterizer& rasterizer, int width, int height)
+    : _rasterizer(rasterizer)
+    , _width(std::max(width, Glyph_rasterizer::MAX_SIZE))
+    , _height(std::max(height, Glyph_rasterizer::MAX_SIZE))
+    , _pixels(std::size_t(_width) * std::size_t(_height), 0)
+    , _scratch(std::size_t(Glyph_rasterizer::MAX_SIZE) * Glyph_rasterizer::MAX_SIZE, 0)
+{
+}
+
+// ****************************************************************************
+
+Draw_texture Glyph_atlas::texture() const
+{
+    Draw_texture t;
+    t.pixels = _pixels.data();
+    t.width = _width;
+    t.height = _height;
+    t.stride = _width;
+    return t;
+}
+
+// ****************************************************************************
+
+Atlas_stats Glyph_atlas::stats() const
+{
+    _stats.glyphs = _map.size();
+    _stats.shelves_height = _shelves_height;
+    return _stats;
+}
+
+// ****************************************************************************
+
+void Glyph_atlas::clear()
+{
+    _slots.clear();
+    _map.clear();
+    for (int c = 0; c < CLASS_COUNT; ++c) {
+        _lru[c] = Lru();
+        _free_cells[c].clear();
+    }
+    _shelves_height = 0;
+    std::fill(_pixels.begin(), _pixels.end(), uint8_t(0));
+    _version++;
+}
+
+// ****************************************************************************
+
+int Glyph_atlas::size_class(int width, int height)
+{
+    const int size = std::max(width, height);
+    int c = 0;
+    for (int cell = SMALLEST_CLASS; cell < size; cell *= 2) {
+        c++;
+    }
+    return c;
+}
+
+// ****************************************************************************
+
+const Atlas_glyph* Glyph_atlas::find(uint32_t codepoint, int pixel_size, uint32_t& hint)
+{
+    const uint64_t key = make_key(codepoint, pixel_size);
+
+    // Fast path: the caller remembers where the glyph was last time
+    if (hint < _slots.size() && _slots[hint].used && _slots[hint].key == key) {
+        _stats.hits++;
+        _stats.hint_hits++;
+        touch(hint);
+        return &_slots[hint].glyph;
+    }
+    auto it = _map.find(key);
+    if (it != _map.end()) {
+        _stats.hits++;
+        hint = it->second;
+        touch(hint);
+        return &_slots[hint].glyph;
+    }
+    return insert(key, codepoint, pixel_size, hint);
+}
+
+// ****************************************************************************
+
+const Atlas_glyph* Glyph_atlas::insert(uint64_t key, uint32_t codepoint, int pixel_size,
+                                       uint32_t& hint)
+{
+    const int max_size = Glyph_rasterizer::MAX_SIZE;
+    Glyph_metrics metrics;
+    if (!_rasterizer.rasterize(codepoint, pixel_size, _scratch.data(), max_size, metrics)) {
+        return nullptr;
+    }
+    _stats.misses++;
+    metrics.width = std::min(metrics.width, max_size);
+    metrics.height = std::min(metrics.height, max_size);
+
+    uint32_t slot;
+    if (metrics.width <= 0 || metrics.height <= 0)
+    {
+        // Blank glyph (space): only the metrics matter, no cell.
+        // There are few of them, they are never evicted.
+        slot = uint32_t(_slots.size());
+        _slots.emplace_back();
+    }
+    else
+    {
+        const int c = size_class(metrics.width, metrics.height);
+        slot = allocate_cell(c);
+        if (slot == NO_SLOT) {
+            _stats.atlas_full++;
+            return nullptr;
+        }
+        const Slot& s = _slots[slot];
+        for (int y = 0; y < metrics.height; ++y) {
+            std::memcpy(&_pixels[std::size_t(s.y + y) * std::size_t(_width) + std::size_t(s.x)],
+                        &_scratch[std::size_t(y) * std::size_t(max_size)],
+                        std::size_t(metrics.width));
+        }
+        _version++;
+    }
+
+    Slot& s = _slots[slot];
+    s.key = key;
+    s.used = true;
+    s.glyph.metrics = metrics;
+    if (s.size_class >= 0) {
+        const float w = float(_width), h = float(_height);
+        s.glyph.uv = { float(s.x) / w, float(s.y) / h,
+                       float(s.x + metrics.width) / w, float(s.y + metrics.height) / h };
+        push_front(slot);
+    } else {
+        s.glyph.uv = Draw_uv{ 0.0f, 0.0f, 0.0f, 0.0f };
+    }
+    s.last_frame = _frame;
+    _map[key] = slot;
+    hint = slot;
+    return &s.glyph;
+}
+
+// ****************************************************************************
+
+uint32_t Glyph_atlas::allocate_cell(int c)
+{
+    // 1. A cell already carved and unused
+    if (!_free_cells[c].empty()) {
+        uint32_t slot = _free_cells[c].back();
+        _free_cells[c].pop_back();
+        return slot;
+    }
+
+    // 2. A new shelf of cells of that class
+    const int cell = SMALLEST_CLASS << c;
+    if (_shelves_height + cell <= _height)
+    {
+        const int y = _shelves_height;
+        _shelves_height += cell;
+        // Pushed in reverse so cells are handed out from left to right
+        for (int x = (_width / cell - 1) * cell; x >= 0; x -= cell)
+        {
+            Slot s;
+            s.x = x;
+            s.y = y;
+            s.size_class = int8_t(c);
+            _free_cells[c].push_back(uint32_t(_slots.size()));
+            _slots.push_back(s);
+        }
+        uint32_t slot = _free_cells[c].back();
+        _free_cells[c].pop_back();
+        return slot;
+    }
+
+    // 3. The least recently used glyph of the class, if not drawn this frame
+    const uint32_t victim = _lru[c].tail;
+    if (victim == NO_SLOT || _slots[victim].last_frame == _frame) {
+        return NO_SLOT;
+    }
+    unlink(victim);
+    _map.erase(_slots[victim].key);
+    _slots[victim].used = false;
+    _stats.evictions++;
+    return victim;
+}
+
+// ****************************************************************************
+
+void Glyph_atlas::touch(uint32_t slot)
+{
+    Slot& s = _slots[slot];
+    s.last_frame = _frame;
+    if (s.size_class >= 0 && _lru[s.size_class].head != slot) {
+        unlink(slot);
+        push_front(slot);
+    }
+}
+
+// ****************************************************************************
+
+void Glyph_atlas::unlink(uint32_t slot)
+{
+    Slot& s = _slots[slot];
+    Lru& lru = _lru[s.size_class];
+    if (s.prev != NO_SLOT) { _slots[s.prev].next = s.next; } else { lru.head = s.next; }
+    if (s.next != NO_SLOT) { _slots[s.next].prev = s.prev; } else { lru.tail = s.prev; }
+    s.prev = s.next = NO_SLOT;
+}
+
+// ****************************************************************************
+
+void Glyph_atlas::push_front(uint32_t slot)
+{
+    Slot& s = _slots[slot];
+    Lru& lru = _lru[s.size_class];
+    s.prev = NO_SLOT;
+    s.next = lru.head;
+    if (lru.head != NO_SLOT) {
+        _slots[lru.head].prev = slot;
+    }
+    lru.head = slot;
+    if (lru.tail == NO_SLOT) {
+        lru.tail = slot;
+    }
+}
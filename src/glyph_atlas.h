@@ -0,0 +1,147 @@
+#pragma once
+
+// Cache of rasterized glyphs packed in one 8 bit texture.
+//
+// Rasterizing a glyph (scaling the bitmap font, or GetGlyphOutline() with
+// GDI) is far too slow to do for every character of every frame. The atlas
+// rasterizes each (codepoint, size) once and keeps the bitmap in a single
+// texture, so a whole string is drawn from one texture: one draw call.
+//
+// Packing: the texture is cut into horizontal shelves, each shelf into
+// square cells of one size class (8, 16, 32, 64 or 128 pixels). A glyph
+// goes in the smallest class its bitmap fits in. Cells of a class are
+// allocated from a new shelf until the texture is full, then recycled:
+//
+//   +--------+--------+--------+--------+----
+//   | 16     | 16     | 16     | 16     | ...   shelf of 16 x 16 cells
+//   +----+----+----+----+----+----+----+----
+//   | 8  | 8  | 8  | 8  | 8  | 8  | 8  | ...   shelf of 8 x 8 cells
+//   +----+----+----+----+----+----+----+----
+//
+// Eviction: each class keeps its cells in least recently used order. When
+// no cell is free, the least recently used one is given to the new glyph,
+// unless it was used during the current frame (its uv may already be in
+// this frame's draw list): then the lookup fails and the character is
+// simply not drawn this frame (counted in 'atlas_full').
+//
+// Lookups go through a hash map. Callers drawing the same glyphs every
+// frame (Text_renderer's layout cache) also keep the returned slot as a
+// hint: when the slot still holds the glyph, the hash map is skipped.
+
+#include "draw_list.h"
+#include "glyph_rasterizer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// A glyph stored in the atlas
+struct Atlas_glyph {
+    Glyph_metrics metrics;
+    Draw_uv uv = {};
+};
+
+struct Atlas_stats {
+    uint64_t hits = 0;        ///< glyph found (hint or hash map)
+    uint64_t hint_hits = 0;   ///< ... without hashing
+    uint64_t misses = 0;      ///< glyph rasterized
+    uint64_t evictions = 0;   ///< glyph replaced to make room
+    uint64_t atlas_full = 0;  ///< no cell could be freed this frame
+    std::size_t glyphs = 0;   ///< glyphs currently stored
+    int shelves_height = 0;   ///< pixels of the texture in use
+};
+
+// ****************************************************************************
+
+class Glyph_atlas {
+public:
+    static const uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+    /// @param width, height : texture size in pixels
+    explicit Glyph_atlas(Glyph_rasterizer& rasterizer, int width = 512, int height = 512);
+
+    Glyph_atlas(const Glyph_atlas&) = delete;
+    Glyph_atlas& operator=(const Glyph_atlas&) = delete;
+
+    /// Call once per frame before the first find(): glyphs found from now
+    /// on are protected from eviction until the next call.
+    void begin_frame() { _frame++; }
+
+    /// Find the glyph, rasterize and store it if needed.
+    /// @param hint : slot returned by a previous call for the same glyph,
+    /// or NO_SLOT. Updated with the glyph's slot.
+    /// @return NULL if the glyph could not be rasterized or stored. Valid
+    /// until the next call.
+    const Atlas_glyph* find(uint32_t codepoint, int pixel_size, uint32_t& hint);
+
+    const Atlas_glyph* find(uint32_t codepoint, int pixel_size) {
+        uint32_t hint = NO_SLOT;
+        return find(codepoint, pixel_size, hint);
+    }
+
+    /// The whole atlas. The pixels never move: the texture stays valid as
+    /// long as the atlas lives.
+    Draw_texture texture() const;
+
+    /// Incremented every time pixels are written: the texture needs to be
+    /// uploaded again when it differs from the version last uploaded.
+    uint64_t version() const { return _version; }
+
+    Glyph_rasterizer& rasterizer() { return _rasterizer; }
+
+    Atlas_stats stats() const;
+
+    /// Forget every glyph (stats are kept)
+    void clear();
+
+private:
+    static const int CLASS_COUNT = 5;    ///< 8, 16, 32, 64, 128
+    static const int SMALLEST_CLASS = 8;
+
+    struct Slot {
+        uint64_t key = 0;
+        Atlas_glyph glyph;
+        uint64_t last_frame = 0;
+        int x = 0, y = 0;          ///< cell position in the texture
+        int8_t size_class = -1;    ///< -1: no pixels (blank glyph)
+        bool used = false;
+        uint32_t prev = NO_SLOT;   ///< LRU list of the class
+        uint32_t next = NO_SLOT;
+    };
+
+    struct Lru {
+        uint32_t head = NO_SLOT; ///< most recently used
+        uint32_t tail = NO_SLOT; ///< least recently used
+    };
+
+    static uint64_t make_key(uint32_t codepoint, int pixel_size) {
+        return (uint64_t(uint32_t(pixel_size)) << 32) | codepoint;
+    }
+    static int size_class(int width, int height);
+
+    void touch(uint32_t slot);
+    void unlink(uint32_t slot);
+    void push_front(uint32_t slot);
+    /// A free cell of 'size_class', or NO_SLOT
+    uint32_t allocate_cell(int size_class);
+    const Atlas_glyph* insert(uint64_t key, uint32_t codepoint, int pixel_size, uint32_t& hint);
+
+    Glyph_rasterizer& _rasterizer;
+    int _width;
+    int _height;
+    std::vector<uint8_t> _pixels;
+    uint64_t _version = 0;
+    uint64_t _frame = 1;
+
+    std::vector<Slot> _slots;
+    std::unordered_map<uint64_t, uint32_t> _map;
+    Lru _lru[CLASS_COUNT];
+    std::vector<uint32_t> _free_cells[CLASS_COUNT]; ///< unused slots with a cell
+    int _shelves_height = 0; ///< y of the next shelf
+
+    /// Rasterizer output, copied in the atlas once the size is known
+    std::vector<uint8_t> _scratch;
+
+    mutable Atlas_stats _stats;
+};
@@ -0,0 +1,296 @@
+#include "glyph_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// ****************************************************************************
+
+namespace {
+
+// 8 x 8 font for ASCII 32 to 126, public domain (font8x8_basic by Daniel
+// Hepper, after the IBM PC BIOS font). One byte per row, top to bottom,
+// bit 0 is the leftmost pixel. Row 7 is below the baseline (descenders).
+const uint8_t FONT_8X8[95][8] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 }, // !
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 }, // #
+    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 }, // $
+    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 }, // %
+    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 }, // &
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '
+    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 }, // (
+    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 }, // )
+    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 }, // *
+    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 }, // +
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ,
+    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // .
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, // /
+    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 }, // 0
+    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 }, // 1
+    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 }, // 2
+    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 }, // 3
+    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 }, // 4
+    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 }, // 5
+    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 }, // 6
+    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 }, // 7
+    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 }, // 8
+    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 }, // 9
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // :
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ;
+    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 }, // <
+    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 }, // =
+    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 }, // >
+    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 }, // ?
+    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 }, // @
+    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 }, // A
+    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 }, // B
+    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 }, // C
+    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 }, // D
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 }, // E
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 }, // F
+    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 }, // G
+    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 }, // H
+    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // I
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 }, // J
+    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 }, // K
+    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 }, // L
+    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 }, // M
+    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 }, // N
+    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 }, // O
+    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 }, // P
+    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 }, // Q
+    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 }, // R
+    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 }, // S
+    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // T
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 }, // U
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // V
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 }, // W
+    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 }, // X
+    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 }, // Y
+    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 }, // Z
+    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 }, // [
+    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 }, // backslash
+    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 }, // ]
+    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF }, // _
+    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // `
+    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 }, // a
+    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 }, // b
+    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 }, // c
+    { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 }, // d
+    { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 }, // e
+    { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 }, // f
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // g
+    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 }, // h
+    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // i
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E }, // j
+    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 }, // k
+    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // l
+    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 }, // m
+    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 }, // n
+    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 }, // o
+    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F }, // p
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 }, // q
+    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 }, // r
+    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 }, // s
+    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 }, // t
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 }, // u
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // v
+    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 }, // w
+    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 }, // x
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // y
+    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 }, // z
+    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 }, // {
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, // |
+    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 }, // }
+    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ~
+};
+
+/// Samples per output pixel along each axis when scaling the bitmap font
+const int SUPERSAMPLING = 4;
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+// std::min() / std::max() bind it to a reference: it needs a definition
+const int Glyph_rasterizer::MAX_SIZE;
+
+// ****************************************************************************
+
+bool Bitmap_font_rasterizer::rasterize(uint32_t codepoint, int pixel_size, uint8_t* pixels,
+                                       int stride, Glyph_metrics& metrics)
+{
+    if (pixel_size <= 0) {
+        return false;
+    }
+    if (codepoint < 32 || codepoint > 126) {
+        codepoint = '?';
+    }
+    const uint8_t* rows = FONT_8X8[codepoint - 32];
+    const float scale = float(pixel_size) / 8.0f;
+    const int size = std::min(int(std::ceil(8.0f * scale)), MAX_SIZE);
+
+    metrics.advance = int(std::lround(8.0f * scale));
+    metrics.offset_x = 0;
+    metrics.offset_y = -ascent(pixel_size);
+    metrics.width = 0;
+    metrics.height = 0;
+    if (codepoint == ' ') {
+        return true;
+    }
+    metrics.width = size;
+    metrics.height = size;
+
+    // Box filter: each output pixel averages SUPERSAMPLING^2 samples of
+    // the 8 x 8 bitmap. Integer scales give sharp pixels, others are
+    // smoothed instead of having uneven strokes.
+    const float step = 1.0f / (scale * float(SUPERSAMPLING));
+    const int total = SUPERSAMPLING * SUPERSAMPLING;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            int hits = 0;
+            for (int sy = 0; sy < SUPERSAMPLING; ++sy) {
+                const int row = std::min(int((float(y * SUPERSAMPLING + sy) + 0.5f) * step), 7);
+                for (int sx = 0; sx < SUPERSAMPLING; ++sx) {
+                    const int col = std::min(int((float(x * SUPERSAMPLING + sx) + 0.5f) * step), 7);
+                    hits += (rows[row] >> col) & 1;
+                }
+            }
+            pixels[y * stride + x] = uint8_t((hits * 255 + total / 2) / total);
+        }
+    }
+    return true;
+}
+
+// ****************************************************************************
+
+int Bitmap_font_rasterizer::ascent(int pixel_size)
+{
+    // Rows 0 to 6 are above the baseline
+    return int(std::lround(7.0f * float(pixel_size) / 8.0f));
+}
+
+// ****************************************************************************
+
+int Bitmap_font_rasterizer::line_height(int pixel_size)
+{
+    return int(std::lround(10.0f * float(pixel_size) / 8.0f));
+}
+
+// ****************************************************************************
+
+#ifdef _WIN32
+
+Gdi_glyph_rasterizer::Gdi_glyph_rasterizer(const wchar_t* face)
+    : _face(face)
+{
+    _dc = CreateCompatibleDC(NULL);
+}
+
+// ****************************************************************************
+
+Gdi_glyph_rasterizer::~Gdi_glyph_rasterizer()
+{
+    if (_dc) {
+        DeleteDC(_dc);
+    }
+    for (auto& font : _fonts) {
+        DeleteObject(font.second);
+    }
+}
+
+// ****************************************************************************
+
+bool Gdi_glyph_rasterizer::select(int pixel_size)
+{
+    if (!_dc || pixel_size <= 0) {
+        return false;
+    }
+    if (_selected == pixel_size) {
+        return true;
+    }
+    auto it = _fonts.find(pixel_size);
+    if (it == _fonts.end())
+    {
+        // Negative height: 'pixel_size' is the em height, not the cell height
+        HFONT font = CreateFontW(-pixel_size, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+                                 DEFAULT_CHARSET, OUT_TT_PRECIS, CLIP_DEFAULT_PRECIS,
+                                 ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, _face);
+        if (!font) {
+            return false;
+        }
+        it = _fonts.emplace(pixel_size, font).first;
+        SelectObject(_dc, font);
+        TEXTMETRICW tm = {};
+        GetTextMetricsW(_dc, &tm);
+        _metrics[pixel_size] = tm;
+    }
+    SelectObject(_dc, it->second);
+    _selected = pixel_size;
+    return true;
+}
+
+// ****************************************************************************
+
+bool Gdi_glyph_rasterizer::rasterize(uint32_t codepoint, int pixel_size, uint8_t* pixels,
+                                     int stride, Glyph_metrics& metrics)
+{
+    if (!select(pixel_size) || codepoint > 0xFFFF) {
+        return false;
+    }
+    // Identity transform
+    MAT2 identity = { {0, 1}, {0, 0}, {0, 0}, {0, 1} };
+    GLYPHMETRICS gm = {};
+    // GGO_GRAY8_BITMAP: one byte per pixel in [0, 64], rows DWORD aligned
+    DWORD bytes = GetGlyphOutlineW(_dc, UINT(codepoint), GGO_GRAY8_BITMAP, &gm, 0, nullptr, &identity);
+    if (bytes == GDI_ERROR) {
+        return false;
+    }
+    metrics.advance = gm.gmCellIncX;
+    metrics.offset_x = gm.gmptGlyphOrigin.x;
+    metrics.offset_y = -gm.gmptGlyphOrigin.y;
+    metrics.width = 0;
+    metrics.height = 0;
+    if (bytes == 0) {
+        return true; // blank glyph (space)
+    }
+    static thread_local uint8_t buffer[4 * MAX_SIZE * MAX_SIZE];
+    if (bytes > sizeof(buffer) ||
+        GetGlyphOutlineW(_dc, UINT(codepoint), GGO_GRAY8_BITMAP, &gm, bytes, buffer, &identity) == GDI_ERROR)
+    {
+        return false;
+    }
+    const int src_stride = (int(gm.gmBlackBoxX) + 3) & ~3;
+    metrics.width = std::min(int(gm.gmBlackBoxX), MAX_SIZE);
+    metrics.height = std::min(int(gm.gmBlackBoxY), MAX_SIZE);
+    for (int y = 0; y < metrics.height; ++y) {
+        for (int x = 0; x < metrics.width; ++x) {
+            pixels[y * stride + x] = uint8_t(std::min(buffer[y * src_stride + x] * 255 / 64, 255));
+        }
+    }
+    return true;
+}
+
+// ****************************************************************************
+
+int Gdi_glyph_rasterizer::ascent(int pixel_size)
+{
+    return select(pixel_size) ? int(_metrics[pixel_size].tmAscent) : pixel_size;
+}
+
+// ****************************************************************************
+
+int Gdi_glyph_rasterizer::line_height(int pixel_size)
+{
+    if (!select(pixel_size)) {
+        return pixel_size;
+    }
+    const TEXTMETRICW& tm = _metrics[pixel_size];
+    return int(tm.tmHeight + tm.tmExternalLeading);
+}
+
+#endif
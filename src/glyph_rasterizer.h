@@ -0,0 +1,92 @@
+#pragma once
+
+// Turn a character into an 8 bit coverage bitmap.
+//
+// - Bitmap_font_rasterizer: built-in 8 x 8 ASCII font scaled to the
+//   requested size (box filtered). No dependency at all: this is what the
+//   headless build and the Linux benchmarks use.
+// - Gdi_glyph_rasterizer (Windows): any installed TrueType font through
+//   GetGlyphOutline(GGO_GRAY8_BITMAP), anti-aliased by GDI.
+//
+// Glyphs are cached in a Glyph_atlas (glyph_atlas.h): a rasterizer is only
+// called the first time a character is drawn at a given size.
+
+#include "platform.h"
+
+#include <cstdint>
+#include <map>
+
+/// Placement of a glyph bitmap relative to the pen position on the baseline
+struct Glyph_metrics {
+    int width = 0;     ///< bitmap size, may be 0 (space)
+    int height = 0;
+    int offset_x = 0;  ///< left of the bitmap - pen x
+    int offset_y = 0;  ///< top of the bitmap - baseline y (negative: above)
+    int advance = 0;   ///< pen x increment
+};
+
+// ****************************************************************************
+
+class Glyph_rasterizer {
+public:
+    /// Largest bitmap rasterize() may produce (width and height)
+    static const int MAX_SIZE = 128;
+
+    virtual ~Glyph_rasterizer() {}
+
+    /// Write the coverage of 'codepoint' at 'pixel_size' (em height) to
+    /// 'pixels' (MAX_SIZE x MAX_SIZE, 'stride' bytes per row).
+    /// Characters the font doesn't have are drawn as a replacement glyph.
+    /// @return false if nothing could be rasterized
+    virtual bool rasterize(uint32_t codepoint, int pixel_size, uint8_t* pixels, int stride,
+                           Glyph_metrics& metrics) = 0;
+
+    /// Distance from the top of a line to the baseline
+    virtual int ascent(int pixel_size) = 0;
+    /// Distance between two baselines
+    virtual int line_height(int pixel_size) = 0;
+};
+
+// ****************************************************************************
+
+class Bitmap_font_rasterizer : public Glyph_rasterizer {
+public:
+    bool rasterize(uint32_t codepoint, int pixel_size, uint8_t* pixels, int stride,
+                   Glyph_metrics& metrics) override;
+    int ascent(int pixel_size) override;
+    int line_height(int pixel_size) override;
+};
+
+// ****************************************************************************
+
+#ifdef _WIN32
+
+class Gdi_glyph_rasterizer : public Glyph_rasterizer {
+public:
+    /// @param face : font name, e.g. L"Segoe UI"
+    explicit Gdi_glyph_rasterizer(const wchar_t* face = L"Segoe UI");
+    ~Gdi_glyph_rasterizer();
+
+    Gdi_glyph_rasterizer(const Gdi_glyph_rasterizer&) = delete;
+    Gdi_glyph_rasterizer& operator=(const Gdi_glyph_rasterizer&) = delete;
+
+    /// false if no device context could be created
+    bool valid() const { return _dc != NULL; }
+
+    bool rasterize(uint32_t codepoint, int pixel_size, uint8_t* pixels, int stride,
+                   Glyph_metrics& metrics) override;
+    int ascent(int pixel_size) override;
+    int line_height(int pixel_size) override;
+
+private:
+    /// Select the font of 'pixel_size' in '_dc', created on first use
+    bool select(int pixel_size);
+
+    const wchar_t* _face;
+    HDC _dc = NULL;
+    std::map<int, HFONT> _fonts;
+    std::map<int, TEXTMETRICW> _metrics;
+    int _selected = 0;
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "input_log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+// ****************************************************************************
+
+namespace {
+
+const char MAGIC[8] = { 'W', 'M', 'S', 'G', 'L', 'O', 'G', '1' };
+
+/// Largest possible record: 5 varints of 10 bytes
+const std::size_t MAX_RECORD = 5 * 10;
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+bool Input_recorder::open(const char* path)
+{
+    _last_time = 0;
+    _messages = 0;
+    return _file.open(path) && _file.append(MAGIC, sizeof(MAGIC));
+}
+
+// ****************************************************************************
+
+void Input_recorder::close()
+{
+    _file.close();
+}
+
+// ****************************************************************************
+
+void Input_recorder::record(const MSG& msg)
+{
+    uint8_t* out = _file.reserve(MAX_RECORD);
+    if (!out) {
+        return;
+    }
+    // MSG::time wraps around every 49.7 days: the signed 32 bits
+    // difference stays correct across the wrap.
+    const int32_t dt = (int32_t)(msg.time - _last_time);
+    const uint32_t window = _window_id ? _window_id(msg.hwnd, _user) : 0;
+
+    // The first byte goes in last: if we crash in the middle of the record
+    // it is still zero, the end of the log for the reader, instead of a
+    // record whose missing fields would read as zeros.
+    uint8_t first[10];
+    std::size_t n = varint_encode(uint64_t(msg.message) + 1, first);
+    std::memcpy(out + 1, first + 1, n - 1);
+    n += varint_encode(zigzag_encode(dt), out + n);
+    n += varint_encode(window, out + n);
+    n += varint_encode(uint64_t(msg.wParam), out + n);
+    n += varint_encode(zigzag_encode(int64_t(msg.lParam)), out + n);
+    std::atomic_signal_fence(std::memory_order_release);
+    out[0] = first[0];
+    _file.commit(n);
+
+    _last_time = msg.time;
+    _messages++;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+
+bool Input_log::open(const char* path)
+{
+    if (!_file.open(path)) {
+        return false;
+    }
+    if (_file.size() < sizeof(MAGIC) || memcmp(_file.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        _file.close();
+        return false;
+    }
+    rewind();
+    return true;
+}
+
+// ****************************************************************************
+
+void Input_log::rewind()
+{
+    _cursor = _file.data() ? _file.data() + sizeof(MAGIC) : nullptr;
+    _time = 0;
+}
+
+// ****************************************************************************
+
+bool Input_log::next(Recorded_message& out)
+{
+    if (!_cursor) {
+        return false;
+    }
+    const uint8_t* end = _file.data() + _file.size();
+    const uint8_t* p = _cursor;
+    uint64_t message, dt, window, wparam, lparam;
+    if (!varint_decode(p, end, message) || message == 0 ||
+        !varint_decode(p, end, dt) ||
+        !varint_decode(p, end, window) ||
+        !varint_decode(p, end, wparam) ||
+        !varint_decode(p, end, lparam))
+    {
+        return false; // end of the log (or truncated record)
+    }
+    _cursor = p;
+    _time += (DWORD)(int32_t)zigzag_decode(dt);
+
+    out.message = UINT(message - 1);
+    out.time = _time;
+    out.window = uint32_t(window);
+    out.wParam = WPARAM(wparam);
+    out.lParam = LPARAM(zigzag_decode(lparam));
+    return true;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+
+Backend_replay::Backend_replay(Input_log& log,
+                               const Window_proc& proc,
+                               Replay_speed speed,
+                               Event_backend* live)
+    : _log(log)
+    , _proc(proc)
+    , _speed(speed)
+    , _live(live)
+{
+    _has_pending = _log.next(_pending);
+    _first_time = _has_pending ? _pending.time : 0;
+    _virtual_now = _first_time;
+    _start = Clock::now();
+}
+
+// ****************************************************************************
+
+DWORD Backend_replay::now_ms() const
+{
+    if (_speed == Replay_speed::MAXIMUM) {
+        return _virtual_now;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - _start);
+    return _first_time + (DWORD)elapsed.count();
+}
+
+// ****************************************************************************
+
+double Backend_replay::ms_until_due() const
+{
+    if (_speed == Replay_speed::MAXIMUM) {
+        return 0.0;
+    }
+    double due = double((int32_t)(_pending.time - _first_time));
+    double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - _start).count();
+    return due - elapsed;
+}
+
+// ****************************************************************************
+
+bool Backend_replay::peek(MSG& msg)
+{
+    if (_live) {
+        MSG live_msg = {};
+        while (_live->peek(live_msg)) {
+            if (live_msg.message == WM_QUIT) {
+                msg = live_msg;
+                return true;
+            }
+            _live->dispatch(live_msg);
+        }
+    }
+
+    if (!_has_pending) {
+        // The log should end with a WM_QUIT, if it doesn't (crash during
+        // the recording) stop the loop anyway.
+        msg = MSG();
+        msg.message = WM_QUIT;
+        return true;
+    }
+    if (ms_until_due() > 0.0) {
+        return false;
+    }
+
+    msg = MSG();
+    msg.hwnd = _window ? _window(_pending.window, _user) : (HWND)(uintptr_t)_pending.window;
+    msg.message = _pending.message;
+    msg.wParam = _pending.wParam;
+    msg.lParam = _pending.lParam;
+    msg.time = _pending.time;
+    _virtual_now = _pending.time;
+    _replayed++;
+
+    _has_pending = _log.next(_pending);
+    return true;
+}
+
+// ****************************************************************************
+
+void Backend_replay::dispatch(MSG& msg)
+{
+    _proc(msg.hwnd, msg.message, msg.wParam, msg.lParam);
+}
+
+// ****************************************************************************
+
+void Backend_replay::wait(double timeout_seconds)
+{
+    if (!_has_pending) {
+        return;
+    }
+    double seconds = std::max(0.0, ms_until_due() * 1e-3);
+    if (timeout_seconds >= 0.0) {
+        seconds = std::min(seconds, timeout_seconds);
+    }
+    if (seconds <= 0.0) {
+        return;
+    }
+    if (_live) {
+        // Also wakes up on real messages
+        _live->wait(seconds);
+    } else {
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+// Record the messages of the main loop to a compact binary log and replay
+// them later, on Windows or on the headless backend.
+//
+// File layout: the 8 bytes "WMSGLOG1" then one record per message, every
+// field a varint (7 bits per byte, high bit set when more bytes follow):
+//
+//     message + 1        (0 marks the end of the log, see below)
+//     time delta         MSG::time - previous MSG::time, zigzag encoded
+//     window             id given by the Window_id_fn, 0 = no window
+//     wParam
+//     lParam             zigzag encoded (it's signed)
+//
+// A mouse move usually takes 7 or 8 bytes instead of the 48 of a MSG.
+//
+// The recorder writes into a memory mapped file (Mapped_append_file): no
+// system call per message, cheap enough to leave on. If the program
+// crashes the file ends with zeros, which the reader treats as the end. The
+// first byte of a record is written last: a record cut short by the crash
+// reads as the end too.
+
+#include "platform.h"
+#include "event_loop.h"
+#include "mapped_file.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// ****************************************************************************
+
+/// Write 'v' as a varint, @return the number of bytes (10 at most)
+inline std::size_t varint_encode(uint64_t v, uint8_t* out)
+{
+    std::size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = uint8_t(v) | 0x80;
+        v >>= 7;
+    }
+    out[n++] = uint8_t(v);
+    return n;
+}
+
+/// Read a varint and advance 'p'. @return false if truncated
+inline bool varint_decode(const uint8_t*& p, const uint8_t* end, uint64_t& v)
+{
+    v = 0;
+    for (unsigned shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        v |= uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Small negative numbers become small positive ones: 0, -1, 1, -2... -> 0, 1, 2, 3...
+inline uint64_t zigzag_encode(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+inline int64_t zigzag_decode(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+// ****************************************************************************
+
+class Input_recorder {
+public:
+    /// Maps a window handle to a stable id (handles change from one run to
+    /// the next). 0 means "no window".
+    typedef uint32_t (*Window_id_fn)(HWND hwnd, void* user);
+
+    /// Create the log. @return false if the file can't be created
+    bool open(const char* path);
+    void close();
+    bool is_open() const { return _file.is_open(); }
+
+    void set_window_id(Window_id_fn fn, void* user) { _window_id = fn; _user = user; }
+
+    /// Append a message (hot path: a few varints written to mapped memory)
+    void record(const MSG& msg);
+
+    uint64_t messages() const { return _messages; }
+    std::size_t bytes() const { return _file.size(); }
+
+private:
+    Mapped_append_file _file;
+    DWORD _last_time = 0;
+    uint64_t _messages = 0;
+    Window_id_fn _window_id = nullptr;
+    void* _user = nullptr;
+};
+
+// ****************************************************************************
+
+struct Recorded_message {
+    UINT message;
+    DWORD time;      ///< absolute MSG::time (rebuilt from the deltas)
+    uint32_t window; ///< see Input_recorder::Window_id_fn
+    WPARAM wParam;
+    LPARAM lParam;
+};
+
+// Sequential reader of a log
+class Input_log {
+public:
+    /// @return false if the file is missing or isn't a log
+    bool open(const char* path);
+    /// Read the next message. @return false at the end of the log
+    bool next(Recorded_message& out);
+    /// Go back to the first message
+    void rewind();
+
+private:
+    Mapped_file _file;
+    const uint8_t* _cursor = nullptr;
+    DWORD _time = 0;
+};
+
+// ****************************************************************************
+
+enum class Replay_speed {
+    RECORDED, ///< messages come out with their original timing
+    MAXIMUM   ///< as fast as the loop can take them
+};
+
+// Event_backend reading its messages from a log.
+//
+// Messages go to 'proc' exactly like Backend_headless. With 'live' the
+// real queue (e.g. Backend_win32) is still drained and dispatched inside
+// peek() so the windows keep responding; these messages bypass the loop's
+// statistics and shouldn't be user input (don't touch the window during
+// a replay).
+class Backend_replay : public Event_backend {
+public:
+    typedef std::function<LRESULT(HWND, UINT, WPARAM, LPARAM)> Window_proc;
+    /// Inverse of Input_recorder::Window_id_fn
+    typedef HWND (*Window_fn)(uint32_t window, void* user);
+
+    Backend_replay(Input_log& log, const Window_proc& proc, Replay_speed speed,
+                   Event_backend* live = nullptr);
+
+    void set_window(Window_fn fn, void* user) { _window = fn; _user = user; }
+
+    /// Messages replayed so far
+    uint64_t replayed() const { return _replayed; }
+
+    bool peek(MSG& msg) override;
+    void dispatch(MSG& msg) override;
+    void wait(double timeout_seconds) override;
+    DWORD now_ms() const override;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    /// Milliseconds before the pending message is due (<= 0: now)
+    double ms_until_due() const;
+
+    Input_log& _log;
+    Window_proc _proc;
+    Replay_speed _speed;
+    Event_backend* _live;
+    Window_fn _window = nullptr;
+    void* _user = nullptr;
+
+    Recorded_message _pending = {};
+    bool _has_pending = false;
+    bool _started = false;
+    DWORD _first_time = 0;   ///< MSG::time of the first message
+    DWORD _virtual_now = 0;  ///< MAXIMUM speed: time of the last message
+    Clock::time_point _start;
+    uint64_t _replayed = 0;
+};
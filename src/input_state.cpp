@@ -0,0 +1,102 @@
+#include "input_state.h"
+
+#include <cstring>
+
+// ****************************************************************************
+
+namespace {
+
+void set_key(Input_state& s, unsigned vk, bool is_down)
+{
+    const unsigned word = (vk >> 6) & 3;
+    const uint64_t bit = uint64_t(1) << (vk & 63);
+    const bool was_down = (s.keys_down[word] & bit) != 0;
+    if (is_down && !was_down) {
+        s.keys_down[word] |= bit;
+        s.keys_pressed[word] |= bit;
+    } else if (!is_down && was_down) {
+        s.keys_down[word] &= ~bit;
+        s.keys_released[word] |= bit;
+    }
+    // else: auto-repeat (key held down) or spurious key up, no edge.
+}
+
+void set_button(Input_state& s, uint8_t button, bool is_down)
+{
+    const bool was_down = (s.buttons_down & button) != 0;
+    if (is_down && !was_down) {
+        s.buttons_down |= button;
+        s.buttons_pressed |= button;
+    } else if (!is_down && was_down) {
+        s.buttons_down &= (uint8_t)~button;
+        s.buttons_released |= button;
+    }
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+void input_reset(Input_state& state)
+{
+    memset(&state, 0, sizeof(Input_state));
+}
+
+// ****************************************************************************
+
+bool input_on_message(Input_state& s, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    switch (message)
+    {
+    // wParam is the virtual key code. We don't need lParam's repeat count:
+    // set_key() ignores a key down for a key that is already down.
+    // WM_SYS* are sent instead when ALT is held or for F10.
+    case WM_KEYDOWN:
+    case WM_SYSKEYDOWN:
+        set_key(s, (unsigned)wParam, true);
+        return true;
+    case WM_KEYUP:
+    case WM_SYSKEYUP:
+        set_key(s, (unsigned)wParam, false);
+        return true;
+
+    // lParam packs the cursor position in client coordinates
+    case WM_MOUSEMOVE:
+        s.mouse = MAKEPOINTS(lParam);
+        return true;
+    case WM_LBUTTONDOWN: s.mouse = MAKEPOINTS(lParam); set_button(s, MOUSE_LEFT, true);    return true;
+    case WM_LBUTTONUP:   s.mouse = MAKEPOINTS(lParam); set_button(s, MOUSE_LEFT, false);   return true;
+    case WM_RBUTTONDOWN: s.mouse = MAKEPOINTS(lParam); set_button(s, MOUSE_RIGHT, true);   return true;
+    case WM_RBUTTONUP:   s.mouse = MAKEPOINTS(lParam); set_button(s, MOUSE_RIGHT, false);  return true;
+    case WM_MBUTTONDOWN: s.mouse = MAKEPOINTS(lParam); set_button(s, MOUSE_MIDDLE, true);  return true;
+    case WM_MBUTTONUP:   s.mouse = MAKEPOINTS(lParam); set_button(s, MOUSE_MIDDLE, false); return true;
+
+    // The high word of wParam is the signed wheel delta (multiple of 120)
+    case WM_MOUSEWHEEL:
+        s.wheel += (short)HIWORD(wParam);
+        return true;
+
+    // We won't receive the key up / button up events once the window lost
+    // the focus: release everything so nothing stays stuck down.
+    case WM_KILLFOCUS:
+        for (unsigned i = 0; i < 4; ++i) {
+            s.keys_released[i] |= s.keys_down[i];
+            s.keys_down[i] = 0;
+        }
+        s.buttons_released |= s.buttons_down;
+        s.buttons_down = 0;
+        return false;
+    }
+    return false;
+}
+
+// ****************************************************************************
+
+void input_end_frame(Input_state& s)
+{
+    memset(s.keys_pressed, 0, sizeof(s.keys_pressed));
+    memset(s.keys_released, 0, sizeof(s.keys_released));
+    s.buttons_pressed = 0;
+    s.buttons_released = 0;
+    s.wheel = 0;
+}
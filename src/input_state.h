@@ -0,0 +1,62 @@
+#pragma once
+
+// Snapshot of the keyboard and mouse, filled from window messages.
+//
+// Instead of asking the OS about a key every frame (GetAsyncKeyState() is a
+// system call, and only tells about one key) event_handler() feeds every
+// keyboard / mouse message to input_on_message() and the frame code reads
+// the result with plain memory accesses.
+//
+// The whole state is a few cache lines: 256 virtual keys stored as bitsets
+// ('down' plus edge triggered 'pressed' / 'released' masks since the last
+// frame) and the mouse position / buttons.
+
+#include "platform.h"
+
+#include <cstdint>
+
+enum Mouse_button {
+    MOUSE_LEFT   = 1 << 0,
+    MOUSE_RIGHT  = 1 << 1,
+    MOUSE_MIDDLE = 1 << 2
+};
+
+struct Input_state {
+    // One bit per virtual key code (VK_*), 4 x 64 = 256 keys
+    uint64_t keys_down[4];
+    uint64_t keys_pressed[4];  ///< went down since the last frame
+    uint64_t keys_released[4]; ///< went up since the last frame
+
+    POINTS mouse;              ///< last known cursor position (client coords)
+    uint8_t buttons_down;      ///< bitfield of 'Mouse_button'
+    uint8_t buttons_pressed;
+    uint8_t buttons_released;
+    int wheel;                 ///< accumulated wheel delta since the last frame
+};
+
+// ****************************************************************************
+
+/// Zero everything (no key down, mouse at 0, 0)
+void input_reset(Input_state& state);
+
+/// Update the state from a window message.
+/// @return true if the message was a keyboard / mouse message.
+bool input_on_message(Input_state& state, UINT message, WPARAM wParam, LPARAM lParam);
+
+/// Clear the edge triggered masks (pressed / released / wheel).
+/// Call at the end of every frame.
+void input_end_frame(Input_state& state);
+
+// ****************************************************************************
+
+inline bool key_bit(const uint64_t* bits, unsigned vk) {
+    return ((bits[(vk >> 6) & 3] >> (vk & 63)) & 1u) != 0;
+}
+
+inline bool key_down(const Input_state& s, unsigned vk)     { return key_bit(s.keys_down, vk); }
+inline bool key_pressed(const Input_state& s, unsigned vk)  { return key_bit(s.keys_pressed, vk); }
+inline bool key_released(const Input_state& s, unsigned vk) { return key_bit(s.keys_released, vk); }
+
+inline bool button_down(const Input_state& s, Mouse_button b)     { return (s.buttons_down & b) != 0; }
+inline bool button_pressed(const Input_state& s, Mouse_button b)  { return (s.buttons_pressed & b) != 0; }
+inline bool button_released(const Input_state& s, Mouse_button b) { return (s.buttons_released & b) != 0; }
@@ -0,0 +1,381 @@
+#include "job_system.h"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// ****************************************************************************
+
+namespace {
+
+std::atomic<Job_mode> g_default_mode{Job_mode::THREADED};
+
+/// Spins of an idle worker before it goes to sleep
+const int IDLE_SPINS = 256;
+
+// Which thread of which Job_system we are. A thread that isn't a worker (or
+// is a worker of another system) is the external thread, index 0: only one
+// at a time, see Job_system::this_thread().
+thread_local const Job_system* tls_system = nullptr;
+thread_local unsigned tls_index = 0;
+
+inline void cpu_pause()
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+// Deque
+// ****************************************************************************
+
+Job_system::Deque::Deque()
+    : _items(new std::atomic<Job*>[MAX_JOBS])
+{
+}
+
+// ****************************************************************************
+
+bool Job_system::Deque::push(Job* job)
+{
+    const int64_t b = _bottom.load(std::memory_order_relaxed);
+    const int64_t t = _top.load(std::memory_order_acquire);
+    if (b - t >= int64_t(MAX_JOBS)) {
+        return false;
+    }
+    _items[std::size_t(b) & (MAX_JOBS - 1)].store(job, std::memory_order_relaxed);
+    // Release: the job (and its payload) is visible before the new bottom
+    _bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+// ****************************************************************************
+
+Job* Job_system::Deque::pop()
+{
+    const int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+    _bottom.store(b, std::memory_order_relaxed);
+    // Thieves must see the reservation before we read 'top'
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = _top.load(std::memory_order_relaxed);
+    if (t > b) {
+        // Empty
+        _bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job* job = _items[std::size_t(b) & (MAX_JOBS - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+        // Last item: race against the thieves for it
+        if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        _bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+// ****************************************************************************
+
+Job* Job_system::Deque::steal()
+{
+    int64_t t = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = _bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+        return nullptr;
+    }
+    Job* job = _items[std::size_t(t) & (MAX_JOBS - 1)].load(std::memory_order_relaxed);
+    if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+        return nullptr; // another thief or the owner got it
+    }
+    return job;
+}
+
+// ****************************************************************************
+// Job_system
+// ****************************************************************************
+
+Job_system::Job_system(int workers)
+    : _mode(default_mode())
+{
+    start(workers);
+}
+
+// ****************************************************************************
+
+Job_system::Job_system(int workers, Job_mode mode)
+    : _mode(mode)
+{
+    start(workers);
+}
+
+// ****************************************************************************
+
+void Job_system::start(int workers)
+{
+    if (_mode == Job_mode::INLINE) {
+        workers = 0;
+    } else if (workers < 0) {
+        unsigned hw = std::thread::hardware_concurrency();
+        workers = hw > 1 ? int(hw) - 1 : 0;
+    }
+    _thread_count = unsigned(workers) + 1;
+    _threads.reset(new Thread_data[_thread_count]);
+    for (unsigned i = 0; i < _thread_count; ++i) {
+        _threads[i].jobs.reset(new Job[MAX_JOBS]);
+        for (std::size_t j = 0; j < MAX_JOBS; ++j) {
+            _threads[i].jobs[j].unfinished.store(0, std::memory_order_relaxed);
+        }
+        _threads[i].random = 0x9E3779B9u * (i + 1);
+    }
+    _workers.reserve(std::size_t(workers));
+    for (unsigned i = 1; i < _thread_count; ++i) {
+        _workers.emplace_back(&Job_system::worker_main, this, i);
+    }
+}
+
+// ****************************************************************************
+
+Job_system::~Job_system()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+    for (std::thread& t : _workers) {
+        t.join();
+    }
+}
+
+// ****************************************************************************
+
+void Job_system::set_default_mode(Job_mode mode)
+{
+    g_default_mode.store(mode);
+}
+
+// ****************************************************************************
+
+Job_mode Job_system::default_mode()
+{
+    return g_default_mode.load();
+}
+
+// ****************************************************************************
+
+void Job_system::set_external_thread()
+{
+    _external.store(std::this_thread::get_id(), std::memory_order_relaxed);
+}
+
+// ****************************************************************************
+
+Job_system::Thread_data& Job_system::this_thread()
+{
+    if (tls_system == this) {
+        return _threads[tls_index];
+    }
+    // The first thread from outside becomes the external thread
+    const std::thread::id self = std::this_thread::get_id();
+    std::thread::id owner = _external.load(std::memory_order_relaxed);
+    if (owner == std::thread::id() &&
+        _external.compare_exchange_strong(owner, self, std::memory_order_relaxed)) {
+        owner = self;
+    }
+    assert(owner == self && "a second external thread uses the Job_system (see set_external_thread())");
+    (void)owner;
+    return _threads[0];
+}
+
+// ****************************************************************************
+
+Job* Job_system::allocate(Job* parent, Job_fn fn)
+{
+    Thread_data& self = this_thread();
+    Job* job = &self.jobs[self.next_job++ & (MAX_JOBS - 1)];
+    // The ring wrapped around onto a job still running: too many jobs
+    // in flight on this thread
+    assert(done(job) && "more than Job_system::MAX_JOBS jobs in flight");
+    job->fn = fn;
+    job->parent = parent;
+    job->unfinished.store(1, std::memory_order_relaxed);
+    if (parent) {
+        parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+// ****************************************************************************
+
+Job* Job_system::create(Job_fn fn, const void* data, std::size_t size)
+{
+    return create_child(nullptr, fn, data, size);
+}
+
+// ****************************************************************************
+
+Job* Job_system::create_child(Job* parent, Job_fn fn, const void* data, std::size_t size)
+{
+    assert(size <= Job::PAYLOAD_SIZE);
+    Job* job = allocate(parent, fn);
+    if (data && size) {
+        std::memcpy(job->payload, data, size < Job::PAYLOAD_SIZE ? size : Job::PAYLOAD_SIZE);
+    }
+    return job;
+}
+
+// ****************************************************************************
+
+void Job_system::run(Job* job)
+{
+    Thread_data& self = this_thread();
+    if (_mode == Job_mode::INLINE || !self.deque.push(job)) {
+        // Inline mode, or the deque is full: no choice but to run it now
+        execute(self, job);
+        return;
+    }
+    // Pairs with the worker going to sleep, see worker_main()
+    _queued.fetch_add(1, std::memory_order_seq_cst);
+    if (_sleeping.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _wake.notify_one();
+    }
+}
+
+// ****************************************************************************
+
+void Job_system::wait(const Job* job)
+{
+    Thread_data& self = this_thread();
+    int idle = 0;
+    while (!done(job))
+    {
+        if (Job* next = next_job(self)) {
+            execute(self, next);
+            idle = 0;
+        } else if (++idle < IDLE_SPINS) {
+            // What's left is running on other threads
+            cpu_pause();
+        } else {
+            // ... for a while: let them have our core
+            std::this_thread::yield();
+        }
+    }
+}
+
+// ****************************************************************************
+
+Job* Job_system::next_job(Thread_data& self)
+{
+    Job* job = self.deque.pop();
+    if (!job && _thread_count > 1)
+    {
+        // Random victim: no two idle threads keep hammering the same deque
+        uint32_t r = self.random;
+        r ^= r << 13;
+        r ^= r >> 17;
+        r ^= r << 5;
+        self.random = r;
+        const unsigned first = r % _thread_count;
+        for (unsigned k = 0; k < _thread_count && !job; ++k) {
+            Thread_data& victim = _threads[(first + k) % _thread_count];
+            if (&victim != &self) {
+                job = victim.deque.steal();
+            }
+        }
+        if (job) {
+            self.steals.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (job) {
+        _queued.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+// ****************************************************************************
+
+void Job_system::execute(Thread_data& self, Job* job)
+{
+    job->fn(*job);
+    self.executed.fetch_add(1, std::memory_order_relaxed);
+    finish(job);
+}
+
+// ****************************************************************************
+
+void Job_system::finish(Job* job)
+{
+    // The last one to finish (the job itself or its last child) completes
+    // the parent. 'parent' is read first: once done, the job's slot may be
+    // reused by its owner at any time.
+    while (job) {
+        Job* parent = job->parent;
+        if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            break;
+        }
+        job = parent;
+    }
+}
+
+// ****************************************************************************
+
+void Job_system::worker_main(unsigned index)
+{
+    tls_system = this;
+    tls_index = index;
+    Thread_data& self = _threads[index];
+    int idle = 0;
+    for (;;)
+    {
+        if (Job* job = next_job(self)) {
+            execute(self, job);
+            idle = 0;
+            continue;
+        }
+        if (++idle < IDLE_SPINS) {
+            cpu_pause();
+            continue;
+        }
+        // Nothing to do for a while: sleep until run() pushes a job.
+        // '_sleeping' is raised before '_queued' is checked and run() raises
+        // '_queued' before checking '_sleeping': a job can't be missed.
+        idle = 0;
+        std::unique_lock<std::mutex> lock(_mutex);
+        _sleeping.fetch_add(1, std::memory_order_seq_cst);
+        if (!_quit && _queued.load(std::memory_order_seq_cst) <= 0) {
+            self.sleeps.fetch_add(1, std::memory_order_relaxed);
+            _wake.wait(lock, [this]() {
+                return _quit || _queued.load(std::memory_order_seq_cst) > 0;
+            });
+        }
+        _sleeping.fetch_sub(1, std::memory_order_relaxed);
+        if (_quit) {
+            return;
+        }
+    }
+}
+
+// ****************************************************************************
+
+Job_stats Job_system::stats() const
+{
+    Job_stats s;
+    for (unsigned i = 0; i < _thread_count; ++i) {
+        s.jobs += _threads[i].executed.load(std::memory_order_relaxed);
+        s.steals += _threads[i].steals.load(std::memory_order_relaxed);
+        s.sleeps += _threads[i].sleeps.load(std::memory_order_relaxed);
+    }
+    return s;
+}
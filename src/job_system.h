@@ -0,0 +1,246 @@
+#pragma once
+
+// Work-stealing job system: a fixed set of worker threads running small
+// jobs, with parent / child dependencies.
+//
+//     Job* root = jobs.create([]() {});               // empty parent
+//     for (...) {
+//         jobs.run(jobs.create_child(root, [&]() { decode(...); }));
+//     }
+//     jobs.run(root);
+//     jobs.wait(root);   // returns once root and all its children are done
+//
+// or simply, for data parallel loops (the tiles of a Framebuffer):
+//
+//     jobs.parallel_for(tile_count, [&](std::size_t tile) { ... });
+//
+// Design:
+// - each thread (the workers, plus one external thread: whoever calls
+//   run() / wait() from outside, e.g. the render thread) owns a deque of
+//   jobs. The owner pushes and pops at the bottom (LIFO: the job it just
+//   created is hot in cache), idle threads steal from the top (FIFO: the
+//   oldest, usually biggest, work). Chase-Lev deque: push / pop are plain
+//   loads and stores in the common case, only the last item and steals
+//   need a compare and swap. No lock anywhere on the job path.
+// - there is one external thread at a time: the first thread from outside
+//   to use the system, or the last one to call set_external_thread(). A
+//   second one would share its deque and ring: it asserts instead.
+// - jobs are allocated from a per-thread ring of MAX_JOBS: no heap
+//   allocation, no freeing. A thread must not have more than MAX_JOBS jobs
+//   in flight (a frame's worth of work is far below that).
+// - a job is done when its own function and every child finished:
+//   'unfinished' counts both, finishing the last one propagates to the
+//   parent.
+// - wait() doesn't block: the waiting thread runs other jobs until the one
+//   it waits on is done.
+// - workers with nothing to steal spin for a moment, then sleep on a
+//   condition variable until a job is pushed.
+//
+// Job_mode::INLINE runs every job right away inside run(), on the calling
+// thread, without any worker: execution order is deterministic, stepping
+// in a debugger is sequential. "-jobs_inline" on the command line.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+struct Job;
+typedef void (*Job_fn)(Job& job);
+
+struct alignas(64) Job {
+    static const std::size_t PAYLOAD_SIZE = 96;
+
+    Job_fn fn;
+    Job* parent;
+    std::atomic<int32_t> unfinished; ///< this job + unfinished children
+    /// Arguments of 'fn' (e.g. the lambda given to Job_system::create())
+    alignas(16) unsigned char payload[PAYLOAD_SIZE];
+};
+
+enum class Job_mode {
+    THREADED, ///< workers run the jobs
+    INLINE    ///< run() executes the job immediately (debugging)
+};
+
+struct Job_stats {
+    uint64_t jobs = 0;   ///< jobs executed
+    uint64_t steals = 0; ///< ... taken from another thread's deque
+    uint64_t sleeps = 0; ///< times a worker went to sleep
+};
+
+// ****************************************************************************
+
+class Job_system {
+public:
+    static const std::size_t MAX_JOBS = 4096; ///< in flight, per thread
+
+    /// @param workers : threads created. Negative means one less than the
+    /// number of hardware threads (the external thread works in wait()).
+    /// @param mode : default_mode() if not specified
+    explicit Job_system(int workers = -1);
+    Job_system(int workers, Job_mode mode);
+    ~Job_system();
+
+    Job_system(const Job_system&) = delete;
+    Job_system& operator=(const Job_system&) = delete;
+
+    /// Mode of the job systems constructed without one (set it at startup)
+    static void set_default_mode(Job_mode mode);
+    static Job_mode default_mode();
+
+    Job_mode mode() const { return _mode; }
+
+    /// Make the calling thread the external thread (e.g. at the top of the
+    /// thread that drives the system from now on). The previous external
+    /// thread must be done with it: no job it created is still running.
+    void set_external_thread();
+
+    /// Worker threads + the external thread
+    unsigned concurrency() const { return unsigned(_workers.size()) + 1; }
+
+    // -------------------------------------------------------------------------
+    /// @name Jobs
+    /// From the external thread or from inside a job only.
+    // -------------------------------------------------------------------------
+
+    /// Job calling 'fn(job)', 'size' bytes of 'data' copied to its payload
+    Job* create(Job_fn fn, const void* data = nullptr, std::size_t size = 0);
+    /// Same, and 'parent' isn't done until this job is
+    Job* create_child(Job* parent, Job_fn fn, const void* data = nullptr, std::size_t size = 0);
+
+    /// Job calling 'callable()'. Captures are copied into the job: they
+    /// must fit in Job::PAYLOAD_SIZE and be trivially copyable (capture
+    /// pointers or references, not std::string / std::vector).
+    template<class F> Job* create(const F& callable) {
+        return create_callable(nullptr, callable);
+    }
+    template<class F> Job* create_child(Job* parent, const F& callable) {
+        return create_callable(parent, callable);
+    }
+
+    /// Make the job available to every thread
+    void run(Job* job);
+
+    /// Run jobs until 'job' and its children are done
+    void wait(const Job* job);
+
+    static bool done(const Job* job) {
+        return job->unfinished.load(std::memory_order_acquire) <= 0;
+    }
+
+    /// Call fn(i) for every i in [0, count): one child job per 'grain'
+    /// indices, returns once they are all done. Reentrant: may be called
+    /// from inside a job.
+    /// @param grain : 0 picks about 8 jobs per thread, enough for idle
+    /// threads to balance uneven items by stealing
+    template<class Fn>
+    void parallel_for(std::size_t count, const Fn& fn, std::size_t grain = 0);
+
+    // -------------------------------------------------------------------------
+
+    /// Totals over every thread. Approximate while jobs are running.
+    Job_stats stats() const;
+
+private:
+    /// Chase-Lev work-stealing deque of job pointers, fixed capacity
+    class Deque {
+    public:
+        Deque();
+        bool push(Job* job);  ///< owner only. false if full
+        Job* pop();           ///< owner only
+        Job* steal();         ///< any thread
+    private:
+        alignas(64) std::atomic<int64_t> _top{0};
+        alignas(64) std::atomic<int64_t> _bottom{0};
+        std::unique_ptr<std::atomic<Job*>[]> _items;
+    };
+
+    /// A worker, or the external thread (index 0)
+    struct alignas(64) Thread_data {
+        Deque deque;
+        std::unique_ptr<Job[]> jobs; ///< ring of MAX_JOBS
+        uint32_t next_job = 0;
+        uint32_t random = 0;         ///< xorshift state to pick victims
+        std::atomic<uint64_t> executed{0};
+        std::atomic<uint64_t> steals{0};
+        std::atomic<uint64_t> sleeps{0};
+    };
+
+    template<class F>
+    Job* create_callable(Job* parent, const F& callable)
+    {
+        static_assert(sizeof(F) <= Job::PAYLOAD_SIZE, "too many captures for a job's payload");
+        static_assert(std::is_trivially_copyable<F>::value, "job captures must be trivially copyable");
+        static_assert(alignof(F) <= 16, "job captures are over aligned");
+        Job* job = allocate(parent, [](Job& j) { (*(const F*)j.payload)(); });
+        new (job->payload) F(callable);
+        return job;
+    }
+
+    void start(int workers);
+    Job* allocate(Job* parent, Job_fn fn);
+    Thread_data& this_thread();
+    /// Own deque first, then steal. NULL if there was nothing to run
+    Job* next_job(Thread_data& self);
+    void execute(Thread_data& self, Job* job);
+    void finish(Job* job);
+    void worker_main(unsigned index);
+
+    Job_mode _mode;
+    std::vector<std::thread> _workers;
+    std::unique_ptr<Thread_data[]> _threads; ///< 0: external thread
+    unsigned _thread_count = 0;
+    std::atomic<std::thread::id> _external{std::thread::id()}; ///< owner of _threads[0]
+
+    // Sleeping workers
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::atomic<int64_t> _queued{0};   ///< jobs pushed and not taken yet
+    std::atomic<unsigned> _sleeping{0};
+    bool _quit = false;
+};
+
+// ****************************************************************************
+
+template<class Fn>
+void Job_system::parallel_for(std::size_t count, const Fn& fn, std::size_t grain)
+{
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = std::max<std::size_t>(1, count / (std::size_t(concurrency()) * 8));
+    }
+    // Not worth a job
+    if (_mode == Job_mode::INLINE || _workers.empty() || count <= grain) {
+        for (std::size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+    // Stay well below the job ring's capacity
+    const std::size_t max_children = MAX_JOBS / 4;
+    grain = std::max(grain, (count + max_children - 1) / max_children);
+
+    const Fn* f = &fn;
+    Job* root = create([]() {});
+    for (std::size_t begin = 0; begin < count; begin += grain)
+    {
+        const std::size_t end = std::min(begin + grain, count);
+        run(create_child(root, [f, begin, end]() {
+            for (std::size_t i = begin; i < end; ++i) {
+                (*f)(i);
+            }
+        }));
+    }
+    run(root);
+    wait(root);
+}
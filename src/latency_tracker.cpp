@@ -0,0 +1,96 @@
+#include "latency_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+// ****************************************************************************
+
+void Latency_histogram::add(int64_t latency_us)
+{
+    // Clocks of two threads: an input can look a hair newer than the present
+    latency_us = std::max<int64_t>(latency_us, 0);
+    const std::size_t bucket = std::min<std::size_t>(std::size_t(latency_us / BUCKET_US), BUCKETS - 1);
+    _buckets[bucket]++;
+    _count++;
+    _max_us = std::max(_max_us, latency_us);
+}
+
+// ****************************************************************************
+
+void Latency_histogram::reset()
+{
+    std::fill(_buckets, _buckets + BUCKETS, uint64_t(0));
+    _count = 0;
+    _max_us = 0;
+}
+
+// ****************************************************************************
+
+double Latency_histogram::percentile_ms(double p) const
+{
+    if (_count == 0) {
+        return 0.0;
+    }
+    // Smallest bucket with at least p * count samples at or below it
+    const uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(p * double(_count))));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i)
+    {
+        seen += _buckets[i];
+        if (seen >= rank) {
+            // The last bucket is open ended: its bound is the maximum
+            const int64_t bound = i + 1 < BUCKETS ? int64_t(i + 1) * BUCKET_US : _max_us;
+            return double(std::min(bound, _max_us)) / 1000.0;
+        }
+    }
+    return max_ms();
+}
+
+// ****************************************************************************
+
+void Latency_tracker::input(int64_t time_us)
+{
+    _pending.push_back(time_us);
+}
+
+// ****************************************************************************
+
+void Latency_tracker::presented(int64_t present_us, int64_t display_us)
+{
+    _frames++;
+    for (int64_t input_us : _pending)
+    {
+        _present.add(present_us - input_us);
+        if (display_us > 0) {
+            _display.add(display_us - input_us);
+        }
+    }
+    _pending.clear();
+}
+
+// ****************************************************************************
+
+Latency_stats Latency_tracker::stats() const
+{
+    Latency_stats s;
+    s.inputs = _present.count();
+    s.frames = _frames;
+    s.present_p50_ms = _present.percentile_ms(0.50);
+    s.present_p99_ms = _present.percentile_ms(0.99);
+    s.present_max_ms = _present.max_ms();
+    s.displayed = _display.count();
+    s.display_p50_ms = _display.percentile_ms(0.50);
+    s.display_p99_ms = _display.percentile_ms(0.99);
+    s.display_max_ms = _display.max_ms();
+    return s;
+}
+
+// ****************************************************************************
+
+void Latency_tracker::reset()
+{
+    _pending.clear();
+    _present.reset();
+    _display.reset();
+    _frames = 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+// Input to present latency, per window.
+//
+// Every input message the render thread applies to a window is remembered
+// with its time stamp ('MSG::time', converted to the raw_input_now_us()
+// clock, see Render_thread::post()). When the window's next frame is
+// presented, each of those inputs is paired with that frame:
+//
+//   latency = when present() returned - when the input happened
+//
+// This is the part of the delay we control: time spent in the OS queue,
+// in our queue, waiting for the frame to start and rendering it. What
+// happens after Present() (the frames the swap chain queues before the one
+// we just gave it, scan out) is only known when the backend can tell when
+// the frame reaches the screen: Renderer::display_time_us(), e.g. the
+// software renderer paced by a simulated Vblank_clock (vblank_clock.h).
+// That one is recorded separately as "input to display".
+//
+// Latencies go to fixed histograms (BUCKET_US wide buckets): the median
+// and the 99th percentile cost no allocation and no sort, whatever the
+// number of inputs.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Latency_stats {
+    uint64_t inputs = 0;         ///< inputs paired with a presented frame
+    uint64_t frames = 0;         ///< presents
+    double present_p50_ms = 0.0; ///< input to present
+    double present_p99_ms = 0.0;
+    double present_max_ms = 0.0;
+    uint64_t displayed = 0;      ///< inputs whose display time is known
+    double display_p50_ms = 0.0; ///< input to display
+    double display_p99_ms = 0.0;
+    double display_max_ms = 0.0;
+};
+
+// ****************************************************************************
+
+/// Histogram of latencies in [0, BUCKETS * BUCKET_US[, anything above goes
+/// to the last bucket (the exact maximum is kept aside)
+class Latency_histogram {
+public:
+    static const int64_t BUCKET_US = 100;
+    static const std::size_t BUCKETS = 2000; ///< 200 ms
+
+    void add(int64_t latency_us);
+    void reset();
+
+    uint64_t count() const { return _count; }
+    /// Upper bound of the bucket holding the 'p' quantile (p in [0, 1]), in ms
+    double percentile_ms(double p) const;
+    double max_ms() const { return double(_max_us) / 1000.0; }
+
+private:
+    uint64_t _buckets[BUCKETS] = {};
+    uint64_t _count = 0;
+    int64_t _max_us = 0;
+};
+
+// ****************************************************************************
+
+class Latency_tracker {
+public:
+    Latency_tracker() { _pending.reserve(256); }
+
+    /// An input event reached the window (render thread, when applied).
+    /// @param time_us : when it happened, raw_input_now_us() clock
+    void input(int64_t time_us);
+
+    /// The window's frame was presented: every input since the last call
+    /// is paired with it.
+    /// @param present_us : when present() returned
+    /// @param display_us : when the frame reaches the screen, 0 if unknown
+    void presented(int64_t present_us, int64_t display_us = 0);
+
+    Latency_stats stats() const;
+    void reset();
+
+private:
+    std::vector<int64_t> _pending; ///< inputs waiting for a frame
+    Latency_histogram _present;
+    Latency_histogram _display;
+    uint64_t _frames = 0;
+};
@@ -0,0 +1,238 @@
+#include "mapped_file.h"
+
+#include "platform.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ****************************************************************************
+
+namespace {
+
+#ifndef _WIN32
+// We store 'fd + 1' in the void* handle so that nullptr means "no file"
+void* fd_to_handle(int fd) { return (void*)(intptr_t)(fd + 1); }
+int handle_to_fd(void* h) { return int((intptr_t)h) - 1; }
+#endif
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+bool Mapped_file::open(const char* path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    _handle = file;
+    _size = (std::size_t)size.QuadPart;
+    if (_size == 0) {
+        return true; // can't map an empty file, but it's a valid one
+    }
+    _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping) {
+        _data = (const uint8_t*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    _handle = fd_to_handle(fd);
+    _size = (std::size_t)st.st_size;
+    if (_size == 0) {
+        return true;
+    }
+    void* p = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    _data = p != MAP_FAILED ? (const uint8_t*)p : nullptr;
+#endif
+    if (!_data) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// ****************************************************************************
+
+void Mapped_file::close()
+{
+#ifdef _WIN32
+    if (_data) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping) {
+        CloseHandle((HANDLE)_mapping);
+    }
+    if (_handle) {
+        CloseHandle((HANDLE)_handle);
+    }
+#else
+    if (_data) {
+        munmap((void*)_data, _size);
+    }
+    if (_handle) {
+        ::close(handle_to_fd(_handle));
+    }
+#endif
+    _data = nullptr;
+    _size = 0;
+    _handle = nullptr;
+    _mapping = nullptr;
+}
+
+// ****************************************************************************
+// ****************************************************************************
+
+bool Mapped_append_file::open(const char* path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                              nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    _handle = file;
+#else
+    int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    _handle = fd_to_handle(fd);
+#endif
+    _size = 0;
+    if (!map(_chunk)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// ****************************************************************************
+
+void Mapped_append_file::close()
+{
+    if (!_handle) {
+        return;
+    }
+    unmap();
+    // The file is as large as the last mapping: cut the unused tail
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    size.QuadPart = (LONGLONG)_size;
+    SetFilePointerEx((HANDLE)_handle, size, nullptr, FILE_BEGIN);
+    SetEndOfFile((HANDLE)_handle);
+    CloseHandle((HANDLE)_handle);
+#else
+    if (ftruncate(handle_to_fd(_handle), (off_t)_size) != 0) {
+        // Nothing we can do: the log only has trailing zeros
+    }
+    ::close(handle_to_fd(_handle));
+#endif
+    _handle = nullptr;
+    _size = 0;
+    _capacity = 0;
+}
+
+// ****************************************************************************
+
+bool Mapped_append_file::append(const void* data, std::size_t bytes)
+{
+    uint8_t* dst = reserve(bytes);
+    if (!dst) {
+        return false;
+    }
+    memcpy(dst, data, bytes);
+    commit(bytes);
+    return true;
+}
+
+// ****************************************************************************
+
+bool Mapped_append_file::grow(std::size_t min_capacity)
+{
+    // Double up to 64 chunks at a time so long recordings remap rarely
+    std::size_t capacity = _capacity + std::min(std::max(_capacity, _chunk), _chunk * 64);
+    while (capacity < min_capacity) {
+        capacity += _chunk;
+    }
+    unmap();
+    return map(capacity);
+}
+
+// ****************************************************************************
+
+bool Mapped_append_file::map(std::size_t capacity)
+{
+#ifdef _WIN32
+    // The mapping object extends the file to 'capacity' bytes
+    LARGE_INTEGER size;
+    size.QuadPart = (LONGLONG)capacity;
+    _mapping = CreateFileMappingA((HANDLE)_handle, nullptr, PAGE_READWRITE,
+                                  (DWORD)(size.QuadPart >> 32), (DWORD)size.QuadPart, nullptr);
+    if (!_mapping) {
+        return false;
+    }
+    _data = (uint8_t*)MapViewOfFile(_mapping, FILE_MAP_WRITE, 0, 0, capacity);
+    if (!_data) {
+        CloseHandle((HANDLE)_mapping);
+        _mapping = nullptr;
+        return false;
+    }
+#else
+    int fd = handle_to_fd(_handle);
+    if (ftruncate(fd, (off_t)capacity) != 0) {
+        return false;
+    }
+    void* p = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    _data = (uint8_t*)p;
+#endif
+    _capacity = capacity;
+    return true;
+}
+
+// ****************************************************************************
+
+void Mapped_append_file::unmap()
+{
+#ifdef _WIN32
+    if (_data) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping) {
+        CloseHandle((HANDLE)_mapping);
+    }
+#else
+    if (_data) {
+        munmap(_data, _capacity);
+    }
+#endif
+    _data = nullptr;
+    _mapping = nullptr;
+    _capacity = 0;
+}
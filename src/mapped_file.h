@@ -0,0 +1,87 @@
+#pragma once
+
+// Memory mapped files.
+//
+// Instead of read() / write() system calls the file is mapped in our
+// address space and accessed like an array: the OS pages it in (or
+// writes it back) on its own.
+// - Mapped_file:        read only view of a whole file
+// - Mapped_append_file: write only, append at the end. The file grows by
+//   large chunks so appending is a memcpy, with a system call every few
+//   megabytes only.
+
+#include <cstddef>
+#include <cstdint>
+
+// ****************************************************************************
+
+class Mapped_file {
+public:
+    Mapped_file() = default;
+    ~Mapped_file() { close(); }
+
+    Mapped_file(const Mapped_file&) = delete;
+    Mapped_file& operator=(const Mapped_file&) = delete;
+
+    /// @return false if the file doesn't exist or can't be mapped
+    bool open(const char* path);
+    void close();
+
+    bool is_open() const { return _data != nullptr || _handle != nullptr; }
+    const uint8_t* data() const { return _data; }
+    std::size_t size() const { return _size; }
+
+private:
+    const uint8_t* _data = nullptr;
+    std::size_t _size = 0;
+    void* _handle = nullptr;  ///< file (Win32 HANDLE or fd + 1)
+    void* _mapping = nullptr; ///< file mapping object (Win32 only)
+};
+
+// ****************************************************************************
+
+class Mapped_append_file {
+public:
+    /// @param chunk : the file grows by this many bytes at a time
+    explicit Mapped_append_file(std::size_t chunk = 4 << 20) : _chunk(chunk) { }
+    ~Mapped_append_file() { close(); }
+
+    Mapped_append_file(const Mapped_append_file&) = delete;
+    Mapped_append_file& operator=(const Mapped_append_file&) = delete;
+
+    /// Create (or truncate) the file. @return false on failure
+    bool open(const char* path);
+    /// Unmap and cut the file to the bytes actually written.
+    void close();
+    bool is_open() const { return _data != nullptr; }
+
+    /// Pointer where at least 'bytes' can be written, call commit() once
+    /// done. Maps a larger view when needed.
+    /// @return nullptr if the file couldn't grow
+    uint8_t* reserve(std::size_t bytes)
+    {
+        if (_size + bytes > _capacity && !grow(_size + bytes)) {
+            return nullptr;
+        }
+        return _data + _size;
+    }
+
+    void commit(std::size_t bytes) { _size += bytes; }
+
+    bool append(const void* data, std::size_t bytes);
+
+    /// Bytes written so far
+    std::size_t size() const { return _size; }
+
+private:
+    bool grow(std::size_t min_capacity);
+    bool map(std::size_t capacity);
+    void unmap();
+
+    uint8_t* _data = nullptr;
+    std::size_t _size = 0;
+    std::size_t _capacity = 0;
+    std::size_t _chunk;
+    void* _handle = nullptr;
+    void* _mapping = nullptr;
+};
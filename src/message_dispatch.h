@@ -0,0 +1,136 @@
+#pragma once
+
+// Compile-time message dispatch tables.
+//
+// Instead of one big switch in the window procedure, every handler is a
+// plain function listed in a constexpr array next to the code it belongs to:
+//
+//     constexpr Message_entry g_input_handlers[] = {
+//         { WM_KEYDOWN,     on_key_down },
+//         { WM_LBUTTONDOWN, on_left_button_down },
+//     };
+//
+// make_dispatch_table() merges any number of such arrays (each subsystem
+// keeps its own list) into a single table built by the compiler:
+// - IDs below 'Dense' (the standard messages WM_* we receive all the time)
+//   index an array of function pointers directly: one load, no branch per
+//   case.
+// - other IDs (WM_USER + x, WM_APP + x, registered messages...) are kept
+//   sorted and found by binary search.
+//
+// The same table type maps WM_COMMAND identifiers (IDM_*) to handlers.
+
+#include "platform.h"
+
+#include <cstddef>
+
+struct Window_state;
+
+// ****************************************************************************
+
+struct Message {
+    HWND hwnd;
+    UINT message;
+    WPARAM wParam;
+    LPARAM lParam;
+    Window_state* window; ///< state of 'hwnd' (see window_manager.h)
+};
+
+/// @return true if the message was fully handled, 'result' is then
+/// returned to Windows. false lets DefWindowProc() process the message.
+typedef bool (*Message_fn)(const Message& msg, LRESULT& result);
+
+struct Message_entry {
+    UINT id;       ///< WM_* for messages, IDM_* for commands
+    Message_fn fn;
+};
+
+// ****************************************************************************
+
+template<std::size_t N, UINT Dense>
+class Dispatch_table {
+public:
+    constexpr Dispatch_table() = default;
+
+    /// Handler of 'id' or nullptr
+    Message_fn find(UINT id) const
+    {
+        if (id < Dense) {
+            return _dense[id];
+        }
+        // Lower bound in the sorted entries
+        std::size_t lo = 0;
+        std::size_t hi = _sparse_count;
+        while (lo < hi) {
+            std::size_t mid = (lo + hi) / 2;
+            if (_sparse[mid].id < id) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return (lo < _sparse_count && _sparse[lo].id == id) ? _sparse[lo].fn : nullptr;
+    }
+
+    /// Call the handler of 'id' (msg.message, or LOWORD(msg.wParam) for a
+    /// command). @return false if there is no handler or it didn't handle it
+    bool dispatch(UINT id, const Message& msg, LRESULT& result) const
+    {
+        Message_fn fn = find(id);
+        return fn ? fn(msg, result) : false;
+    }
+
+    /// false if the same ID was registered twice
+    constexpr bool valid() const { return _valid; }
+
+    // Filled by make_dispatch_table()
+    constexpr void add(const Message_entry& e)
+    {
+        if (e.id < Dense) {
+            if (_dense[e.id]) {
+                _valid = false;
+            }
+            _dense[e.id] = e.fn;
+            return;
+        }
+        // Insertion sort, N is small and this runs in the compiler
+        std::size_t i = _sparse_count++;
+        while (i > 0 && _sparse[i - 1].id > e.id) {
+            _sparse[i] = _sparse[i - 1];
+            --i;
+        }
+        if (i > 0 && _sparse[i - 1].id == e.id) {
+            _valid = false;
+        }
+        _sparse[i] = e;
+    }
+
+    constexpr void add(const Message_entry* list, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            add(list[i]);
+        }
+    }
+
+private:
+    Message_fn _dense[Dense] = {};
+    Message_entry _sparse[N > 0 ? N : 1] = {};
+    std::size_t _sparse_count = 0;
+    bool _valid = true;
+};
+
+// ****************************************************************************
+
+/// Build a table from one or several arrays of Message_entry.
+/// 'Dense': IDs below this value get a direct lookup.
+///
+///     constexpr auto g_table = make_dispatch_table<0x240>(list_a, list_b);
+///     static_assert(g_table.valid(), "a message has two handlers");
+template<UINT Dense, std::size_t... Ns>
+constexpr Dispatch_table<(Ns + ... + 0), Dense>
+make_dispatch_table(const Message_entry (&... lists)[Ns])
+{
+    Dispatch_table<(Ns + ... + 0), Dense> table;
+    (table.add(lists, Ns), ...);
+    return table;
+}
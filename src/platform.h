@@ -0,0 +1,95 @@
+#pragma once
+
+// Thin portability layer.
+//
+// On Windows this is just "framework.h" (i.e. <windows.h>).
+// On other platforms (Linux build farm, headless benchmarks) we define the
+// small subset of Win32 types, messages and macros the platform-neutral
+// modules rely on. Values are copied from <winuser.h> so that a message
+// stream recorded on Windows means the same thing when replayed on Linux.
+
+#ifdef _WIN32
+
+#include "framework.h"
+
+#else
+
+#include <cstdint>
+
+// Handles are opaque pointers, exactly like the real Win32 'DECLARE_HANDLE()'
+struct HWND__ { int unused; };
+typedef HWND__* HWND;
+
+typedef unsigned int  UINT;
+typedef uint32_t      DWORD;
+typedef uint16_t      WORD;
+typedef int           BOOL;
+typedef uintptr_t     WPARAM;
+typedef intptr_t      LPARAM;
+typedef intptr_t      LRESULT;
+
+#ifndef TRUE
+#define TRUE  1
+#define FALSE 0
+#endif
+
+#define CALLBACK
+
+struct POINT  { long  x; long  y; };
+struct POINTS { short x; short y; };
+
+struct MSG {
+    HWND   hwnd;
+    UINT   message;
+    WPARAM wParam;
+    LPARAM lParam;
+    DWORD  time;
+    POINT  pt;
+    DWORD  lPrivate;
+};
+
+#define LOWORD(l) ((WORD)(((uintptr_t)(l)) & 0xffff))
+#define HIWORD(l) ((WORD)((((uintptr_t)(l)) >> 16) & 0xffff))
+#define MAKELPARAM(l, h) ((LPARAM)(((uint32_t)(WORD)(l)) | (((uint32_t)(WORD)(h)) << 16)))
+inline POINTS MAKEPOINTS(LPARAM l) { POINTS p = { (short)LOWORD(l), (short)HIWORD(l) }; return p; }
+
+#define UNREFERENCED_PARAMETER(P) (void)(P)
+
+// Window messages (see <winuser.h>)
+#define WM_NULL           0x0000
+#define WM_CREATE         0x0001
+#define WM_DESTROY        0x0002
+#define WM_MOVE           0x0003
+#define WM_SIZE           0x0005
+#define WM_KILLFOCUS      0x0008
+#define WM_PAINT          0x000F
+#define WM_CLOSE          0x0010
+#define WM_QUIT           0x0012
+#define WM_KEYDOWN        0x0100
+#define WM_KEYUP          0x0101
+#define WM_CHAR           0x0102
+#define WM_SYSKEYDOWN     0x0104
+#define WM_SYSKEYUP       0x0105
+#define WM_COMMAND        0x0111
+#define WM_TIMER          0x0113
+#define WM_MOUSEMOVE      0x0200
+#define WM_LBUTTONDOWN    0x0201
+#define WM_LBUTTONUP      0x0202
+#define WM_RBUTTONDOWN    0x0204
+#define WM_RBUTTONUP      0x0205
+#define WM_MBUTTONDOWN    0x0207
+#define WM_MBUTTONUP      0x0208
+#define WM_MOUSEWHEEL     0x020A
+#define WM_ENTERSIZEMOVE  0x0231
+#define WM_EXITSIZEMOVE   0x0232
+#define WM_USER           0x0400
+
+// WM_SIZE wParam
+#define SIZE_RESTORED     0
+#define SIZE_MINIMIZED    1
+#define SIZE_MAXIMIZED    2
+
+// Virtual key codes
+#define VK_ESCAPE         0x1B
+
+#endif
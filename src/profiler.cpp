@@ -0,0 +1,265 @@
+#include "profiler.h"
+
+#include "platform.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> g_profiler_enabled{false};
+thread_local Profile_ring* t_profile_ring = nullptr;
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Every ring ever created. Rings are never freed (until exit) so that the
+// events of a thread that already finished can still be exported.
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Profile_ring>> rings;
+
+    // Reference point to convert ticks to time
+    uint64_t base_ticks = profiler_ticks();
+    Clock::time_point base_time = Clock::now();
+};
+
+Registry& registry()
+{
+    static Registry r;
+    return r;
+}
+
+// ----------------------------------------------------------------------------
+
+/// Microseconds per tick, measured between the creation of the registry and
+/// now (the longer the program ran the more precise)
+double microseconds_per_tick()
+{
+    Registry& r = registry();
+#ifdef PROFILER_HAS_RDTSC
+    // The time stamp counter runs at a constant rate on any CPU from the
+    // last 15 years, but the rate is unknown: calibrate against the clock.
+    // Make sure we measure over a few milliseconds at least.
+    for (;;) {
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - r.base_time).count();
+        uint64_t ticks = profiler_ticks() - r.base_ticks;
+        if (us > 5000.0 && ticks > 0) {
+            return us / double(ticks);
+        }
+    }
+#else
+    (void)r;
+    return 1e-3; // ticks are nanoseconds
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+/// Write 's' as a JSON string (thread names may contain anything)
+void write_json_string(FILE* file, const char* s)
+{
+    fputc('"', file);
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', file);
+        }
+        if ((unsigned char)*s >= 0x20) {
+            fputc(*s, file);
+        }
+    }
+    fputc('"', file);
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+void profiler_set_enabled(bool state)
+{
+    registry(); // set the time reference before anything is recorded
+    g_profiler_enabled.store(state);
+}
+
+// ****************************************************************************
+
+Profile_ring* profiler_create_thread_ring()
+{
+    // Cold path: once per thread
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.rings.emplace_back(new Profile_ring());
+    Profile_ring* ring = r.rings.back().get();
+    ring->thread_id = uint32_t(r.rings.size());
+    snprintf(ring->thread_name, sizeof(ring->thread_name), "thread %u", ring->thread_id);
+    t_profile_ring = ring;
+    return ring;
+}
+
+// ****************************************************************************
+
+void profiler_set_thread_name(const char* name)
+{
+    Profile_ring* ring = profiler_thread_ring();
+    snprintf(ring->thread_name, sizeof(ring->thread_name), "%s", name);
+}
+
+// ****************************************************************************
+
+void profile_counter(const char* name, uint64_t value)
+{
+    Profile_event e = { name, Profile_event::COUNTER, 0, profiler_ticks(), value };
+    profiler_thread_ring()->push(e);
+}
+
+// ****************************************************************************
+
+void profiler_reset()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (std::unique_ptr<Profile_ring>& ring : r.rings) {
+        ring->count.store(0);
+    }
+}
+
+// ****************************************************************************
+
+bool profiler_export_chrome_trace(const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    Registry& r = registry();
+    const double us_per_tick = microseconds_per_tick();
+
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    // Format reference:
+    // https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (std::unique_ptr<Profile_ring>& ring : r.rings)
+    {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                first ? "" : ",\n", ring->thread_id);
+        write_json_string(file, ring->thread_name);
+        fprintf(file, "}}");
+        first = false;
+
+        const uint64_t count = ring->count.load(std::memory_order_acquire);
+        const uint64_t start = count > Profile_ring::SIZE ? count - Profile_ring::SIZE : 0;
+        for (uint64_t i = start; i < count; ++i)
+        {
+            const Profile_event& e = ring->events[i & Profile_ring::MASK];
+            // Signed difference: events recorded before the registry existed
+            // (can't happen in practice) would show at negative times.
+            const double ts = double(int64_t(e.begin - r.base_ticks)) * us_per_tick;
+            switch (e.kind)
+            {
+            case Profile_event::ZONE:
+                fprintf(file, ",\n{\"name\":");
+                write_json_string(file, e.name);
+                fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        ring->thread_id, ts, double(e.end - e.begin) * us_per_tick);
+                break;
+            case Profile_event::MESSAGE:
+            {
+                // Zones are keyed by message: "WM_KEYDOWN" or "WM_0x1234"
+                char name[16];
+                const char* known = profiler_message_name(e.arg);
+                if (!known) {
+                    snprintf(name, sizeof(name), "WM_0x%04X", e.arg);
+                }
+                fprintf(file, ",\n{\"name\":\"%s\",\"cat\":", known ? known : name);
+                write_json_string(file, e.name);
+                fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"message\":%u}}",
+                        ring->thread_id, ts, double(e.end - e.begin) * us_per_tick, e.arg);
+            }break;
+            case Profile_event::COUNTER:
+                fprintf(file, ",\n{\"name\":");
+                write_json_string(file, e.name);
+                fprintf(file, ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%llu}}",
+                        ring->thread_id, ts, (unsigned long long)e.end);
+                break;
+            }
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
+
+// ****************************************************************************
+
+double profiler_zone_overhead_ns(int iterations)
+{
+    if (iterations <= 0) {
+        return 0.0;
+    }
+    const bool was_enabled = profiler_enabled();
+    g_profiler_enabled.store(true);
+
+    Profile_ring* ring = profiler_thread_ring();
+    const uint64_t saved = ring->count.load();
+
+    // Warm up: the first lap around the ring pays for page faults, we want
+    // the steady state cost.
+    for (std::size_t i = 0; i < Profile_ring::SIZE; ++i) {
+        Profile_zone zone("overhead");
+    }
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        Profile_zone zone("overhead");
+    }
+    const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+    // Forget the fake zones. The ring may have wrapped around and lost older
+    // events, but at least we don't export a million "overhead" zones.
+    ring->count.store(saved);
+    g_profiler_enabled.store(was_enabled);
+    return ns / double(iterations);
+}
+
+// ****************************************************************************
+
+const char* profiler_message_name(uint32_t message)
+{
+    switch (message)
+    {
+#define MESSAGE_NAME(m) case m: return #m
+    MESSAGE_NAME(WM_NULL);
+    MESSAGE_NAME(WM_CREATE);
+    MESSAGE_NAME(WM_DESTROY);
+    MESSAGE_NAME(WM_MOVE);
+    MESSAGE_NAME(WM_SIZE);
+    MESSAGE_NAME(WM_KILLFOCUS);
+    MESSAGE_NAME(WM_PAINT);
+    MESSAGE_NAME(WM_CLOSE);
+    MESSAGE_NAME(WM_QUIT);
+    MESSAGE_NAME(WM_KEYDOWN);
+    MESSAGE_NAME(WM_KEYUP);
+    MESSAGE_NAME(WM_CHAR);
+    MESSAGE_NAME(WM_SYSKEYDOWN);
+    MESSAGE_NAME(WM_SYSKEYUP);
+    MESSAGE_NAME(WM_COMMAND);
+    MESSAGE_NAME(WM_TIMER);
+    MESSAGE_NAME(WM_MOUSEMOVE);
+    MESSAGE_NAME(WM_LBUTTONDOWN);
+    MESSAGE_NAME(WM_LBUTTONUP);
+    MESSAGE_NAME(WM_RBUTTONDOWN);
+    MESSAGE_NAME(WM_RBUTTONUP);
+    MESSAGE_NAME(WM_MBUTTONDOWN);
+    MESSAGE_NAME(WM_MBUTTONUP);
+    MESSAGE_NAME(WM_MOUSEWHEEL);
+    MESSAGE_NAME(WM_ENTERSIZEMOVE);
+    MESSAGE_NAME(WM_EXITSIZEMOVE);
+#undef MESSAGE_NAME
+    }
+    return nullptr;
+}
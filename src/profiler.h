@@ -0,0 +1,172 @@
+#pragma once
+
+// Low overhead scoped instrumentation.
+//
+//     void update() {
+//         PROFILE_ZONE("update");   // measured until the end of the scope
+//         ...
+//     }
+//
+// Every thread records its zones in its own ring buffer: no lock, no
+// allocation (the ring is allocated the first time a thread records
+// something), a timestamp read at both ends of the zone and a 32 bytes
+// store. Once full a ring overwrites its oldest events.
+//
+// Recording is off until profiler_set_enabled(true), a disabled zone costs
+// a single load and branch. Define DISABLE_PROFILER in the preprocessor
+// definitions of the project to compile the macros out entirely.
+//
+// profiler_export_chrome_trace() writes every ring to a JSON file that can
+// be opened with chrome://tracing or https://ui.perfetto.dev
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_HAS_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_HAS_RDTSC 1
+#else
+#include <chrono>
+#endif
+
+// ****************************************************************************
+
+struct Profile_event {
+    enum Kind : uint32_t {
+        ZONE,     ///< named scope: [begin, end]
+        MESSAGE,  ///< window procedure call, 'arg' is the message (WM_*)
+        COUNTER   ///< a value sampled at 'begin', stored in 'end'
+    };
+    const char* name; ///< must be a string literal (or outlive the profiler)
+    Kind kind;
+    uint32_t arg;
+    uint64_t begin;   ///< profiler_ticks()
+    uint64_t end;
+};
+
+// Events of a single thread. Only the owner thread writes.
+struct Profile_ring {
+    static const std::size_t SIZE = 1 << 16; ///< events (2MB)
+    static const std::size_t MASK = SIZE - 1;
+
+    std::atomic<uint64_t> count{0}; ///< events ever recorded
+    uint32_t thread_id = 0;         ///< 1, 2, 3... in order of first use
+    char thread_name[32] = {};
+    Profile_event events[SIZE];
+
+    void push(const Profile_event& e) {
+        uint64_t n = count.load(std::memory_order_relaxed);
+        events[n & MASK] = e;
+        count.store(n + 1, std::memory_order_release);
+    }
+};
+
+// ****************************************************************************
+
+/// Raw timestamp: the CPU's time stamp counter on x86 (a few cycles to
+/// read), nanoseconds elsewhere. Converted to time on export.
+inline uint64_t profiler_ticks()
+{
+#ifdef PROFILER_HAS_RDTSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+extern std::atomic<bool> g_profiler_enabled;
+
+inline bool profiler_enabled() { return g_profiler_enabled.load(std::memory_order_relaxed); }
+void profiler_set_enabled(bool state);
+
+extern thread_local Profile_ring* t_profile_ring;
+Profile_ring* profiler_create_thread_ring();
+
+/// Ring of the calling thread (allocated on the first call)
+inline Profile_ring* profiler_thread_ring() {
+    Profile_ring* ring = t_profile_ring;
+    return ring ? ring : profiler_create_thread_ring();
+}
+
+/// Name displayed for the calling thread in the trace viewer
+void profiler_set_thread_name(const char* name);
+
+/// Record a value (e.g. how long a message waited in the queue)
+void profile_counter(const char* name, uint64_t value);
+
+/// Forget every recorded event (call while the other threads are idle)
+void profiler_reset();
+
+/// Write every ring in the Chrome trace event format. Call once the
+/// instrumented threads are idle (e.g. at exit), a ring written during the
+/// export may produce a few garbage events.
+/// @return false if the file couldn't be written
+bool profiler_export_chrome_trace(const char* path);
+
+/// Measure the cost of one recorded zone (begin + end) in nanoseconds, by
+/// recording 'iterations' empty zones on the calling thread. The events
+/// are removed afterwards.
+double profiler_zone_overhead_ns(int iterations = 1000000);
+
+/// "WM_KEYDOWN" etc. for the messages we know about, NULL otherwise
+const char* profiler_message_name(uint32_t message);
+
+// ****************************************************************************
+
+class Profile_zone {
+public:
+    explicit Profile_zone(const char* name,
+                          uint32_t arg = 0,
+                          Profile_event::Kind kind = Profile_event::ZONE)
+        : _ring(nullptr)
+    {
+        if (profiler_enabled()) {
+            _ring = profiler_thread_ring();
+            _name = name;
+            _kind = kind;
+            _arg = arg;
+            _begin = profiler_ticks();
+        }
+    }
+
+    ~Profile_zone() {
+        if (_ring) {
+            Profile_event e = { _name, _kind, _arg, _begin, profiler_ticks() };
+            _ring->push(e);
+        }
+    }
+
+    Profile_zone(const Profile_zone&) = delete;
+    Profile_zone& operator=(const Profile_zone&) = delete;
+
+private:
+    Profile_ring* _ring;
+    const char* _name;
+    Profile_event::Kind _kind;
+    uint32_t _arg;
+    uint64_t _begin;
+};
+
+// ****************************************************************************
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifndef DISABLE_PROFILER
+/// Measure the enclosing scope
+#define PROFILE_ZONE(name) Profile_zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+/// Measure the enclosing scope as the handling of a window message
+#define PROFILE_MESSAGE(message) \
+    Profile_zone PROFILE_CONCAT(profile_zone_, __LINE__)("event_handler", uint32_t(message), Profile_event::MESSAGE)
+#define PROFILE_COUNTER(name, value) \
+    do { if (profiler_enabled()) { profile_counter(name, value); } } while (0)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_MESSAGE(message) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#endif
@@ -0,0 +1,194 @@
+#include "raw_input.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+// ****************************************************************************
+
+bool Mouse_history::push(const Raw_mouse& raw, int64_t time_us)
+{
+    Mouse_sample s;
+    s.time_us = time_us;
+    const bool absolute = (raw.flags & RAW_MOUSE_MOVE_ABSOLUTE) != 0;
+    s.dx = absolute ? 0 : raw.last_x;
+    s.dy = absolute ? 0 : raw.last_y;
+    s.buttons = raw.button_flags;
+    s.wheel = (raw.button_flags & RAW_MOUSE_WHEEL) ? raw.button_data : int16_t(0);
+
+    _pushed.store(_pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (!_queue.push(s)) {
+        _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+// ****************************************************************************
+
+std::size_t Mouse_history::collect()
+{
+    _frame.clear();
+    _frame_dx = 0;
+    _frame_dy = 0;
+    // Bounded: samples pushed meanwhile wait for the next frame
+    Mouse_sample s;
+    while (_frame.size() < CAPACITY && _queue.pop(s)) {
+        _frame.push_back(s);
+        _frame_dx += s.dx;
+        _frame_dy += s.dy;
+    }
+    _frames++;
+    _max_per_frame = std::max(_max_per_frame, _frame.size());
+    return _frame.size();
+}
+
+// ****************************************************************************
+
+Mouse_history_stats Mouse_history::stats() const
+{
+    Mouse_history_stats s;
+    s.samples = _pushed.load(std::memory_order_relaxed);
+    s.dropped = _dropped.load(std::memory_order_relaxed);
+    s.frames = _frames;
+    s.max_per_frame = _max_per_frame;
+    return s;
+}
+
+// ****************************************************************************
+
+int64_t raw_input_now_us()
+{
+    // QueryPerformanceCounter() on Windows
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ****************************************************************************
+
+std::vector<Raw_mouse> make_synthetic_raw_mouse(std::size_t count, unsigned seed)
+{
+    std::vector<Raw_mouse> reports;
+    reports.reserve(count);
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> jitter(-1, 1);
+    std::uniform_int_distribution<int> kind(0, 999);
+
+    bool left_down = false;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        Raw_mouse r = {};
+        // A high rate mouse reports a few counts at a time: one turn of the
+        // circle every 2000 reports (a quarter of a second at 8 kHz)
+        const double angle = double(i) * (6.283185307179586 / 2000.0);
+        r.last_x = int32_t(std::lround(4.0 * std::cos(angle))) + jitter(rng);
+        r.last_y = int32_t(std::lround(4.0 * std::sin(angle))) + jitter(rng);
+
+        const int k = kind(rng);
+        if (k < 2) {
+            r.button_flags = left_down ? RAW_MOUSE_LEFT_UP : RAW_MOUSE_LEFT_DOWN;
+            left_down = !left_down;
+        } else if (k < 4) {
+            r.button_flags = RAW_MOUSE_WHEEL;
+            r.button_data = (k & 1) ? 120 : -120;
+        }
+        reports.push_back(r);
+    }
+    return reports;
+}
+
+// ****************************************************************************
+
+#ifdef _WIN32
+
+namespace {
+
+bool push_report(const RAWINPUT& input, Mouse_history& history, int64_t time_us)
+{
+    if (input.header.dwType != RIM_TYPEMOUSE) {
+        return false;
+    }
+    const RAWMOUSE& m = input.data.mouse;
+    Raw_mouse raw;
+    raw.flags = m.usFlags;
+    raw.button_flags = m.usButtonFlags;
+    raw.button_data = (int16_t)m.usButtonData;
+    raw.last_x = m.lLastX;
+    raw.last_y = m.lLastY;
+    history.push(raw, time_us);
+    return true;
+}
+
+/// A 32 bit process on 64 bit Windows gets GetRawInputBuffer() blocks in
+/// the 64 bit layout: the header is 8 bytes larger.
+bool wow64_layout()
+{
+#ifdef _WIN64
+    return false;
+#else
+    static const bool wow64 = []() {
+        BOOL state = FALSE;
+        return IsWow64Process(GetCurrentProcess(), &state) && state;
+    }();
+    return wow64;
+#endif
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+bool raw_input_register()
+{
+    RAWINPUTDEVICE device = {};
+    device.usUsagePage = 0x01; // HID_USAGE_PAGE_GENERIC
+    device.usUsage = 0x02;     // HID_USAGE_GENERIC_MOUSE
+    device.dwFlags = 0;        // only while we have the focus
+    device.hwndTarget = NULL;  // the focused window
+    return RegisterRawInputDevices(&device, 1, sizeof(device)) != FALSE;
+}
+
+// ****************************************************************************
+
+std::size_t raw_input_read(HRAWINPUT input, Mouse_history& history)
+{
+    const int64_t now = raw_input_now_us();
+    std::size_t count = 0;
+
+    // 1. The report of this WM_INPUT (no longer in the queue)
+    RAWINPUT report;
+    UINT size = sizeof(report);
+    if (GetRawInputData(input, RID_INPUT, &report, &size, sizeof(RAWINPUTHEADER)) != (UINT)-1) {
+        count += push_report(report, history, now) ? 1 : 0;
+    }
+
+    // 2. Every report queued since: one call instead of one WM_INPUT
+    // dispatch each. The buffer must be 8 bytes aligned (QWORD).
+    static thread_local uint64_t buffer[2048];
+    for (;;)
+    {
+        UINT bytes = sizeof(buffer);
+        UINT n = GetRawInputBuffer((RAWINPUT*)buffer, &bytes, sizeof(RAWINPUTHEADER));
+        if (n == 0 || n == (UINT)-1) {
+            break;
+        }
+        const RAWINPUT* r = (const RAWINPUT*)buffer;
+        for (UINT i = 0; i < n; ++i) {
+            if (wow64_layout()) {
+                RAWINPUT fixed;
+                fixed.header = r->header;
+                std::memcpy(&fixed.data, (const uint8_t*)&r->data + 8, sizeof(RAWMOUSE));
+                count += push_report(fixed, history, now) ? 1 : 0;
+            } else {
+                count += push_report(*r, history, now) ? 1 : 0;
+            }
+            r = NEXTRAWINPUTBLOCK(r);
+        }
+    }
+    return count;
+}
+
+#endif
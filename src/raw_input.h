@@ -0,0 +1,152 @@
+#pragma once
+
+// Every mouse sample, at the device's polling rate.
+//
+// WM_MOUSEMOVE is synthesized by Windows from the cursor position: moves are
+// merged while the queue is busy and the cursor is clamped to the screen
+// and accelerated. A 1000 Hz (or 8000 Hz) mouse delivers many samples per
+// frame, the frame code only ever sees the last position.
+//
+// Raw input (RegisterRawInputDevices()) sends the device's reports with
+// WM_INPUT instead: relative motion in device counts, before pointer
+// acceleration, plus the button transitions and the wheel. At high rates
+// reading them one WM_INPUT at a time costs a message dispatch each, so on
+// the first WM_INPUT we read it with GetRawInputData() then drain every
+// report still queued with a single GetRawInputBuffer() call.
+//
+//   UI thread                                         render thread
+//   ---------                                         -------------
+//   WM_INPUT -> raw_input_read() -> Mouse_history -> collect() once per
+//               (batch)             (lock-free ring)   frame: this frame's
+//                                                      samples, in order
+//
+// Mouse_history is a single producer / single consumer ring (spsc_queue.h)
+// of CAPACITY samples. Samples are time stamped when they are read: a batch
+// read with GetRawInputBuffer() shares one time stamp (reports don't carry
+// their own), their order is preserved. When the render thread falls
+// behind by more than CAPACITY samples the newest are dropped and counted.
+//
+// Raw_mouse mirrors the fields of Win32's RAWMOUSE we use, so that the
+// history can be fed and measured on Linux too (see
+// make_synthetic_raw_mouse()).
+
+#include "platform.h"
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// RAWMOUSE::usFlags (see <winuser.h>)
+enum Raw_mouse_move : uint16_t {
+    RAW_MOUSE_MOVE_ABSOLUTE = 0x0001  ///< last_x / last_y are positions in [0, 65535]
+};
+
+/// RAWMOUSE::usButtonFlags (see <winuser.h>)
+enum Raw_mouse_button : uint16_t {
+    RAW_MOUSE_LEFT_DOWN   = 0x0001,
+    RAW_MOUSE_LEFT_UP     = 0x0002,
+    RAW_MOUSE_RIGHT_DOWN  = 0x0004,
+    RAW_MOUSE_RIGHT_UP    = 0x0008,
+    RAW_MOUSE_MIDDLE_DOWN = 0x0010,
+    RAW_MOUSE_MIDDLE_UP   = 0x0020,
+    RAW_MOUSE_WHEEL       = 0x0400
+};
+
+/// One device report (subset of RAWMOUSE)
+struct Raw_mouse {
+    uint16_t flags;        ///< usFlags
+    uint16_t button_flags; ///< usButtonFlags
+    int16_t button_data;   ///< usButtonData: wheel delta
+    int32_t last_x;        ///< lLastX: motion in device counts
+    int32_t last_y;
+};
+
+/// A report as the frame code sees it
+struct Mouse_sample {
+    int64_t time_us;       ///< when it was read, microseconds (steady clock)
+    int32_t dx;            ///< relative motion (device counts), 0 for absolute devices
+    int32_t dy;
+    uint16_t buttons;      ///< RAW_MOUSE_*_DOWN / _UP transitions
+    int16_t wheel;         ///< multiple of 120 (WHEEL_DELTA)
+};
+
+struct Mouse_history_stats {
+    uint64_t samples = 0;          ///< pushed by the UI thread
+    uint64_t dropped = 0;          ///< ring full
+    uint64_t frames = 0;           ///< calls to collect()
+    std::size_t max_per_frame = 0; ///< most samples seen in one frame
+};
+
+// ****************************************************************************
+
+class Mouse_history {
+public:
+    static const std::size_t CAPACITY = 4096;
+
+    Mouse_history() { _frame.reserve(CAPACITY); }
+
+    // -------------------------------------------------------------------------
+    /// @name Producer (UI thread)
+    // -------------------------------------------------------------------------
+
+    /// @return false if the sample was dropped (ring full)
+    bool push(const Raw_mouse& raw, int64_t time_us);
+
+    // -------------------------------------------------------------------------
+    /// @name Consumer (render thread)
+    // -------------------------------------------------------------------------
+
+    /// Move every pending sample to frame(). Call once per frame.
+    /// @return number of samples this frame
+    std::size_t collect();
+
+    /// Samples collected by the last collect(), oldest first
+    const std::vector<Mouse_sample>& frame() const { return _frame; }
+
+    /// Sum of the motion of frame()
+    int64_t frame_dx() const { return _frame_dx; }
+    int64_t frame_dy() const { return _frame_dy; }
+
+    /// Consumer side. 'samples' and 'dropped' are approximate while the
+    /// producer runs.
+    Mouse_history_stats stats() const;
+
+private:
+    Spsc_queue<Mouse_sample, CAPACITY> _queue;
+    std::atomic<uint64_t> _pushed{0};  ///< producer only writes
+    std::atomic<uint64_t> _dropped{0};
+
+    // Consumer
+    std::vector<Mouse_sample> _frame;
+    int64_t _frame_dx = 0;
+    int64_t _frame_dy = 0;
+    uint64_t _frames = 0;
+    std::size_t _max_per_frame = 0;
+};
+
+/// Microseconds on the clock of Mouse_sample::time_us
+int64_t raw_input_now_us();
+
+/// Reproducible raw mouse reports: mostly small relative motions along a
+/// wobbly circle, a few button transitions and wheel notches. Feed them to
+/// Mouse_history::push() at the rate of the device being simulated (e.g.
+/// 8000 Hz), to measure the history without a mouse (or on Linux).
+std::vector<Raw_mouse> make_synthetic_raw_mouse(std::size_t count, unsigned seed = 0);
+
+// ****************************************************************************
+
+#ifdef _WIN32
+
+/// Ask for WM_INPUT mouse reports, sent to the window with the keyboard
+/// focus. WM_MOUSEMOVE and the button messages keep coming.
+bool raw_input_register();
+
+/// Call on WM_INPUT: read the report of 'input' (the message's lParam) and
+/// every report still queued, push them to 'history'. The queued reports
+/// are all for the focused window, i.e. the one receiving this WM_INPUT.
+/// @return number of samples read
+std::size_t raw_input_read(HRAWINPUT input, Mouse_history& history);
+
+#endif
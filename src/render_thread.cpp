@@ -0,0 +1,436 @@
+#include "render_thread.h"
+
+#include "draw_list.h"
+#include "event_loop.h"
+#include "input_state.h"
+#include "profiler.h"
+#include "renderer.h"
+#include "startup_timer.h"
+#include "window_manager.h"
+
+#include <algorithm>
+#include <chrono>
+
+// ****************************************************************************
+
+Render_thread::Render_thread(Window_manager& windows, const Frame_pacer& pacer)
+    : _windows(windows)
+    , _pacer(pacer)
+{
+}
+
+// ****************************************************************************
+
+Render_thread::~Render_thread()
+{
+    stop();
+}
+
+// ****************************************************************************
+
+void Render_thread::set_streamer(Asset_streamer* streamer, const Upload_budget& budget)
+{
+    _streamer = streamer;
+    _upload_budget = budget;
+    if (_streamer) {
+        // With Pacing::ON_DEMAND nothing else would run pump()
+        _streamer->set_ready_callback([this]() { request_redraw(); });
+    }
+}
+
+// ****************************************************************************
+
+void Render_thread::start()
+{
+    if (running()) {
+        return;
+    }
+    if (!_jobs) {
+        _jobs.reset(new Job_system());
+    }
+    _quit.store(false);
+    _thread = std::thread(&Render_thread::thread_main, this);
+}
+
+// ****************************************************************************
+
+void Render_thread::stop()
+{
+    if (!running()) {
+        return;
+    }
+    _quit.store(true);
+    wake();
+    _thread.join();
+}
+
+// ****************************************************************************
+
+bool Render_thread::is_render_message(UINT message)
+{
+    switch (message)
+    {
+    // What input_on_message() and Resize_manager::on_message() care about
+    case WM_KEYDOWN: case WM_KEYUP: case WM_SYSKEYDOWN: case WM_SYSKEYUP:
+    case WM_MOUSEMOVE: case WM_MOUSEWHEEL:
+    case WM_LBUTTONDOWN: case WM_LBUTTONUP:
+    case WM_RBUTTONDOWN: case WM_RBUTTONUP:
+    case WM_MBUTTONDOWN: case WM_MBUTTONUP:
+    case WM_KILLFOCUS:
+    case WM_SIZE: case WM_ENTERSIZEMOVE: case WM_EXITSIZEMOVE:
+        return true;
+    }
+    return false;
+}
+
+// ****************************************************************************
+
+bool Render_thread::is_input_message(UINT message)
+{
+    // Not the resizes: they are no user input to show
+    return is_render_message(message) && message != WM_KILLFOCUS &&
+           message != WM_SIZE && message != WM_ENTERSIZEMOVE && message != WM_EXITSIZEMOVE;
+}
+
+// ****************************************************************************
+
+bool Render_thread::post(const Window_state& window, UINT message, WPARAM wParam, LPARAM lParam,
+                         DWORD time)
+{
+    if (!is_render_message(message)) {
+        return false;
+    }
+    // 'MSG::time' is in milliseconds on the backend's clock (GetTickCount()
+    // on Windows, 10 to 16 ms steps): convert its age to our microsecond
+    // clock, the one the frames are time stamped with.
+    int64_t time_us = raw_input_now_us();
+    if (_input_clock) {
+        const int32_t age_ms = int32_t(_input_clock->now_ms() - time);
+        if (age_ms > 0) {
+            time_us -= int64_t(age_ms) * 1000;
+        }
+    }
+    Render_event event = { Render_event::MESSAGE, uint32_t(window.index), message, wParam, lParam, time_us };
+    if (!running()) {
+        apply(event);
+        return true;
+    }
+    // A mouse move is worthless once the next one arrives: rather drop it
+    // than make the UI thread wait.
+    if (message == WM_MOUSEMOVE && !_events.push(event)) {
+        _stats.dropped++;
+        return true;
+    }
+    if (message != WM_MOUSEMOVE) {
+        push(event);
+    }
+    _stats.events++;
+    _stats.max_queue = std::max(_stats.max_queue, _events.size());
+    wake();
+    return true;
+}
+
+// ****************************************************************************
+
+void Render_thread::close_window(const Window_state& window)
+{
+    Render_event event = { Render_event::CLOSE_WINDOW, uint32_t(window.index), 0, 0, 0, 0 };
+    const uint64_t ticket = ++_close_requests;
+    if (!running()) {
+        apply(event);
+        return;
+    }
+    push(event);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _wake.notify_one();
+    _closed.wait(lock, [&]() { return _close_done >= ticket; });
+}
+
+// ****************************************************************************
+
+void Render_thread::push(const Render_event& event)
+{
+    // Keys, clicks and resizes must not be lost: if the render thread is
+    // that late, give it some time to catch up.
+    while (!_events.push(event)) {
+        _stats.queue_full++;
+        wake();
+        std::this_thread::yield();
+    }
+}
+
+// ****************************************************************************
+
+void Render_thread::wake()
+{
+    // Pairs with the fence in wait(): either the render thread sees the
+    // new event before sleeping or we see it sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleeping.load(std::memory_order_relaxed)) {
+        // Taking the lock guarantees the notification can't slip in between
+        // the render thread's last check and its wait.
+        std::lock_guard<std::mutex> lock(_mutex);
+        _wake.notify_one();
+    }
+}
+
+// ****************************************************************************
+
+void Render_thread::thread_main()
+{
+    if (profiler_enabled()) {
+        profiler_set_thread_name("render");
+    }
+    // This thread runs the renderers' jobs (from this start() on)
+    _jobs->set_external_thread();
+    // GDI objects belong to the thread that creates them
+#ifdef _WIN32
+    std::unique_ptr<Gdi_glyph_rasterizer> gdi(new Gdi_glyph_rasterizer());
+    if (gdi->valid()) {
+        _font = std::move(gdi);
+    }
+#endif
+    if (!_font) {
+        _font.reset(new Bitmap_font_rasterizer());
+    }
+    _text.reset(new Text_renderer(*_font));
+
+    while (!_quit.load(std::memory_order_acquire))
+    {
+        drain();
+        Clock::time_point now = Clock::now();
+        if (_pacer.frame_due(now)) {
+            render_frame();
+            _pacer.frame_done(Clock::now());
+        } else {
+            wait(_pacer.seconds_until_due(now));
+        }
+    }
+    // Don't leave a close_window() hanging
+    drain();
+    _stats.arena = _arena.stats();
+    _stats.text = _text->stats();
+    _stats.atlas = _text->atlas().stats();
+    _text.reset();
+    _font.reset();
+}
+
+// ****************************************************************************
+
+bool Render_thread::drain()
+{
+    PROFILE_ZONE("drain");
+    bool any = false;
+    Render_event event;
+    while (_events.pop(event)) {
+        apply(event);
+        _pacer.on_message();
+        any = true;
+    }
+    // Not an input but something to show (e.g. a new status text)
+    if (_redraw.exchange(false, std::memory_order_acquire)) {
+        _pacer.request_redraw();
+        any = true;
+    }
+    return any;
+}
+
+// ****************************************************************************
+
+void Render_thread::apply(const Render_event& event)
+{
+    if (event.window >= _windows.size()) {
+        return;
+    }
+    Window_state& window = _windows[event.window];
+    if (event.type == Render_event::CLOSE_WINDOW) {
+        window.renderer.reset();
+        std::lock_guard<std::mutex> lock(_mutex);
+        _close_done++;
+        _closed.notify_all();
+        return;
+    }
+    input_on_message(window.input, event.message, event.wParam, event.lParam);
+    window.resize.on_message(event.message, event.wParam, event.lParam);
+    if (is_input_message(event.message)) {
+        window.latency.input(event.time_us);
+    }
+}
+
+// ****************************************************************************
+
+void Render_thread::render_frame()
+{
+    PROFILE_ZONE("render_frame");
+    auto start = Clock::now();
+    // Everything allocated during the frame before last is released here
+    _arena.begin_frame();
+    _text->begin_frame();
+    if (_streamer) {
+        // Before the windows: what arrives this frame can be drawn in it
+        PROFILE_ZONE("streaming");
+        _streamer->pump(_upload_budget);
+    }
+    for (std::size_t i = 0; i < _windows.size(); ++i)
+    {
+        Window_state& window = _windows[i];
+        if (!window.renderer) {
+            continue;
+        }
+        {
+            PROFILE_ZONE("wait_for_frame");
+            window.renderer->wait_for_frame();
+        }
+        // Late latch: what arrived while we waited is part of this frame.
+        // (drain() may have closed the window)
+        drain();
+        if (!window.renderer) {
+            continue;
+        }
+        if (key_pressed(window.input, VK_ESCAPE)) {
+            _quit_requested = true;
+        }
+        // Every raw mouse sample since the last frame
+        window.mouse_history.collect();
+        // Apply the last WM_SIZE (if any) before drawing
+        {
+            PROFILE_ZONE("resize");
+            window.resize.end_frame(*window.renderer);
+        }
+        {
+            // Crosshair under the mouse cursor. The draw list lives in the
+            // frame arena: recording it doesn't touch the heap.
+            PROFILE_ZONE("draw");
+            Draw_list list(_arena.current(), 64);
+            const float x = float(window.input.mouse.x) + 0.5f;
+            const float y = float(window.input.mouse.y) + 0.5f;
+            const uint32_t color = button_down(window.input, MOUSE_LEFT) ? 0xFFFFC040 : 0xC0FFFFFF;
+            draw_mouse_trail(window, list, x, y);
+            list.line(x - 12.0f, y, x + 12.0f, y, 1.0f, color);
+            list.line(x, y - 12.0f, x, y + 12.0f, 1.0f, color);
+            list.rect(x - 2.5f, y - 2.5f, 5.0f, 5.0f, color);
+            draw_overlay(window, list);
+
+            // Only what differs from the last frame is repainted: the
+            // crosshair's old and new position, a status text that changed
+            window.renderer->set_job_system(_jobs.get());
+            window.renderer->set_partial_redraw(_partial_redraw);
+            window.damage.update(list, window.renderer->damage());
+
+            window.renderer->clear(0.1f, 0.2f, 0.3f);
+            window.renderer->submit(list);
+        }
+        {
+            PROFILE_ZONE("present");
+            window.renderer->present();
+        }
+        window.latency.presented(raw_input_now_us(), window.renderer->display_time_us());
+
+        // Forget about this frame's pressed / released keys
+        input_end_frame(window.input);
+    }
+    // The upload budget ran out: the rest goes in the next frame. Asked
+    // here, after the windows' drain(), so this frame doesn't consume it
+    if (_streamer && _streamer->upload_pending()) {
+        request_redraw();
+    }
+    _stats.frames++;
+    if (_stats.frames == 1) {
+        startup_mark("first frame presented");
+    }
+
+    Frame_state& state = _frames.back();
+    state.frame = _stats.frames;
+    state.frame_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    state.quit = _quit_requested;
+    _frames.publish();
+}
+
+// ****************************************************************************
+
+void Render_thread::publish_status(Window_state& window, const char* text)
+{
+    window.overlay.back().clear().append(text);
+    window.overlay.publish();
+    request_redraw();
+}
+
+// ****************************************************************************
+
+void Render_thread::request_redraw()
+{
+    _redraw.store(true, std::memory_order_release);
+    wake();
+}
+
+// ****************************************************************************
+
+void Render_thread::draw_mouse_trail(const Window_state& window, Draw_list& list, float x, float y)
+{
+    // Walk the frame's raw samples backward from the cursor: one segment
+    // per device report, i.e. the motion WM_MOUSEMOVE merged away.
+    // Raw counts are not pixels (no pointer acceleration): this shows the
+    // shape of the motion, not its exact on screen path.
+    const std::vector<Mouse_sample>& samples = window.mouse_history.frame();
+    const std::size_t MAX_SEGMENTS = 256;
+    const std::size_t first = samples.size() > MAX_SEGMENTS ? samples.size() - MAX_SEGMENTS : 0;
+    for (std::size_t k = samples.size(); k-- > first; )
+    {
+        const float px = x - float(samples[k].dx);
+        const float py = y - float(samples[k].dy);
+        if (px != x || py != y) {
+            list.line(px, py, x, y, 1.0f, 0x80FF8040);
+        }
+        x = px;
+        y = py;
+    }
+}
+
+// ****************************************************************************
+
+void Render_thread::draw_overlay(Window_state& window, Draw_list& list)
+{
+    window.overlay.update();
+    const char* text = window.overlay.front().c_str();
+    if (text[0] == '\0') {
+        return;
+    }
+    const int size = 16;
+    const float margin = 6.0f;
+    const float padding = 4.0f;
+    const float height = float(_text->line_height(size));
+    const float y = float(window.renderer->height()) - margin - height;
+    const float width = float(_text->measure(text, size));
+
+    // Above the crosshair: a translucent band, then the text (same layer,
+    // text is always drawn after the solid rectangles)
+    list.set_layer(1);
+    list.rect(margin - padding, y - padding, width + 2.0f * padding, height + 2.0f * padding, 0xA0000000);
+    _text->draw(list, margin, y, text, size, 0xFFFFFFFF);
+    list.set_layer(0);
+
+    // New glyphs were rasterized: the renderer gets the atlas again. Glyphs
+    // already on screen may have moved in it, repaint everything.
+    if (_text->upload(*window.renderer, window.atlas_version)) {
+        window.renderer->damage().add(0, 0, window.renderer->width(), window.renderer->height());
+    }
+}
+
+// ****************************************************************************
+
+void Render_thread::wait(double timeout_seconds)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_events.empty() && !_redraw.load(std::memory_order_relaxed) &&
+        !_quit.load(std::memory_order_acquire)) {
+        if (timeout_seconds < 0.0) {
+            _wake.wait(lock);
+        } else {
+            _wake.wait_for(lock, std::chrono::duration<double>(timeout_seconds));
+        }
+    }
+    _sleeping.store(false, std::memory_order_relaxed);
+}
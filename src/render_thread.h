@@ -0,0 +1,221 @@
+#pragma once
+
+// Draw the windows from a dedicated thread.
+//
+// Win32 runs its own modal message loop when the user drags / resizes a
+// window or when a dialog box is opened (DialogBox()): our main loop, and
+// thus our frames, are stuck until the modal loop returns. Moving the
+// rendering to its own thread keeps the frames flowing:
+//
+//   UI thread (wWinMain)                        render thread
+//   --------------------                        -------------
+//   event_handler() --- Spsc_queue<Render_event> ---> input / resize
+//   quit <------------ Triple_buffer<Frame_state> ---- frame results
+//   status.flush() ---- Window_state::overlay ------> status overlay (+ redraw)
+//   WM_INPUT ---------- Window_state::mouse_history -> mouse trail
+//   Asset_streamer ---------- ready callback (redraw) -> pump(), top of frame
+//
+// Each frame, per window: wait until the display can take a frame
+// (Renderer::wait_for_frame(), see Present_mode), *then* read the input
+// that arrived in the meantime and record the frame ("late latch"). The
+// input a frame shows is as fresh as it can be when the frame is queued.
+// Every input message is paired with the frame it was presented in, see
+// Window_state::latency (latency_tracker.h).
+//
+// - the UI thread forwards the keyboard, mouse and resize messages through
+//   a lock-free single producer / single consumer queue. It never waits on
+//   the render thread (except in close_window())
+// - the render thread publishes a small summary of each frame through a
+//   triple buffer, the UI thread reads the latest one whenever it likes.
+//
+// One Job_system, owned here, is shared by the renderers of every window:
+// they are all driven by the render thread, one after the other, so one set
+// of workers is enough (not one per window). The render thread is its
+// external thread. The Asset_streamer keeps its own: its reader thread
+// runs the decode jobs.
+//
+// Ownership of a Window_state once start() was called:
+// - render thread: 'input', 'resize', 'renderer', 'atlas_version',
+//   'latency' and 'damage'
+// - UI thread: 'hwnd', 'status' and 'closed'
+// - 'overlay' and 'mouse_history': written by the UI thread, read by the
+//   render thread
+// No window may be added to the Window_manager while the thread runs.
+
+#include "platform.h"
+#include "asset_streamer.h"
+#include "frame_arena.h"
+#include "frame_pacer.h"
+#include "job_system.h"
+#include "spsc_queue.h"
+#include "text_renderer.h"
+#include "triple_buffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class Event_backend;
+class Window_manager;
+struct Window_state;
+
+// ****************************************************************************
+
+struct Render_event {
+    enum Type : uint32_t {
+        MESSAGE,      ///< a window message (input or resize)
+        CLOSE_WINDOW  ///< release the window's renderer
+    };
+    Type type;
+    uint32_t window; ///< Window_state::index
+    UINT message;
+    WPARAM wParam;
+    LPARAM lParam;
+    int64_t time_us; ///< when the input happened, raw_input_now_us() clock
+};
+
+// Published by the render thread after each frame
+struct Frame_state {
+    uint64_t frame = 0;     ///< frames rendered so far
+    double frame_ms = 0.0;  ///< CPU time of the last frame
+    bool quit = false;      ///< escape was pressed in one of the windows
+};
+
+// Call stats() after stop()
+struct Render_thread_stats {
+    uint64_t frames = 0;
+    uint64_t events = 0;     ///< messages forwarded to the render thread
+    uint64_t dropped = 0;    ///< mouse moves dropped because the queue was full
+    uint64_t queue_full = 0; ///< times the UI thread had to retry a push
+    std::size_t max_queue = 0; ///< highest number of pending events seen
+    Arena_stats arena;       ///< per-frame allocations of the render thread
+    Text_stats text;         ///< status overlay
+    Atlas_stats atlas;
+};
+
+// ****************************************************************************
+
+class Render_thread {
+public:
+    typedef Frame_pacer::Clock Clock;
+
+    /// @param pacer : pacing of the render thread's frames
+    explicit Render_thread(Window_manager& windows, const Frame_pacer& pacer = Frame_pacer());
+    ~Render_thread();
+
+    Render_thread(const Render_thread&) = delete;
+    Render_thread& operator=(const Render_thread&) = delete;
+
+    /// Replace the pacing policy. Call before start()
+    void set_pacer(const Frame_pacer& pacer) { _pacer = pacer; }
+
+    /// Backend whose now_ms() is the clock of 'MSG::time' (for post()).
+    /// Without one, messages are time stamped when they are posted.
+    /// Call before start()
+    void set_input_clock(const Event_backend* backend) { _input_clock = backend; }
+
+    /// Only repaint what changed from one frame to the next (default), see
+    /// Renderer::set_partial_redraw(). Call before start()
+    void set_partial_redraw(bool state) { _partial_redraw = state; }
+
+    /// Streamed assets are uploaded at the top of each frame, at most
+    /// 'budget' per frame (NULL: no streaming). An asset ready to upload
+    /// asks for a frame, like request_redraw(). Call before start() and
+    /// before the streamer's first request()
+    void set_streamer(Asset_streamer* streamer, const Upload_budget& budget = Upload_budget());
+
+    void start();
+    /// Ask the thread to finish its current frame and join it.
+    void stop();
+    bool running() const { return _thread.joinable(); }
+
+    // -------------------------------------------------------------------------
+    /// @name UI thread side
+    // -------------------------------------------------------------------------
+
+    /// Forward the message if the render thread needs it (keyboard, mouse
+    /// and resize messages).
+    /// @param time : 'MSG::time' of the message (GetMessageTime())
+    /// @return true if the message was forwarded
+    bool post(const Window_state& window, UINT message, WPARAM wParam, LPARAM lParam, DWORD time);
+
+    /// Release the window's renderer from the render thread and wait until
+    /// it's done. Call on WM_DESTROY: the swap chain must go away while the
+    /// HWND is still valid.
+    void close_window(const Window_state& window);
+
+    /// Latest frame published by the render thread
+    const Frame_state& latest() { _frames.update(); return _frames.front(); }
+
+    /// Draw the status at the bottom of the window (instead of a
+    /// SetWindowText(), a cross process call) and request_redraw() so it
+    /// shows with Pacing::ON_DEMAND too. Call from Status_text::flush().
+    /// Never blocks.
+    void publish_status(Window_state& window, const char* text);
+
+    /// Ask for a frame even if no input arrived (Frame_pacer::request_redraw()
+    /// on the render thread) and wake the thread up. Any thread, never blocks.
+    void request_redraw();
+
+    // -------------------------------------------------------------------------
+
+    Render_thread_stats stats() const { return _stats; }
+    Pacing_stats pacing_stats() const { return _pacer.stats(); }
+
+    static bool is_render_message(UINT message);
+    /// Keyboard and mouse messages, the ones whose latency is measured
+    static bool is_input_message(UINT message);
+
+private:
+    void thread_main();
+    void push(const Render_event& event);
+    void wake();
+    /// Apply every pending event. @return true if there was one
+    bool drain();
+    void apply(const Render_event& event);
+    void render_frame();
+    /// Record this frame's raw mouse motion, ending at (x, y)
+    void draw_mouse_trail(const Window_state& window, Draw_list& list, float x, float y);
+    /// Record the status text of the window at its bottom left corner
+    void draw_overlay(Window_state& window, Draw_list& list);
+    void wait(double timeout_seconds);
+
+    Window_manager& _windows;
+    Frame_pacer _pacer;
+    const Event_backend* _input_clock = nullptr;
+    bool _partial_redraw = true;
+    Asset_streamer* _streamer = nullptr;
+    Upload_budget _upload_budget;
+    std::thread _thread;
+    std::atomic<bool> _quit{false};
+
+    Spsc_queue<Render_event, 1024> _events;
+    Triple_buffer<Frame_state> _frames;
+
+    // Sleeping / waking up the render thread
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::atomic<bool> _sleeping{false};
+    std::atomic<bool> _redraw{false}; ///< request_redraw(), taken by drain()
+
+    // close_window() handshake
+    std::condition_variable _closed;
+    uint64_t _close_requests = 0; ///< UI thread only
+    uint64_t _close_done = 0;     ///< protected by '_mutex'
+
+    bool _quit_requested = false; ///< render thread only
+    /// Transient data of the frame being rendered (and of the previous
+    /// one), reset at the top of render_frame(). Render thread only.
+    Frame_arena _arena;
+    /// Workers of every window's renderer, see Renderer::set_job_system().
+    /// Created by the first start(): after Job_system::set_default_mode()
+    std::unique_ptr<Job_system> _jobs;
+    /// Text of every window, one glyph atlas. Created by the render thread.
+    std::unique_ptr<Glyph_rasterizer> _font;
+    std::unique_ptr<Text_renderer> _text;
+    Render_thread_stats _stats;
+};
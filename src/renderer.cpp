@@ -0,0 +1,181 @@
+#include "renderer.h"
+
+#include "draw_list.h"
+#include "renderer_d3d11.h"
+#include "renderer_software.h"
+
+#include <algorithm>
+#include <chrono>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+void Renderer::clear(float r, float g, float b, float a)
+{
+    Clock::time_point t = Clock::now();
+    const int age = buffer_age();
+    if (!_partial_redraw || age == 0 || age > 2) {
+        _damage.clear();
+        _damage.add(0, 0, _width, _height);
+    }
+    _damage.clip(_width, _height);
+    // The back buffer also misses the frames presented since it was drawn
+    _repaint = _damage;
+    if (age == 2) {
+        _repaint.add(_previous_damage);
+        _repaint.clip(_width, _height);
+    }
+    do_clear(r, g, b, a);
+    _stats.clear_seconds += seconds_since(t);
+}
+
+// ****************************************************************************
+
+void Renderer::submit(Draw_list& list)
+{
+    if (list.empty()) {
+        return;
+    }
+    Clock::time_point t = Clock::now();
+    const Draw_batches& batches = list.sort_and_merge();
+    do_submit(list, batches);
+    _stats.draw_seconds += seconds_since(t);
+    _stats.draw_commands += batches.count;
+    _stats.draw_calls += batches.batch_count;
+    _stats.unsorted_draw_calls += batches.unsorted_batch_count;
+}
+
+// ****************************************************************************
+
+void Renderer::present()
+{
+    Clock::time_point t = Clock::now();
+    do_present();
+    _stats.present_seconds += seconds_since(t);
+    _stats.frames++;
+    _stats.frame_pixels += uint64_t(_width) * uint64_t(_height);
+    _stats.repaint_pixels += uint64_t(_repaint.area());
+    _previous_damage = _damage;
+    _damage.clear();
+    _repaint.clear();
+}
+
+// ****************************************************************************
+
+void Renderer::wait_for_frame()
+{
+    Clock::time_point t = Clock::now();
+    do_wait_for_frame();
+    _stats.wait_seconds += seconds_since(t);
+}
+
+// ****************************************************************************
+
+void Renderer::damage_all()
+{
+    _damage.add(0, 0, _buffer_width, _buffer_height);
+    _previous_damage.clear();
+    _previous_damage.add(0, 0, _buffer_width, _buffer_height);
+}
+
+// ****************************************************************************
+
+void Renderer::resize(int width, int height)
+{
+    // A minimized window reports a 0 x 0 client area: keep the old buffers
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    if (width != _buffer_width || height != _buffer_height) {
+        resize_buffers(width, height);
+    }
+    set_size(width, height);
+}
+
+// ****************************************************************************
+
+void Renderer::resize_buffers(int width, int height)
+{
+    if (width <= 0 || height <= 0 || (width == _buffer_width && height == _buffer_height)) {
+        return;
+    }
+    Clock::time_point t = Clock::now();
+    do_resize_buffers(width, height);
+    _buffer_width = width;
+    _buffer_height = height;
+    // Visible size can't exceed the buffers
+    const int w = std::min(_width, width);
+    const int h = std::min(_height, height);
+    if (w > 0 && h > 0) {
+        do_set_size(w, h);
+    }
+    _width = w;
+    _height = h;
+    damage_all();
+    _stats.resize_seconds += seconds_since(t);
+    _stats.resizes++;
+}
+
+// ****************************************************************************
+
+void Renderer::set_size(int width, int height)
+{
+    width = std::min(width, _buffer_width);
+    height = std::min(height, _buffer_height);
+    if (width <= 0 || height <= 0 || (width == _width && height == _height)) {
+        return;
+    }
+    Clock::time_point t = Clock::now();
+    do_set_size(width, height);
+    _width = width;
+    _height = height;
+    damage_all();
+    _stats.resize_seconds += seconds_since(t);
+    _stats.size_changes++;
+}
+
+// ****************************************************************************
+
+std::unique_ptr<Renderer> create_renderer(Renderer_type type)
+{
+    switch (type) {
+    case Renderer_type::D3D11:
+#ifdef _WIN32
+        return std::unique_ptr<Renderer>(new Renderer_d3d11());
+#else
+        return nullptr;
+#endif
+    case Renderer_type::SOFTWARE:
+        return std::unique_ptr<Renderer>(new Renderer_software());
+    }
+    return nullptr;
+}
+
+// ****************************************************************************
+
+std::unique_ptr<Renderer> create_best_renderer(void* native_window, int width, int height,
+                                               Present_mode mode)
+{
+    std::unique_ptr<Renderer> renderer = create_renderer(Renderer_type::D3D11);
+    if (renderer) {
+        renderer->set_present_mode(mode);
+        if (renderer->init(native_window, width, height)) {
+            return renderer;
+        }
+    }
+    renderer = create_renderer(Renderer_type::SOFTWARE);
+    renderer->set_present_mode(mode);
+    renderer->init(native_window, width, height);
+    return renderer;
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+// Rendering backend abstraction.
+//
+// Two implementations:
+// - Renderer_d3d11    (renderer_d3d11.h)    Direct3D 11 flip model swap chain
+// - Renderer_software (renderer_software.h) CPU rendering into an in-memory
+//   framebuffer. Used when no GPU is available and on Linux, where it lets
+//   us measure clear / present / resize cost without a window system.
+//
+// Public calls are timed so both backends report the same Render_stats.
+//
+// Present modes. With vsync, a frame given to present() waits in a queue
+// for its vertical blank. By default DXGI lets up to 3 frames queue up:
+// present() only blocks once the queue is full, so a loop faster than the
+// display renders each frame from input that is up to 3 refreshes old by
+// the time it's shown. Present_mode::WAITABLE caps the queue (1 frame by
+// default) and moves the waiting to wait_for_frame(), *before* the frame
+// reads its input ("late latch"):
+//
+//   QUEUED:    [input][render][present: blocks......]  [input][render]...
+//   WAITABLE:  [wait_for_frame.....][input][render][present]  [wait...]
+//
+// Partial redraw (set_partial_redraw()). The frame code tells what changed
+// since the last frame with damage() (see damage_region.h), before clear().
+// The back buffer we draw into may be older than the last frame: with a
+// flip model swap chain of 2 buffers it holds the frame before last
+// (buffer_age() == 2). What must be repainted is the damage of this frame
+// plus the damage of the frames the buffer missed: repaint(). clear() and
+// submit() only touch repaint(), present() only presents damage().
+//
+// Capture (set_capture()): present() hands the frame and its damage to a
+// Frame_capture (frame_capture.h), which writes it to a file from its own
+// thread.
+
+#include "damage_region.h"
+
+#include <cstdint>
+#include <memory>
+
+class Draw_list;
+class Frame_capture;
+class Job_system;
+struct Draw_batches;
+struct Draw_texture;
+
+// ****************************************************************************
+
+struct Render_stats {
+    uint64_t frames = 0;          ///< number of present()
+    uint64_t resizes = 0;         ///< number of buffer reallocations
+    uint64_t size_changes = 0;    ///< number of visible size changes
+    double clear_seconds = 0.0;
+    double present_seconds = 0.0;
+    double resize_seconds = 0.0;  ///< reallocations + size changes
+    double draw_seconds = 0.0;    ///< submit(): sort, merge and draw
+    double wait_seconds = 0.0;    ///< wait_for_frame()
+    uint64_t draw_commands = 0;   ///< primitives submitted
+    uint64_t draw_calls = 0;      ///< batches after sorting and merging
+    uint64_t unsorted_draw_calls = 0; ///< batches without sorting
+    uint64_t frame_pixels = 0;    ///< visible pixels of the presented frames
+    uint64_t repaint_pixels = 0;  ///< ... actually repainted (partial redraw)
+};
+
+// ****************************************************************************
+
+enum class Present_mode {
+    QUEUED,  ///< present() blocks when the display queue is full (3 frames)
+    WAITABLE ///< at most 'max_latency' frames queued, wait in wait_for_frame()
+};
+
+// ****************************************************************************
+
+class Renderer {
+public:
+    virtual ~Renderer() {}
+
+    /// @param native_window : HWND on Windows, may be NULL for offscreen
+    /// rendering with the software renderer.
+    /// @return false if the backend is not available on this machine.
+    virtual bool init(void* native_window, int width, int height) = 0;
+
+    virtual const char* name() const = 0;
+
+    /// present() copies the image to the window itself (GDI blit) instead
+    /// of handing it to the compositor: the window's WM_PAINT must then
+    /// wait for a frame rather than validate (see on_paint() in win_main.cpp)
+    virtual bool paints_window() const { return false; }
+
+    /// Call before init(): the swap chain is created for it. The backend
+    /// may fall back to Present_mode::QUEUED (see present_mode()).
+    /// @param max_latency : frames queued at most with WAITABLE
+    void set_present_mode(Present_mode mode, int max_latency = 1) {
+        _present_mode = mode;
+        _max_latency = max_latency < 1 ? 1 : max_latency;
+    }
+    Present_mode present_mode() const { return _present_mode; }
+
+    /// Block until the display can take a new frame (Present_mode::WAITABLE,
+    /// returns right away otherwise). Call at the start of the frame, then
+    /// read the input.
+    void wait_for_frame();
+
+    /// Fill the back buffer with a color (components in [0, 1]). Starts
+    /// the frame: with partial redraw only repaint() is cleared.
+    void clear(float r, float g, float b, float a = 1.0f);
+
+    /// Draw the commands recorded in 'list' to the back buffer, sorted and
+    /// merged into batches first (see draw_list.h)
+    void submit(Draw_list& list);
+
+    /// Coverage texture used by Draw_list::glyph(..., id, ...). The pixels
+    /// are copied (D3D11) or must stay valid until replaced (software).
+    virtual void set_texture(uint16_t id, const Draw_texture& texture) = 0;
+
+    /// Display the back buffer. With 'vsync' on, waits for the vertical
+    /// blank (when the backend supports it).
+    void present();
+
+    /// Reallocate the back buffer(s) for a new client area size.
+    /// Same as resize_buffers(width, height) then set_size(width, height)
+    void resize(int width, int height);
+
+    /// Reallocate the back buffer(s), this is the expensive part of a
+    /// resize. The buffers may be larger than the visible size.
+    void resize_buffers(int width, int height);
+
+    /// Change the visible size (what clear(), present() etc. work on)
+    /// without reallocating. Must fit in the current buffers: call
+    /// resize_buffers() first if needed.
+    void set_size(int width, int height);
+
+    void set_vsync(bool state) { _vsync = state; }
+
+    /// Off (default): every frame repaints and presents the whole window.
+    /// On: only the damage() is, see the top of this file.
+    void set_partial_redraw(bool state) { _partial_redraw = state; }
+    bool partial_redraw() const { return _partial_redraw; }
+
+    /// What changed since the last present(), in pixels. Add to it before
+    /// clear(), it is emptied by present(). A resize damages everything.
+    Damage_region& damage() { return _damage; }
+
+    /// What clear() and submit() touch this frame (valid after clear())
+    const Damage_region& repaint() const { return _repaint; }
+
+    /// Give every presented frame to 'capture' (NULL: stop). Must outlive
+    /// the renderer, or be reset first.
+    void set_capture(Frame_capture* capture) { _capture = capture; }
+
+    /// Worker threads the backend may use for its CPU side work (the
+    /// software renderer's tiles, the capture's copies). NULL (default):
+    /// everything runs on the calling thread. Shared by every renderer the
+    /// thread drives, see Render_thread. Must outlive the renderer.
+    void set_job_system(Job_system* jobs) { _jobs = jobs; }
+
+    /// When the last present()ed frame reaches the screen, in microseconds
+    /// on the raw_input_now_us() clock. 0 if the backend can't tell.
+    int64_t display_time_us() const { return _display_time_us; }
+
+    /// Visible size
+    int width() const { return _width; }
+    int height() const { return _height; }
+
+    /// Allocated size (>= visible size)
+    int buffer_width() const { return _buffer_width; }
+    int buffer_height() const { return _buffer_height; }
+
+    const Render_stats& stats() const { return _stats; }
+    void reset_stats() { _stats = Render_stats(); }
+
+protected:
+    virtual void do_clear(float r, float g, float b, float a) = 0;
+    virtual void do_present() = 0;
+    virtual void do_submit(const Draw_list& list, const Draw_batches& batches) = 0;
+    virtual void do_resize_buffers(int width, int height) = 0;
+    virtual void do_set_size(int width, int height) = 0;
+    virtual void do_wait_for_frame() { }
+
+    /// How many presents ago the back buffer we're about to draw into was
+    /// last drawn. 0 if unknown: every frame is repainted entirely.
+    virtual int buffer_age() const { return 0; }
+
+    /// The content of every buffer is lost (e.g. reallocated)
+    void damage_all();
+
+    int _width = 0;
+    int _height = 0;
+    int _buffer_width = 0;
+    int _buffer_height = 0;
+    bool _vsync = true;
+    Present_mode _present_mode = Present_mode::QUEUED;
+    int _max_latency = 1;
+    int64_t _display_time_us = 0;
+    bool _partial_redraw = false;
+    Damage_region _damage;          ///< this frame
+    Damage_region _previous_damage; ///< last frame
+    Damage_region _repaint;
+    Frame_capture* _capture = nullptr;
+    Job_system* _jobs = nullptr;
+    Render_stats _stats;
+};
+
+// ****************************************************************************
+
+enum class Renderer_type {
+    D3D11,
+    SOFTWARE
+};
+
+/// @return NULL if 'type' is not compiled in on this platform.
+std::unique_ptr<Renderer> create_renderer(Renderer_type type);
+
+/// Try Direct3D 11 first and fall back to the software renderer.
+/// Never returns NULL.
+std::unique_ptr<Renderer> create_best_renderer(void* native_window, int width, int height,
+                                               Present_mode mode = Present_mode::QUEUED);
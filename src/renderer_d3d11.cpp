@@ -0,0 +1,293 @@
+#include "renderer_d3d11.h"
+
+#include "frame_capture.h"
+
+#ifdef _WIN32
+
+#pragma comment(lib, "dxgi.lib")
+
+using Microsoft::WRL::ComPtr;
+
+// ****************************************************************************
+
+bool Renderer_d3d11::init(void* native_window, int width, int height)
+{
+    HWND hwnd = (HWND)native_window;
+    if (!hwnd) {
+        return false;
+    }
+
+    // BGRA support is needed to interoperate with GDI / Direct2D and matches
+    // the pixel format of our software renderer.
+    UINT flags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+#ifdef _DEBUG
+    // Validation messages in the debugger output window
+    // (only works if the "Graphics Tools" optional feature is installed)
+    flags |= D3D11_CREATE_DEVICE_DEBUG;
+#endif
+
+    const D3D_FEATURE_LEVEL levels[] = { D3D_FEATURE_LEVEL_11_1, D3D_FEATURE_LEVEL_11_0 };
+    HRESULT hr = D3D11CreateDevice(
+        nullptr,                  // default adapter
+        D3D_DRIVER_TYPE_HARDWARE, // we want a GPU, otherwise we use the software renderer
+        nullptr,
+        flags,
+        levels, ARRAYSIZE(levels),
+        D3D11_SDK_VERSION,
+        &_device, nullptr, &_context);
+
+#ifdef _DEBUG
+    if (FAILED(hr)) {
+        // Debug layer not installed, try again without it.
+        flags &= ~D3D11_CREATE_DEVICE_DEBUG;
+        hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, flags,
+                               levels, ARRAYSIZE(levels), D3D11_SDK_VERSION,
+                               &_device, nullptr, &_context);
+    }
+#endif
+    if (FAILED(hr)) {
+        return false;
+    }
+
+    // The swap chain must be created by the same DXGI factory that created
+    // the adapter our device runs on: device -> adapter -> factory
+    ComPtr<IDXGIDevice> dxgi_device;
+    ComPtr<IDXGIAdapter> adapter;
+    ComPtr<IDXGIFactory2> factory;
+    if (FAILED(_device.As(&dxgi_device)) ||
+        FAILED(dxgi_device->GetAdapter(&adapter)) ||
+        FAILED(adapter->GetParent(IID_PPV_ARGS(&factory))))
+    {
+        return false;
+    }
+
+    DXGI_SWAP_CHAIN_DESC1 desc = {};
+    desc.Width = (UINT)width;
+    desc.Height = (UINT)height;
+    desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    desc.SampleDesc.Count = 1; // flip model doesn't support MSAA back buffers
+    desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    desc.BufferCount = 2;      // flip model needs at least 2 buffers
+    desc.Scaling = DXGI_SCALING_NONE;
+    desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL; // keeps the buffers' content
+    desc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
+    if (_present_mode == Present_mode::WAITABLE) {
+        desc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    }
+
+    hr = factory->CreateSwapChainForHwnd(_device.Get(), hwnd, &desc,
+                                         nullptr, // windowed
+                                         nullptr, // any output
+                                         &_swap_chain);
+    if (FAILED(hr) && desc.Flags != 0) {
+        // Flag unknown before Windows 8.1: plain swap chain
+        desc.Flags = 0;
+        hr = factory->CreateSwapChainForHwnd(_device.Get(), hwnd, &desc, nullptr, nullptr,
+                                             &_swap_chain);
+    }
+    if (FAILED(hr)) {
+        return false;
+    }
+    _swap_chain_flags = desc.Flags;
+
+    ComPtr<IDXGISwapChain2> swap_chain2;
+    if (desc.Flags != 0 && SUCCEEDED(_swap_chain.As(&swap_chain2))) {
+        // The object is signaled each time a queued frame is displayed. It
+        // must be waited on before the first frame too.
+        swap_chain2->SetMaximumFrameLatency((UINT)_max_latency);
+        _frame_latency_waitable = swap_chain2->GetFrameLatencyWaitableObject();
+    } else if (_present_mode == Present_mode::WAITABLE) {
+        // Still cap the queue, Present() is where we'll block
+        _present_mode = Present_mode::QUEUED;
+        ComPtr<IDXGIDevice1> dxgi_device1;
+        if (SUCCEEDED(_device.As(&dxgi_device1))) {
+            dxgi_device1->SetMaximumFrameLatency((UINT)_max_latency);
+        }
+    }
+    // We handle ALT+ENTER (or not) ourselves
+    factory->MakeWindowAssociation(hwnd, DXGI_MWA_NO_ALT_ENTER);
+
+    // Partial clears need Direct3D 11.1 (Windows 8, or 7 with the platform update)
+    _context.As(&_context1);
+
+    _width = _buffer_width = width;
+    _height = _buffer_height = height;
+    damage_all();
+    return create_render_target() && _draw.init(_device.Get());
+}
+
+// ****************************************************************************
+
+Renderer_d3d11::~Renderer_d3d11()
+{
+    if (_frame_latency_waitable) {
+        CloseHandle(_frame_latency_waitable);
+    }
+}
+
+// ****************************************************************************
+
+bool Renderer_d3d11::create_render_target()
+{
+    ComPtr<ID3D11Texture2D> back_buffer;
+    if (FAILED(_swap_chain->GetBuffer(0, IID_PPV_ARGS(&back_buffer)))) {
+        return false;
+    }
+    return SUCCEEDED(_device->CreateRenderTargetView(back_buffer.Get(), nullptr, &_render_target));
+}
+
+// ****************************************************************************
+
+void Renderer_d3d11::do_clear(float r, float g, float b, float a)
+{
+    const float color[4] = { r, g, b, a };
+    // With flip model the render target is unbound after every Present()
+    // so we must bind it again each frame.
+    _context->OMSetRenderTargets(1, _render_target.GetAddressOf(), nullptr);
+    if (_repaint.covers(_width, _height) || !_context1) {
+        _context->ClearRenderTargetView(_render_target.Get(), color);
+    } else if (!_repaint.empty()) {
+        D3D11_RECT rects[Damage_region::MAX_RECTS];
+        UINT count = 0;
+        for (const Damage_rect& r : _repaint) {
+            rects[count++] = { LONG(r.x0), LONG(r.y0), LONG(r.x1), LONG(r.y1) };
+        }
+        _context1->ClearView(_render_target.Get(), color, rects, count);
+    }
+
+    // The swap chain buffers may be larger than the window (see
+    // Resize_manager): we only draw to the visible top left corner.
+    // With DXGI_SCALING_NONE the rest is cropped by the compositor.
+    D3D11_VIEWPORT viewport = {};
+    viewport.Width = (float)_width;
+    viewport.Height = (float)_height;
+    viewport.MaxDepth = 1.0f;
+    _context->RSSetViewports(1, &viewport);
+}
+
+// ****************************************************************************
+
+void Renderer_d3d11::do_submit(const Draw_list& list, const Draw_batches& batches)
+{
+    // Render target and viewport were set by do_clear()
+    const bool full = _repaint.covers(_width, _height);
+    _draw.execute(_context.Get(), list, batches, _width, _height, full ? nullptr : &_repaint);
+}
+
+// ****************************************************************************
+
+void Renderer_d3d11::do_present()
+{
+    // SyncInterval = 1: wait for the next vertical blank. The dirty
+    // rectangles are a hint to the compositor: everything outside must be
+    // the same as in the previous frame. No rectangle means the whole
+    // buffer, so a frame without damage is presented whole.
+    RECT dirty[Damage_region::MAX_RECTS];
+    DXGI_PRESENT_PARAMETERS params = {};
+    if (!_damage.covers(_width, _height)) {
+        for (const Damage_rect& r : _damage) {
+            dirty[params.DirtyRectsCount++] = { LONG(r.x0), LONG(r.y0), LONG(r.x1), LONG(r.y1) };
+        }
+        params.pDirtyRects = params.DirtyRectsCount > 0 ? dirty : nullptr;
+    }
+    // Before Present1(): afterwards buffer 0 is the next back buffer
+    if (_capture) {
+        capture_frame();
+    }
+    _swap_chain->Present1(_vsync ? 1 : 0, 0, &params);
+}
+
+// ****************************************************************************
+
+void Renderer_d3d11::capture_frame()
+{
+    // The slot we're about to reuse holds the oldest copy: hand it over if
+    // the GPU is done with it, without waiting
+    Readback& slot = _readback[_readback_next];
+    Damage_region damage = _damage;
+    if (slot.pending) {
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        if (SUCCEEDED(_context->Map(slot.texture.Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped))) {
+            _capture->on_present((const uint32_t*)mapped.pData, slot.width, slot.height,
+                                 int(mapped.RowPitch / 4), &slot.damage);
+            _context->Unmap(slot.texture.Get(), 0);
+        } else {
+            // DXGI_ERROR_WAS_STILL_DRAWING: that frame is lost, not its
+            // damage, which goes to the copy that follows it
+            Readback& next = _readback[(_readback_next + 1) % CAPTURE_LATENCY];
+            (next.pending ? next.damage : damage).add(slot.damage);
+        }
+        slot.pending = false;
+    }
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    if (slot.texture) {
+        slot.texture->GetDesc(&desc);
+    }
+    if (!slot.texture || desc.Width != UINT(_buffer_width) || desc.Height != UINT(_buffer_height)) {
+        desc = {};
+        desc.Width = UINT(_buffer_width);
+        desc.Height = UINT(_buffer_height);
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+        desc.SampleDesc.Count = 1;
+        desc.Usage = D3D11_USAGE_STAGING;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        slot.texture.Reset();
+        if (FAILED(_device->CreateTexture2D(&desc, nullptr, &slot.texture))) {
+            return;
+        }
+    }
+    ComPtr<ID3D11Texture2D> back_buffer;
+    if (FAILED(_swap_chain->GetBuffer(0, IID_PPV_ARGS(&back_buffer)))) {
+        return;
+    }
+    // Only the visible part of the (maybe larger) back buffer
+    const D3D11_BOX box = { 0, 0, 0, UINT(_width), UINT(_height), 1 };
+    _context->CopySubresourceRegion(slot.texture.Get(), 0, 0, 0, 0, back_buffer.Get(), 0, &box);
+    slot.damage = damage;
+    slot.width = _width;
+    slot.height = _height;
+    slot.pending = true;
+    _readback_next = (_readback_next + 1) % CAPTURE_LATENCY;
+}
+
+// ****************************************************************************
+
+void Renderer_d3d11::do_wait_for_frame()
+{
+    if (!_frame_latency_waitable) {
+        return;
+    }
+    // Bounded: a window that is hidden or on a display that went to sleep
+    // may not signal for a long time, the frame then just runs late.
+    WaitForSingleObjectEx(_frame_latency_waitable, 1000, TRUE);
+}
+
+// ****************************************************************************
+
+void Renderer_d3d11::do_resize_buffers(int width, int height)
+{
+    // Every reference to the back buffers must be released before
+    // ResizeBuffers() or it fails.
+    _context->OMSetRenderTargets(0, nullptr, nullptr);
+    _render_target.Reset();
+    _context->Flush();
+
+    // 0 and DXGI_FORMAT_UNKNOWN: keep the current buffer count and format.
+    // The flags must be the ones the swap chain was created with.
+    _swap_chain->ResizeBuffers(0, (UINT)width, (UINT)height, DXGI_FORMAT_UNKNOWN, _swap_chain_flags);
+    create_render_target();
+}
+
+// ****************************************************************************
+
+void Renderer_d3d11::do_set_size(int width, int height)
+{
+    // Nothing to do: the viewport is set from _width, _height in do_clear()
+    UNREFERENCED_PARAMETER(width);
+    UNREFERENCED_PARAMETER(height);
+}
+
+#endif
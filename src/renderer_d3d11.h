@@ -0,0 +1,92 @@
+#pragma once
+
+// Direct3D 11 renderer with a flip model swap chain.
+//
+// Flip model (DXGI_SWAP_EFFECT_FLIP_*) lets the compositor (DWM) use
+// our back buffers directly instead of copying them, which saves a full
+// screen copy per frame and is required for tearing / low latency modes.
+// https://docs.microsoft.com/en-us/windows/win32/direct3ddxgi/for-best-performance--use-dxgi-flip-model
+//
+// Present_mode::WAITABLE creates the swap chain with
+// DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT: the queue of frames
+// is capped by IDXGISwapChain2::SetMaximumFrameLatency() and the waitable
+// object is signaled when the display can take a new frame, which is what
+// wait_for_frame() waits on. Windows 8.1 and later; on older systems we
+// fall back to QUEUED with IDXGIDevice1::SetMaximumFrameLatency().
+// https://docs.microsoft.com/en-us/windows/uwp/gaming/reduce-latency-with-dxgi-1-3-swap-chains
+//
+// Partial redraw: DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL keeps the content of
+// the back buffers (FLIP_DISCARD doesn't), each holds the frame before
+// last (buffer_age() == 2). repaint() is cleared with ClearView() (Direct3D
+// 11.1) and the draw calls are scissored to it, then Present1() gives the
+// compositor this frame's damage as dirty rectangles: only those are
+// copied / composed. Without Direct3D 11.1 every frame is repainted.
+//
+// Capture: before Present1() the back buffer is copied (on the GPU) to a
+// staging texture, one of a ring of CAPTURE_LATENCY. The copy made that
+// many frames ago is then mapped without waiting (D3D11_MAP_FLAG_DO_NOT_WAIT)
+// and given to the Frame_capture: the CPU never stalls on the GPU, the
+// capture is a few frames behind. A copy the GPU hasn't finished when its
+// texture is needed again is dropped, its damage goes to the next one.
+
+#ifdef _WIN32
+
+#include "renderer.h"
+#include "draw_d3d11.h"
+#include "platform.h"
+
+#include <d3d11_1.h>
+#include <dxgi1_3.h>
+#include <wrl/client.h>
+
+class Renderer_d3d11 : public Renderer {
+public:
+    ~Renderer_d3d11();
+
+    /// @return false if no Direct3D 11 device could be created
+    bool init(void* native_window, int width, int height) override;
+    const char* name() const override { return "d3d11"; }
+    void set_texture(uint16_t id, const Draw_texture& texture) override { _draw.set_texture(id, texture); }
+
+    ID3D11Device* device() const { return _device.Get(); }
+    ID3D11DeviceContext* context() const { return _context.Get(); }
+
+protected:
+    void do_clear(float r, float g, float b, float a) override;
+    void do_present() override;
+    void do_submit(const Draw_list& list, const Draw_batches& batches) override;
+    void do_resize_buffers(int width, int height) override;
+    void do_set_size(int width, int height) override;
+    void do_wait_for_frame() override;
+    int buffer_age() const override { return _context1 ? 2 : 0; }
+
+private:
+    static const int CAPTURE_LATENCY = 3;
+
+    /// A copy of the back buffer on its way to the CPU
+    struct Readback {
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> texture; ///< D3D11_USAGE_STAGING
+        Damage_region damage; ///< since the previous readback
+        int width = 0;
+        int height = 0;
+        bool pending = false; ///< copied, not given to the capture yet
+    };
+
+    bool create_render_target();
+    /// Give the oldest readback to the capture, copy this frame
+    void capture_frame();
+
+    // ComPtr calls Release() for us when destroyed or reassigned
+    Microsoft::WRL::ComPtr<ID3D11Device> _device;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext1> _context1; ///< ClearView(), NULL before 11.1
+    Microsoft::WRL::ComPtr<IDXGISwapChain1> _swap_chain;
+    Microsoft::WRL::ComPtr<ID3D11RenderTargetView> _render_target;
+    UINT _swap_chain_flags = 0;            ///< ResizeBuffers() needs them again
+    HANDLE _frame_latency_waitable = NULL; ///< Present_mode::WAITABLE
+    Draw_d3d11 _draw;
+    Readback _readback[CAPTURE_LATENCY];
+    int _readback_next = 0;
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "renderer_software.h"
+
+#include "frame_capture.h"
+#include "platform.h"
+#include "vblank_clock.h"
+
+#include <algorithm>
+#include <thread>
+
+// ****************************************************************************
+
+uint32_t pack_bgra(float r, float g, float b, float a)
+{
+    auto to_byte = [](float v) -> uint32_t {
+        v = std::min(std::max(v, 0.0f), 1.0f);
+        return (uint32_t)(v * 255.0f + 0.5f);
+    };
+    return (to_byte(a) << 24) | (to_byte(r) << 16) | (to_byte(g) << 8) | to_byte(b);
+}
+
+// ****************************************************************************
+
+bool Renderer_software::init(void* native_window, int width, int height)
+{
+    _window = native_window;
+    resize(std::max(width, 1), std::max(height, 1));
+    return true;
+}
+
+// ****************************************************************************
+
+void Renderer_software::do_clear(float r, float g, float b, float a)
+{
+    // Partial redraw: the tiles outside repaint() are skipped by every
+    // operation of the frame (clear, draw and resolve)
+    _back.set_damage(_repaint.covers(_width, _height) ? nullptr : &_repaint);
+    _back.set_job_system(_jobs);
+    _back.clear(pack_bgra(r, g, b, a));
+}
+
+// ****************************************************************************
+
+void Renderer_software::do_submit(const Draw_list& list, const Draw_batches& batches)
+{
+    _draw.execute(list, batches, _back, _jobs);
+}
+
+// ****************************************************************************
+
+void Renderer_software::do_present()
+{
+    _back.resolve(_front.data(), _width);
+    if (_capture) {
+        _capture->on_present(_front.data(), _width, _height, _width, &_damage, _jobs);
+    }
+
+#ifdef _WIN32
+    if (_window) {
+        blit_to_window();
+    }
+#endif
+    if (_vblank) {
+        queue_for_vblank();
+    }
+}
+
+// ****************************************************************************
+
+#ifdef _WIN32
+void Renderer_software::blit_to_window()
+{
+    HWND hwnd = (HWND)_window;
+
+    // Describe our framebuffer to GDI: 32 bits per pixel, top-down rows
+    // (a negative height means the first row is the top of the image)
+    BITMAPINFO info = {};
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = _width;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    // Some of the window was uncovered or invalidated since the last frame
+    // (on_paint() in win_main.cpp asked for this frame and left the update
+    // region alone): the whole front buffer is blitted. Otherwise only what
+    // changed: each damaged rectangle is a band of whole rows of the front
+    // buffer, described to GDI as an image of its own.
+    RECT update;
+    const bool exposed = GetUpdateRect(hwnd, &update, FALSE) != FALSE;
+    HDC hdc = GetDC(hwnd);
+    if (exposed)
+    {
+        info.bmiHeader.biHeight = -_height;
+        SetDIBitsToDevice(hdc, 0, 0, DWORD(_width), DWORD(_height), 0, 0, 0, UINT(_height),
+                          _front.data(), &info, DIB_RGB_COLORS);
+    }
+    else
+    {
+        for (const Damage_rect& r : _damage)
+        {
+            const int rows = r.y1 - r.y0;
+            info.bmiHeader.biHeight = -rows;
+            SetDIBitsToDevice(hdc, r.x0, r.y0, DWORD(r.x1 - r.x0), DWORD(rows), r.x0, 0, 0, UINT(rows),
+                              _front.data() + std::size_t(r.y0) * std::size_t(_width), &info, DIB_RGB_COLORS);
+        }
+    }
+    ReleaseDC(hwnd, hdc);
+    // Only the region that was invalid before the blit is painted now: what
+    // was invalidated since stays so, for the next frame.
+    if (exposed) {
+        ValidateRect(hwnd, &update);
+    }
+}
+#endif
+
+// ****************************************************************************
+
+int Renderer_software::queue_limit() const
+{
+    // DXGI's default maximum frame latency is 3
+    return _present_mode == Present_mode::WAITABLE ? std::min(_max_latency, int(MAX_QUEUED)) : 3;
+}
+
+// ****************************************************************************
+
+void Renderer_software::retire_displayed(Clock::time_point now)
+{
+    while (_queued > 0 && _queue[_queue_head] <= now) {
+        _queue_head = (_queue_head + 1) % MAX_QUEUED;
+        _queued--;
+    }
+}
+
+// ****************************************************************************
+
+void Renderer_software::wait_for_queue_slot()
+{
+    retire_displayed(Clock::now());
+    while (_queued >= queue_limit()) {
+        // The oldest frame leaves the queue at its vertical blank
+        std::this_thread::sleep_until(_queue[_queue_head]);
+        retire_displayed(Clock::now());
+    }
+}
+
+// ****************************************************************************
+
+void Renderer_software::queue_for_vblank()
+{
+    Clock::time_point now = Clock::now();
+    Clock::time_point display = now;
+    if (_vsync)
+    {
+        // What Present() does: block while the queue is full, then the
+        // frame is shown at the first vertical blank after the frames
+        // ahead of it (one frame per refresh).
+        wait_for_queue_slot();
+        now = Clock::now();
+        display = _vblank->next(now);
+        if (_queued > 0) {
+            const Clock::time_point last = _queue[(_queue_head + _queued - 1) % MAX_QUEUED];
+            display = std::max(display, last + _vblank->period());
+        }
+        _queue[(_queue_head + _queued) % MAX_QUEUED] = display;
+        _queued++;
+    }
+    // else: shown right away, tearing
+    _display_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        display.time_since_epoch()).count();
+}
+
+// ****************************************************************************
+
+void Renderer_software::do_wait_for_frame()
+{
+    // The frame latency waitable object: signaled once fewer than
+    // 'max_latency' frames wait for their vertical blank
+    if (_vblank && _vsync && _present_mode == Present_mode::WAITABLE) {
+        wait_for_queue_slot();
+    }
+}
+
+// ****************************************************************************
+
+void Renderer_software::do_resize_buffers(int width, int height)
+{
+    _back.reserve(width, height);
+    std::vector<uint32_t>().swap(_front);
+    _front.reserve(std::size_t(width) * std::size_t(height));
+}
+
+// ****************************************************************************
+
+void Renderer_software::do_set_size(int width, int height)
+{
+    // Within the capacity reserved by do_resize_buffers(): no allocation
+    _back.resize(width, height);
+    _front.resize(std::size_t(width) * std::size_t(height));
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+// CPU renderer: draws into a framebuffer in system memory.
+//
+// The back buffer is a tiled Framebuffer (framebuffer.h) processed by the
+// worker threads of the Job_system given to set_job_system(), serially
+// without one. present() resolves it to a row major front buffer (the
+// image "on screen"). On Windows, when a window is given to init(), the
+// front buffer is then blitted to the window with GDI. Without a window (Linux, headless
+// benchmarks) the front buffer can be inspected with front_pixels().
+//
+// Given a simulated Vblank_clock (vblank_clock.h), present() and
+// wait_for_frame() behave like a vsynced swap chain in the current
+// Present_mode: frames queue up for their vertical blank, present() or
+// wait_for_frame() block when the queue is full, and display_time_us()
+// tells when the frame will be shown.
+//
+// Partial redraw: the back buffer is kept from one frame to the next
+// (buffer_age() is 1), only the tiles overlapping the damage are cleared,
+// drawn and resolved, and only the damaged rectangles are blitted.
+//
+// Capture: the front buffer is given to the Frame_capture right after the
+// resolve, with this frame's damage.
+
+#include "renderer.h"
+#include "draw_software.h"
+#include "framebuffer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+class Vblank_clock;
+
+class Renderer_software : public Renderer {
+public:
+    bool init(void* native_window, int width, int height) override;
+    const char* name() const override { return "software"; }
+    bool paints_window() const override { return _window != nullptr; }
+    void set_texture(uint16_t id, const Draw_texture& texture) override { _draw.set_texture(id, texture); }
+
+    /// Draw here, then present()
+    Framebuffer& back_buffer() { return _back; }
+
+    /// Pixels are 32 bits 0xAARRGGBB, i.e. bytes B, G, R, A in memory which
+    /// is the layout of a Windows DIB and of DXGI_FORMAT_B8G8R8A8_UNORM.
+    /// Row major, 'width()' pixels per row.
+    const uint32_t* front_pixels() const { return _front.data(); }
+
+    /// Pace present() on a simulated display, NULL to present immediately
+    /// (the default). Must outlive the renderer.
+    void set_vblank_clock(const Vblank_clock* clock) { _vblank = clock; _queued = 0; }
+
+protected:
+    void do_clear(float r, float g, float b, float a) override;
+    void do_present() override;
+    void do_submit(const Draw_list& list, const Draw_batches& batches) override;
+    void do_resize_buffers(int width, int height) override;
+    void do_set_size(int width, int height) override;
+    void do_wait_for_frame() override;
+    int buffer_age() const override { return 1; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    static const int MAX_QUEUED = 8;
+
+#ifdef _WIN32
+    void blit_to_window();
+#endif
+    /// Frames allowed to wait for their vertical blank
+    int queue_limit() const;
+    /// Drop the frames whose vertical blank is past
+    void retire_displayed(Clock::time_point now);
+    /// Block until the queue has room for one more frame
+    void wait_for_queue_slot();
+    /// Simulated Present(): queue the frame for its vertical blank
+    void queue_for_vblank();
+
+    void* _window = nullptr;
+    Framebuffer _back;
+    Draw_software _draw;
+    std::vector<uint32_t> _front;
+
+    // Simulated display
+    const Vblank_clock* _vblank = nullptr;
+    Clock::time_point _queue[MAX_QUEUED]; ///< display time of the queued frames
+    int _queue_head = 0;
+    int _queued = 0;
+};
+
+// ****************************************************************************
+
+/// Convert a float color to a 0xAARRGGBB pixel
+uint32_t pack_bgra(float r, float g, float b, float a);
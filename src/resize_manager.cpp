@@ -0,0 +1,91 @@
+#include "resize_manager.h"
+
+#include "renderer.h"
+
+#include <algorithm>
+#include <chrono>
+
+// ****************************************************************************
+
+namespace {
+
+// Round up to a multiple of 64 pixels (the software framebuffer tile size)
+int round_up(int v) { return (v + 63) & ~63; }
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+bool Resize_manager::on_message(UINT message, WPARAM wParam, LPARAM lParam)
+{
+    switch (message)
+    {
+    // Sent when the user starts dragging the border (or moving the window)
+    // DefWindowProc() then runs its own modal loop until WM_EXITSIZEMOVE.
+    case WM_ENTERSIZEMOVE:
+        _interactive = true;
+        return true;
+    case WM_EXITSIZEMOVE:
+        _interactive = false;
+        _settle = true;
+        return true;
+
+    // wParam: SIZE_MINIMIZED, SIZE_MAXIMIZED, SIZE_RESTORED...
+    // LOWORD(lParam) = client width, HIWORD(lParam) = client height
+    case WM_SIZE:
+        _stats.size_events++;
+        _minimized = (wParam == SIZE_MINIMIZED);
+        if (!_minimized) {
+            _width = LOWORD(lParam);
+            _height = HIWORD(lParam);
+            _pending = true;
+        }
+        return true;
+    }
+    return false;
+}
+
+// ****************************************************************************
+
+void Resize_manager::end_frame(Renderer& renderer)
+{
+    if ((!_pending && !_settle) || _minimized || _width <= 0 || _height <= 0) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    const int bw = renderer.buffer_width();
+    const int bh = renderer.buffer_height();
+    const bool too_small = _width > bw || _height > bh;
+
+    if (_interactive)
+    {
+        // Grow with some slack so the next few pixels of dragging fit
+        if (too_small) {
+            int w = round_up(std::max(bw, int(float(_width) * (1.0f + _grow_margin))));
+            int h = round_up(std::max(bh, int(float(_height) * (1.0f + _grow_margin))));
+            renderer.resize_buffers(w, h);
+            _stats.reallocations++;
+        }
+    }
+    else
+    {
+        // Not dragging (maximize, programmatic resize, or the drag just
+        // ended): fit the buffers exactly if they are too small or wastefully
+        // large.
+        const double buffer_area = double(bw) * double(bh);
+        const double area = double(_width) * double(_height);
+        if (too_small || buffer_area > area * double(_shrink_ratio)) {
+            renderer.resize_buffers(_width, _height);
+            _stats.reallocations++;
+        }
+    }
+
+    if (_pending) {
+        renderer.set_size(_width, _height);
+        _stats.applied++;
+    }
+    _pending = false;
+    _settle = false;
+    _stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
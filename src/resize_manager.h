@@ -0,0 +1,64 @@
+#pragma once
+
+// Debounced back buffer reallocation.
+//
+// While the user drags the border of the window we receive a WM_SIZE for
+// every pixel of movement. Reallocating the swap chain / framebuffer each
+// time is very expensive, so:
+// - WM_SIZE only records the new size, it is applied once at the end of the
+//   frame by end_frame() (several WM_SIZE in a frame cost one resize)
+// - buffers only grow, with some slack, during an interactive resize
+//   (between WM_ENTERSIZEMOVE and WM_EXITSIZEMOVE). Shrinking the window
+//   only changes the visible size.
+// - once the resize is over we give memory back, but only if the buffers
+//   are much larger than needed (hysteresis) to avoid flip-flopping.
+
+#include "platform.h"
+
+#include <cstdint>
+
+class Renderer;
+
+struct Resize_stats {
+    uint64_t size_events = 0;   ///< WM_SIZE received
+    uint64_t applied = 0;       ///< visible size changes applied by end_frame()
+    uint64_t reallocations = 0; ///< buffer reallocations
+    double seconds = 0.0;       ///< time spent in end_frame() resizing
+};
+
+class Resize_manager {
+public:
+    /// Fraction of the size added as slack when the buffers must grow
+    /// during an interactive resize.
+    void set_grow_margin(float margin) { _grow_margin = margin; }
+
+    /// Release memory once the interactive resize ended if the buffers'
+    /// area exceeds the visible area by this factor.
+    void set_shrink_ratio(float ratio) { _shrink_ratio = ratio; }
+
+    /// Feed every window message (WM_SIZE, WM_ENTERSIZEMOVE, WM_EXITSIZEMOVE)
+    /// @return true if the message was about resizing.
+    bool on_message(UINT message, WPARAM wParam, LPARAM lParam);
+
+    /// Apply the pending size to the renderer, call once per frame before
+    /// drawing.
+    void end_frame(Renderer& renderer);
+
+    /// Is the user currently dragging the window border?
+    bool interactive() const { return _interactive; }
+    bool minimized() const { return _minimized; }
+
+    const Resize_stats& stats() const { return _stats; }
+    void reset_stats() { _stats = Resize_stats(); }
+
+private:
+    bool _interactive = false;
+    bool _minimized = false;
+    bool _pending = false;
+    bool _settle = false;        ///< interactive resize just ended
+    int _width = 0;
+    int _height = 0;
+    float _grow_margin = 0.25f;
+    float _shrink_ratio = 2.0f;
+    Resize_stats _stats;
+};
@@ -0,0 +1,140 @@
+#include "resource_cache.h"
+
+#include <chrono>
+
+// ****************************************************************************
+
+Resource_cache::~Resource_cache()
+{
+    _stop.store(true);
+    if (_background.joinable()) {
+        _background.join();
+    }
+    for (std::unique_ptr<Entry>& e : _entries) {
+        if (e->state.load() == LOADED && e->data && e->release) {
+            e->release(e->data);
+        }
+    }
+}
+
+// ****************************************************************************
+
+void Resource_cache::add(Id id, const Load_fn& load, Load_policy policy, const Free_fn& release)
+{
+    Entry* e = new Entry();
+    e->id = id;
+    e->load = load;
+    e->release = release;
+    e->policy = policy;
+    _entries.emplace_back(e);
+}
+
+// ****************************************************************************
+
+Resource_cache::Entry* Resource_cache::find(Id id) const
+{
+    // A handful of entries: a linear scan over contiguous pointers beats a
+    // hash map here.
+    for (const std::unique_ptr<Entry>& e : _entries) {
+        if (e->id == id) {
+            return e.get();
+        }
+    }
+    return nullptr;
+}
+
+// ****************************************************************************
+
+void Resource_cache::start_background(const std::function<void()>& on_done)
+{
+    if (_background.joinable()) {
+        return;
+    }
+    _background = std::thread([this, on_done]()
+    {
+        for (std::unique_ptr<Entry>& e : _entries) {
+            if (_stop.load()) {
+                break;
+            }
+            if (e->policy == Load_policy::BACKGROUND) {
+                acquire(*e, true);
+            }
+        }
+        _background_done.store(true, std::memory_order_release);
+        if (on_done && !_stop.load()) {
+            on_done();
+        }
+    });
+}
+
+// ****************************************************************************
+
+void* Resource_cache::get(Id id)
+{
+    Entry* e = find(id);
+    if (!e) {
+        return nullptr;
+    }
+    if (e->state.load(std::memory_order_acquire) == LOADED) {
+        return e->data;
+    }
+    return acquire(*e, false);
+}
+
+// ****************************************************************************
+
+void* Resource_cache::try_get(Id id) const
+{
+    Entry* e = find(id);
+    if (!e || e->state.load(std::memory_order_acquire) != LOADED) {
+        return nullptr;
+    }
+    return e->data;
+}
+
+// ****************************************************************************
+
+bool Resource_cache::ready(Id id) const
+{
+    Entry* e = find(id);
+    return e && e->state.load(std::memory_order_acquire) == LOADED;
+}
+
+// ****************************************************************************
+
+void* Resource_cache::acquire(Entry& e, bool background)
+{
+    int expected = UNLOADED;
+    if (e.state.compare_exchange_strong(expected, LOADING))
+    {
+        // We won the right to load it
+        auto start = std::chrono::steady_clock::now();
+        void* data = e.load ? e.load() : nullptr;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        e.data = data;
+        e.state.store(LOADED, std::memory_order_release);
+        _stats.loaded++;
+        _stats.loaded_in_background += background ? 1 : 0;
+        _stats.load_ms += ms;
+        _loaded.notify_all();
+        return data;
+    }
+
+    // Someone else is loading it
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (e.state.load() != LOADED) {
+        _stats.waits++;
+        _loaded.wait(lock, [&e]() { return e.state.load() == LOADED; });
+    }
+    return e.data;
+}
+
+// ****************************************************************************
+
+Resource_stats Resource_cache::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
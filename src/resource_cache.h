@@ -0,0 +1,105 @@
+#pragma once
+
+// Deferred resource loading.
+//
+// Anything that isn't needed to show the first frame (icons, accelerator
+// tables, later on shaders and textures) is registered here with a loader
+// function instead of being loaded up front:
+//
+//     g_resources.add(RES_ICON, [=]() { return (void*)LoadIcon(...); }, Load_policy::BACKGROUND);
+//     g_resources.start_background();   // after the window is shown
+//     ...
+//     HICON icon = (HICON)g_resources.try_get(RES_ICON); // NULL until loaded
+//
+// - Load_policy::LAZY: loaded by the first get()
+// - Load_policy::BACKGROUND: loaded by a worker thread started with
+//   start_background(). get() before that loads it on the spot.
+// get() always returns a loaded resource (waiting if another thread is
+// loading it), try_get() never waits.
+//
+// Register every resource before start_background(): the table of entries
+// doesn't change afterwards, lookups don't take any lock.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class Load_policy {
+    LAZY,       ///< load on first use
+    BACKGROUND  ///< load ahead of time in the background thread
+};
+
+struct Resource_stats {
+    uint32_t loaded = 0;
+    uint32_t loaded_in_background = 0;
+    uint32_t waits = 0;            ///< get() had to wait for another thread
+    double load_ms = 0.0;          ///< total time spent in loaders
+};
+
+// ****************************************************************************
+
+class Resource_cache {
+public:
+    typedef uint32_t Id;
+    typedef std::function<void*()> Load_fn;
+    /// Release a loaded resource (may be null: nothing to free)
+    typedef std::function<void(void*)> Free_fn;
+
+    Resource_cache() = default;
+    /// Joins the background thread and frees the resources
+    ~Resource_cache();
+
+    Resource_cache(const Resource_cache&) = delete;
+    Resource_cache& operator=(const Resource_cache&) = delete;
+
+    /// Register a resource. 'id' is any value, unique in this cache.
+    void add(Id id, const Load_fn& load, Load_policy policy, const Free_fn& release = Free_fn());
+
+    /// Load every Load_policy::BACKGROUND resource from a worker thread.
+    /// 'on_done' (optional) is called from that thread at the end.
+    void start_background(const std::function<void()>& on_done = std::function<void()>());
+
+    /// The resource, loaded now if necessary. nullptr for an unknown id or
+    /// if the loader failed.
+    void* get(Id id);
+
+    /// The resource if it's already loaded, nullptr otherwise (never waits)
+    void* try_get(Id id) const;
+
+    bool ready(Id id) const;
+    /// Are all Load_policy::BACKGROUND resources loaded?
+    bool background_done() const { return _background_done.load(std::memory_order_acquire); }
+
+    /// Exact once background_done() returns true
+    Resource_stats stats() const;
+
+private:
+    enum State : int { UNLOADED, LOADING, LOADED };
+
+    struct Entry {
+        Id id;
+        Load_fn load;
+        Free_fn release;
+        Load_policy policy;
+        std::atomic<int> state{UNLOADED};
+        void* data = nullptr;
+    };
+
+    Entry* find(Id id) const;
+    /// Load 'e' or wait for the thread loading it. @return e.data
+    void* acquire(Entry& e, bool background);
+
+    std::vector<std::unique_ptr<Entry>> _entries;
+    std::thread _background;
+    std::atomic<bool> _background_done{false};
+    std::atomic<bool> _stop{false};
+
+    mutable std::mutex _mutex;
+    std::condition_variable _loaded;
+    Resource_stats _stats; ///< protected by '_mutex'
+};
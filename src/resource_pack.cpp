@@ -0,0 +1,153 @@
+#include "resource_pack.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// ****************************************************************************
+
+namespace {
+
+const char MAGIC[8] = { 'R', 'E', 'S', 'P', 'A', 'C', 'K', '1' };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t toc_offset;
+    uint32_t reserved;
+};
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+bool Resource_pack::open(const char* path)
+{
+    close();
+    if (!_file.open(path) || _file.size() < sizeof(Header)) {
+        _file.close();
+        return false;
+    }
+    Header h;
+    memcpy(&h, _file.data(), sizeof(h));
+    const std::size_t toc_end = std::size_t(h.toc_offset) + std::size_t(h.count) * sizeof(Toc_entry);
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != 1 ||
+        h.toc_offset % 4 != 0 || toc_end > _file.size())
+    {
+        _file.close();
+        return false;
+    }
+    // Validate every entry once so lookups don't have to
+    const Toc_entry* toc = (const Toc_entry*)(_file.data() + h.toc_offset);
+    for (uint32_t i = 0; i < h.count; ++i) {
+        if (std::size_t(toc[i].offset) + toc[i].size > _file.size()) {
+            _file.close();
+            return false;
+        }
+    }
+    _toc = toc;
+    _count = h.count;
+    return true;
+}
+
+// ****************************************************************************
+
+Pack_blob Resource_pack::find(Pack_type type, uint32_t id) const
+{
+    Pack_blob blob;
+    // Entries are sorted by (type, id)
+    const uint64_t key = (uint64_t(type) << 32) | id;
+    std::size_t lo = 0;
+    std::size_t hi = _count;
+    while (lo < hi) {
+        std::size_t mid = (lo + hi) / 2;
+        uint64_t k = (uint64_t(_toc[mid].type) << 32) | _toc[mid].id;
+        if (k < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < _count && _toc[lo].type == uint32_t(type) && _toc[lo].id == id) {
+        blob.data = _file.data() + _toc[lo].offset;
+        blob.size = _toc[lo].size;
+    }
+    return blob;
+}
+
+// ****************************************************************************
+
+std::string_view Resource_pack::string(uint32_t id) const
+{
+    Pack_blob blob = find(Pack_type::STRING, id);
+    return blob ? std::string_view((const char*)blob.data, blob.size) : std::string_view();
+}
+
+// ****************************************************************************
+
+const char16_t* Resource_pack::string_utf16(uint32_t id, std::size_t* length) const
+{
+    Pack_blob blob = find(Pack_type::STRING_UTF16, id);
+    if (length) {
+        *length = blob.size / 2;
+    }
+    // Blobs are 8 bytes aligned by the tool: safe to read as char16_t
+    return blob ? (const char16_t*)blob.data : nullptr;
+}
+
+// ****************************************************************************
+
+const Pack_accel* Resource_pack::accelerators(uint32_t id, std::size_t* count) const
+{
+    Pack_blob blob = find(Pack_type::ACCELERATORS, id);
+    *count = blob.size / sizeof(Pack_accel);
+    return blob ? (const Pack_accel*)blob.data : nullptr;
+}
+
+// ****************************************************************************
+
+#ifdef _WIN32
+
+HICON create_icon_from_ico(const Pack_blob& ico, int size)
+{
+    // .ico layout: ICONDIR { u16 0, u16 type = 1, u16 count } followed by
+    // 'count' ICONDIRENTRY { u8 width, u8 height, u8 colors, u8 0,
+    // u16 planes, u16 bpp, u32 bytes, u32 offset } (0 width means 256)
+    if (!ico || ico.size < 6) {
+        return NULL;
+    }
+    const uint8_t* p = ico.data;
+    const unsigned count = p[4] | (p[5] << 8);
+    if (ico.size < 6 + 16 * std::size_t(count)) {
+        return NULL;
+    }
+    int best = -1;
+    int best_score = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        const uint8_t* e = p + 6 + 16 * i;
+        int width = e[0] ? e[0] : 256;
+        int bpp = e[6] | (e[7] << 8);
+        // Closest size first, then the most colors
+        int score = -std::abs(width - size) * 64 + bpp;
+        if (best < 0 || score > best_score) {
+            best = int(i);
+            best_score = score;
+        }
+    }
+    if (best < 0) {
+        return NULL;
+    }
+    const uint8_t* e = p + 6 + 16 * best;
+    uint32_t bytes, offset;
+    memcpy(&bytes, e + 8, 4);
+    memcpy(&offset, e + 12, 4);
+    if (std::size_t(offset) + bytes > ico.size) {
+        return NULL;
+    }
+    // The image itself (BITMAPINFOHEADER + pixels or PNG) is what the
+    // RT_ICON resources contain, CreateIconFromResourceEx() takes it as is.
+    return CreateIconFromResourceEx((PBYTE)(p + offset), bytes, TRUE, 0x00030000,
+                                    size, size, LR_DEFAULTCOLOR);
+}
+
+#endif
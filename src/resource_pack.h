@@ -0,0 +1,87 @@
+#pragma once
+
+// Read only access to resources.pack, produced at build time from
+// resource.h and main_win_rsc.rc by tools/make_resource_pack.py
+//
+// The file is memory mapped and never copied: a lookup is a binary search
+// in the table of contents and returns a pointer into the mapping.
+// Strings are stored NUL terminated in UTF-8 and UTF-16, so they can be
+// handed to the Win32 'W' functions directly, with no length limit (as
+// opposed to LoadStringW() into a fixed size buffer).
+//
+// It doesn't depend on the Win32 resource loader: the headless build on
+// Linux reads the same strings and tables.
+
+#include "platform.h"
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum class Pack_type : uint32_t {
+    STRING       = 1, ///< UTF-8
+    STRING_UTF16 = 2, ///< UTF-16LE
+    ACCELERATORS = 3, ///< array of Pack_accel
+    ICON         = 4  ///< .ico file
+};
+
+// Same layout as the Win32 ACCEL struct
+struct Pack_accel {
+    uint8_t fVirt;
+    uint8_t pad;
+    uint16_t key;
+    uint16_t cmd;
+};
+static_assert(sizeof(Pack_accel) == 6, "must match ACCEL");
+
+struct Pack_blob {
+    const uint8_t* data = nullptr;
+    std::size_t size = 0;
+    explicit operator bool() const { return data != nullptr; }
+};
+
+// ****************************************************************************
+
+class Resource_pack {
+public:
+    /// @return false if the file is missing or isn't a valid pack
+    bool open(const char* path);
+    void close() { _file.close(); _toc = nullptr; _count = 0; }
+    bool is_open() const { return _toc != nullptr; }
+
+    /// Raw entry, empty blob if not found
+    Pack_blob find(Pack_type type, uint32_t id) const;
+
+    /// Zero-copy UTF-8 view (NUL terminated), empty if not found
+    std::string_view string(uint32_t id) const;
+
+    /// Zero-copy UTF-16 string (NUL terminated), nullptr if not found.
+    /// 'length' (optional) receives the number of characters.
+    const char16_t* string_utf16(uint32_t id, std::size_t* length = nullptr) const;
+
+    /// Accelerator table entries, nullptr if not found
+    const Pack_accel* accelerators(uint32_t id, std::size_t* count) const;
+
+    std::size_t entry_count() const { return _count; }
+
+private:
+    struct Toc_entry {
+        uint32_t type;
+        uint32_t id;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    Mapped_file _file;
+    const Toc_entry* _toc = nullptr;
+    std::size_t _count = 0;
+};
+
+// ****************************************************************************
+
+#ifdef _WIN32
+/// Create an icon from a .ico file in memory (e.g. a Pack_type::ICON blob),
+/// picking the image closest to 'size' pixels. Free it with DestroyIcon()
+HICON create_icon_from_ico(const Pack_blob& ico, int size);
+#endif
@@ -0,0 +1,306 @@
+#include "simd_kernels.h"
+
+// SSE2 is part of every x86-64 CPU. On 32 bits x86 it is only used when the
+// compiler targets it (-msse2, /arch:SSE2): otherwise the kernels are scalar.
+// AVX2 may not be available: its kernels are compiled for AVX2 (target
+// attribute with gcc / clang, MSVC accepts the intrinsics anywhere) and only
+// selected after checking the CPU supports it.
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAS_X86_KERNELS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// ****************************************************************************
+
+namespace {
+
+// =============================================================================
+namespace scalar {
+// =============================================================================
+
+void fill(uint32_t* dst, std::size_t count, uint32_t color)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        dst[i] = color;
+    }
+}
+
+// x / 255 rounded, exact for x in [0, 255 * 255]
+inline uint32_t div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+inline uint32_t blend_pixel(uint32_t d, uint32_t s)
+{
+    const uint32_t a = s >> 24;
+    const uint32_t inv = 255 - a;
+    uint32_t b = div255((s & 0xFF) * a + (d & 0xFF) * inv);
+    uint32_t g = div255(((s >> 8) & 0xFF) * a + ((d >> 8) & 0xFF) * inv);
+    uint32_t r = div255(((s >> 16) & 0xFF) * a + ((d >> 16) & 0xFF) * inv);
+    uint32_t o = div255(a * 255 + (d >> 24) * inv);
+    return (o << 24) | (r << 16) | (g << 8) | b;
+}
+
+void blend(uint32_t* dst, const uint32_t* src, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        dst[i] = blend_pixel(dst[i], src[i]);
+    }
+}
+
+inline uint32_t swap_pixel(uint32_t p) {
+    return (p & 0xFF00FF00u) | ((p >> 16) & 0xFFu) | ((p & 0xFFu) << 16);
+}
+
+void swap_red_blue(uint32_t* dst, const uint32_t* src, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        dst[i] = swap_pixel(src[i]);
+    }
+}
+
+}// END scalar namespace
+
+#ifdef HAS_X86_KERNELS
+// =============================================================================
+namespace sse2 {
+// =============================================================================
+
+void fill(uint32_t* dst, std::size_t count, uint32_t color)
+{
+    const __m128i c = _mm_set1_epi32((int)color);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(dst + i), c);
+    }
+    scalar::fill(dst + i, count - i, color);
+}
+
+// Blend two pixels unpacked to 16 bits per channel (B G R A B G R A)
+inline __m128i blend_16(__m128i s, __m128i d)
+{
+    // Broadcast each pixel's alpha to its 4 channels
+    __m128i a = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    // For the alpha channel the source is weighted by 255 instead of alpha
+    // so that out.a = src.a + dst.a * (1 - src.a)
+    const __m128i rgb_mask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    const __m128i alpha_255 = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    const __m128i w = _mm_or_si128(_mm_and_si128(a, rgb_mask), alpha_255);
+
+    // x = s * w + d * (255 - a) <= 255 * 255 fits in an unsigned 16 bits
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(s, w), _mm_mullo_epi16(d, inv));
+    // Rounded division by 255: (x + 128 + ((x + 128) >> 8)) >> 8
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    x = _mm_add_epi16(x, _mm_srli_epi16(x, 8));
+    return _mm_srli_epi16(x, 8);
+}
+
+void blend(uint32_t* dst, const uint32_t* src, std::size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = blend_16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i hi = blend_16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    scalar::blend(dst + i, src + i, count - i);
+}
+
+void swap_red_blue(uint32_t* dst, const uint32_t* src, std::size_t count)
+{
+    // No byte shuffle in SSE2 (pshufb is SSSE3): masks and shifts instead
+    const __m128i keep = _mm_set1_epi32((int)0xFF00FF00u);
+    const __m128i low = _mm_set1_epi32(0xFF);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i r = _mm_or_si128(_mm_and_si128(p, keep),
+                    _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), low),
+                                 _mm_slli_epi32(_mm_and_si128(p, low), 16)));
+        _mm_storeu_si128((__m128i*)(dst + i), r);
+    }
+    scalar::swap_red_blue(dst + i, src + i, count - i);
+}
+
+}// END sse2 namespace
+
+// =============================================================================
+namespace avx2 {
+// =============================================================================
+
+TARGET_AVX2
+void fill(uint32_t* dst, std::size_t count, uint32_t color)
+{
+    const __m256i c = _mm256_set1_epi32((int)color);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256((__m256i*)(dst + i), c);
+    }
+    // The tail runs non-VEX SSE code: clear the upper halves of the ymm
+    // registers first, otherwise every call pays an AVX/SSE transition
+    // penalty (measured 10x slower on short spans such as narrow
+    // rectangles or the edge of a tile). Same in every AVX2 kernel.
+    _mm256_zeroupper();
+    scalar::fill(dst + i, count - i, color);
+}
+
+// Same as sse2::blend_16() on 4 pixels. Unpack / pack / shuffles in AVX2
+// work within each 128 bits lane, which is all we need here.
+TARGET_AVX2
+inline __m256i blend_16(__m256i s, __m256i d)
+{
+    __m256i a = _mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm256_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    const __m256i rgb_mask = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1,
+                                              0, -1, -1, -1, 0, -1, -1, -1);
+    const __m256i alpha_255 = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0,
+                                               255, 0, 0, 0, 255, 0, 0, 0);
+    const __m256i w = _mm256_or_si256(_mm256_and_si256(a, rgb_mask), alpha_255);
+
+    __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(s, w), _mm256_mullo_epi16(d, inv));
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    x = _mm256_add_epi16(x, _mm256_srli_epi16(x, 8));
+    return _mm256_srli_epi16(x, 8);
+}
+
+TARGET_AVX2
+void blend(uint32_t* dst, const uint32_t* src, std::size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i lo = blend_16(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+        __m256i hi = blend_16(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    _mm256_zeroupper(); // before the SSE2 tail, see fill()
+    sse2::blend(dst + i, src + i, count - i);
+}
+
+TARGET_AVX2
+void swap_red_blue(uint32_t* dst, const uint32_t* src, std::size_t count)
+{
+    // Byte shuffle: for each pixel bytes (0 1 2 3) -> (2 1 0 3)
+    const __m256i order = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                           2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(p, order));
+    }
+    _mm256_zeroupper(); // before the SSE2 tail, see fill()
+    sse2::swap_red_blue(dst + i, src + i, count - i);
+}
+
+}// END avx2 namespace
+
+// ****************************************************************************
+
+bool cpu_has_avx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // AVX2 also needs the OS to save the YMM registers (OSXSAVE + XCR0)
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    // Needed when called before main() (we select kernels at static init)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // HAS_X86_KERNELS
+
+// ****************************************************************************
+
+const Span_kernels g_scalar = { scalar::fill, scalar::blend, scalar::swap_red_blue };
+#ifdef HAS_X86_KERNELS
+const Span_kernels g_sse2 = { sse2::fill, sse2::blend, sse2::swap_red_blue };
+const Span_kernels g_avx2 = { avx2::fill, avx2::blend, avx2::swap_red_blue };
+#endif
+
+Kernel_level g_level = best_kernel_level();
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+const Span_kernels& span_kernels()
+{
+#ifdef HAS_X86_KERNELS
+    switch (g_level) {
+    case Kernel_level::AVX2: return g_avx2;
+    case Kernel_level::SSE2: return g_sse2;
+    default: break;
+    }
+#endif
+    return g_scalar;
+}
+
+// ****************************************************************************
+
+Kernel_level best_kernel_level()
+{
+#ifdef HAS_X86_KERNELS
+    static const bool avx2 = cpu_has_avx2();
+    return avx2 ? Kernel_level::AVX2 : Kernel_level::SSE2;
+#else
+    return Kernel_level::SCALAR;
+#endif
+}
+
+// ****************************************************************************
+
+Kernel_level set_kernel_level(Kernel_level level)
+{
+    Kernel_level best = best_kernel_level();
+    g_level = (int)level > (int)best ? best : level;
+    return g_level;
+}
+
+// ****************************************************************************
+
+Kernel_level kernel_level()
+{
+    return g_level;
+}
+
+// ****************************************************************************
+
+const char* to_string(Kernel_level level)
+{
+    switch (level) {
+    case Kernel_level::SCALAR: return "scalar";
+    case Kernel_level::SSE2:   return "sse2";
+    case Kernel_level::AVX2:   return "avx2";
+    }
+    return "unknown";
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// Pixel span kernels used by the software framebuffer.
+//
+// Every kernel exists in three flavors: plain C++ (scalar), SSE2 (4 pixels
+// per instruction) and AVX2 (8 pixels). The best version supported by the
+// CPU is selected at startup; set_kernel_level() forces a given level, which
+// is how we compare the SIMD versions against the scalar baseline.
+//
+// Pixels are 32 bits 0xAARRGGBB (bytes B, G, R, A in memory) unless stated
+// otherwise.
+
+#include <cstddef>
+#include <cstdint>
+
+enum class Kernel_level {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+struct Span_kernels {
+    /// dst[i] = color
+    void (*fill)(uint32_t* dst, std::size_t count, uint32_t color);
+
+    /// Alpha blend 'src' over 'dst' (straight, non premultiplied alpha):
+    /// dst.rgb = src.rgb * src.a + dst.rgb * (1 - src.a)
+    /// dst.a   = src.a + dst.a * (1 - src.a)
+    void (*blend)(uint32_t* dst, const uint32_t* src, std::size_t count);
+
+    /// Swap the red and blue channels: RGBA8 <-> BGRA8
+    void (*swap_red_blue)(uint32_t* dst, const uint32_t* src, std::size_t count);
+};
+
+/// Kernels of the currently selected level
+const Span_kernels& span_kernels();
+
+/// Best level available on this CPU
+Kernel_level best_kernel_level();
+
+/// Select the kernels used by span_kernels(). Levels the CPU (or the
+/// compiler) doesn't support are clamped to the best available one.
+/// @return the level actually selected
+Kernel_level set_kernel_level(Kernel_level level);
+
+Kernel_level kernel_level();
+
+const char* to_string(Kernel_level level);
@@ -0,0 +1,71 @@
+#pragma once
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread (Single Producer Single Consumer).
+//
+// A ring buffer of 'N' slots (N must be a power of two) and two counters:
+// - '_head' only written by the consumer (next slot to read)
+// - '_tail' only written by the producer (next slot to write)
+// Each side reads the other side's counter with acquire semantic and
+// publishes its own with release semantic, no lock and no CAS loop.
+// The counters live on their own cache lines so the two threads don't
+// fight over the same line (false sharing).
+
+#include <atomic>
+#include <cstddef>
+
+template<class T, std::size_t N>
+class Spsc_queue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+public:
+    /// Producer side. @return false if the queue is full (value not pushed)
+    bool push(const T& value)
+    {
+        const std::size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head_cache == N) {
+            // Looks full: refresh our copy of the consumer's counter
+            _head_cache = _head.load(std::memory_order_acquire);
+            if (tail - _head_cache == N) {
+                return false;
+            }
+        }
+        _slots[tail & (N - 1)] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer side. @return false if the queue is empty
+    bool pop(T& value)
+    {
+        const std::size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail_cache) {
+            _tail_cache = _tail.load(std::memory_order_acquire);
+            if (head == _tail_cache) {
+                return false;
+            }
+        }
+        value = _slots[head & (N - 1)];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Approximate number of elements (exact if called from either side
+    /// while the other side is idle)
+    std::size_t size() const {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+    static constexpr std::size_t capacity() { return N; }
+
+private:
+    // Consumer's cache line
+    alignas(64) std::atomic<std::size_t> _head{0};
+    std::size_t _tail_cache = 0; ///< consumer's last view of '_tail'
+
+    // Producer's cache line
+    alignas(64) std::atomic<std::size_t> _tail{0};
+    std::size_t _head_cache = 0; ///< producer's last view of '_head'
+
+    alignas(64) T _slots[N];
+};
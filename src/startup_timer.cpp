@@ -0,0 +1,111 @@
+#include "startup_timer.h"
+
+#include "platform.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Mark {
+    const char* name;
+    double ms;
+};
+
+const std::size_t MAX_MARKS = 32;
+
+Mark g_marks[MAX_MARKS];
+std::atomic<std::size_t> g_reserved{0}; ///< slots taken
+std::atomic<std::size_t> g_count{0};    ///< slots fully written (in order)
+
+/// Milliseconds between process creation and the static initialization of
+/// this file (0 when the OS can't tell)
+double process_age_ms()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user, now;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    GetSystemTimePreciseAsFileTime(&now);
+    ULARGE_INTEGER c, n;
+    c.LowPart = creation.dwLowDateTime; c.HighPart = creation.dwHighDateTime;
+    n.LowPart = now.dwLowDateTime;      n.HighPart = now.dwHighDateTime;
+    // FILETIME are expressed in 100 nanoseconds units
+    return n.QuadPart > c.QuadPart ? double(n.QuadPart - c.QuadPart) * 1e-4 : 0.0;
+#else
+    return 0.0;
+#endif
+}
+
+// Time zero expressed in the steady clock
+const double g_age_at_init_ms = process_age_ms();
+const Clock::time_point g_init_time = Clock::now();
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+double startup_elapsed_ms()
+{
+    return g_age_at_init_ms +
+           std::chrono::duration<double, std::milli>(Clock::now() - g_init_time).count();
+}
+
+// ****************************************************************************
+
+void startup_mark(const char* name)
+{
+    const double ms = startup_elapsed_ms();
+    std::size_t slot = g_reserved.fetch_add(1);
+    if (slot >= MAX_MARKS) {
+        return;
+    }
+    g_marks[slot].name = name;
+    g_marks[slot].ms = ms;
+    // Publish in slot order so readers never see a half written mark
+    std::size_t expected = slot;
+    while (!g_count.compare_exchange_weak(expected, slot + 1)) {
+        expected = slot;
+    }
+}
+
+// ****************************************************************************
+
+bool startup_has_mark(const char* name)
+{
+    const std::size_t count = g_count.load();
+    for (std::size_t i = 0; i < count; ++i) {
+        if (g_marks[i].name == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ****************************************************************************
+
+std::size_t startup_mark_count()
+{
+    return g_count.load();
+}
+
+// ****************************************************************************
+
+void startup_report(Startup_print_fn print, void* user)
+{
+    const std::size_t count = g_count.load();
+    double previous = 0.0;
+    char line[128];
+    for (std::size_t i = 0; i < count; ++i) {
+        snprintf(line, sizeof(line), "startup: %-28s %8.2f ms  (at %8.2f ms)\n",
+                 g_marks[i].name, g_marks[i].ms - previous, g_marks[i].ms);
+        print(line, user);
+        previous = g_marks[i].ms;
+    }
+}
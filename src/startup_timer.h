@@ -0,0 +1,34 @@
+#pragma once
+
+// Timestamps of the startup phases, from process creation to the first
+// presented frame.
+//
+//     startup_mark("register_class");   // end of a phase
+//     ...
+//     startup_report(print_fn, user);   // one line per phase
+//
+// Marks can be added from any thread (e.g. the render thread marks the
+// first frame), without allocation. Time zero is the creation of the
+// process as reported by the OS on Windows (so the time spent by the
+// loader and the C runtime before wWinMain() is included), the static
+// initialization of this module elsewhere.
+
+#include <cstddef>
+
+/// Record the end of a phase. 'name' must be a string literal.
+/// Only the first 32 marks are kept.
+void startup_mark(const char* name);
+
+/// Milliseconds since time zero
+double startup_elapsed_ms();
+
+/// Has a mark with this name (same pointer) been recorded?
+bool startup_has_mark(const char* name);
+
+/// Number of marks recorded so far
+std::size_t startup_mark_count();
+
+/// Call 'print(text, user)' with one line per phase: its duration and the
+/// time since time zero.
+typedef void (*Startup_print_fn)(const char* text, void* user);
+void startup_report(Startup_print_fn print, void* user);
@@ -0,0 +1,59 @@
+#pragma once
+
+// Throttled status text (e.g. drawn at the bottom of the window).
+//
+// event_handler() may update the status on every mouse / key message, but
+// pushing it somewhere has a cost: a copy to the render thread, or worse
+// SetWindowText(), a cross process call to the window manager. Status_text keeps the latest text and
+// flush() pushes it at most once per frame, and only if it changed.
+// Nothing here allocates memory.
+
+#include "fixed_string.h"
+
+class Status_text {
+public:
+    typedef Fixed_string<256> Buffer;
+
+    /// Function that displays the text, 'target' is the user pointer given
+    /// to flush() (e.g. the HWND)
+    typedef void (*Push_fn)(void* target, const char* text);
+
+    /// Start writing a new status. The returned buffer is empty.
+    Buffer& begin() {
+        _dirty = true;
+        return _pending.clear();
+    }
+
+    void set(const char* text) { begin().append(text); }
+
+    /// Call once per frame: pushes the pending text if it differs from the
+    /// last one pushed. @return true if 'push' was called.
+    bool flush(Push_fn push, void* target) {
+        if (!_dirty) {
+            return false;
+        }
+        _dirty = false;
+        if (_has_shown && _pending == _shown) {
+            _skipped++;
+            return false;
+        }
+        _shown = _pending;
+        _has_shown = true;
+        _pushes++;
+        push(target, _shown.c_str());
+        return true;
+    }
+
+    const char* current() const { return _shown.c_str(); }
+
+    unsigned long long pushes() const { return _pushes; }   ///< calls to push
+    unsigned long long skipped() const { return _skipped; } ///< identical texts not pushed
+
+private:
+    Buffer _pending;
+    Buffer _shown;
+    bool _dirty = false;
+    bool _has_shown = false;
+    unsigned long long _pushes = 0;
+    unsigned long long _skipped = 0;
+};
@@ -0,0 +1,214 @@
+#include "text_renderer.h"
+
+#include "draw_list.h"
+#include "profiler.h"
+#include "renderer.h"
+
+#include <cmath>
+#include <cstring>
+
+// ****************************************************************************
+
+namespace {
+
+const uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+/// Decode the code point at 's' and advance 's' past it. Malformed
+/// sequences give U+FFFD and skip a single byte.
+uint32_t next_codepoint(const unsigned char*& s, const unsigned char* end)
+{
+    const uint32_t c = *s++;
+    if (c < 0x80) {
+        return c;
+    }
+    int extra;
+    uint32_t cp;
+    if      ((c & 0xE0) == 0xC0) { extra = 1; cp = c & 0x1F; }
+    else if ((c & 0xF0) == 0xE0) { extra = 2; cp = c & 0x0F; }
+    else if ((c & 0xF8) == 0xF0) { extra = 3; cp = c & 0x07; }
+    else { return REPLACEMENT_CHARACTER; }
+    if (end - s < extra) {
+        return REPLACEMENT_CHARACTER;
+    }
+    for (int i = 0; i < extra; ++i) {
+        if ((s[i] & 0xC0) != 0x80) {
+            return REPLACEMENT_CHARACTER;
+        }
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+    s += extra;
+    return cp;
+}
+
+/// FNV-1a of the string and its size
+uint64_t hash_text(const char* text, std::size_t length, int pixel_size)
+{
+    uint64_t h = 14695981039346656037ull ^ uint64_t(uint32_t(pixel_size));
+    for (std::size_t i = 0; i < length; ++i) {
+        h = (h ^ uint64_t((unsigned char)text[i])) * 1099511628211ull;
+    }
+    return h;
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+Text_renderer::Text_renderer(Glyph_rasterizer& rasterizer, int atlas_width, int atlas_height)
+    : _atlas(rasterizer, atlas_width, atlas_height)
+{
+    _layouts.reserve(LAYOUT_CACHE_SIZE);
+    _layout_map.reserve(LAYOUT_CACHE_SIZE);
+}
+
+// ****************************************************************************
+
+int Text_renderer::draw(Draw_list& list, float x, float y, const char* utf8, int pixel_size,
+                        uint32_t color)
+{
+    PROFILE_ZONE("draw_text");
+    Layout& layout = shape(utf8, pixel_size);
+    _stats.strings++;
+
+    const float left = std::floor(x + 0.5f);
+    const float baseline = std::floor(y + 0.5f) + float(_atlas.rasterizer().ascent(pixel_size));
+    for (Shaped_glyph& g : layout.glyphs)
+    {
+        const Atlas_glyph* glyph = _atlas.find(g.codepoint, pixel_size, g.hint);
+        if (!glyph || glyph->metrics.width == 0) {
+            continue;
+        }
+        const Glyph_metrics& m = glyph->metrics;
+        list.glyph(left + float(g.x + m.offset_x), baseline + float(m.offset_y),
+                   float(m.width), float(m.height), glyph->uv, ATLAS_TEXTURE, color);
+        _stats.glyphs++;
+    }
+    return layout.width;
+}
+
+// ****************************************************************************
+
+int Text_renderer::measure(const char* utf8, int pixel_size)
+{
+    return shape(utf8, pixel_size).width;
+}
+
+// ****************************************************************************
+
+bool Text_renderer::upload(Renderer& renderer, uint64_t& uploaded_version) const
+{
+    if (uploaded_version == _atlas.version()) {
+        return false;
+    }
+    renderer.set_texture(ATLAS_TEXTURE, _atlas.texture());
+    uploaded_version = _atlas.version();
+    return true;
+}
+
+// ****************************************************************************
+
+Text_renderer::Layout& Text_renderer::shape(const char* utf8, int pixel_size)
+{
+    const std::size_t length = std::strlen(utf8);
+    const uint64_t hash = hash_text(utf8, length, pixel_size);
+
+    uint32_t index;
+    auto it = _layout_map.find(hash);
+    if (it != _layout_map.end())
+    {
+        index = it->second;
+        Layout& cached = _layouts[index];
+        if (cached.pixel_size == pixel_size && cached.text.size() == length &&
+            std::memcmp(cached.text.data(), utf8, length) == 0)
+        {
+            _stats.layout_hits++;
+            if (_head != index) {
+                unlink(index);
+                push_front(index);
+            }
+            return cached;
+        }
+        // Hash collision: the new string takes the entry
+        unlink(index);
+    }
+    else if (_layouts.size() < LAYOUT_CACHE_SIZE)
+    {
+        index = uint32_t(_layouts.size());
+        _layouts.emplace_back();
+    }
+    else
+    {
+        // Recycle the least recently used layout, vectors and string keep
+        // their capacity: no allocation once the cache is warm.
+        index = _tail;
+        unlink(index);
+        auto old = _layout_map.find(_layouts[index].hash);
+        if (old != _layout_map.end() && old->second == index) {
+            _layout_map.erase(old);
+        }
+    }
+    _stats.layout_misses++;
+
+    Layout& layout = _layouts[index];
+    layout.hash = hash;
+    layout.text.assign(utf8, length);
+    layout.pixel_size = pixel_size;
+    layout.glyphs.clear();
+
+    bool complete = true;
+    int pen = 0;
+    const unsigned char* s = (const unsigned char*)utf8;
+    const unsigned char* end = s + length;
+    while (s < end)
+    {
+        Shaped_glyph g = { next_codepoint(s, end), pen, Glyph_atlas::NO_SLOT };
+        // The advance is only known once the glyph is rasterized: this is
+        // also what brings the glyphs of a new string in the atlas.
+        const Atlas_glyph* glyph = _atlas.find(g.codepoint, pixel_size, g.hint);
+        if (glyph) {
+            pen += glyph->metrics.advance;
+        } else {
+            complete = false;
+        }
+        layout.glyphs.push_back(g);
+    }
+    layout.width = pen;
+    push_front(index);
+    // Missing glyphs (atlas full for this frame): don't keep a layout with
+    // wrong advances, shape the string again next time.
+    if (complete) {
+        _layout_map[hash] = index;
+    } else {
+        if (it != _layout_map.end()) {
+            _layout_map.erase(it);
+        }
+        layout.hash = 0;
+    }
+    return layout;
+}
+
+// ****************************************************************************
+
+void Text_renderer::unlink(uint32_t index)
+{
+    Layout& l = _layouts[index];
+    if (l.prev != NO_LAYOUT) { _layouts[l.prev].next = l.next; } else { _head = l.next; }
+    if (l.next != NO_LAYOUT) { _layouts[l.next].prev = l.prev; } else { _tail = l.prev; }
+    l.prev = l.next = NO_LAYOUT;
+}
+
+// ****************************************************************************
+
+void Text_renderer::push_front(uint32_t index)
+{
+    Layout& l = _layouts[index];
+    l.prev = NO_LAYOUT;
+    l.next = _head;
+    if (_head != NO_LAYOUT) {
+        _layouts[_head].prev = index;
+    }
+    _head = index;
+    if (_tail == NO_LAYOUT) {
+        _tail = index;
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+// Draw UTF-8 text with a Draw_list.
+//
+//     Bitmap_font_rasterizer font;
+//     Text_renderer text(font);
+//     // every frame:
+//     text.begin_frame();
+//     text.draw(list, 10, 10, "x: 120 y: 45", 16, 0xFFFFFFFF);
+//     text.upload(*renderer, uploaded_version); // only if the atlas changed
+//     renderer->submit(list);
+//
+// Glyphs come from a Glyph_atlas (glyph_atlas.h), so every character of
+// every string is one quad of the same texture: all the text of a layer is
+// a single draw call.
+//
+// Shaping (decoding the UTF-8 and placing each glyph on the line) is cached
+// too: a status message or a label is usually drawn unchanged for many
+// frames. The last LAYOUT_CACHE_SIZE (string, size) pairs are kept, least
+// recently used first out. A cached layout also remembers the atlas slot of
+// each glyph, so drawing it again is a hash of the string and one array
+// walk, without any hash map lookup per character.
+//
+// Left to right, single line, no kerning: enough for status and debug text.
+
+#include "glyph_atlas.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Draw_list;
+class Renderer;
+
+struct Text_stats {
+    uint64_t strings = 0;       ///< calls to draw()
+    uint64_t glyphs = 0;        ///< quads emitted
+    uint64_t layout_hits = 0;   ///< strings drawn from the layout cache
+    uint64_t layout_misses = 0; ///< strings shaped
+};
+
+// ****************************************************************************
+
+class Text_renderer {
+public:
+    /// Texture id of the atlas given to Renderer::set_texture()
+    static const uint16_t ATLAS_TEXTURE = 1;
+    static const std::size_t LAYOUT_CACHE_SIZE = 256;
+
+    explicit Text_renderer(Glyph_rasterizer& rasterizer, int atlas_width = 512, int atlas_height = 512);
+
+    Text_renderer(const Text_renderer&) = delete;
+    Text_renderer& operator=(const Text_renderer&) = delete;
+
+    /// Call once per frame, before the first draw()
+    void begin_frame() { _atlas.begin_frame(); }
+
+    /// Record the glyphs of 'utf8', the top left of the line at (x, y).
+    /// Positions are rounded to whole pixels (glyphs are not resampled).
+    /// @return width of the text in pixels
+    int draw(Draw_list& list, float x, float y, const char* utf8, int pixel_size, uint32_t color);
+
+    /// Width of the text in pixels (shaped and cached like draw())
+    int measure(const char* utf8, int pixel_size);
+
+    int line_height(int pixel_size) { return _atlas.rasterizer().line_height(pixel_size); }
+
+    /// Give the atlas to 'renderer' if glyphs were added since the version
+    /// it last received. Call after the draw() calls of the frame and before
+    /// Renderer::submit().
+    /// @param uploaded_version : per renderer, start at 0
+    /// @return true if the texture was uploaded
+    bool upload(Renderer& renderer, uint64_t& uploaded_version) const;
+
+    Glyph_atlas& atlas() { return _atlas; }
+    const Text_stats& stats() const { return _stats; }
+
+private:
+    static const uint32_t NO_LAYOUT = 0xFFFFFFFFu;
+
+    struct Shaped_glyph {
+        uint32_t codepoint;
+        int x;          ///< pen position from the start of the line
+        uint32_t hint;  ///< atlas slot, see Glyph_atlas::find()
+    };
+
+    struct Layout {
+        uint64_t hash = 0;
+        std::string text;          ///< to tell hash collisions apart
+        int pixel_size = 0;
+        int width = 0;
+        std::vector<Shaped_glyph> glyphs;
+        uint32_t prev = NO_LAYOUT; ///< LRU list
+        uint32_t next = NO_LAYOUT;
+    };
+
+    /// Cached layout of the string, shaped on a miss
+    Layout& shape(const char* utf8, int pixel_size);
+    void unlink(uint32_t index);
+    void push_front(uint32_t index);
+
+    Glyph_atlas _atlas;
+
+    std::vector<Layout> _layouts;
+    std::unordered_map<uint64_t, uint32_t> _layout_map;
+    uint32_t _head = NO_LAYOUT; ///< most recently used
+    uint32_t _tail = NO_LAYOUT; ///< least recently used
+
+    Text_stats _stats;
+};
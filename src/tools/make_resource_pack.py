@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""Build resources.pack from resource.h and main_win_rsc.rc
+
+The pack is a single file meant to be memory mapped (see resource_pack.h):
+
+    header   "RESPACK1", u32 version, u32 entry count, u32 toc offset, u32 0
+    toc      entry count x { u32 type, u32 id, u32 offset, u32 size }
+             sorted by (type, id) for binary search
+    data     every blob aligned on 8 bytes
+
+Blob types:
+    1 STRING         UTF-8, followed by a 0 byte (not counted in size)
+    2 STRING_UTF16   UTF-16LE, followed by a 0 wchar (not counted in size)
+    3 ACCELERATORS   array of Win32 ACCEL { u8 fVirt, u8 0, u16 key, u16 cmd }
+    4 ICON           the .ico file as is
+
+Only the STRINGTABLE, ACCELERATORS and ICON statements are read, menus and
+dialogs stay in the .rc file.
+
+usage: make_resource_pack.py main_win_rsc.rc resource.h resources.pack
+"""
+
+import os
+import re
+import struct
+import sys
+
+STRING, STRING_UTF16, ACCELERATORS, ICON = 1, 2, 3, 4
+
+# <winuser.h> accelerator flags
+FVIRTKEY, FNOINVERT, FSHIFT, FCONTROL, FALT = 0x01, 0x02, 0x04, 0x08, 0x10
+
+# Win32 identifiers the .rc may use besides the ones of resource.h
+WIN32_IDS = {"IDOK": 1, "IDCANCEL": 2}
+
+
+def read_text(path):
+    """.rc files written by Visual Studio are UTF-16 (with BOM), resource.h
+    usually is in the local code page: only its ASCII part matters."""
+    raw = open(path, "rb").read()
+    if raw.startswith(b"\xff\xfe") or raw.startswith(b"\xfe\xff"):
+        return raw.decode("utf-16")
+    if raw.startswith(b"\xef\xbb\xbf"):
+        return raw[3:].decode("utf-8")
+    return raw.decode("utf-8", errors="replace")
+
+
+def parse_defines(text):
+    ids = dict(WIN32_IDS)
+    for m in re.finditer(r"^\s*#define\s+(\w+)\s+(-?\d+)", text, re.M):
+        ids[m.group(1)] = int(m.group(2))
+    return ids
+
+
+def resolve(token, ids):
+    token = token.strip()
+    if re.fullmatch(r"-?\d+", token):
+        return int(token)
+    if token not in ids:
+        sys.exit("unknown identifier: " + token)
+    return ids[token]
+
+
+def unquote(s):
+    """rc string literal: "" is a quote, \\n \\t \\\\ escapes"""
+    s = s[1:-1].replace('""', '"')
+    return re.sub(r"\\(.)", lambda m: {"n": "\n", "t": "\t"}.get(m.group(1), m.group(1)), s)
+
+
+def blocks(text, keyword):
+    """Yield (name, body lines) of every '<name> <keyword> ... BEGIN ... END'"""
+    pattern = re.compile(r"^(\w*)\s*" + keyword + r"\b[^\n]*\n(.*?)^\s*BEGIN\s*$(.*?)^\s*END\s*$",
+                         re.M | re.S)
+    for m in pattern.finditer(text):
+        yield m.group(1), m.group(3).strip().splitlines()
+
+
+def parse_strings(text, ids):
+    out = {}
+    for _, lines in blocks(text, "STRINGTABLE"):
+        for line in lines:
+            m = re.match(r'\s*(\w+)\s*,?\s*(".*")\s*$', line)
+            if m:
+                out[resolve(m.group(1), ids)] = unquote(m.group(2))
+    return out
+
+
+def parse_accelerators(text, ids):
+    out = {}
+    for name, lines in blocks(text, "ACCELERATORS"):
+        table = []
+        for line in lines:
+            parts = [p.strip() for p in re.split(r",(?=(?:[^\"]*\"[^\"]*\")*[^\"]*$)", line) if p.strip()]
+            if len(parts) < 2:
+                continue
+            key, cmd, flags = parts[0], resolve(parts[1], ids), [f.upper() for f in parts[2:]]
+            fvirt = 0
+            if key.startswith('"'):
+                key = unquote(key)
+                if key.startswith("^"):    # "^C" is Ctrl+C
+                    code = ord(key[1].upper()) - ord("A") + 1
+                else:
+                    code = ord(key)
+            else:
+                code = resolve(key, ids) if not key.startswith("VK_") else VIRTUAL_KEYS[key]
+            if "VIRTKEY" in flags:
+                fvirt |= FVIRTKEY
+            if "NOINVERT" in flags:
+                fvirt |= FNOINVERT
+            if "SHIFT" in flags:
+                fvirt |= FSHIFT
+            if "CONTROL" in flags:
+                fvirt |= FCONTROL
+            if "ALT" in flags:
+                fvirt |= FALT
+            table.append(struct.pack("<BBHH", fvirt, 0, code, cmd))
+        out[resolve(name, ids)] = b"".join(table)
+    return out
+
+
+VIRTUAL_KEYS = {"VK_BACK": 0x08, "VK_TAB": 0x09, "VK_RETURN": 0x0D, "VK_ESCAPE": 0x1B,
+                "VK_SPACE": 0x20, "VK_DELETE": 0x2E, "VK_INSERT": 0x2D,
+                **{"VK_F%d" % i: 0x6F + i for i in range(1, 13)}}
+
+
+def parse_icons(text, ids, rc_dir):
+    out = {}
+    for m in re.finditer(r'^\s*(\w+)\s+ICON\s+"([^"]+)"', text, re.M):
+        path = os.path.join(rc_dir, m.group(2).replace("\\\\", "/"))
+        out[resolve(m.group(1), ids)] = open(path, "rb").read()
+    return out
+
+
+def build_pack(entries):
+    """entries: list of (type, id, bytes, terminator)"""
+    entries.sort(key=lambda e: (e[0], e[1]))
+    header_size = 24
+    toc_size = 16 * len(entries)
+    data = bytearray()
+    toc = bytearray()
+    base = header_size + toc_size
+    for type_, id_, blob, terminator in entries:
+        while (base + len(data)) % 8:
+            data.append(0)
+        toc += struct.pack("<IIII", type_, id_ & 0xFFFFFFFF, base + len(data), len(blob))
+        data += blob + terminator
+    header = b"RESPACK1" + struct.pack("<IIII", 1, len(entries), header_size, 0)
+    return header + toc + data
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.exit(__doc__)
+    rc_path, header_path, out_path = sys.argv[1:]
+    ids = parse_defines(read_text(header_path))
+    rc = read_text(rc_path)
+
+    entries = []
+    for id_, s in parse_strings(rc, ids).items():
+        entries.append((STRING, id_, s.encode("utf-8"), b"\0"))
+        entries.append((STRING_UTF16, id_, s.encode("utf-16-le"), b"\0\0"))
+    for id_, table in parse_accelerators(rc, ids).items():
+        entries.append((ACCELERATORS, id_, table, b""))
+    for id_, ico in parse_icons(rc, ids, os.path.dirname(os.path.abspath(rc_path))).items():
+        entries.append((ICON, id_, ico, b""))
+
+    pack = build_pack(entries)
+    # Don't touch the file (and trigger a relink / copy) if nothing changed
+    if os.path.exists(out_path) and open(out_path, "rb").read() == pack:
+        return
+    with open(out_path, "wb") as f:
+        f.write(pack)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,63 @@
+#pragma once
+
+// Lock-free triple buffer: one writer thread publishes a value every frame,
+// one reader thread always gets the latest complete value.
+//
+// Three copies of 'T':
+// - the writer fills its 'back' copy then swaps it with the 'middle' one
+// - the reader swaps its 'front' copy with the 'middle' one when a new
+//   value was published
+// Neither side ever waits for the other (unlike a mutex or double
+// buffering): a slow reader simply skips values, a slow writer makes the
+// reader see the same value again.
+//
+// The middle index and a "new value" flag are packed in one atomic byte so
+// each swap is a single exchange().
+
+#include <atomic>
+#include <cstdint>
+
+template<class T>
+class Triple_buffer {
+public:
+    Triple_buffer() = default;
+    explicit Triple_buffer(const T& init) {
+        for (T& s : _slots) {
+            s = init;
+        }
+    }
+
+    /// Writer side: the copy to fill. Stays valid until publish().
+    T& back() { return _slots[_back]; }
+
+    /// Writer side: make back() the latest value.
+    void publish()
+    {
+        uint8_t prev = _middle.exchange(uint8_t(_back | DIRTY), std::memory_order_acq_rel);
+        _back = prev & INDEX;
+    }
+
+    /// Reader side: fetch the latest published value if any.
+    /// @return true if front() changed since the last call
+    bool update()
+    {
+        if ((_middle.load(std::memory_order_relaxed) & DIRTY) == 0) {
+            return false;
+        }
+        uint8_t prev = _middle.exchange(_front, std::memory_order_acq_rel);
+        _front = prev & INDEX;
+        return true;
+    }
+
+    /// Reader side: the latest value fetched by update()
+    const T& front() const { return _slots[_front]; }
+
+private:
+    static const uint8_t INDEX = 0x3;
+    static const uint8_t DIRTY = 0x4;
+
+    T _slots[3] = {};
+    alignas(64) std::atomic<uint8_t> _middle{1};
+    alignas(64) uint8_t _back = 0;  ///< writer only
+    alignas(64) uint8_t _front = 2; ///< reader only
+};
@@ -0,0 +1,20 @@
+#include "vblank_clock.h"
+
+// ****************************************************************************
+
+Vblank_clock::Vblank_clock(double hz)
+    : _hz(hz > 1.0 ? hz : 1.0)
+    , _period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _hz)))
+{
+}
+
+// ****************************************************************************
+
+Vblank_clock::Clock::time_point Vblank_clock::next(Clock::time_point t) const
+{
+    if (t < _origin) {
+        return _origin;
+    }
+    const auto elapsed = t - _origin;
+    return _origin + (elapsed / _period + 1) * _period;
+}
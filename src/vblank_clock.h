@@ -0,0 +1,30 @@
+#pragma once
+
+// Vertical blank of a simulated display: 'hz' refreshes per second since
+// the clock was created.
+//
+// Give it to Renderer_software::set_vblank_clock() and present() queues
+// frames and blocks like a vsynced DXGI swap chain does (Present_mode
+// included), without a screen. This is how frame scheduling and the input
+// latency it causes are measured on Linux.
+
+#include <chrono>
+
+/// Immutable once created: may be shared by several renderers.
+class Vblank_clock {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit Vblank_clock(double hz = 60.0);
+
+    double hz() const { return _hz; }
+    Clock::duration period() const { return _period; }
+
+    /// First vertical blank strictly after 't'
+    Clock::time_point next(Clock::time_point t) const;
+
+private:
+    double _hz;
+    Clock::duration _period;
+    Clock::time_point _origin = Clock::now();
+};
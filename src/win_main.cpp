@@ -5,26 +5,110 @@
 
 #include "framework.h"
 #include "win_main.h"
+#include "event_loop.h"
+#include "frame_pacer.h"
+#include "status_text.h"
+#include "renderer.h"
+#include "resize_manager.h"
+#include "window_manager.h"
+#include "render_thread.h"
+#include "profiler.h"
+#include "raw_input.h"
+#include "message_dispatch.h"
+#include "input_log.h"
+#include "job_system.h"
+#include "asset_streamer.h"
+#include "frame_capture.h"
+#include "resource_cache.h"
+#include "resource_pack.h"
+#include "startup_timer.h"
+#include "backend_win32.h"
 
-#include <d3d11.h>
 #include <assert.h>
 #include <cstdio>
+#include <cstring>
+#include <memory>
 #include <string>
 
-#define MAX_LOADSTRING 100
-
 // Global Variables:
-WCHAR szTitle[MAX_LOADSTRING];                  // The title bar text
-WCHAR szWindowClass[MAX_LOADSTRING];            // the main window class name
+Resource_pack g_pack;                           // resources.pack (strings, icons...)
+const WCHAR* g_title = L"";                     // The title bar text
+const WCHAR* g_window_class = L"";              // the main window class name
+Window_manager g_windows;                       // per window state (input, renderer...)
+Render_thread g_render_thread(g_windows);       // draws every window
+Resource_cache g_resources;                     // icons, accelerators... loaded in the background
+Present_mode g_present_mode = Present_mode::QUEUED; // swap chains of the windows ("-waitable")
+std::unique_ptr<Asset_streamer> g_streamer;     // large assets, uploaded by the render thread
+Frame_capture g_capture;                        // what the first window shows ("-capture")
+
+// Resources of g_resources
+enum Resource_id : Resource_cache::Id {
+    RES_ICON,
+    RES_ICON_SMALL,
+    RES_ACCELERATORS
+};
 
 
 // ****************************************************************************
 
 // Forward declarations of functions included in this code module:
 ATOM                register_class(HINSTANCE hInstance);
-bool                init_instance(HINSTANCE, int);
+void                register_resources(HINSTANCE hInstance);
+void                open_resource_pack();
+const WCHAR*        load_string(HINSTANCE hInstance, UINT id, std::wstring& storage);
+bool                apply_resources(Backend_win32& backend);
+void                report_startup(bool append_to_file);
+bool                init_instance(HINSTANCE, int, int);
+bool                create_window(HINSTANCE, Window_state*, int);
 LRESULT CALLBACK    event_handler(HWND, UINT, WPARAM, LPARAM);
 INT_PTR CALLBACK    about_callback(HWND, UINT, WPARAM, LPARAM);
+Frame_pacer         parse_pacing(LPCWSTR command_line);
+void                report_pacing(const Pacing_stats& stats, const Loop_stats& loop);
+void                report_frame_memory(const Arena_stats& stats);
+void                report_text(const Text_stats& text, const Atlas_stats& atlas);
+void                report_raw_input();
+void                report_latency();
+void                report_streaming();
+void                stream_assets(LPCWSTR command_line);
+void                report_capture();
+void                export_trace();
+int                 parse_window_count(LPCWSTR command_line);
+
+// Message handlers (see message_dispatch.h)
+bool                on_command(const Message& msg, LRESULT& result);
+bool                on_about(const Message& msg, LRESULT& result);
+bool                on_exit(const Message& msg, LRESULT& result);
+bool                on_destroy(const Message& msg, LRESULT& result);
+bool                on_key_down(const Message& msg, LRESULT& result);
+bool                on_left_button_down(const Message& msg, LRESULT& result);
+bool                on_input(const Message& msg, LRESULT& result);
+bool                on_paint(const Message& msg, LRESULT& result);
+
+// ****************************************************************************
+
+// Messages handled by event_handler(). A subsystem can keep its own list
+// next to its code and simply add it to make_dispatch_table() below.
+constexpr Message_entry g_window_handlers[] = {
+    { WM_COMMAND,     on_command          },
+    { WM_DESTROY,     on_destroy          },
+    { WM_KEYDOWN,     on_key_down         },
+    { WM_LBUTTONDOWN, on_left_button_down },
+    { WM_INPUT,       on_input            },
+    { WM_PAINT,       on_paint            },
+};
+
+// Menu items and accelerators (LOWORD(wParam) of WM_COMMAND)
+constexpr Message_entry g_menu_commands[] = {
+    { IDM_ABOUT, on_about },
+    { IDM_EXIT,  on_exit  },
+};
+
+// Built by the compiler: the standard messages (WM_* below 0x240, which
+// includes WM_ENTERSIZEMOVE / WM_EXITSIZEMOVE) are a direct array lookup.
+constexpr auto g_message_table = make_dispatch_table<0x240>(g_window_handlers);
+constexpr auto g_command_table = make_dispatch_table<0x100>(g_menu_commands);
+static_assert(g_message_table.valid(), "a message has two handlers");
+static_assert(g_command_table.valid(), "a command has two handlers");
 
 // ****************************************************************************
 
@@ -107,112 +191,194 @@ int APIENTRY wWinMain(
 {
     // A windows.h specific macro to avoid the unused variable compiler warning
     UNREFERENCED_PARAMETER(hPrevInstance);
-    // Alternatively note that we could just comment the parameter like so: _In_ LPWSTR /*lpCmdLine*/ to avoid that same warning.
-    UNREFERENCED_PARAMETER(lpCmdLine);
+
+    // Time every phase until the first frame is presented (see
+    // startup_timer.h). Time zero is the creation of the process.
+    startup_mark("wWinMain");
+
+    // "-trace": record every loop phase and window message, the timeline
+    // is written to trace.json at exit (see profiler.h)
+    bool tracing = wcsstr(lpCmdLine, L"-trace") != nullptr;
+    if (tracing) {
+        profiler_set_enabled(true);
+        profiler_set_thread_name("UI");
+    }
+
+    // "-jobs_inline": no worker thread, every job runs on the thread that
+    // submits it in a deterministic order (see job_system.h). Must be set
+    // before the render thread starts: it creates the renderers' workers.
+    if (wcsstr(lpCmdLine, L"-jobs_inline")) {
+        Job_system::set_default_mode(Job_mode::INLINE);
+    }
+
+    // "-waitable": at most one frame queued for the display, the render
+    // thread waits for the vertical blank *before* reading the input (see
+    // Present_mode in renderer.h). Pair it with "-uncapped": the display
+    // paces the frames.
+    if (wcsstr(lpCmdLine, L"-waitable")) {
+        g_present_mode = Present_mode::WAITABLE;
+    }
+
+    // Strings (window class and title) are read from resources.pack:
+    // mapping it costs about as much as opening a file.
+    open_resource_pack();
+    startup_mark("open resources.pack");
+
+    // Nothing is loaded here: icons and accelerators are not needed to
+    // show the first frame, they are listed in g_resources and loaded by a
+    // background thread once the windows are up.
+    register_resources(hInstance);
 
     register_class(hInstance);
+    startup_mark("register_class");
 
     // Perform application initialization:
-    if (!init_instance(hInstance, nCmdShow)) {
+    // "-windows <N>" on the command line opens N windows (default is 1)
+    if (!init_instance(hInstance, nCmdShow, parse_window_count(lpCmdLine))) {
         return 0;
     }
+    startup_mark("init_instance");
+
+    // Every mouse report (WM_INPUT), not only the merged WM_MOUSEMOVE
+    raw_input_register();
+
+    g_resources.start_background([]() { startup_mark("background resources"); });
+
+    // The message loop lives in event_loop.cpp, it is platform-neutral and
+    // only talks to a 'backend'. Backend_win32 peeks messages from the
+    // Windows queue and forwards them to our event_handler() through
+    // TranslateAccelerator() / TranslateMessage() / DispatchMessage()
+    // (see backend_win32.cpp)
+    // The accelerator table is given to the backend once loaded (see
+    // apply_resources()), until then TranslateAccelerator() does nothing.
+    Backend_win32 backend(NULL);
+
+    // "-replay" / "-replay_fast": play input.log back at the recorded speed
+    // or as fast as possible, instead of reading the user's input.
+    // The Windows queue is still pumped so the windows keep responding.
+    Input_log log;
+    std::unique_ptr<Backend_replay> replay;
+    if (wcsstr(lpCmdLine, L"-replay") && log.open("input.log"))
+    {
+        Replay_speed speed = wcsstr(lpCmdLine, L"-replay_fast") ? Replay_speed::MAXIMUM : Replay_speed::RECORDED;
+        replay.reset(new Backend_replay(log, event_handler, speed, &backend));
+        replay->set_window([](uint32_t id, void*) -> HWND {
+            return (id > 0 && id <= g_windows.size()) ? g_windows[id - 1].hwnd : NULL;
+        }, nullptr);
+    }
+    Event_loop loop(replay ? (Event_backend&)*replay : (Event_backend&)backend);
 
-    HACCEL hAccelTable = LoadAccelerators(hInstance, MAKEINTRESOURCE(IDC_MAINWIN));
-
-    // Struct holding the value of a message such as: 
-    // user events (e.g. mouse click, keyboard events) 
-    // WM_LBUTTONDOWN (left button down)
-    // window events (e.g. closing/quiting window) WM_CLOSE / WM_QUIT
-    // system events
-    // https://docs.microsoft.com/en-us/windows/win32/learnwin32/window-messages
-    // https://docs.microsoft.com/en-us/windows/win32/api/winuser/ns-winuser-msg
-    MSG msg;
-    // ZeroMemory(void* ptr, length);
-    // Zero memory fills with zeros the bytes starting from 'ptr' to 'ptr+length'
-    // equivalent to memset((void*)ptr, (int value =) 0, length)    
-    // since MSG is a struct this allows us to avoid doing MSG.message = 0, MSG.time = 0, etc.
-    // Alternatively MSG msg = {}; works as well.
-    // It's yet another windows API idiosyncrasy in a vain attempt to make 
-    // the code "clearer" according to: 
-    // https://devblogs.microsoft.com/oldnewthing/20050628-07/?p=35183
-    ZeroMemory(&msg, sizeof(MSG));
-
-    // Rendering loop:
-    while (msg.message != WM_QUIT)
+    // "-record": log every message to input.log (memory mapped, cheap
+    // enough to leave on). Windows are identified by creation order since
+    // handles change from one run to the next.
+    Input_recorder recorder;
+    if (!replay && wcsstr(lpCmdLine, L"-record") && recorder.open("input.log"))
     {
-        // returns true if a message was available in the event queue.
-        BOOL s = PeekMessage(// MSG* messsage
-                             &msg, 
-                             // HWND hwnd: Handle to the window we peek a 
-                             // message from, or NULL to peek from every window
-                             NULL, 
-                             // UINT wMsgFilterMin, wMsgFilterMax:
-                             // define the interval [min, max] of message codes
-                             // that we should look out for. 0, 0 means we peek
-                             // any message (no filtering)
-                             0, 0, 
-                             // UINT wRemoveMsg: a bitfield to specify how we 
-                             // process messages in the event queue.
-                             // PM_REMOVE: remove from the queue when processed
-                             // https://docs.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-peekmessagea
-                             PM_REMOVE);
-
-        //
-        //
-        // struct MSG {
-        //     // Handle to the window that received the message
-        //     // NULL from thread messages
-        //     HWND hwnd;
-        //     // Message type
-        //     UINT message;
-        //     // Additional parameters which values depends on 
-        //     // the type of the message
-        //     WPARAM wParam;
-        //     LPARAM lParam;
-        //     // Time the message was posted 
-        //     DWORD time;
-        //     // Cursor position when the message was posted
-        //     POINT pt;
-        //     // Internal value for the API (we can ignore it)
-        //     DWORD lPrivate;
-        // };
-        
-
-        if (s)
-        {
-            if (!TranslateAccelerator(msg.hwnd, hAccelTable, &msg))
-            {
-                // TranslateMessage() will add additional messages to the queue
-                // that will get picked up by PeekMessage() or GetMessage() on 
-                // the next iteration of our loop.
-                // For instance on WM_KEYDOWN and WM_KEYUP events it will add
-                // a WM_CHAR or WM_DEADCHAR event message.
-                // On a WM_CHAR event you can retreive the key code in wParam
-                // WM_SYSKEYDOWN and WM_SYSKEYUP produce a WM_SYSCHAR or 
-                // WM_SYSDEADCHAR message.
-                TranslateMessage(&msg);
-
-                // Call the "window procedure" i.e our function event_handler() 
-                // that should handle the various events the API knows to call 
-                // this function because we specified it in 'register_class()' 
-                // earlier
-                DispatchMessage(&msg);
-            }
-        }
+        recorder.set_window_id([](HWND hwnd, void*) -> uint32_t {
+            Window_state* window = g_windows.from_hwnd(hwnd);
+            return window ? uint32_t(window->index) + 1 : 0;
+        }, nullptr);
+        loop.set_recorder(&recorder);
+    }
 
-        // Break if user presses escape key
-        if (GetAsyncKeyState(VK_ESCAPE)) {
-            msg.wParam = 0;
-            break;
+    // Frame pacing: sleep between frames instead of busy spinning.
+    // Select the policy of the render thread from the command line:
+    // "-uncapped", "-on_demand" or "-hz <value>" (default is 60Hz)
+    g_render_thread.set_pacer(parse_pacing(lpCmdLine));
+    // "-full_redraw": repaint and present the whole window every frame
+    // instead of only what changed (see damage_region.h)
+    g_render_thread.set_partial_redraw(wcsstr(lpCmdLine, L"-full_redraw") == nullptr);
+    // Input time stamps ('MSG::time') are on the clock of the loop's backend
+    g_render_thread.set_input_clock(replay ? (Event_backend*)replay.get() : &backend);
+    // Large assets are read and decoded in the background, then uploaded
+    // by the render thread a few megabytes per frame (see asset_streamer.h):
+    // loading never stalls a frame nor this thread.
+    g_streamer.reset(new Asset_streamer());
+    g_render_thread.set_streamer(g_streamer.get());
+    // "-stream <file>": stream a large file that way
+    stream_assets(lpCmdLine);
+    // "-capture": write the frames of the first window to capture.wfc, for
+    // support cases (see frame_capture.h). "-capture_every <N>" keeps one
+    // frame in N.
+    if (wcsstr(lpCmdLine, L"-capture") && g_windows.size() > 0 && g_windows[0].renderer)
+    {
+        int every = 1;
+        if (LPCWSTR arg = wcsstr(lpCmdLine, L"-capture_every ")) {
+            every = _wtoi(arg + 15);
         }
+        if (g_capture.open("capture.wfc", every)) {
+            g_windows[0].renderer->set_capture(&g_capture);
+        }
+    }
+
+    // Rendering happens in its own thread (see render_thread.h) so that
+    // frames keep coming while this thread is stuck in a modal loop
+    // (window dragged or resized, about box opened...)
+    g_render_thread.start();
+
+    // This thread only handles messages and the status text, 60Hz is plenty
+    Frame_pacer pacer(Pacing::FIXED_HZ, 60.0);
+    loop.set_pacer(&pacer);
 
+    // Handle every pending message before each frame (not just one) so that
+    // a burst of input doesn't add one frame of latency per message.
+    loop.set_batched(true);
+
+    // "-startup_bench": quit as soon as the first frame is presented and
+    // the background resources are loaded, append the phase timings to
+    // startup.log. Run it right after a reboot (cold start: DLLs and
+    // resources not in the file cache) then again (warm start).
+    const bool startup_bench = wcsstr(lpCmdLine, L"-startup_bench") != nullptr;
+
+    startup_mark("loop ready");
+
+    // Per frame work of the UI thread, called once per iteration of the loop:
+    loop.set_frame_callback([&backend, startup_bench]() -> bool
+    {
+        // Icons and accelerators, as soon as the background thread is done
+        bool resources_applied = apply_resources(backend);
+        if (startup_bench && resources_applied && g_render_thread.latest().frame > 0) {
+            return false;
+        }
+        g_windows.for_each_open([](Window_state& window)
+        {
+            // Hand the status text to the render thread, which draws it at
+            // the bottom of the window: at most once per frame and only if
+            // it changed since last time. No SetWindowText(), a cross
+            // process call to the window manager.
+            window.status.flush([](void* target, const char* text) {
+                g_render_thread.publish_status(*(Window_state*)target, text);
+            }, &window);
+        });
+        // Break if user presses escape key.
+        // The render thread reads the keyboard state (see
+        // Render_thread::render_frame()) and tells us through the latest
+        // Frame_state, reading it never blocks.
+        return !g_render_thread.latest().quit;
+    });
+
+    int exit_code = loop.run();
+    recorder.close();
+
+    g_render_thread.stop();
+    g_capture.close();
+    report_startup(startup_bench);
+    report_pacing(g_render_thread.pacing_stats(), loop.stats());
+    report_frame_memory(g_render_thread.stats().arena);
+    report_text(g_render_thread.stats().text, g_render_thread.stats().atlas);
+    report_raw_input();
+    report_latency();
+    report_streaming();
+    report_capture();
+    g_streamer.reset();
+    if (tracing) {
+        export_trace();
     }
 
-    UnregisterClassW(szWindowClass, hInstance);
+    UnregisterClassW(g_window_class, hInstance);
 
-    // When message == WM_QUIT then msg.wParam contains the value 
-    // past to PostQuitMessage(value) which should be our exist value.
-    return (int)msg.wParam;
+    // exit_code is the value past to PostQuitMessage(value)
+    return exit_code;
 }
 
 // ****************************************************************************
@@ -232,7 +398,8 @@ int APIENTRY wWinMain(
 // This happens to be the identifier RegisterClassExW() returns.
 ATOM register_class(HINSTANCE hInstance)
 {
-    LoadStringW(hInstance, IDC_MAINWIN, szWindowClass, MAX_LOADSTRING);
+    static std::wstring class_name;
+    g_window_class = load_string(hInstance, IDC_MAINWIN, class_name);
 
     // About the postfix: 'EX', 'W', or 'A' in functions structures etc.
     // - 'EX' means 'extended' and is for newer version of the same function 
@@ -260,7 +427,11 @@ ATOM register_class(HINSTANCE hInstance)
 
     // Note: You may want to add 'CS_OWNDC' to support multiple windows when 
     // you draw with 'GDI'. (DC= Device Context)
-    wcex.style = CS_HREDRAW | CS_VREDRAW;
+    //
+    // We use neither: the whole client area would be invalidated on every
+    // size change. The renderer already knows a resize damages everything
+    // and otherwise only repaints what changed (see damage_region.h).
+    wcex.style = 0;
 
 
     // Pass on the callback in charge of handling events (mouse, keyboard, 
@@ -282,7 +453,11 @@ ATOM register_class(HINSTANCE hInstance)
 
     // Application icon
     // wcex.hIcon = NULL uses default icon
-    wcex.hIcon = LoadIcon(hInstance, MAKEINTRESOURCE(IDI_MAINWIN));
+    // We don't load it here: it's not needed to show the first frame.
+    // It is loaded by a background thread (see register_resources()) then
+    // attached to the windows with WM_SETICON (see apply_resources())
+    wcex.hIcon = NULL;
+    //wcex.hIcon = LoadIcon(hInstance, MAKEINTRESOURCE(IDI_MAINWIN));
     //alternative syntax :
     //wcex.hIcon = (HICON)LoadImage(hInstance, MAKEINTRESOURCE(IDI_MAINWIN), IMAGE_ICON, LR_DEFAULTSIZE, LR_DEFAULTSIZE, LR_DEFAULTCOLOR | LR_SHARED);
     //wcex.hIcon = (HICON)LoadImage(hInstance, MAKEINTRESOURCE(IDI_MAINWIN), IMAGE_ICON, 16, 16, 0);
@@ -321,11 +496,12 @@ ATOM register_class(HINSTANCE hInstance)
     
     // String of the name of our window class, this will serve as an identifier
     // of our this specific Class when using other API functions.
-    wcex.lpszClassName = szWindowClass;
+    wcex.lpszClassName = g_window_class;
 
     // Small Icon,
     // If set to null search for a small icon in wcex.hIcon
-    wcex.hIconSm = LoadIcon(wcex.hInstance, MAKEINTRESOURCE(IDI_SMALL));
+    // (loaded in the background as well)
+    wcex.hIconSm = NULL;
 
     return RegisterClassExW(&wcex);
 }
@@ -333,23 +509,169 @@ ATOM register_class(HINSTANCE hInstance)
 // ****************************************************************************
 
 //
-//   FUNCTION: init_instance(HINSTANCE, int)
+//  FUNCTION: register_resources(HINSTANCE)
+//
+//  PURPOSE: List the resources that can be loaded after the first frame.
+//  Nothing is loaded here, see Resource_cache.
+//
+void register_resources(HINSTANCE hInstance)
+{
+    // We first look into resources.pack, the resources embedded in the
+    // executable (main_win_rsc.rc) are the fallback when the pack is missing.
+    // Either way the handles live as long as the process, no need for a
+    // Free_fn.
+    g_resources.add(RES_ICON, [hInstance]() -> void* {
+        if (HICON icon = create_icon_from_ico(g_pack.find(Pack_type::ICON, IDI_MAINWIN), GetSystemMetrics(SM_CXICON))) {
+            return icon;
+        }
+        return LoadIcon(hInstance, MAKEINTRESOURCE(IDI_MAINWIN));
+    }, Load_policy::BACKGROUND);
+
+    g_resources.add(RES_ICON_SMALL, [hInstance]() -> void* {
+        if (HICON icon = create_icon_from_ico(g_pack.find(Pack_type::ICON, IDI_SMALL), GetSystemMetrics(SM_CXSMICON))) {
+            return icon;
+        }
+        return LoadIcon(hInstance, MAKEINTRESOURCE(IDI_SMALL));
+    }, Load_policy::BACKGROUND);
+
+    g_resources.add(RES_ACCELERATORS, [hInstance]() -> void* {
+        std::size_t count = 0;
+        if (const Pack_accel* table = g_pack.accelerators(IDC_MAINWIN, &count)) {
+            // Pack_accel has the layout of ACCEL: no conversion
+            return CreateAcceleratorTableW((LPACCEL)table, int(count));
+        }
+        return LoadAccelerators(hInstance, MAKEINTRESOURCE(IDC_MAINWIN));
+    }, Load_policy::BACKGROUND);
+}
+
+// ****************************************************************************
+
+//
+//  FUNCTION: open_resource_pack()
+//
+//  PURPOSE: Map resources.pack, built next to the executable from
+//  main_win_rsc.rc by tools/make_resource_pack.py (pre-build event)
+//
+void open_resource_pack()
+{
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(NULL, path, MAX_PATH);
+    if (length == 0 || length >= MAX_PATH) {
+        return;
+    }
+    // Replace "basic_window.exe" by "resources.pack"
+    char* slash = strrchr(path, '\\');
+    char* name = slash ? slash + 1 : path;
+    strcpy_s(name, MAX_PATH - (name - path), "resources.pack");
+    g_pack.open(path);
+}
+
+// ****************************************************************************
+
+//
+//  FUNCTION: load_string(HINSTANCE, UINT, std::wstring&)
+//
+//  PURPOSE: String 'id' of the string table, of any length.
+//
+//  COMMENTS:
+//
+//        From resources.pack we get a pointer into the mapped file (no copy).
+//        Otherwise LoadStringW() with a buffer size of 0 gives a read only
+//        pointer to the resource, which isn't NUL terminated: we copy it to
+//        'storage'. In both cases there is no fixed size buffer to truncate
+//        the string.
+//
+const WCHAR* load_string(HINSTANCE hInstance, UINT id, std::wstring& storage)
+{
+    if (const char16_t* s = g_pack.string_utf16(id)) {
+        return (const WCHAR*)s;
+    }
+    const WCHAR* resource = nullptr;
+    int length = LoadStringW(hInstance, id, (LPWSTR)&resource, 0);
+    storage.assign(resource ? resource : L"", resource ? length : 0);
+    return storage.c_str();
+}
+
+// ****************************************************************************
+
+//
+//  FUNCTION: apply_resources(Backend_win32&)
+//
+//  PURPOSE: Hand the background loaded resources to the windows and the
+//  message loop. Called every frame by the UI thread, does nothing once
+//  done.
+//
+//  RETURN: true once everything is applied
+//
+bool apply_resources(Backend_win32& backend)
+{
+    static bool applied = false;
+    if (applied || !g_resources.background_done()) {
+        return applied;
+    }
+    HICON icon = (HICON)g_resources.try_get(RES_ICON);
+    HICON icon_small = (HICON)g_resources.try_get(RES_ICON_SMALL);
+    g_windows.for_each_open([&](Window_state& window)
+    {
+        // ICON_BIG: Alt+Tab and the taskbar, ICON_SMALL: the title bar
+        SendMessage(window.hwnd, WM_SETICON, ICON_BIG, (LPARAM)icon);
+        SendMessage(window.hwnd, WM_SETICON, ICON_SMALL, (LPARAM)icon_small);
+    });
+    backend.set_accelerators((HACCEL)g_resources.try_get(RES_ACCELERATORS));
+    applied = true;
+    return true;
+}
+
+// ****************************************************************************
+
+//
+//   FUNCTION: init_instance(HINSTANCE, int, int)
 //
-//   PURPOSE: Saves instance handle and creates main window
+//   PURPOSE: Creates and displays the program windows
 //
 //   COMMENTS:
 //
-//        In this function, we save the instance handle in a global variable 
-//        and create and display the main program window.
+//        All windows are instances of the same class (see register_class())
+//        and are served by the same message loop. Each one gets its own
+//        Window_state (see window_manager.h)
+//
+bool init_instance(HINSTANCE hInstance, int nCmdShow, int window_count)
+{
+    static std::wstring title;
+    g_title = load_string(hInstance, IDS_APP_TITLE, title);
+
+    for (int i = 0; i < window_count; ++i)
+    {
+        // The state is allocated first so that the window procedure can
+        // find it from the very first message (see WM_NCCREATE)
+        Window_state* state = g_windows.allocate();
+        if (!create_window(hInstance, state, nCmdShow)) {
+            g_windows.cancel(state);
+            // Only failing to create the main window is fatal
+            return i > 0;
+        }
+    }
+    return true;
+}
+
+// ****************************************************************************
+
+//
+//   FUNCTION: create_window(HINSTANCE, Window_state*, int)
 //
-bool init_instance(HINSTANCE hInstance, int nCmdShow)
+//   PURPOSE: Creates and displays one window and its renderer
+//
+bool create_window(HINSTANCE hInstance, Window_state* state, int nCmdShow)
 {
-    LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);
+    std::wstring title = g_title;
+    if (state->index > 0) {
+        title += L" #" + std::to_wstring(state->index + 1);
+    }
 
     // HWND = handle Window
     HWND handle_window = CreateWindowW(
-        szWindowClass, // String of the Class name
-        szTitle,       // Window main title
+        g_window_class,// String of the Class name
+        title.c_str(), // Window main title
 
         // bitflags for the window style
         // https://docs.microsoft.com/en-us/windows/win32/winmsg/window-styles
@@ -366,7 +688,9 @@ bool init_instance(HINSTANCE hInstance, int nCmdShow)
 
         // LPVOID lpParam: a pointer to some data you created, it will be then 
         // passed to the lpParam of the window procedure.
-        nullptr);      
+        // We give the Window_state of this window, event_handler() stores
+        // it in the GWLP_USERDATA slot of the window on WM_NCCREATE.
+        state);
 
     /*
         How to use the lpParam of CreateWindow():
@@ -397,6 +721,16 @@ bool init_instance(HINSTANCE hInstance, int nCmdShow)
     {
         return false;
     }
+    g_windows.on_created(state, handle_window);
+
+    // Direct3D 11 when a GPU is available, CPU rendering otherwise.
+    RECT client;
+    GetClientRect(handle_window, &client);
+    state->renderer = create_best_renderer(handle_window, client.right - client.left, client.bottom - client.top,
+                                           g_present_mode);
+    // Only one window waits for the vertical blank, otherwise N windows
+    // would divide the frame rate by N.
+    state->renderer->set_vsync(state->index == 0);
 
     ShowWindow(handle_window, nCmdShow);
     UpdateWindow(handle_window);
@@ -413,7 +747,7 @@ bool init_instance(HINSTANCE hInstance, int nCmdShow)
 //  PURPOSE: Processes messages for the main window.
 //
 //  WM_COMMAND  - process the application menu
-//  WM_PAINT    - Paint the main window
+//  WM_PAINT    - Ask the render thread to paint the main window
 //  WM_DESTROY  - post a quit message and return
 //
 //
@@ -431,84 +765,33 @@ LRESULT CALLBACK event_handler(
     // (you'll have to look it up in the MSDN doc)
     WPARAM wParam, LPARAM lParam)
 {
-    switch (message)
-    {
-        // WM_COMMAND is triggered when the user select a menu item such as 
-        // 'about' or 'exists' here; or on control (buttons etc.) selection.
-        // int type = HIWORD(wParam):
-        //     - type == 0 -> menu
-        //     - type == 1 -> accelerator
-        //     - type == other -> control (Control-defined notification code)
-
-        // int id = LOWORD(wParam):
-        //     - type == menu: Menu identifier (IDM_*)
-        //     - type == Accelerator: Accelerator identifier (IDM_*)
-        //     - type == Control: Control identifier
-        // https://docs.microsoft.com/en-us/windows/win32/menurc/wm-command
-        
-        case WM_COMMAND: 
-        {
-            // Extract the first 16 bits
-            int wmId = LOWORD(wParam);
-            // Parse the menu selections:
-            switch (wmId)
-            {
-            case IDM_ABOUT:
-                DialogBox(GetModuleHandle(nullptr), MAKEINTRESOURCE(IDD_ABOUTBOX), hWnd, about_callback);
-                return 0;                
-            case IDM_EXIT:
-                DestroyWindow(hWnd);
-                return 0;                         
-            }
-        }break;
-#if 0
-        case WM_PAINT:
-        {
-            PAINTSTRUCT ps;
-            HDC hdc = BeginPaint(hWnd, &ps);
-            // When not using direct3D this is where the window painting
-            // is executed.
-            EndPaint(hWnd, &ps);
-        }
-        break;
-#endif
-        case WM_DESTROY: 
-        {
-            // Push the WM_QUIT message (this will allows us to quit the main
-            // loop)
-            PostQuitMessage(0);
-            // DefWindowProc() will destroy the window itself on WM_DESTROY
-            // by calling DestroyWindow() 
-        }break;
-        case WM_KEYDOWN:
-        {
-            // Note: agnostic to character case (lower or upper case)
-            // You must check for num keys as well
-            if (wParam == 'F') {
-                SetWindowText(hWnd, L"F pressed");
-            }
+    // Time spent handling each kind of message (only with "-trace")
+    PROFILE_MESSAGE(message);
+
+    // WM_NCCREATE is the first message that carries the lpParam given to
+    // CreateWindow(): attach our Window_state to the HWND.
+    // (a few messages such as WM_GETMINMAXINFO can arrive even before)
+    if (message == WM_NCCREATE) {
+        Window_manager::on_nccreate(hWnd, lParam);
+    }
 
-        }break;
-#if 0
-        // Get the case sensitive ASCII character
-        case WM_CHAR:
-        {
-            std::string str;
-            str.push_back((char)(wParam));
+    // O(1) lookup through GWLP_USERDATA
+    Window_state* window = g_windows.from_hwnd(hWnd);
+    if (!window) {
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    }
 
-            char t[2] = { (char)(wParam), '\0' };
-            
-            SetWindowTextA(hWnd, /*str.c_str()*/t );
-        }break;
-#endif
-        case WM_LBUTTONDOWN:
-        {
-            POINTS p = MAKEPOINTS(lParam);
-            std::string str = "Left mouse button down. ";
-            str += " x: " + std::to_string(p.x);
-            str += " y: " + std::to_string(p.y);
-            SetWindowTextA(hWnd, str.c_str() );
-        }break;
+    // Forward keyboard / mouse messages (to keep track of the input state)
+    // and size changes (the back buffer is resized at the end of the frame)
+    // to the render thread. Never blocks, even during a modal loop.
+    g_render_thread.post(*window, message, wParam, lParam, GetMessageTime());
+
+    // Look up the handler of the message in a table built at compile time
+    // (see g_message_table at the top of this file) instead of a switch.
+    Message msg = { hWnd, message, wParam, lParam, window };
+    LRESULT result = 0;
+    if (g_message_table.dispatch(message, msg, result)) {
+        return result;
     }
 
     // Calls the default window procedure to provide default processing for any 
@@ -521,6 +804,135 @@ LRESULT CALLBACK event_handler(
 
 // ****************************************************************************
 
+// WM_COMMAND is triggered when the user select a menu item such as 
+// 'about' or 'exists' here; or on control (buttons etc.) selection.
+// int type = HIWORD(wParam):
+//     - type == 0 -> menu
+//     - type == 1 -> accelerator
+//     - type == other -> control (Control-defined notification code)
+
+// int id = LOWORD(wParam):
+//     - type == menu: Menu identifier (IDM_*)
+//     - type == Accelerator: Accelerator identifier (IDM_*)
+//     - type == Control: Control identifier
+// https://docs.microsoft.com/en-us/windows/win32/menurc/wm-command
+bool on_command(const Message& msg, LRESULT& result)
+{
+    // Extract the first 16 bits and parse the menu selections
+    // (see g_command_table)
+    return g_command_table.dispatch(LOWORD(msg.wParam), msg, result);
+}
+
+// ****************************************************************************
+
+bool on_about(const Message& msg, LRESULT& result)
+{
+    DialogBox(GetModuleHandle(nullptr), MAKEINTRESOURCE(IDD_ABOUTBOX), msg.hwnd, about_callback);
+    result = 0;
+    return true;
+}
+
+// ****************************************************************************
+
+bool on_exit(const Message& msg, LRESULT& result)
+{
+    DestroyWindow(msg.hwnd);
+    result = 0;
+    return true;
+}
+
+// ****************************************************************************
+
+bool on_destroy(const Message& msg, LRESULT& result)
+{
+    UNREFERENCED_PARAMETER(result);
+    // The render thread must let go of the swap chain first
+    g_render_thread.close_window(*msg.window);
+    // Push the WM_QUIT message (this will allows us to quit the main
+    // loop) once the last window is closed.
+    if (g_windows.on_destroy(msg.hwnd) == 0) {
+        PostQuitMessage(0);
+    }
+    // DefWindowProc() will destroy the window itself on WM_DESTROY
+    // by calling DestroyWindow() 
+    return false;
+}
+
+// ****************************************************************************
+
+bool on_key_down(const Message& msg, LRESULT& result)
+{
+    UNREFERENCED_PARAMETER(result);
+    // Note: agnostic to character case (lower or upper case)
+    // You must check for num keys as well
+    if (msg.wParam == 'F') {
+        msg.window->status.set("F pressed");
+    }
+    return false;
+}
+
+// ****************************************************************************
+
+// A swap chain is composited by DWM: the default processing (BeginPaint() /
+// EndPaint()) validates the window. The software renderer blits to the
+// window from the render thread instead (Renderer_software::blit_to_window()):
+// ask for a frame, it blits the whole front buffer and validates the update
+// region once it is painted. Validating here would leave garbage on screen.
+// Until that frame Windows keeps sending WM_PAINT whenever the queue is
+// empty, each one only sets the redraw flag again.
+bool on_paint(const Message& msg, LRESULT& result)
+{
+    if (!msg.window->renderer || !msg.window->renderer->paints_window()) {
+        return false;
+    }
+    g_render_thread.request_redraw();
+    result = 0;
+    return true;
+}
+
+// ****************************************************************************
+
+#if 0
+// Get the case sensitive ASCII character
+// (add { WM_CHAR, on_char } to g_window_handlers)
+bool on_char(const Message& msg, LRESULT& result)
+{
+    msg.window->status.begin().append((char)(msg.wParam));
+    return false;
+}
+#endif
+
+// ****************************************************************************
+
+// A mouse report. Read it and every report queued behind it in one go
+// (see raw_input.h), the render thread gets them with the next frame.
+bool on_input(const Message& msg, LRESULT& result)
+{
+    UNREFERENCED_PARAMETER(result);
+    raw_input_read((HRAWINPUT)msg.lParam, msg.window->mouse_history);
+    // DefWindowProc() must still see WM_INPUT (it releases the report)
+    return false;
+}
+
+// ****************************************************************************
+
+bool on_left_button_down(const Message& msg, LRESULT& result)
+{
+    UNREFERENCED_PARAMETER(result);
+    POINTS p = MAKEPOINTS(msg.lParam);
+    // The text is only handed to the render thread once per frame
+    // (see status.flush() in the frame callback)
+    // Status_text::begin() returns a fixed size buffer, building the
+    // string doesn't allocate memory contrary to std::string.
+    msg.window->status.begin()
+        .append("Left mouse button down. ")
+        .append(" x: ").append(p.x)
+        .append(" y: ").append(p.y);
+    return false;
+}
+
+// ****************************************************************************
+
 // Message handler for about box.
 INT_PTR CALLBACK about_callback(HWND hDlg, 
                                 UINT message, 
@@ -545,3 +957,262 @@ INT_PTR CALLBACK about_callback(HWND hDlg,
 }
 
 // ****************************************************************************
+
+//
+//  FUNCTION: parse_pacing(LPCWSTR)
+//
+//  PURPOSE: Build the frame pacer according to the command line
+//
+//  -uncapped  : busy loop, a frame every iteration (100% of a core)
+//  -on_demand : only redraw after an input, sleep otherwise
+//  -hz <N>    : N frames per seconds, sleep in between (default 60)
+//
+Frame_pacer parse_pacing(LPCWSTR command_line)
+{
+    if (wcsstr(command_line, L"-uncapped")) {
+        return Frame_pacer(Pacing::UNCAPPED);
+    }
+    if (wcsstr(command_line, L"-on_demand")) {
+        return Frame_pacer(Pacing::ON_DEMAND);
+    }
+    double hz = 60.0;
+    if (LPCWSTR arg = wcsstr(command_line, L"-hz ")) {
+        hz = _wtof(arg + 4);
+    }
+    return Frame_pacer(Pacing::FIXED_HZ, hz > 0.0 ? hz : 60.0);
+}
+
+// ****************************************************************************
+
+// Print frame time jitter, CPU usage and input latency to the debugger
+// output window (Visual Studio 'Output' tab, or a tool like DebugView)
+void report_pacing(const Pacing_stats& stats, const Loop_stats& loop)
+{
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "frames: %llu, frame time: %.3f ms, jitter: %.3f ms, max: %.3f ms, cpu: %.1f%%\n",
+             (unsigned long long)stats.frames, stats.mean_frame_ms,
+             stats.jitter_ms, stats.max_frame_ms, stats.cpu_usage * 100.0);
+    OutputDebugStringA(buffer);
+    snprintf(buffer, sizeof(buffer),
+             "messages: %llu (coalesced %llu), input latency: %.2f ms (max %.0f ms)\n",
+             (unsigned long long)loop.messages, (unsigned long long)loop.coalesced,
+             loop.mean_latency_ms(), loop.latency_max_ms);
+    OutputDebugStringA(buffer);
+}
+
+// ****************************************************************************
+
+// Per-frame allocations of the render thread (see frame_arena.h). Once the
+// arena is large enough 'heap' stops growing: frames don't touch the heap.
+void report_frame_memory(const Arena_stats& stats)
+{
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "frame arena: %llu allocations, high water %zu / %zu bytes, overflows: %llu, heap blocks: %llu\n",
+             (unsigned long long)stats.allocations, stats.high_water, stats.capacity,
+             (unsigned long long)stats.overflows, (unsigned long long)stats.heap_allocations);
+    OutputDebugStringA(buffer);
+}
+
+// ****************************************************************************
+
+// Status overlay (see text_renderer.h): once the strings and glyphs are
+// cached, nearly every lookup should be a hit.
+void report_text(const Text_stats& text, const Atlas_stats& atlas)
+{
+    const uint64_t lookups = atlas.hits + atlas.misses;
+    const uint64_t strings = text.layout_hits + text.layout_misses;
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "text: %llu strings (%.1f%% layout hits), %llu glyphs, atlas: %.1f%% hits, %zu glyphs, %llu evictions\n",
+             (unsigned long long)text.strings,
+             strings ? 100.0 * double(text.layout_hits) / double(strings) : 0.0,
+             (unsigned long long)text.glyphs,
+             lookups ? 100.0 * double(atlas.hits) / double(lookups) : 0.0,
+             atlas.glyphs, (unsigned long long)atlas.evictions);
+    OutputDebugStringA(buffer);
+}
+
+// ****************************************************************************
+
+// Raw mouse samples per window (see raw_input.h): how many the frames saw
+// and whether the render thread kept up.
+void report_raw_input()
+{
+    for (std::size_t i = 0; i < g_windows.size(); ++i)
+    {
+        const Mouse_history_stats stats = g_windows[i].mouse_history.stats();
+        if (stats.samples == 0) {
+            continue;
+        }
+        char buffer[192];
+        snprintf(buffer, sizeof(buffer),
+                 "window %zu raw mouse: %llu samples, %llu dropped, up to %zu per frame\n",
+                 i + 1, (unsigned long long)stats.samples, (unsigned long long)stats.dropped,
+                 stats.max_per_frame);
+        OutputDebugStringA(buffer);
+    }
+}
+
+// ****************************************************************************
+
+// Input to present latency per window (see latency_tracker.h): how old the
+// input shown by a frame is when the frame is handed to the display.
+void report_latency()
+{
+    for (std::size_t i = 0; i < g_windows.size(); ++i)
+    {
+        const Latency_stats stats = g_windows[i].latency.stats();
+        if (stats.inputs == 0) {
+            continue;
+        }
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+                 "window %zu input to present (%s): p50 %.1f ms, p99 %.1f ms, max %.1f ms, "
+                 "%llu inputs over %llu frames\n",
+                 i + 1, g_present_mode == Present_mode::WAITABLE ? "waitable" : "queued",
+                 stats.present_p50_ms, stats.present_p99_ms, stats.present_max_ms,
+                 (unsigned long long)stats.inputs, (unsigned long long)stats.frames);
+        OutputDebugStringA(buffer);
+    }
+}
+
+// ****************************************************************************
+
+//
+//  FUNCTION: stream_assets(LPCWSTR)
+//
+//  PURPOSE: "-stream <file>" (or "-stream "<file>"" with spaces): stream the
+//           file in the background. Nothing draws it yet: the upload only
+//           reads the bytes, report_streaming() tells how it went.
+//
+void stream_assets(LPCWSTR command_line)
+{
+    LPCWSTR arg = wcsstr(command_line, L"-stream ");
+    if (!arg) {
+        return;
+    }
+    arg += 8;
+    while (*arg == L' ') {
+        arg++;
+    }
+    const WCHAR stop = *arg == L'"' ? L'"' : L' ';
+    if (stop == L'"') {
+        arg++;
+    }
+    LPCWSTR end = arg;
+    while (*end && *end != stop) {
+        end++;
+    }
+    // Mapped_file opens it with CreateFileA()
+    char path[MAX_PATH];
+    const int length = WideCharToMultiByte(CP_ACP, 0, arg, int(end - arg), path, MAX_PATH - 1, nullptr, nullptr);
+    if (length <= 0) {
+        return;
+    }
+    path[length] = 0;
+    g_streamer->request(path, Stream_priority::NORMAL,
+        [](const Stream_asset& asset, std::size_t offset, std::size_t size) {
+            // Where a texture upload would copy the slice
+            volatile uint8_t sink = 0;
+            for (std::size_t i = offset; i < offset + size; i += 4096) {
+                sink = sink ^ asset.data[i];
+            }
+        });
+}
+
+// ****************************************************************************
+
+void report_streaming()
+{
+    const Stream_stats stats = g_streamer->stats();
+    if (stats.requests == 0) {
+        return;
+    }
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "streaming: %llu assets (%llu failed, %llu cancelled), %.1f MB read in %.2f s, "
+             "decode %.2f s, longest upload %.2f ms\n",
+             (unsigned long long)stats.completed, (unsigned long long)stats.failed,
+             (unsigned long long)stats.cancelled, double(stats.bytes_read) / (1024.0 * 1024.0),
+             stats.read_seconds, stats.decode_seconds, stats.max_pump_ms);
+    OutputDebugStringA(buffer);
+}
+
+// ****************************************************************************
+
+void report_capture()
+{
+    const Capture_stats& stats = g_capture.stats();
+    if (stats.captured == 0) {
+        return;
+    }
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "capture: %llu frames (%llu skipped, %llu dropped), %.1f MB, %.1f%% of the pixels copied, "
+             "%.3f ms per frame (max %.3f ms)\n",
+             (unsigned long long)stats.captured, (unsigned long long)stats.skipped,
+             (unsigned long long)stats.dropped, double(stats.file_bytes) / (1024.0 * 1024.0),
+             100.0 * double(stats.copied_pixels) / double(stats.frame_pixels),
+             stats.copy_seconds * 1000.0 / double(stats.captured), stats.max_copy_ms);
+    OutputDebugStringA(buffer);
+}
+
+// ****************************************************************************
+
+// Write the recorded zones to trace.json (open it with chrome://tracing
+// or https://ui.perfetto.dev) and print the cost of a zone.
+void export_trace()
+{
+    profiler_set_enabled(false);
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "profiler: %.1f ns per zone, trace.json %s\n",
+             profiler_zone_overhead_ns(),
+             profiler_export_chrome_trace("trace.json") ? "written" : "could not be written");
+    OutputDebugStringA(buffer);
+}
+
+// ****************************************************************************
+
+// Startup_print_fn to the debugger output window, and to a FILE* if any
+void print_startup_line(const char* text, void* file)
+{
+    OutputDebugStringA(text);
+    if (file) {
+        fputs(text, (FILE*)file);
+    }
+}
+
+// Print the duration of every startup phase (see startup_timer.h)
+// With 'append_to_file' the report is also added to startup.log
+void report_startup(bool append_to_file)
+{
+    FILE* file = nullptr;
+    if (append_to_file) {
+        fopen_s(&file, "startup.log", "a");
+    }
+    startup_report(print_startup_line, file);
+    if (file) {
+        fputs("\n", file);
+        fclose(file);
+    }
+}
+
+// ****************************************************************************
+
+//
+//  FUNCTION: parse_window_count(LPCWSTR)
+//
+//  PURPOSE: number of windows to open: "-windows <N>" (default is 1)
+//
+int parse_window_count(LPCWSTR command_line)
+{
+    if (LPCWSTR arg = wcsstr(command_line, L"-windows ")) {
+        int count = _wtoi(arg + 9);
+        return count > 0 ? count : 1;
+    }
+    return 1;
+}
+
+// ****************************************************************************
@@ -0,0 +1,112 @@
+#include "window_manager.h"
+
+// ****************************************************************************
+
+Window_manager::~Window_manager()
+{
+#ifdef _WIN32
+    // Windows still alive would keep a dangling pointer in GWLP_USERDATA
+    for (std::unique_ptr<Window_state>& w : _windows) {
+        if (!_headless && !w->closed && w->hwnd) {
+            SetWindowLongPtr(w->hwnd, GWLP_USERDATA, 0);
+        }
+    }
+#endif
+}
+
+// ****************************************************************************
+
+Window_state* Window_manager::allocate()
+{
+    _windows.emplace_back(new Window_state());
+    Window_state* state = _windows.back().get();
+    state->index = int(_windows.size()) - 1;
+    return state;
+}
+
+// ****************************************************************************
+
+void Window_manager::on_created(Window_state* state, HWND hwnd)
+{
+    // on_nccreate() already set it, but a window procedure that doesn't
+    // call on_nccreate() would leave it NULL.
+    state->hwnd = hwnd;
+    _open++;
+}
+
+// ****************************************************************************
+
+void Window_manager::cancel(Window_state* state)
+{
+    // Only the last allocated state can be cancelled (indices must stay
+    // valid for the headless handles)
+    if (!_windows.empty() && _windows.back().get() == state) {
+        _windows.pop_back();
+    }
+}
+
+// ****************************************************************************
+
+#ifdef _WIN32
+
+void Window_manager::on_nccreate(HWND hwnd, LPARAM lParam)
+{
+    CREATESTRUCT* cs = (CREATESTRUCT*)lParam;
+    Window_state* state = (Window_state*)cs->lpCreateParams;
+    if (!state) {
+        return;
+    }
+    state->hwnd = hwnd;
+    // Every window has a pointer sized slot for the application
+    SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)state);
+}
+
+#endif
+
+// ****************************************************************************
+
+Window_state* Window_manager::create_headless(int width, int height)
+{
+    Window_state* state = allocate();
+    // Fake handle: index + 1 (so that NULL stays invalid)
+    state->hwnd = (HWND)(uintptr_t)(state->index + 1);
+    state->renderer = create_renderer(Renderer_type::SOFTWARE);
+    state->renderer->init(nullptr, width, height);
+    on_created(state, state->hwnd);
+    return state;
+}
+
+// ****************************************************************************
+
+Window_state* Window_manager::from_hwnd(HWND hwnd) const
+{
+    if (!hwnd) {
+        return nullptr;
+    }
+    if (_headless) {
+        std::size_t i = (std::size_t)(uintptr_t)hwnd - 1;
+        return i < _windows.size() ? _windows[i].get() : nullptr;
+    }
+#ifdef _WIN32
+    return (Window_state*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+#else
+    return nullptr;
+#endif
+}
+
+// ****************************************************************************
+
+std::size_t Window_manager::on_destroy(HWND hwnd)
+{
+    Window_state* state = from_hwnd(hwnd);
+    if (state && !state->closed) {
+        state->closed = true;
+        // Release the swap chain while the HWND is still valid
+        // (with a Render_thread, close_window() already did it)
+        if (state->renderer) {
+            state->renderer.reset();
+        }
+        _open--;
+    }
+    return _open;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+// Several windows of the same class served by a single message pump.
+//
+// Every window owns a Window_state (input, status text, renderer...). With
+// Win32 the pointer travels through CreateWindow()'s lpParam:
+// - CreateWindowW(..., lpParam = state)
+// - on WM_NCCREATE (the very first message that carries it) we read
+//   CREATESTRUCT::lpCreateParams and store it in the window's
+//   GWLP_USERDATA slot
+// - from then on window_from_hwnd() is a single GetWindowLongPtr(): O(1)
+//   whatever the number of windows.
+//
+// Without Win32 (headless backend) handles are fake: the index of the
+// window plus one, decoded just as fast.
+
+#include "platform.h"
+#include "damage_region.h"
+#include "input_state.h"
+#include "latency_tracker.h"
+#include "raw_input.h"
+#include "renderer.h"
+#include "resize_manager.h"
+#include "status_text.h"
+#include "triple_buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// ****************************************************************************
+
+struct Window_state {
+    HWND hwnd = NULL;
+    int index = 0;               ///< creation order, 0 is the main window
+    Input_state input = {};      ///< keyboard / mouse snapshot
+    Mouse_history mouse_history; ///< every raw mouse sample, see raw_input.h
+    Status_text status;          ///< pending status text
+    /// Latest status published by the UI thread, drawn by the render thread
+    Triple_buffer<Status_text::Buffer> overlay;
+    Resize_manager resize;       ///< debounced back buffer resizing
+    std::unique_ptr<Renderer> renderer; ///< Direct3D 11 or software fallback
+    bool closed = false;         ///< received WM_DESTROY
+    uint64_t atlas_version = 0;  ///< glyph atlas version given to 'renderer'
+    Latency_tracker latency;     ///< input to present, see latency_tracker.h
+    Damage_tracker damage;       ///< what changed since the last frame
+};
+
+// ****************************************************************************
+
+class Window_manager {
+public:
+    /// @param headless : create fake windows instead of Win32 ones
+    explicit Window_manager(bool headless = false) : _headless(headless) { }
+    ~Window_manager();
+
+    /// Allocate the state of a new window. Pass it as the lpParam of
+    /// CreateWindowW() then call on_created() (or cancel() on failure)
+    Window_state* allocate();
+    void on_created(Window_state* state, HWND hwnd);
+    void cancel(Window_state* state);
+
+#ifdef _WIN32
+    /// To be called on WM_NCCREATE from the window procedure: attach the
+    /// Window_state given to CreateWindowW() to the HWND.
+    static void on_nccreate(HWND hwnd, LPARAM lParam);
+#endif
+
+    /// Create a window without any window system (headless backend)
+    Window_state* create_headless(int width, int height);
+
+    /// O(1) lookup. Returns NULL for windows we didn't create, or before
+    /// WM_NCCREATE.
+    Window_state* from_hwnd(HWND hwnd) const;
+
+    /// Mark a window as closed (call on WM_DESTROY).
+    /// @return the number of windows still open
+    std::size_t on_destroy(HWND hwnd);
+
+    std::size_t size() const { return _windows.size(); }
+    std::size_t open_count() const { return _open; }
+    Window_state& operator[](std::size_t i) { return *_windows[i]; }
+
+    /// Call fn(Window_state&) for every open window
+    template<class Fn>
+    void for_each_open(Fn fn) {
+        for (std::unique_ptr<Window_state>& w : _windows) {
+            if (!w->closed) {
+                fn(*w);
+            }
+        }
+    }
+
+private:
+    bool _headless;
+    std::size_t _open = 0;
+    std::vector<std::unique_ptr<Window_state>> _windows;
+};
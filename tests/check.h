@@ -0,0 +1,16 @@
+#pragma once
+
+// CHECK(condition) for the headless tests: unlike assert() it stays in
+// optimized builds. On failure prints the condition and its location then
+// exits with 1, which is what ctest looks at.
+
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            std::exit(1); \
+        } \
+    } while (0)
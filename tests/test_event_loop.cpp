@@ -0,0 +1,67 @@
+// Event_loop on Backend_headless: every message reaches the window procedure
+// in order, WM_QUIT ends the loop with its exit code, the batched mode
+// coalesces redundant mouse moves and the frame callback can stop the loop.
+
+#include "event_loop.h"
+#include "backend_headless.h"
+#include "check.h"
+
+#include <vector>
+
+// ****************************************************************************
+
+int main()
+{
+    const std::vector<MSG> script = make_synthetic_stream(10000, nullptr, 1);
+
+    // One message per frame
+    {
+        std::vector<UINT> seen;
+        Backend_headless backend([&seen](HWND, UINT msg, WPARAM, LPARAM) -> LRESULT {
+            seen.push_back(msg);
+            return 0;
+        });
+        backend.post(script);
+        backend.post_quit(7);
+        Event_loop loop(backend);
+        CHECK(loop.run() == 7);
+        CHECK(seen.size() == script.size());
+        for (std::size_t i = 0; i < seen.size(); ++i) {
+            CHECK(seen[i] == script[i].message);
+        }
+        CHECK(loop.stats().messages == script.size());
+        CHECK(loop.stats().frames >= script.size());
+        CHECK(loop.stats().coalesced == 0);
+    }
+
+    // Batched: consecutive mouse moves fold into the last one
+    {
+        std::size_t moves = 0;
+        for (std::size_t i = 0; i < script.size(); ++i) {
+            moves += script[i].message == WM_MOUSEMOVE;
+        }
+        std::size_t seen = 0;
+        Backend_headless backend([&seen](HWND, UINT, WPARAM, LPARAM) -> LRESULT {
+            seen++;
+            return 0;
+        });
+        backend.post(script);
+        Event_loop loop(backend);
+        loop.set_batched(true);
+        CHECK(loop.run() == 0);
+        CHECK(loop.stats().coalesced > 0 && loop.stats().coalesced < moves);
+        CHECK(seen + loop.stats().coalesced == script.size());
+    }
+
+    // The frame callback stops the loop
+    {
+        Backend_headless backend([](HWND, UINT, WPARAM, LPARAM) -> LRESULT { return 0; });
+        backend.set_quit_when_empty(false);
+        int frames = 0;
+        Event_loop loop(backend);
+        loop.set_frame_callback([&frames]() { return ++frames < 100; });
+        CHECK(loop.run() == 0);
+        CHECK(frames == 100);
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Frames captured from the software renderer's present() (frame_capture.h)
+// decode back to exactly what the front buffer showed: with partial redraw
+// (only the damage is copied), with full redraws, and with one frame in 4.
+// Frames are read in order, then again seeking backward through the index
+// (chained index blocks), then from a copy without the trailer, as a crash
+// leaves it: by walking the records.
+
+#include "renderer_software.h"
+#include "frame_capture.h"
+#include "damage_region.h"
+#include "draw_list.h"
+#include "frame_arena.h"
+#include "check.h"
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+// ****************************************************************************
+
+namespace {
+
+const int WIDTH = 640;
+const int HEIGHT = 360;
+
+uint64_t hash(const uint32_t* pixels, std::size_t count)
+{
+    // FNV-1a
+    uint64_t h = 1469598103934665603ull;
+    for (std::size_t i = 0; i < count; ++i) {
+        h ^= pixels[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/// Check the frames of the capture at 'path' against what was shown
+void read_back(const char* path, std::size_t captured, std::map<uint64_t, uint64_t>& shown)
+{
+    Capture_reader reader;
+    CHECK(reader.open(path));
+    CHECK(reader.frames() == captured);
+    std::vector<uint32_t> pixels;
+    for (std::size_t i = 0; i < reader.frames(); ++i) {
+        CHECK(reader.read(i, pixels));
+        CHECK(pixels.size() == std::size_t(WIDTH) * HEIGHT);
+        CHECK(hash(pixels.data(), pixels.size()) == shown[reader.entry(i).frame]);
+    }
+    // Backward: every read starts over from a keyframe
+    for (std::size_t i = reader.frames(); i > 0; i = i > 13 ? i - 13 : 0) {
+        const std::size_t k = reader.seek(reader.entry(i - 1).time_us);
+        CHECK(reader.entry(k).time_us <= reader.entry(i - 1).time_us);
+        CHECK(reader.read(k, pixels));
+        CHECK(hash(pixels.data(), pixels.size()) == shown[reader.entry(k).frame]);
+    }
+}
+
+/// Copy of 'path' without its last 'cut' bytes
+bool truncated_copy(const char* path, const char* copy, long cut)
+{
+    FILE* in = std::fopen(path, "rb");
+    if (!in) {
+        return false;
+    }
+    std::vector<char> bytes;
+    char buffer[4096];
+    for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), in)) > 0; ) {
+        bytes.insert(bytes.end(), buffer, buffer + n);
+    }
+    std::fclose(in);
+    FILE* out = std::fopen(copy, "wb");
+    if (!out || bytes.size() < std::size_t(cut)) {
+        return false;
+    }
+    std::fwrite(bytes.data(), 1, bytes.size() - std::size_t(cut), out);
+    return std::fclose(out) == 0;
+}
+
+/// Capture 'frames' frames to 'path' and check every captured one
+void round_trip(bool partial, int every, int frames, const char* path)
+{
+    Renderer_software renderer;
+    renderer.init(nullptr, WIDTH, HEIGHT);
+    renderer.set_partial_redraw(partial);
+    Frame_capture capture;
+    CHECK(capture.open(path, every));
+    renderer.set_capture(&capture);
+
+    // Hash of the front buffer of every present(), by frame number
+    std::map<uint64_t, uint64_t> shown;
+    Frame_arena arena;
+    Damage_tracker tracker;
+    for (int f = 0; f < frames; ++f)
+    {
+        arena.begin_frame();
+        Draw_list list(arena.current(), 64);
+        // A moving crosshair, a status band changing width, a panel that
+        // comes and goes
+        const float x = float((f * 7) % WIDTH);
+        const float y = float((f * 3) % HEIGHT);
+        list.line(x - 12.0f, y, x + 12.0f, y, 1.0f, 0xC0FFFFFF);
+        list.line(x, y - 12.0f, x, y + 12.0f, 1.0f, 0xC0FFFFFF);
+        list.rect(x - 2.5f, y - 2.5f, 5.0f, 5.0f, 0xFFFFC040);
+        list.rect(6.0f, HEIGHT - 30.0f, 100.0f + float(f % 50), 22.0f, 0xA0000000);
+        if ((f / 40) % 2) {
+            list.rect(200.0f, 100.0f, 300.0f, 200.0f, 0xFF308050);
+        }
+        tracker.update(list, renderer.damage());
+        renderer.clear(0.1f, 0.2f, 0.3f);
+        renderer.submit(list);
+        renderer.present();
+        shown[uint64_t(f + 1)] = hash(renderer.front_pixels(), std::size_t(WIDTH) * HEIGHT);
+    }
+    renderer.set_capture(nullptr);
+    capture.close();
+
+    const Capture_stats& stats = capture.stats();
+    std::printf("%s, every %d: %llu captured, %llu dropped, %llu keyframes, %.1f%% of the pixels copied, %llu bytes\n",
+                partial ? "partial" : "full", every, (unsigned long long)stats.captured,
+                (unsigned long long)stats.dropped, (unsigned long long)stats.keyframes,
+                100.0 * double(stats.copied_pixels) / double(stats.frame_pixels),
+                (unsigned long long)stats.file_bytes);
+    CHECK(stats.captured + stats.dropped + stats.skipped == uint64_t(frames));
+
+    read_back(path, std::size_t(stats.captured), shown);
+
+    // The trailer is 24 bytes: without it the index blocks are skipped
+    const std::string copy = std::string(path) + ".cut";
+    CHECK(truncated_copy(path, copy.c_str(), 24));
+    read_back(copy.c_str(), std::size_t(stats.captured), shown);
+    std::remove(copy.c_str());
+    std::remove(path);
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    round_trip(true, 1, 300, "test_frame_capture_partial.wfc");
+    round_trip(false, 1, 60, "test_frame_capture_full.wfc");
+    round_trip(true, 4, 300, "test_frame_capture_every4.wfc");
+    return 0;
+}
@@ -0,0 +1,235 @@
+// Input log (input_log.h): varints and zigzag round trip, a stream recorded
+// through a batched Event_loop replays through Backend_replay with the very
+// same messages reaching the window procedure and the same coalescing, a log
+// cut short by a crash (a record cut in the middle, then zeros) stops at the
+// last whole record, and Replay_speed::RECORDED keeps the original timing
+// where MAXIMUM doesn't wait.
+
+#include "input_log.h"
+#include "event_loop.h"
+#include "backend_headless.h"
+#include "check.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Dispatched {
+    UINT message;
+    WPARAM wParam;
+    LPARAM lParam;
+
+    bool operator==(const Dispatched& d) const {
+        return message == d.message && wParam == d.wParam && lParam == d.lParam;
+    }
+};
+
+void varints()
+{
+    const uint64_t values[] = { 0, 1, 127, 128, 300, 16383, 16384, 0xFFFFFFFFull,
+                                1ull << 63, 0xFFFFFFFFFFFFFFFFull };
+    for (uint64_t v : values)
+    {
+        uint8_t bytes[10];
+        const std::size_t n = varint_encode(v, bytes);
+        CHECK(n >= 1 && n <= 10);
+        CHECK(n == 1 || v >= 0x80);
+        const uint8_t* p = bytes;
+        uint64_t back;
+        CHECK(varint_decode(p, bytes + n, back) && back == v && p == bytes + n);
+        // Truncated: the last byte is missing
+        p = bytes;
+        CHECK(n == 1 || !varint_decode(p, bytes + n - 1, back));
+    }
+    uint8_t bytes[10];
+    CHECK(varint_encode(0xFFFFFFFFFFFFFFFFull, bytes) == 10);
+
+    // Small magnitudes stay small, whatever their sign
+    CHECK(zigzag_encode(0) == 0 && zigzag_encode(-1) == 1 && zigzag_encode(1) == 2 && zigzag_encode(-2) == 3);
+    const int64_t signed_values[] = { 0, 1, -1, 63, -64, 1000000, -1000000, INT64_MAX, INT64_MIN };
+    for (int64_t v : signed_values) {
+        CHECK(zigzag_decode(zigzag_encode(v)) == v);
+    }
+}
+
+/// Run a batched loop over 'backend', recording to 'recorder' if not NULL
+int run_loop(Event_backend& backend, Input_recorder* recorder, Loop_stats& stats)
+{
+    Event_loop loop(backend);
+    loop.set_batched(true);
+    loop.set_recorder(recorder);
+    const int code = loop.run();
+    stats = loop.stats();
+    return code;
+}
+
+void record_and_replay(const std::vector<MSG>& script, const char* path)
+{
+    // Record the live run
+    std::vector<Dispatched> live;
+    Backend_headless backend([&live](HWND, UINT msg, WPARAM w, LPARAM l) -> LRESULT {
+        live.push_back({ msg, w, l });
+        return 0;
+    });
+    backend.post(script);
+    backend.post_quit(3);
+    Input_recorder recorder;
+    CHECK(recorder.open(path));
+    Loop_stats live_stats;
+    CHECK(run_loop(backend, &recorder, live_stats) == 3);
+    CHECK(recorder.messages() == script.size() + 1); // + WM_QUIT
+    std::printf("%llu messages recorded in %zu bytes (%.2f bytes per message), %llu coalesced\n",
+                (unsigned long long)recorder.messages(), recorder.bytes(),
+                double(recorder.bytes()) / double(recorder.messages()),
+                (unsigned long long)live_stats.coalesced);
+    recorder.close();
+
+    // Replay it
+    std::vector<Dispatched> replayed;
+    Input_log log;
+    CHECK(log.open(path));
+    Backend_replay replay(log, [&replayed](HWND, UINT msg, WPARAM w, LPARAM l) -> LRESULT {
+        replayed.push_back({ msg, w, l });
+        return 0;
+    }, Replay_speed::MAXIMUM);
+    Loop_stats replay_stats;
+    CHECK(run_loop(replay, nullptr, replay_stats) == 3);
+
+    CHECK(live_stats.coalesced > 0);
+    CHECK(replayed == live);
+    CHECK(replay_stats.messages == live_stats.messages);
+    CHECK(replay_stats.coalesced == live_stats.coalesced);
+    CHECK(replay.replayed() == script.size() + 1);
+}
+
+std::vector<uint8_t> read_file(const char* path)
+{
+    std::vector<uint8_t> bytes;
+    FILE* f = std::fopen(path, "rb");
+    CHECK(f != nullptr);
+    uint8_t buffer[4096];
+    for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), f)) > 0; ) {
+        bytes.insert(bytes.end(), buffer, buffer + n);
+    }
+    std::fclose(f);
+    return bytes;
+}
+
+void write_file(const char* path, const std::vector<uint8_t>& bytes)
+{
+    FILE* f = std::fopen(path, "wb");
+    CHECK(f != nullptr);
+    CHECK(std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size());
+    CHECK(std::fclose(f) == 0);
+}
+
+/// Bytes of the log of the first 'count' messages of 'script'
+std::vector<uint8_t> record(const std::vector<MSG>& script, std::size_t count, const char* path)
+{
+    Input_recorder recorder;
+    CHECK(recorder.open(path));
+    for (std::size_t i = 0; i < count; ++i) {
+        recorder.record(script[i]);
+    }
+    recorder.close();
+    return read_file(path);
+}
+
+/// Messages read from the log at 'path'
+std::size_t count_messages(const char* path, const std::vector<MSG>& script)
+{
+    Input_log log;
+    CHECK(log.open(path));
+    Recorded_message m;
+    std::size_t n = 0;
+    while (log.next(m)) {
+        CHECK(n < script.size());
+        CHECK(m.message == script[n].message && m.time == script[n].time);
+        CHECK(m.wParam == script[n].wParam && m.lParam == script[n].lParam);
+        n++;
+    }
+    return n;
+}
+
+void crashed_logs(const std::vector<MSG>& script, const char* path)
+{
+    const std::size_t WHOLE = 100;
+    const std::vector<uint8_t> head = record(script, WHOLE, path);
+    const std::vector<uint8_t> full = record(script, WHOLE + 1, path);
+    CHECK(full.size() > head.size() + 2);
+
+    // The file ends in the middle of a record
+    std::vector<uint8_t> bytes(full.begin(), full.end() - 1);
+    write_file(path, bytes);
+    CHECK(count_messages(path, script) == WHOLE);
+
+    // What a crash leaves in the mapped file: the first byte of the record
+    // is written last, the file was grown with zeros
+    bytes.assign(head.begin(), head.end());
+    bytes.push_back(0);
+    bytes.insert(bytes.end(), full.begin() + std::ptrdiff_t(head.size()) + 1, full.end() - 1);
+    bytes.resize(bytes.size() + 4096, 0);
+    write_file(path, bytes);
+    CHECK(count_messages(path, script) == WHOLE);
+
+    // The replay stops there too
+    Input_log log;
+    CHECK(log.open(path));
+    std::size_t dispatched = 0;
+    Backend_replay replay(log, [&dispatched](HWND, UINT, WPARAM, LPARAM) -> LRESULT {
+        dispatched++;
+        return 0;
+    }, Replay_speed::MAXIMUM);
+    Event_loop loop(replay);
+    CHECK(loop.run() == 0);
+    CHECK(replay.replayed() == WHOLE && dispatched == WHOLE);
+}
+
+/// @return seconds taken by the replay of 'script' at 'speed'
+double replay_seconds(const std::vector<MSG>& script, Replay_speed speed, const char* path)
+{
+    record(script, script.size(), path);
+    Input_log log;
+    CHECK(log.open(path));
+    Backend_replay replay(log, [](HWND, UINT, WPARAM, LPARAM) -> LRESULT { return 0; }, speed);
+    Event_loop loop(replay);
+    const Clock::time_point start = Clock::now();
+    CHECK(loop.run() == 0);
+    CHECK(replay.replayed() == script.size());
+    if (speed == Replay_speed::MAXIMUM) {
+        // The clock follows the messages
+        CHECK(replay.now_ms() == script.back().time);
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    const char* path = "test_input_log.wml";
+    varints();
+    record_and_replay(make_synthetic_stream(5000, nullptr, 3), path);
+    crashed_logs(make_synthetic_stream(200, nullptr, 4), path);
+
+    // 300 messages 1 ms apart
+    const std::vector<MSG> timed = make_synthetic_stream(300, nullptr, 5, 1);
+    const double span = double(timed.back().time - timed.front().time) / 1000.0;
+    const double recorded = replay_seconds(timed, Replay_speed::RECORDED, path);
+    const double maximum = replay_seconds(timed, Replay_speed::MAXIMUM, path);
+    std::printf("replay of %.3f s of input: recorded %.3f s, maximum %.3f s\n", span, recorded, maximum);
+    CHECK(recorded >= span * 0.95);
+    CHECK(maximum < span * 0.5);
+
+    std::remove(path);
+    return 0;
+}
@@ -0,0 +1,54 @@
+// A Job_system has one external thread at a time. The thread that creates
+// it isn't necessarily the one that drives it (Render_thread, the asset
+// reader): set_external_thread() hands it over, and the jobs run from the
+// new thread, with children, complete as before.
+
+#include "job_system.h"
+#include "check.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+// ****************************************************************************
+
+namespace {
+
+/// A parent with 'count' children, run and waited on by the calling thread
+int run_children(Job_system& jobs, int count)
+{
+    std::atomic<int> ran{0};
+    std::atomic<int>* counter = &ran;
+    Job* root = jobs.create([]() {});
+    for (int i = 0; i < count; ++i) {
+        jobs.run(jobs.create_child(root, [counter]() { counter->fetch_add(1); }));
+    }
+    jobs.run(root);
+    jobs.wait(root);
+    return ran.load();
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    Job_system jobs(2);
+    // This thread claims the system on first use
+    CHECK(run_children(jobs, 100) == 100);
+
+    // ... then hands it to another one, like Render_thread::start() again
+    int ran = 0;
+    std::thread other([&]() {
+        jobs.set_external_thread();
+        ran = run_children(jobs, 1000);
+    });
+    other.join();
+    CHECK(ran == 1000);
+
+    jobs.set_external_thread();
+    CHECK(run_children(jobs, 10) == 10);
+    std::printf("%llu jobs\n", (unsigned long long)jobs.stats().jobs);
+    return 0;
+}
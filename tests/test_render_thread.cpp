@@ -0,0 +1,127 @@
+// The render thread keeps producing frames while the UI thread is blocked
+// (what a modal loop, a dialog box or a drag resize does to wWinMain).
+// Frame_state::frame must advance during the block, and the input posted
+// just before it must still reach the render thread.
+// With Pacing::ON_DEMAND, a new status text alone triggers a frame, and a
+// streamed asset is uploaded to the end without any input (an upload
+// budget of 1 MB per frame: 8 frames).
+
+#include "render_thread.h"
+#include "window_manager.h"
+#include "check.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// ****************************************************************************
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/// Wait until the render thread published at least 'frame' frames
+bool wait_for_frame(Render_thread& render, uint64_t frame)
+{
+    const Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+    while (render.latest().frame < frame && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return render.latest().frame >= frame;
+}
+
+void status_wakes_on_demand()
+{
+    Window_manager windows(true);
+    Window_state* window = windows.create_headless(320, 240);
+    Render_thread render(windows, Frame_pacer(Pacing::ON_DEMAND));
+    render.start();
+
+    // The first frame, then nothing: no input
+    CHECK(wait_for_frame(render, 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const uint64_t idle = render.latest().frame;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(render.latest().frame == idle);
+
+    render.publish_status(*window, "status changed");
+    CHECK(wait_for_frame(render, idle + 1));
+    render.stop();
+}
+
+void streaming_on_demand()
+{
+    const char* path = "test_render_thread.asset";
+    std::vector<char> bytes(8 << 20, 1);
+    FILE* f = std::fopen(path, "wb");
+    CHECK(f != nullptr);
+    std::fwrite(bytes.data(), 1, bytes.size(), f);
+    std::fclose(f);
+
+    Window_manager windows(true);
+    windows.create_headless(320, 240);
+    Render_thread render(windows, Frame_pacer(Pacing::ON_DEMAND));
+    Upload_budget budget;
+    budget.bytes = 1 << 20;
+    std::atomic<std::size_t> uploaded{0};
+    std::atomic<bool> done{false};
+    {
+        Asset_streamer streamer;
+        render.set_streamer(&streamer, budget);
+        render.start();
+        CHECK(wait_for_frame(render, 1));
+
+        streamer.request(path, Stream_priority::NORMAL,
+            [&](const Stream_asset&, std::size_t, std::size_t size) { uploaded += size; },
+            [&](Stream_id, bool ok) { done = ok; });
+        const Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+        while (!done && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        render.stop();
+    }
+    std::remove(path);
+    CHECK(done);
+    CHECK(uploaded == bytes.size());
+    CHECK(render.stats().frames >= 1 + bytes.size() / budget.bytes);
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    Window_manager windows(true);
+    Window_state* window = windows.create_headless(320, 240);
+
+    Render_thread render(windows, Frame_pacer(Pacing::FIXED_HZ, 100));
+    render.start();
+
+    // Let the thread get going
+    CHECK(wait_for_frame(render, 3));
+
+    for (int i = 0; i < 10; ++i) {
+        render.post(*window, WM_MOUSEMOVE, 0, MAKELPARAM(10 + i, 20), 0);
+    }
+    render.post(*window, WM_KEYDOWN, VK_ESCAPE, 0, 0);
+    const uint64_t before = render.latest().frame;
+
+    // Blocked: no message pumped, nothing posted, nothing read
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    const Frame_state after = render.latest();
+    render.stop();
+    std::printf("%llu frames while the UI thread was blocked for 300 ms\n",
+                (unsigned long long)(after.frame - before));
+    // 30 frames are due at 100 Hz, leave room for a loaded machine
+    CHECK(after.frame >= before + 10);
+    CHECK(after.quit);
+    CHECK(render.stats().events == 11);
+
+    status_wakes_on_demand();
+    streaming_on_demand();
+    return 0;
+}
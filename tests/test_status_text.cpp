@@ -0,0 +1,155 @@
+// Status_text on the event loop hot path: once warmed up, a frame of mouse
+// and key messages that rewrite the status makes zero heap allocations
+// (counted by alloc_counter.h), the text is pushed at most once per frame
+// and identical texts are skipped. The loop is batched and the messages
+// arrive in bursts, as a fast mouse sends them: several updates land in
+// the same frame and must collapse into that one push.
+
+#include "status_text.h"
+#include "alloc_counter.h"
+#include "event_loop.h"
+#include "backend_headless.h"
+#include "input_state.h"
+#include "check.h"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+// ****************************************************************************
+
+namespace {
+
+const int SKIP_TEST = 77; // see SKIP_RETURN_CODE in CMakeLists.txt
+
+struct Window {
+    Status_text status;
+    Input_state input;
+    char shown[Status_text::Buffer::capacity() + 1];
+    unsigned long long pushes_this_frame = 0;
+    unsigned long long updates_this_frame = 0; ///< status rewritten
+};
+
+/// Plays a script like Backend_headless, but the queue looks empty after
+/// every 'burst' messages: a batched loop runs a frame per burst.
+/// Never allocates once constructed.
+class Burst_backend : public Event_backend {
+public:
+    typedef std::function<LRESULT(HWND, UINT, WPARAM, LPARAM)> Window_proc;
+
+    Burst_backend(const std::vector<MSG>& script, std::size_t burst, const Window_proc& proc)
+        : _script(script), _burst(burst), _proc(proc)
+    { }
+
+    bool peek(MSG& msg) override
+    {
+        if (_next == _script.size()) {
+            msg = MSG();
+            msg.message = WM_QUIT;
+            return true;
+        }
+        if (_peeked == _burst) {
+            _peeked = 0;
+            return false;
+        }
+        _peeked++;
+        msg = _script[_next++];
+        return true;
+    }
+
+    void dispatch(MSG& msg) override { _proc(msg.hwnd, msg.message, msg.wParam, msg.lParam); }
+    void wait(double) override { }
+    DWORD now_ms() const override { return _next ? _script[_next - 1].time : 0; }
+
+private:
+    std::vector<MSG> _script;
+    std::size_t _burst;
+    Window_proc _proc;
+    std::size_t _next = 0;
+    std::size_t _peeked = 0;
+};
+
+void push(void* target, const char* text)
+{
+    Window* w = static_cast<Window*>(target);
+    std::strcpy(w->shown, text);
+    w->pushes_this_frame++;
+}
+
+}// END Anonymous namespace
+
+// ****************************************************************************
+
+int main()
+{
+    if (!alloc_counter_enabled()) {
+        std::printf("ENABLE_ALLOC_COUNTER is not defined, nothing to count\n");
+        return SKIP_TEST;
+    }
+
+    const std::size_t MESSAGES = 20000;
+    const std::size_t WARM_UP_FRAMES = 10;
+    const std::size_t BURST = 8;
+
+    Window window;
+    input_reset(window.input);
+
+    // Same work as event_handler(): update the input snapshot and rewrite
+    // the status on clicks, moves and keys. The script is built up front:
+    // the loop must not allocate.
+    Burst_backend backend(make_synthetic_stream(MESSAGES, nullptr, 5), BURST,
+                          [&window](HWND, UINT msg, WPARAM w, LPARAM l) -> LRESULT {
+        input_on_message(window.input, msg, w, l);
+        const POINTS p = MAKEPOINTS(l);
+        if (msg == WM_LBUTTONDOWN) {
+            window.updates_this_frame++;
+            window.status.begin()
+                .append("Left mouse button down. ")
+                .append(" x: ").append(p.x)
+                .append(" y: ").append(p.y);
+        } else if (msg == WM_MOUSEMOVE) {
+            // Mostly the same text: exercises the skip
+            window.updates_this_frame++;
+            window.status.begin().append("Mouse over the window");
+        } else if (msg == WM_KEYDOWN) {
+            window.updates_this_frame++;
+            window.status.begin().append("Key down: ").append(char(w));
+        }
+        return 0;
+    });
+
+    std::size_t frames = 0;
+    std::size_t busy_frames = 0; // frames with several status updates
+    unsigned long long before = 0;
+    Event_loop loop(backend);
+    loop.set_batched(true);
+    loop.set_frame_callback([&]() {
+        window.pushes_this_frame = 0;
+        window.status.flush(push, &window);
+        CHECK(window.pushes_this_frame <= 1);
+        if (window.updates_this_frame > 1) {
+            busy_frames++;
+        }
+        window.updates_this_frame = 0;
+        input_end_frame(window.input);
+        if (++frames == WARM_UP_FRAMES) {
+            before = heap_allocation_count();
+        }
+        return true;
+    });
+    CHECK(loop.run() == 0);
+
+    const unsigned long long allocations = heap_allocation_count() - before;
+    std::printf("%zu frames (%zu with several status updates), %llu messages, %llu pushes, %llu skipped,"
+                " %llu heap allocations\n",
+                frames, busy_frames, (unsigned long long)loop.stats().messages,
+                window.status.pushes(), window.status.skipped(), allocations);
+    CHECK(frames > WARM_UP_FRAMES);
+    CHECK(busy_frames > 0);
+    CHECK(window.status.pushes() <= frames);
+    CHECK(allocations == 0);
+    CHECK(window.status.pushes() > 0 && window.status.skipped() > 0);
+    CHECK(std::strcmp(window.shown, window.status.current()) == 0);
+    return 0;
+}